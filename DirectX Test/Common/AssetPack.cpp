@@ -0,0 +1,701 @@
+//***************************************************************************************
+// AssetPack.cpp
+//***************************************************************************************
+
+#include "AssetPack.h"
+#include "Hash.h"
+#include "Lz4.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#ifndef _WIN32
+#include <codecvt>
+#include <locale>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	std::uint64_t AlignUp(std::uint64_t x, std::uint64_t alignment)
+	{
+		return (x + alignment - 1) / alignment * alignment;
+	}
+
+	template<typename T>
+	T MathMin(const T& a, const T& b)
+	{
+		return a < b ? a : b;
+	}
+
+#ifdef _WIN32
+	// The Windows file streams take wide paths directly.
+	const std::wstring& NativePath(const std::wstring& path)
+	{
+		return path;
+	}
+#else
+	std::string NativePath(const std::wstring& path)
+	{
+		std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
+		return convert.to_bytes(path);
+	}
+#endif
+
+	// True if count elements of elementSize bytes starting at offset fit in fileSize
+	// bytes.  Written so that no corrupt value can overflow it.
+	bool InFile(std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t fileSize)
+	{
+		return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+	}
+
+	// Checks the chunk table of a compressed payload against the entry and fills in the
+	// start offset of every chunk inside the payload, plus the end of the last one.
+	bool ReadChunkTable(const std::uint8_t* data, const AssetPackEntry& entry, std::vector<std::uint64_t>& offsets)
+	{
+		if (entry.StoredSize < sizeof(AssetPackChunkHeader))
+			return false;
+
+		const AssetPackChunkHeader* chunks = (const AssetPackChunkHeader*)data;
+		const std::uint32_t* storedSizes = (const std::uint32_t*)(chunks + 1);
+		const std::uint64_t chunkCount = chunks->ChunkCount;
+		const std::uint64_t chunkSize = chunks->ChunkSize;
+
+		if (chunkSize == 0 ||
+			chunkCount != entry.RawSize / chunkSize + (entry.RawSize % chunkSize != 0 ? 1 : 0) ||
+			!InFile(sizeof(AssetPackChunkHeader), chunkCount, sizeof(std::uint32_t), entry.StoredSize))
+			return false;
+
+		offsets.resize((size_t)chunkCount + 1);
+		offsets[0] = sizeof(AssetPackChunkHeader) + chunkCount * sizeof(std::uint32_t);
+		for (std::uint64_t i = 0; i < chunkCount; ++i)
+		{
+			offsets[i + 1] = offsets[i] + (storedSizes[i] & ~AssetPackChunkHeader::StoredRawBit);
+			if (offsets[i + 1] > entry.StoredSize)
+				return false;
+		}
+		return true;
+	}
+
+	bool ReadWholeFile(const std::wstring& path, std::vector<std::uint8_t>& data)
+	{
+		std::ifstream fin(NativePath(path), std::ios::binary);
+		if (!fin)
+			return false;
+
+		fin.seekg(0, std::ios_base::end);
+		std::streamoff size = fin.tellg();
+		fin.seekg(0, std::ios_base::beg);
+
+		data.resize((size_t)size);
+		fin.read((char*)data.data(), size);
+		return (bool)fin;
+	}
+}
+
+AssetPack::AssetPack()
+{
+}
+
+AssetPack::~AssetPack()
+{
+	Close();
+
+	{
+		std::lock_guard<std::mutex> lock(mWorkerMutex);
+		mStopping = true;
+	}
+	mJobPosted.notify_all();
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+bool AssetPack::Open(const std::wstring& filename)
+{
+	Close();
+
+#ifdef _WIN32
+	mFile = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size) || (std::uint64_t)size.QuadPart < sizeof(AssetPackHeader))
+	{
+		Close();
+		return false;
+	}
+	mSize = (std::uint64_t)size.QuadPart;
+
+	mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	mBase = (const std::uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+	if (mBase == nullptr)
+	{
+		Close();
+		return false;
+	}
+#else
+	int file = open(NativePath(filename).c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || (std::uint64_t)info.st_size < sizeof(AssetPackHeader))
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping keeps the file alive after the descriptor is closed.
+	void* base = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (base == MAP_FAILED)
+		return false;
+
+	mBase = (const std::uint8_t*)base;
+	mSize = (std::uint64_t)info.st_size;
+#endif
+
+	mHeader = (const AssetPackHeader*)mBase;
+	if (!Validate())
+	{
+		Close();
+		return false;
+	}
+
+	mEntries = (const AssetPackEntry*)(mBase + mHeader->TocOffset);
+	mSeeds = (const std::uint32_t*)(mBase + mHeader->SeedOffset);
+	mSlots = (const std::uint32_t*)(mBase + mHeader->SlotOffset);
+	mNames = (const char*)(mBase + mHeader->NameOffset);
+
+	return true;
+}
+
+bool AssetPack::Validate()const
+{
+	const AssetPackHeader& header = *mHeader;
+	if (header.Magic != AssetPackHeader::MagicValue ||
+		header.Version == 0 || header.Version > AssetPackHeader::CurrentVersion ||
+		header.TocOffset % alignof(AssetPackEntry) != 0 ||
+		header.SeedOffset % sizeof(std::uint32_t) != 0 ||
+		header.SlotOffset % sizeof(std::uint32_t) != 0 ||
+		!InFile(header.TocOffset, header.EntryCount, sizeof(AssetPackEntry), mSize) ||
+		!InFile(header.SeedOffset, header.BucketCount, sizeof(std::uint32_t), mSize) ||
+		!InFile(header.SlotOffset, header.EntryCount, sizeof(std::uint32_t), mSize) ||
+		!InFile(header.DataOffset, header.DataSize, 1, mSize) ||
+		header.NameOffset > header.DataOffset ||
+		(header.EntryCount > 0 && header.BucketCount == 0))
+		return false;
+
+	// Names sit between the name offset and the payloads.
+	const AssetPackEntry* entries = (const AssetPackEntry*)(mBase + header.TocOffset);
+	const char* names = (const char*)(mBase + header.NameOffset);
+	const std::uint64_t namesSize = header.DataOffset - header.NameOffset;
+
+	std::vector<std::uint64_t> chunkOffsets;
+	for (std::uint32_t i = 0; i < header.EntryCount; ++i)
+	{
+		const AssetPackEntry& entry = entries[i];
+
+		if (!InFile(entry.Offset, entry.StoredSize, 1, mSize))
+			return false;
+
+		if (entry.NameOffset >= namesSize ||
+			memchr(names + entry.NameOffset, '\0', (size_t)(namesSize - entry.NameOffset)) == nullptr)
+			return false;
+
+		if ((entry.Flags & AssetPackFlag_Lz4) == 0)
+		{
+			if (entry.RawSize != entry.StoredSize)
+				return false;
+		}
+		else if (entry.Offset % alignof(AssetPackChunkHeader) != 0 ||
+			!ReadChunkTable(mBase + entry.Offset, entry, chunkOffsets))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AssetPack::Close()
+{
+#ifdef _WIN32
+	if (mBase != nullptr)
+		UnmapViewOfFile(mBase);
+	if (mMapping != nullptr)
+		CloseHandle(mMapping);
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = nullptr;
+#else
+	if (mBase != nullptr)
+		munmap((void*)mBase, (size_t)mSize);
+#endif
+	mBase = nullptr;
+	mSize = 0;
+	mHeader = nullptr;
+	mEntries = nullptr;
+	mSeeds = nullptr;
+	mSlots = nullptr;
+	mNames = nullptr;
+}
+
+bool AssetPack::IsOpen()const
+{
+	return mBase != nullptr;
+}
+
+const AssetPackEntry* AssetPack::Find(const std::string& name)const
+{
+	if (!IsOpen() || mHeader->EntryCount == 0)
+		return nullptr;
+
+	std::string normalized = NormalizeName(name);
+	std::uint64_t hash = HashName(normalized);
+
+	std::uint32_t seed = mSeeds[hash % mHeader->BucketCount];
+	std::uint32_t index = mSlots[Slot(hash, seed, mHeader->EntryCount)];
+	if (index >= mHeader->EntryCount)
+		return nullptr;
+
+	// The perfect hash only covers names that are in the pack, so confirm the hit.
+	const AssetPackEntry& entry = mEntries[index];
+	if (entry.NameHash != hash || normalized != mNames + entry.NameOffset)
+		return nullptr;
+
+	return &entry;
+}
+
+std::string AssetPack::GetName(const AssetPackEntry& entry)const
+{
+	return std::string(mNames + entry.NameOffset);
+}
+
+const std::uint8_t* AssetPack::GetData(const AssetPackEntry& entry)const
+{
+	return mBase + entry.Offset;
+}
+
+struct AssetPack::DecodeJob
+{
+	const AssetPackEntry* Entry = nullptr;
+	const std::uint8_t* Data = nullptr;
+	const std::uint64_t* Offsets = nullptr;
+	std::uint8_t* Dst = nullptr;
+	std::uint32_t ChunkCount = 0;
+	std::uint64_t ChunkSize = 0;
+
+	std::atomic<std::uint32_t> NextChunk{ 0 };
+	std::atomic<bool> Succeeded{ true };
+};
+
+bool AssetPack::Decode(const AssetPackEntry& entry, std::uint8_t* dst)
+{
+	const std::uint8_t* data = GetData(entry);
+
+	if ((entry.Flags & AssetPackFlag_Lz4) == 0)
+	{
+		memcpy(dst, data, (size_t)entry.RawSize);
+		return true;
+	}
+
+	// Open has checked the table; this only recovers the chunk offsets.
+	std::vector<std::uint64_t> offsets;
+	if (!ReadChunkTable(data, entry, offsets))
+		return false;
+
+	DecodeJob job;
+	job.Entry = &entry;
+	job.Data = data;
+	job.Offsets = offsets.data();
+	job.Dst = dst;
+	job.ChunkCount = ((const AssetPackChunkHeader*)data)->ChunkCount;
+	job.ChunkSize = ((const AssetPackChunkHeader*)data)->ChunkSize;
+
+	std::lock_guard<std::mutex> decodeLock(mDecodeMutex);
+
+	// The calling thread takes a share of the chunks too, so a single chunk never waits
+	// for a worker to wake up.
+	if (job.ChunkCount > 1)
+	{
+		if (mWorkers.empty())
+		{
+			for (std::uint32_t i = 1; i < std::thread::hardware_concurrency(); ++i)
+				mWorkers.emplace_back(&AssetPack::WorkerMain, this);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mWorkerMutex);
+			mJob = &job;
+			++mJobSerial;
+			mBusyWorkers = (std::uint32_t)mWorkers.size();
+		}
+		mJobPosted.notify_all();
+	}
+
+	RunDecodeJob(job);
+
+	// The job lives on this stack, so every worker must be done with it.
+	std::unique_lock<std::mutex> lock(mWorkerMutex);
+	mJobFinished.wait(lock, [this]() { return mBusyWorkers == 0; });
+	mJob = nullptr;
+
+	return job.Succeeded;
+}
+
+void AssetPack::RunDecodeJob(DecodeJob& job)
+{
+	const std::uint32_t* storedSizes = (const std::uint32_t*)(job.Data + sizeof(AssetPackChunkHeader));
+
+	for (std::uint32_t i = job.NextChunk++; i < job.ChunkCount; i = job.NextChunk++)
+	{
+		std::uint64_t rawOffset = i * job.ChunkSize;
+		size_t rawSize = (size_t)MathMin(job.ChunkSize, job.Entry->RawSize - rawOffset);
+		size_t storedSize = (size_t)(job.Offsets[i + 1] - job.Offsets[i]);
+		const std::uint8_t* src = job.Data + job.Offsets[i];
+
+		bool ok;
+		if (storedSizes[i] & AssetPackChunkHeader::StoredRawBit)
+		{
+			ok = storedSize == rawSize;
+			if (ok)
+				memcpy(job.Dst + rawOffset, src, rawSize);
+		}
+		else
+		{
+			ok = Lz4::Decompress(src, storedSize, job.Dst + rawOffset, rawSize);
+		}
+
+		if (!ok)
+			job.Succeeded = false;
+	}
+}
+
+void AssetPack::WorkerMain()
+{
+	std::uint64_t lastSerial = 0;
+	for (;;)
+	{
+		DecodeJob* job;
+		{
+			std::unique_lock<std::mutex> lock(mWorkerMutex);
+			mJobPosted.wait(lock, [&]() { return mStopping || mJobSerial != lastSerial; });
+			if (mStopping)
+				return;
+
+			lastSerial = mJobSerial;
+			job = mJob;
+		}
+
+		RunDecodeJob(*job);
+
+		{
+			std::lock_guard<std::mutex> lock(mWorkerMutex);
+			--mBusyWorkers;
+		}
+		mJobFinished.notify_one();
+	}
+}
+
+std::uint32_t AssetPack::GetEntryCount()const
+{
+	return mHeader != nullptr ? mHeader->EntryCount : 0;
+}
+
+const AssetPackEntry* AssetPack::GetEntries()const
+{
+	return mEntries;
+}
+
+void AssetPack::Prefetch()const
+{
+	if (!IsOpen() || mHeader->DataSize == 0)
+		return;
+
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (PVOID)(mBase + mHeader->DataOffset);
+	range.NumberOfBytes = (SIZE_T)mHeader->DataSize;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	// madvise wants a page aligned start.
+	const std::uint64_t pageSize = (std::uint64_t)sysconf(_SC_PAGESIZE);
+	const std::uint64_t begin = mHeader->DataOffset / pageSize * pageSize;
+	madvise((void*)(mBase + begin), (size_t)(mHeader->DataOffset + mHeader->DataSize - begin), MADV_WILLNEED);
+#endif
+}
+
+std::string AssetPack::NormalizeName(const std::string& name)
+{
+	std::string result = name;
+	for (char& c : result)
+	{
+		if (c == '\\')
+			c = '/';
+		else if (c >= 'A' && c <= 'Z')
+			c = (char)(c - 'A' + 'a');
+	}
+	return result;
+}
+
+std::uint64_t AssetPack::HashName(const std::string& normalizedName)
+{
+	return Fnv1a(normalizedName.data(), normalizedName.size());
+}
+
+std::uint32_t AssetPack::Slot(std::uint64_t hash, std::uint32_t seed, std::uint32_t count)
+{
+	// Remix the name hash with the bucket seed (splitmix64 finaliser).
+	std::uint64_t x = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ull;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBull;
+	x ^= x >> 31;
+	return (std::uint32_t)(x % count);
+}
+
+void AssetPackBuilder::AddFile(const std::string& name, const std::wstring& path, bool compress)
+{
+	Item item;
+	item.Name = AssetPack::NormalizeName(name);
+	item.Path = path;
+	item.Compress = compress;
+	mItems.push_back(std::move(item));
+}
+
+void AssetPackBuilder::AddMemory(const std::string& name, std::vector<std::uint8_t> data, bool compress)
+{
+	Item item;
+	item.Name = AssetPack::NormalizeName(name);
+	item.Data = std::move(data);
+	item.Compress = compress;
+	mItems.push_back(std::move(item));
+}
+
+bool AssetPackBuilder::CompressChunks(const std::vector<std::uint8_t>& raw, std::vector<std::uint8_t>& stored)
+{
+	const std::uint32_t chunkCount = (std::uint32_t)((raw.size() + AssetPack::ChunkSize - 1) / AssetPack::ChunkSize);
+
+	AssetPackChunkHeader header;
+	header.ChunkCount = chunkCount;
+	header.ChunkSize = AssetPack::ChunkSize;
+
+	std::vector<std::uint32_t> storedSizes(chunkCount);
+	std::vector<std::uint8_t> body;
+	std::vector<std::uint8_t> scratch(Lz4::CompressBound(AssetPack::ChunkSize));
+
+	for (std::uint32_t i = 0; i < chunkCount; ++i)
+	{
+		size_t offset = (size_t)i * AssetPack::ChunkSize;
+		size_t size = MathMin<size_t>(AssetPack::ChunkSize, raw.size() - offset);
+
+		size_t compressed = Lz4::Compress(raw.data() + offset, size, scratch.data(), scratch.size());
+		if (compressed > 0 && compressed < size)
+		{
+			storedSizes[i] = (std::uint32_t)compressed;
+			body.insert(body.end(), scratch.begin(), scratch.begin() + compressed);
+		}
+		else
+		{
+			storedSizes[i] = (std::uint32_t)size | AssetPackChunkHeader::StoredRawBit;
+			body.insert(body.end(), raw.begin() + offset, raw.begin() + offset + size);
+		}
+	}
+
+	stored.resize(sizeof(header) + storedSizes.size() * sizeof(std::uint32_t));
+	memcpy(stored.data(), &header, sizeof(header));
+	memcpy(stored.data() + sizeof(header), storedSizes.data(), storedSizes.size() * sizeof(std::uint32_t));
+	stored.insert(stored.end(), body.begin(), body.end());
+
+	// Only worth it if the disk reads shrink.
+	return stored.size() < raw.size();
+}
+
+bool AssetPackBuilder::Write(const std::wstring& filename)
+{
+	const std::uint32_t count = (std::uint32_t)mItems.size();
+
+	std::vector<std::uint32_t> flags(count, AssetPackFlag_None);
+	std::vector<std::uint64_t> rawSizes(count);
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		Item& item = mItems[i];
+		if (!item.Path.empty() && !ReadWholeFile(item.Path, item.Data))
+			return false;
+
+		rawSizes[i] = item.Data.size();
+
+		std::vector<std::uint8_t> stored;
+		if (item.Compress && CompressChunks(item.Data, stored))
+		{
+			item.Data = std::move(stored);
+			flags[i] = AssetPackFlag_Lz4;
+		}
+	}
+
+	//
+	// Table of contents, sorted by name hash.
+	//
+
+	std::vector<AssetPackEntry> entries(count);
+	std::vector<std::uint32_t> tocToItem(count);
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		entries[i].NameHash = AssetPack::HashName(mItems[i].Name);
+		entries[i].StoredSize = mItems[i].Data.size();
+		entries[i].RawSize = rawSizes[i];
+		entries[i].Flags = flags[i];
+		tocToItem[i] = i;
+	}
+
+	std::sort(tocToItem.begin(), tocToItem.end(), [&](std::uint32_t a, std::uint32_t b)
+	{
+		return entries[a].NameHash < entries[b].NameHash;
+	});
+
+	std::vector<AssetPackEntry> toc(count);
+	for (std::uint32_t i = 0; i < count; ++i)
+		toc[i] = entries[tocToItem[i]];
+
+	for (std::uint32_t i = 1; i < count; ++i)
+	{
+		if (toc[i].NameHash == toc[i - 1].NameHash)
+			return false;
+	}
+
+	//
+	// Perfect hash (hash and displace): every bucket gets the first seed that sends all
+	// of its names to free slots.  Largest buckets are placed first.
+	//
+
+	const std::uint32_t bucketCount = count > 0 ? count : 1;
+	std::vector<std::vector<std::uint32_t>> buckets(bucketCount);
+	for (std::uint32_t i = 0; i < count; ++i)
+		buckets[toc[i].NameHash % bucketCount].push_back(i);
+
+	std::vector<std::uint32_t> bucketOrder(bucketCount);
+	for (std::uint32_t i = 0; i < bucketCount; ++i)
+		bucketOrder[i] = i;
+	std::sort(bucketOrder.begin(), bucketOrder.end(), [&](std::uint32_t a, std::uint32_t b)
+	{
+		return buckets[a].size() > buckets[b].size();
+	});
+
+	std::vector<std::uint32_t> seeds(bucketCount, 0);
+	std::vector<std::uint32_t> slots(count, UINT32_MAX);
+	std::vector<std::uint32_t> candidate;
+
+	for (std::uint32_t b : bucketOrder)
+	{
+		if (buckets[b].empty())
+			break;
+
+		bool placed = false;
+		for (std::uint32_t seed = 1; seed < (1u << 24) && !placed; ++seed)
+		{
+			candidate.clear();
+			placed = true;
+			for (std::uint32_t tocIndex : buckets[b])
+			{
+				std::uint32_t slot = AssetPack::Slot(toc[tocIndex].NameHash, seed, count);
+				if (slots[slot] != UINT32_MAX ||
+					std::find(candidate.begin(), candidate.end(), slot) != candidate.end())
+				{
+					placed = false;
+					break;
+				}
+				candidate.push_back(slot);
+			}
+
+			if (placed)
+			{
+				seeds[b] = seed;
+				for (size_t k = 0; k < candidate.size(); ++k)
+					slots[candidate[k]] = buckets[b][k];
+			}
+		}
+
+		if (!placed)
+			return false;
+	}
+
+	//
+	// Names and offsets.
+	//
+
+	std::vector<char> names;
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		const std::string& name = mItems[tocToItem[i]].Name;
+		toc[i].NameOffset = (std::uint32_t)names.size();
+		names.insert(names.end(), name.begin(), name.end());
+		names.push_back('\0');
+	}
+
+	AssetPackHeader header;
+	header.EntryCount = count;
+	header.BucketCount = bucketCount;
+	header.TocOffset = sizeof(AssetPackHeader);
+	header.SeedOffset = header.TocOffset + count * sizeof(AssetPackEntry);
+	header.SlotOffset = header.SeedOffset + bucketCount * sizeof(std::uint32_t);
+	header.NameOffset = header.SlotOffset + count * sizeof(std::uint32_t);
+	header.DataOffset = AlignUp(header.NameOffset + names.size(), AssetPack::PayloadAlignment);
+
+	// Payloads go in insertion order so a level streams front to back.
+	std::vector<std::uint32_t> itemToToc(count);
+	for (std::uint32_t i = 0; i < count; ++i)
+		itemToToc[tocToItem[i]] = i;
+
+	std::uint64_t offset = header.DataOffset;
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		AssetPackEntry& entry = toc[itemToToc[i]];
+		entry.Offset = offset;
+		offset = AlignUp(offset + entry.StoredSize, AssetPack::PayloadAlignment);
+	}
+	header.DataSize = offset - header.DataOffset;
+
+	//
+	// Write it out.
+	//
+
+	std::ofstream fout(NativePath(filename), std::ios::binary | std::ios::trunc);
+	if (!fout)
+		return false;
+
+	const char zeros[AssetPack::PayloadAlignment] = {};
+
+	fout.write((const char*)&header, sizeof(header));
+	fout.write((const char*)toc.data(), toc.size() * sizeof(AssetPackEntry));
+	fout.write((const char*)seeds.data(), seeds.size() * sizeof(std::uint32_t));
+	fout.write((const char*)slots.data(), slots.size() * sizeof(std::uint32_t));
+	fout.write(names.data(), names.size());
+	fout.write(zeros, (std::streamsize)(header.DataOffset - (header.NameOffset + names.size())));
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		const AssetPackEntry& entry = toc[itemToToc[i]];
+		const std::vector<std::uint8_t>& data = mItems[i].Data;
+		fout.write((const char*)data.data(), data.size());
+		fout.write(zeros, (std::streamsize)(AlignUp(entry.StoredSize, AssetPack::PayloadAlignment) - entry.StoredSize));
+	}
+
+	return (bool)fout;
+}
@@ -0,0 +1,199 @@
+//***************************************************************************************
+// AssetPack.h
+//
+// Binary pack file holding many assets so that a level loads with a few large
+// sequential reads instead of one open/seek per loose file.
+//
+// File layout (all offsets are absolute, little endian):
+//   AssetPackHeader
+//   AssetPackEntry[EntryCount]   table of contents sorted by NameHash
+//   uint32 Seeds[BucketCount]    perfect hash displacement per bucket
+//   uint32 Slots[EntryCount]     perfect hash slot -> table of contents index
+//   char   Names[]               zero terminated, normalised entry names
+//   payloads                     each starting on a 4 KiB boundary
+//
+// Compressed payloads (AssetPackFlag_Lz4) are split into independent chunks of
+// AssetPack::ChunkSize raw bytes so they can be decoded on several threads:
+//   AssetPackChunkHeader
+//   uint32 ChunkStoredSize[ChunkCount]   high bit set = chunk stored uncompressed
+//   chunk data, back to back
+//
+// Names are normalised to lower case with '/' separators before hashing, so lookups
+// behave like the case-insensitive file system they replace.
+//
+// AssetPack maps the file into memory and resolves names through the perfect hash
+// (one bucket read, one slot read, one name compare).  Compressed entries are decoded
+// by a pool of worker threads that the pack starts on first use and keeps until it is
+// destroyed.  Open checks every table, entry
+// and chunk table against the file size, so a truncated or corrupt pack fails to open
+// instead of reading past the mapping.  AssetPackBuilder writes packs and is shared by
+// the game and the AssetPacker tool.
+//***************************************************************************************
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum AssetPackFlags : std::uint32_t
+{
+	// Payload is stored as-is.
+	AssetPackFlag_None = 0,
+
+	// Payload is a chunk table followed by LZ4 blocks.
+	AssetPackFlag_Lz4 = 1 << 0,
+};
+
+struct AssetPackHeader
+{
+	static const std::uint32_t MagicValue = 0x4B415041; // "APAK"
+	static const std::uint32_t CurrentVersion = 2;
+
+	std::uint32_t Magic = MagicValue;
+	std::uint32_t Version = CurrentVersion;
+	std::uint32_t EntryCount = 0;
+	std::uint32_t BucketCount = 0;
+	std::uint64_t TocOffset = 0;
+	std::uint64_t SeedOffset = 0;
+	std::uint64_t SlotOffset = 0;
+	std::uint64_t NameOffset = 0;
+	std::uint64_t DataOffset = 0;
+	std::uint64_t DataSize = 0;
+};
+
+struct AssetPackEntry
+{
+	std::uint64_t NameHash = 0;
+
+	// Absolute offset of the payload, always a multiple of AssetPack::PayloadAlignment.
+	std::uint64_t Offset = 0;
+
+	// Bytes stored in the file and bytes after decoding.  Equal for uncompressed entries.
+	std::uint64_t StoredSize = 0;
+	std::uint64_t RawSize = 0;
+
+	// Offset of the zero terminated name relative to AssetPackHeader::NameOffset.
+	std::uint32_t NameOffset = 0;
+
+	// Combination of AssetPackFlags.
+	std::uint32_t Flags = AssetPackFlag_None;
+};
+
+struct AssetPackChunkHeader
+{
+	static const std::uint32_t StoredRawBit = 0x80000000;
+
+	std::uint32_t ChunkCount = 0;
+	std::uint32_t ChunkSize = 0;
+};
+
+class AssetPack
+{
+public:
+
+	static const std::uint64_t PayloadAlignment = 4096;
+	static const std::uint32_t ChunkSize = 256 * 1024;
+
+	AssetPack();
+	AssetPack(const AssetPack& rhs) = delete;
+	AssetPack& operator=(const AssetPack& rhs) = delete;
+	~AssetPack();
+
+	// Maps the pack into memory.  Returns false if the file is missing or malformed.
+	bool Open(const std::wstring& filename);
+	void Close();
+	bool IsOpen()const;
+
+	// Returns nullptr if the pack has no entry with this name.
+	const AssetPackEntry* Find(const std::string& name)const;
+
+	std::string GetName(const AssetPackEntry& entry)const;
+
+	// Stored bytes of the entry.  Only usable directly when entry.Flags is None.
+	const std::uint8_t* GetData(const AssetPackEntry& entry)const;
+
+	// Writes entry.RawSize decoded bytes to dst, decompressing chunks on the worker
+	// threads.  dst may be any memory the CPU can read back, such as a mapped upload
+	// buffer in a write-back heap.  Returns false if the payload is corrupt.
+	bool Decode(const AssetPackEntry& entry, std::uint8_t* dst);
+
+	std::uint32_t GetEntryCount()const;
+	const AssetPackEntry* GetEntries()const;
+
+	// Asks the OS to read the whole payload region in one sequential pass, so the
+	// per-entry accesses that follow hit memory instead of the disk.
+	void Prefetch()const;
+
+	static std::string NormalizeName(const std::string& name);
+	static std::uint64_t HashName(const std::string& normalizedName);
+	static std::uint32_t Slot(std::uint64_t hash, std::uint32_t seed, std::uint32_t count);
+
+private:
+
+	struct DecodeJob;
+
+	bool Validate()const;
+
+	void WorkerMain();
+	static void RunDecodeJob(DecodeJob& job);
+
+private:
+
+#ifdef _WIN32
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+#endif
+	const std::uint8_t* mBase = nullptr;
+	std::uint64_t mSize = 0;
+
+	const AssetPackHeader* mHeader = nullptr;
+	const AssetPackEntry* mEntries = nullptr;
+	const std::uint32_t* mSeeds = nullptr;
+	const std::uint32_t* mSlots = nullptr;
+	const char* mNames = nullptr;
+
+	// One Decode at a time hands its chunks to the workers through mJob.
+	std::mutex mDecodeMutex;
+	std::mutex mWorkerMutex;
+	std::condition_variable mJobPosted;
+	std::condition_variable mJobFinished;
+	DecodeJob* mJob = nullptr;
+	std::uint64_t mJobSerial = 0;
+	std::uint32_t mBusyWorkers = 0;
+	bool mStopping = false;
+	std::vector<std::thread> mWorkers;
+};
+
+class AssetPackBuilder
+{
+public:
+
+	// Payloads are written in the order they are added, so add them in load order.
+	// Compressed entries fall back to raw storage when LZ4 does not make them smaller.
+	void AddFile(const std::string& name, const std::wstring& path, bool compress = false);
+	void AddMemory(const std::string& name, std::vector<std::uint8_t> data, bool compress = false);
+
+	// Returns false if a file cannot be read or written, or if two names collide.
+	bool Write(const std::wstring& filename);
+
+private:
+
+	struct Item
+	{
+		std::string Name;
+		std::wstring Path;
+		std::vector<std::uint8_t> Data;
+		bool Compress = false;
+	};
+
+	static bool CompressChunks(const std::vector<std::uint8_t>& raw, std::vector<std::uint8_t>& stored);
+
+	std::vector<Item> mItems;
+};
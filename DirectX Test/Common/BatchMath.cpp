@@ -0,0 +1,248 @@
+//***************************************************************************************
+// BatchMath.cpp
+//***************************************************************************************
+
+#include "BatchMath.h"
+#include "CpuFeatures.h"
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BATCH_MATH_SSE2 1
+#define BATCH_MATH_AVX2 1
+#define BATCH_MATH_AVX512 1
+#include <immintrin.h>
+#endif
+
+// MSVC emits any intrinsic whatever /arch says; GCC and Clang have to be told which
+// functions may use the wider instruction sets.
+#if defined(__clang__)
+#define BATCH_MATH_TARGET_BEGIN(isa) _Pragma("clang attribute push (__attribute__((target(" #isa "))), apply_to = function)")
+#define BATCH_MATH_TARGET_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define BATCH_MATH_PRAGMA(x) _Pragma(#x)
+#define BATCH_MATH_TARGET_BEGIN(isa) _Pragma("GCC push_options") BATCH_MATH_PRAGMA(GCC target(isa))
+#define BATCH_MATH_TARGET_END _Pragma("GCC pop_options")
+#else
+#define BATCH_MATH_TARGET_BEGIN(isa)
+#define BATCH_MATH_TARGET_END
+#endif
+
+namespace Scalar
+{
+	struct Lanes
+	{
+		typedef float Vector;
+		typedef bool Mask;
+		static const size_t Width = 1;
+
+		static Vector Load(const float* p) { return *p; }
+		static void Store(float* p, Vector v) { *p = v; }
+		static Vector Set1(float v) { return v; }
+		static Vector Add(Vector a, Vector b) { return a + b; }
+		static Vector Sub(Vector a, Vector b) { return a - b; }
+		static Vector Mul(Vector a, Vector b) { return a * b; }
+		static Vector Div(Vector a, Vector b) { return a / b; }
+		static Vector MulAdd(Vector a, Vector b, Vector c) { return a * b + c; }
+		static Vector Min(Vector a, Vector b) { return b < a ? b : a; }
+		static Vector Max(Vector a, Vector b) { return b > a ? b : a; }
+		static Vector Sqrt(Vector a) { return sqrtf(a); }
+		static Vector Abs(Vector a) { return fabsf(a); }
+		static Mask Less(Vector a, Vector b) { return a < b; }
+		static Mask Greater(Vector a, Vector b) { return a > b; }
+		static Vector Select(Mask m, Vector a, Vector b) { return m ? a : b; }
+	};
+
+#include "BatchMathKernels.inl"
+}
+
+#if BATCH_MATH_SSE2
+namespace Sse2
+{
+	struct Lanes
+	{
+		typedef __m128 Vector;
+		typedef __m128 Mask;
+		static const size_t Width = 4;
+
+		static Vector Load(const float* p) { return _mm_loadu_ps(p); }
+		static void Store(float* p, Vector v) { _mm_storeu_ps(p, v); }
+		static Vector Set1(float v) { return _mm_set1_ps(v); }
+		static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+		static Vector Sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+		static Vector Div(Vector a, Vector b) { return _mm_div_ps(a, b); }
+		static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static Vector Min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+		static Vector Max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+		static Vector Sqrt(Vector a) { return _mm_sqrt_ps(a); }
+		static Vector Abs(Vector a) { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+		static Mask Less(Vector a, Vector b) { return _mm_cmplt_ps(a, b); }
+		static Mask Greater(Vector a, Vector b) { return _mm_cmpgt_ps(a, b); }
+		static Vector Select(Mask m, Vector a, Vector b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+	};
+
+#include "BatchMathKernels.inl"
+}
+#endif
+
+#if BATCH_MATH_AVX2
+BATCH_MATH_TARGET_BEGIN("avx2,fma")
+namespace Avx2
+{
+	struct Lanes
+	{
+		typedef __m256 Vector;
+		typedef __m256 Mask;
+		static const size_t Width = 8;
+
+		static Vector Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, Vector v) { _mm256_storeu_ps(p, v); }
+		static Vector Set1(float v) { return _mm256_set1_ps(v); }
+		static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+		static Vector Sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+		static Vector Div(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+		static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm256_fmadd_ps(a, b, c); }
+		static Vector Min(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+		static Vector Max(Vector a, Vector b) { return _mm256_max_ps(a, b); }
+		static Vector Sqrt(Vector a) { return _mm256_sqrt_ps(a); }
+		static Vector Abs(Vector a) { return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff))); }
+		static Mask Less(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static Mask Greater(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static Vector Select(Mask m, Vector a, Vector b) { return _mm256_blendv_ps(b, a, m); }
+	};
+
+#include "BatchMathKernels.inl"
+}
+BATCH_MATH_TARGET_END
+#endif
+
+#if BATCH_MATH_AVX512
+BATCH_MATH_TARGET_BEGIN("avx512f")
+namespace Avx512
+{
+	struct Lanes
+	{
+		typedef __m512 Vector;
+		typedef __mmask16 Mask;
+		static const size_t Width = 16;
+
+		static Vector Load(const float* p) { return _mm512_loadu_ps(p); }
+		static void Store(float* p, Vector v) { _mm512_storeu_ps(p, v); }
+		static Vector Set1(float v) { return _mm512_set1_ps(v); }
+		static Vector Add(Vector a, Vector b) { return _mm512_add_ps(a, b); }
+		static Vector Sub(Vector a, Vector b) { return _mm512_sub_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm512_mul_ps(a, b); }
+		static Vector Div(Vector a, Vector b) { return _mm512_div_ps(a, b); }
+		static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm512_fmadd_ps(a, b, c); }
+		static Vector Min(Vector a, Vector b) { return _mm512_min_ps(a, b); }
+		static Vector Max(Vector a, Vector b) { return _mm512_max_ps(a, b); }
+		static Vector Sqrt(Vector a) { return _mm512_sqrt_ps(a); }
+		static Vector Abs(Vector a) { return _mm512_abs_ps(a); }
+		static Mask Less(Vector a, Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+		static Mask Greater(Vector a, Vector b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+		static Vector Select(Mask m, Vector a, Vector b) { return _mm512_mask_blend_ps(m, b, a); }
+	};
+
+#include "BatchMathKernels.inl"
+}
+BATCH_MATH_TARGET_END
+#endif
+
+namespace
+{
+	BatchMath::Path ResolvePath(BatchMath::Path path)
+	{
+		BatchMath::Path best = BatchMath::GetBestPath();
+		if (path == BatchMath::Path::Auto || (int)path > (int)best)
+			return best;
+		return path;
+	}
+}
+
+// Runs kernel on the widest allowed path, then on the scalar path for the rest.
+#if BATCH_MATH_SSE2
+#define BATCH_MATH_CASE_SSE2(kernel, ...) case BatchMath::Path::Sse2: done = Sse2::kernel(__VA_ARGS__, 0, count); break;
+#else
+#define BATCH_MATH_CASE_SSE2(kernel, ...)
+#endif
+#if BATCH_MATH_AVX2
+#define BATCH_MATH_CASE_AVX2(kernel, ...) case BatchMath::Path::Avx2: done = Avx2::kernel(__VA_ARGS__, 0, count); break;
+#else
+#define BATCH_MATH_CASE_AVX2(kernel, ...)
+#endif
+#if BATCH_MATH_AVX512
+#define BATCH_MATH_CASE_AVX512(kernel, ...) case BatchMath::Path::Avx512: done = Avx512::kernel(__VA_ARGS__, 0, count); break;
+#else
+#define BATCH_MATH_CASE_AVX512(kernel, ...)
+#endif
+
+#define BATCH_MATH_DISPATCH(path, kernel, ...) \
+	size_t done = 0; \
+	switch (ResolvePath(path)) \
+	{ \
+	BATCH_MATH_CASE_AVX512(kernel, __VA_ARGS__) \
+	BATCH_MATH_CASE_AVX2(kernel, __VA_ARGS__) \
+	BATCH_MATH_CASE_SSE2(kernel, __VA_ARGS__) \
+	default: break; \
+	} \
+	Scalar::kernel(__VA_ARGS__, done, count)
+
+void BatchMath::TransformPoints(const DirectX::XMFLOAT4X4& m, ConstFloat3Array in, Float3Array out,
+	size_t count, Path path)
+{
+	BATCH_MATH_DISPATCH(path, TransformPoints, m, in, out);
+}
+
+void BatchMath::TransformVectors(const DirectX::XMFLOAT4X4& m, ConstFloat3Array in, Float3Array out,
+	size_t count, Path path)
+{
+	BATCH_MATH_DISPATCH(path, TransformVectors, m, in, out);
+}
+
+void BatchMath::Normalize(ConstFloat3Array in, Float3Array out, size_t count, Path path)
+{
+	BATCH_MATH_DISPATCH(path, Normalize, in, out);
+}
+
+void BatchMath::Lerp(const float* a, const float* b, float t, float* out, size_t count, Path path)
+{
+	BATCH_MATH_DISPATCH(path, Lerp, a, b, t, out);
+}
+
+void BatchMath::MultiplyAdd(const float* a, const float* b, float s, float* out, size_t count, Path path)
+{
+	BATCH_MATH_DISPATCH(path, MultiplyAdd, a, b, s, out);
+}
+
+void BatchMath::Clamp(const float* x, float low, float high, float* out, size_t count, Path path)
+{
+	BATCH_MATH_DISPATCH(path, Clamp, x, low, high, out);
+}
+
+void BatchMath::AngleFromXY(const float* x, const float* y, float* out, size_t count, Path path)
+{
+	BATCH_MATH_DISPATCH(path, AngleFromXY, x, y, out);
+}
+
+BatchMath::Path BatchMath::GetBestPath()
+{
+	static const Path best = []()
+	{
+		const CpuFeatures& cpu = CpuFeatures::Get();
+#if BATCH_MATH_AVX512
+		if (cpu.Avx512F)
+			return Path::Avx512;
+#endif
+#if BATCH_MATH_AVX2
+		if (cpu.Avx2 && cpu.Fma)
+			return Path::Avx2;
+#endif
+#if BATCH_MATH_SSE2
+		if (cpu.Sse2)
+			return Path::Sse2;
+#endif
+		return Path::Scalar;
+	}();
+	return best;
+}
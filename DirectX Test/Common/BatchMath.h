@@ -0,0 +1,78 @@
+//***************************************************************************************
+// BatchMath.h
+//
+// MathHelper operations applied to whole arrays at once.
+//
+// Vectors are stored as structure-of-arrays, one float array per component, so a SIMD
+// register holds the same component of 4 (SSE2), 8 (AVX2) or 16 (AVX-512) elements and
+// every kernel is a straight run of loads, arithmetic and stores with no shuffling.
+// Each kernel is written once against a small lane type and compiled for every
+// instruction set; the path is picked at run time from CpuFeatures, and the scalar
+// instance finishes the elements that do not fill a register.  The AVX2 and AVX-512
+// paths use fused multiply-add, so their results can differ from the others in the
+// last bit.
+//
+// Output arrays may be the input arrays (in-place updates) but must not otherwise
+// overlap them.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+
+class BatchMath
+{
+public:
+
+	enum class Path
+	{
+		Auto,
+		Scalar,
+		Sse2,
+		Avx2,
+		Avx512
+	};
+
+	struct Float3Array
+	{
+		float* X = nullptr;
+		float* Y = nullptr;
+		float* Z = nullptr;
+	};
+
+	struct ConstFloat3Array
+	{
+		const float* X = nullptr;
+		const float* Y = nullptr;
+		const float* Z = nullptr;
+
+		ConstFloat3Array() = default;
+		ConstFloat3Array(const float* x, const float* y, const float* z) : X(x), Y(y), Z(z) {}
+		ConstFloat3Array(const Float3Array& a) : X(a.X), Y(a.Y), Z(a.Z) {}
+	};
+
+	// out = (in, 1) * m and (in, 0) * m, row vectors as in DirectXMath.
+	static void TransformPoints(const DirectX::XMFLOAT4X4& m, ConstFloat3Array in, Float3Array out,
+		size_t count, Path path = Path::Auto);
+	static void TransformVectors(const DirectX::XMFLOAT4X4& m, ConstFloat3Array in, Float3Array out,
+		size_t count, Path path = Path::Auto);
+
+	// Unit length vectors; zero vectors stay zero.
+	static void Normalize(ConstFloat3Array in, Float3Array out, size_t count, Path path = Path::Auto);
+
+	// out = a + (b - a) * t.
+	static void Lerp(const float* a, const float* b, float t, float* out, size_t count, Path path = Path::Auto);
+
+	// out = a + b * s, e.g. positions advanced by velocities over a time step.
+	static void MultiplyAdd(const float* a, const float* b, float s, float* out, size_t count, Path path = Path::Auto);
+
+	static void Clamp(const float* x, float low, float high, float* out, size_t count, Path path = Path::Auto);
+
+	// Polar angle of each (x, y) in [0, 2*PI), as MathHelper::AngleFromXY, from a
+	// polynomial arctangent accurate to about 2e-6 radians.  (0, 0) gives 0.
+	static void AngleFromXY(const float* x, const float* y, float* out, size_t count, Path path = Path::Auto);
+
+	// Widest path this machine supports.
+	static Path GetBestPath();
+};
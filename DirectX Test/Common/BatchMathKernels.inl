@@ -0,0 +1,157 @@
+//***************************************************************************************
+// BatchMathKernels.inl
+//
+// Kernels of BatchMath, included by BatchMath.cpp once per instruction set inside a
+// namespace that defines Lanes: a register of Lanes::Width floats with the operations
+// used below.  Every kernel starts at begin, handles whole registers only and returns
+// the index of the first element it left for the scalar instance.
+//***************************************************************************************
+
+size_t TransformPoints(const DirectX::XMFLOAT4X4& m, BatchMath::ConstFloat3Array in,
+	BatchMath::Float3Array out, size_t begin, size_t count)
+{
+	typedef Lanes::Vector V;
+	const V m11 = Lanes::Set1(m._11), m12 = Lanes::Set1(m._12), m13 = Lanes::Set1(m._13);
+	const V m21 = Lanes::Set1(m._21), m22 = Lanes::Set1(m._22), m23 = Lanes::Set1(m._23);
+	const V m31 = Lanes::Set1(m._31), m32 = Lanes::Set1(m._32), m33 = Lanes::Set1(m._33);
+	const V m41 = Lanes::Set1(m._41), m42 = Lanes::Set1(m._42), m43 = Lanes::Set1(m._43);
+
+	size_t i = begin;
+	for (; i + Lanes::Width <= count; i += Lanes::Width)
+	{
+		V x = Lanes::Load(in.X + i);
+		V y = Lanes::Load(in.Y + i);
+		V z = Lanes::Load(in.Z + i);
+
+		Lanes::Store(out.X + i, Lanes::MulAdd(x, m11, Lanes::MulAdd(y, m21, Lanes::MulAdd(z, m31, m41))));
+		Lanes::Store(out.Y + i, Lanes::MulAdd(x, m12, Lanes::MulAdd(y, m22, Lanes::MulAdd(z, m32, m42))));
+		Lanes::Store(out.Z + i, Lanes::MulAdd(x, m13, Lanes::MulAdd(y, m23, Lanes::MulAdd(z, m33, m43))));
+	}
+	return i;
+}
+
+size_t TransformVectors(const DirectX::XMFLOAT4X4& m, BatchMath::ConstFloat3Array in,
+	BatchMath::Float3Array out, size_t begin, size_t count)
+{
+	typedef Lanes::Vector V;
+	const V m11 = Lanes::Set1(m._11), m12 = Lanes::Set1(m._12), m13 = Lanes::Set1(m._13);
+	const V m21 = Lanes::Set1(m._21), m22 = Lanes::Set1(m._22), m23 = Lanes::Set1(m._23);
+	const V m31 = Lanes::Set1(m._31), m32 = Lanes::Set1(m._32), m33 = Lanes::Set1(m._33);
+
+	size_t i = begin;
+	for (; i + Lanes::Width <= count; i += Lanes::Width)
+	{
+		V x = Lanes::Load(in.X + i);
+		V y = Lanes::Load(in.Y + i);
+		V z = Lanes::Load(in.Z + i);
+
+		Lanes::Store(out.X + i, Lanes::MulAdd(x, m11, Lanes::MulAdd(y, m21, Lanes::Mul(z, m31))));
+		Lanes::Store(out.Y + i, Lanes::MulAdd(x, m12, Lanes::MulAdd(y, m22, Lanes::Mul(z, m32))));
+		Lanes::Store(out.Z + i, Lanes::MulAdd(x, m13, Lanes::MulAdd(y, m23, Lanes::Mul(z, m33))));
+	}
+	return i;
+}
+
+size_t Normalize(BatchMath::ConstFloat3Array in, BatchMath::Float3Array out, size_t begin, size_t count)
+{
+	typedef Lanes::Vector V;
+	const V zero = Lanes::Set1(0.0f);
+	const V one = Lanes::Set1(1.0f);
+
+	size_t i = begin;
+	for (; i + Lanes::Width <= count; i += Lanes::Width)
+	{
+		V x = Lanes::Load(in.X + i);
+		V y = Lanes::Load(in.Y + i);
+		V z = Lanes::Load(in.Z + i);
+
+		V lengthSq = Lanes::MulAdd(x, x, Lanes::MulAdd(y, y, Lanes::Mul(z, z)));
+		V scale = Lanes::Select(Lanes::Greater(lengthSq, zero), Lanes::Div(one, Lanes::Sqrt(lengthSq)), zero);
+
+		Lanes::Store(out.X + i, Lanes::Mul(x, scale));
+		Lanes::Store(out.Y + i, Lanes::Mul(y, scale));
+		Lanes::Store(out.Z + i, Lanes::Mul(z, scale));
+	}
+	return i;
+}
+
+size_t Lerp(const float* a, const float* b, float t, float* out, size_t begin, size_t count)
+{
+	const Lanes::Vector tv = Lanes::Set1(t);
+
+	size_t i = begin;
+	for (; i + Lanes::Width <= count; i += Lanes::Width)
+	{
+		Lanes::Vector av = Lanes::Load(a + i);
+		Lanes::Store(out + i, Lanes::MulAdd(Lanes::Sub(Lanes::Load(b + i), av), tv, av));
+	}
+	return i;
+}
+
+size_t MultiplyAdd(const float* a, const float* b, float s, float* out, size_t begin, size_t count)
+{
+	const Lanes::Vector sv = Lanes::Set1(s);
+
+	size_t i = begin;
+	for (; i + Lanes::Width <= count; i += Lanes::Width)
+		Lanes::Store(out + i, Lanes::MulAdd(Lanes::Load(b + i), sv, Lanes::Load(a + i)));
+	return i;
+}
+
+size_t Clamp(const float* x, float low, float high, float* out, size_t begin, size_t count)
+{
+	const Lanes::Vector lowv = Lanes::Set1(low);
+	const Lanes::Vector highv = Lanes::Set1(high);
+
+	size_t i = begin;
+	for (; i + Lanes::Width <= count; i += Lanes::Width)
+		Lanes::Store(out + i, Lanes::Max(lowv, Lanes::Min(Lanes::Load(x + i), highv)));
+	return i;
+}
+
+size_t AngleFromXY(const float* x, const float* y, float* out, size_t begin, size_t count)
+{
+	typedef Lanes::Vector V;
+	const V zero = Lanes::Set1(0.0f);
+	const V tiny = Lanes::Set1(1e-30f);
+	const V pi = Lanes::Set1(3.1415926535f);
+	const V halfPi = Lanes::Set1(1.5707963268f);
+	const V twoPi = Lanes::Set1(6.2831853072f);
+
+	// Odd minimax polynomial for atan on [0, 1].
+	const V c1 = Lanes::Set1(0.99997726f);
+	const V c3 = Lanes::Set1(-0.33262347f);
+	const V c5 = Lanes::Set1(0.19354346f);
+	const V c7 = Lanes::Set1(-0.11643287f);
+	const V c9 = Lanes::Set1(0.05265332f);
+	const V c11 = Lanes::Set1(-0.01172120f);
+
+	size_t i = begin;
+	for (; i + Lanes::Width <= count; i += Lanes::Width)
+	{
+		V xv = Lanes::Load(x + i);
+		V yv = Lanes::Load(y + i);
+		V ax = Lanes::Abs(xv);
+		V ay = Lanes::Abs(yv);
+
+		// The angle of the first octant, then mirrored into the right one.
+		V a = Lanes::Div(Lanes::Min(ax, ay), Lanes::Max(Lanes::Max(ax, ay), tiny));
+		V s = Lanes::Mul(a, a);
+		V p = Lanes::MulAdd(s, c11, c9);
+		p = Lanes::MulAdd(s, p, c7);
+		p = Lanes::MulAdd(s, p, c5);
+		p = Lanes::MulAdd(s, p, c3);
+		p = Lanes::MulAdd(s, p, c1);
+		V r = Lanes::Mul(a, p);
+
+		r = Lanes::Select(Lanes::Greater(ay, ax), Lanes::Sub(halfPi, r), r);
+		r = Lanes::Select(Lanes::Less(xv, zero), Lanes::Sub(pi, r), r);
+		r = Lanes::Select(Lanes::Less(yv, zero), Lanes::Sub(twoPi, r), r);
+
+		// 2*PI - r rounds up to 2*PI for the smallest r.
+		r = Lanes::Select(Lanes::Less(r, twoPi), r, zero);
+
+		Lanes::Store(out + i, r);
+	}
+	return i;
+}
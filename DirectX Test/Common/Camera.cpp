@@ -3,6 +3,8 @@
 //***************************************************************************************
 
 #include "Camera.h"
+#include <cassert>
+#include <cstring>
 
 using namespace DirectX;
 
@@ -124,8 +126,26 @@ void Camera::SetLens(float fovY, float aspect, float zn, float zf)
 	mNearWindowHeight = 2.0f * mNearZ * tanf( 0.5f*mFovY );
 	mFarWindowHeight  = 2.0f * mFarZ * tanf( 0.5f*mFovY );
 
+	XMFLOAT4X4 proj;
 	XMMATRIX P = XMMatrixPerspectiveFovLH(mFovY, mAspect, mNearZ, mFarZ);
-	XMStoreFloat4x4(&mProj, P);
+	XMStoreFloat4x4(&proj, P);
+
+	if(memcmp(&proj, &mProj, sizeof(proj)) == 0)
+		return;
+	mProj = proj;
+
+	// P = [xs 0 0 0; 0 ys 0 0; 0 0 a 1; 0 0 b 0] inverts to
+	// [1/xs 0 0 0; 0 1/ys 0 0; 0 0 0 1/b; 0 0 1 -a/b].
+	float a = mProj(2, 2);
+	float b = mProj(3, 2);
+	mInvProj = XMFLOAT4X4(
+		1.0f / mProj(0, 0), 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f / mProj(1, 1), 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f / b,
+		0.0f, 0.0f, 1.0f, -a / b);
+
+	++mProjVersion;
+	UpdateViewProj();
 }
 
 void Camera::LookAt(FXMVECTOR pos, FXMVECTOR target, FXMVECTOR worldUp)
@@ -176,6 +196,45 @@ XMFLOAT4X4 Camera::GetProj4x4f()const
 	return mProj;
 }
 
+XMMATRIX Camera::GetInvView()const
+{
+	assert(!mViewDirty);
+	return XMLoadFloat4x4(&mInvView);
+}
+
+XMMATRIX Camera::GetInvProj()const
+{
+	return XMLoadFloat4x4(&mInvProj);
+}
+
+XMMATRIX Camera::GetViewProj()const
+{
+	assert(!mViewDirty);
+	return XMLoadFloat4x4(&mViewProj);
+}
+
+XMMATRIX Camera::GetInvViewProj()const
+{
+	assert(!mViewDirty);
+	return XMLoadFloat4x4(&mInvViewProj);
+}
+
+const Frustum& Camera::GetFrustum()const
+{
+	assert(!mViewDirty);
+	return mFrustum;
+}
+
+std::uint64_t Camera::GetViewVersion()const
+{
+	return mViewVersion;
+}
+
+std::uint64_t Camera::GetProjVersion()const
+{
+	return mProjVersion;
+}
+
 void Camera::Strafe(float d)
 {
 	// mPosition += d*mRight
@@ -273,28 +332,57 @@ void Camera::UpdateViewMatrix()
 		XMStoreFloat3(&mUp, U);
 		XMStoreFloat3(&mLook, L);
 
-		mView(0, 0) = mRight.x;
-		mView(1, 0) = mRight.y;
-		mView(2, 0) = mRight.z;
-		mView(3, 0) = x;
+		XMFLOAT4X4 view;
+
+		view(0, 0) = mRight.x;
+		view(1, 0) = mRight.y;
+		view(2, 0) = mRight.z;
+		view(3, 0) = x;
 
-		mView(0, 1) = mUp.x;
-		mView(1, 1) = mUp.y;
-		mView(2, 1) = mUp.z;
-		mView(3, 1) = y;
+		view(0, 1) = mUp.x;
+		view(1, 1) = mUp.y;
+		view(2, 1) = mUp.z;
+		view(3, 1) = y;
 
-		mView(0, 2) = mLook.x;
-		mView(1, 2) = mLook.y;
-		mView(2, 2) = mLook.z;
-		mView(3, 2) = z;
+		view(0, 2) = mLook.x;
+		view(1, 2) = mLook.y;
+		view(2, 2) = mLook.z;
+		view(3, 2) = z;
 
-		mView(0, 3) = 0.0f;
-		mView(1, 3) = 0.0f;
-		mView(2, 3) = 0.0f;
-		mView(3, 3) = 1.0f;
+		view(0, 3) = 0.0f;
+		view(1, 3) = 0.0f;
+		view(2, 3) = 0.0f;
+		view(3, 3) = 1.0f;
 
 		mViewDirty = false;
+
+		if(memcmp(&view, &mView, sizeof(view)) == 0)
+			return;
+		mView = view;
+
+		// The view is a rotation followed by a translation, so its inverse has the
+		// basis vectors as rows and the position as translation.
+		mInvView = XMFLOAT4X4(
+			mRight.x, mRight.y, mRight.z, 0.0f,
+			mUp.x, mUp.y, mUp.z, 0.0f,
+			mLook.x, mLook.y, mLook.z, 0.0f,
+			mPosition.x, mPosition.y, mPosition.z, 1.0f);
+
+		++mViewVersion;
+		UpdateViewProj();
 	}
 }
 
+void Camera::UpdateViewProj()
+{
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX proj = XMLoadFloat4x4(&mProj);
+	XMMATRIX invView = XMLoadFloat4x4(&mInvView);
+	XMMATRIX invProj = XMLoadFloat4x4(&mInvProj);
+
+	// (V * P)^-1 = P^-1 * V^-1.
+	XMStoreFloat4x4(&mViewProj, XMMatrixMultiply(view, proj));
+	XMStoreFloat4x4(&mInvViewProj, XMMatrixMultiply(invProj, invView));
 
+	mFrustum = Frustum::FromViewProj(mViewProj);
+}
@@ -6,12 +6,19 @@
 //    so that the view matrix can be constructed.  
 //   -It keeps track of the viewing frustum of the camera so that the projection
 //    matrix can be obtained.
+//   -It caches view * proj and the inverses of all three.  The view is a rigid
+//    transform and the projection a plain perspective, so both inverses are written
+//    down directly instead of going through XMMatrixInverse.  Version numbers change
+//    whenever the matrices do, so users can skip work derived from them.
+//   -It keeps the world space frustum of view * proj for culling.
 //***************************************************************************************
 
 #ifndef CAMERA_H
 #define CAMERA_H
 
-#include "d3dUtil.h"
+#include "MathHelper.h"
+#include "FrustumCuller.h"
+#include <cstdint>
 
 class Camera
 {
@@ -61,6 +68,19 @@ public:
 	DirectX::XMFLOAT4X4 GetView4x4f()const;
 	DirectX::XMFLOAT4X4 GetProj4x4f()const;
 
+	DirectX::XMMATRIX GetInvView()const;
+	DirectX::XMMATRIX GetInvProj()const;
+	DirectX::XMMATRIX GetViewProj()const;
+	DirectX::XMMATRIX GetInvViewProj()const;
+
+	// World space frustum, for FrustumCuller.
+	const Frustum& GetFrustum()const;
+
+	// Bumped when the view (UpdateViewMatrix) or the projection (SetLens) actually
+	// changes; setting the same pose or lens again keeps them.
+	std::uint64_t GetViewVersion()const;
+	std::uint64_t GetProjVersion()const;
+
 	// Strafe/Walk the camera a distance d.
 	void Strafe(float d);
 	void Walk(float d);
@@ -74,6 +94,10 @@ public:
 	// After modifying camera position/orientation, call to rebuild the view matrix.
 	void UpdateViewMatrix();
 
+private:
+
+	void UpdateViewProj();
+
 private:
 
 	// Camera coordinate system with coordinates relative to world space.
@@ -95,6 +119,14 @@ private:
 	// Cache View/Proj matrices.
 	DirectX::XMFLOAT4X4 mView = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4X4 mProj = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mInvView = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mInvProj = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mViewProj = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 mInvViewProj = MathHelper::Identity4x4();
+	Frustum mFrustum;
+
+	std::uint64_t mViewVersion = 0;
+	std::uint64_t mProjVersion = 0;
 };
 
 #endif // CAMERA_H
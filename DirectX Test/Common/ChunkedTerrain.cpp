@@ -0,0 +1,130 @@
+//***************************************************************************************
+// ChunkedTerrain.cpp
+//***************************************************************************************
+
+#include "ChunkedTerrain.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+ChunkedTerrain::ChunkedTerrain(const Desc& desc, HeightFunction height)
+	: mDesc(desc)
+	, mHeight(height)
+	, mSlots(desc.ChunkCount)
+{
+}
+
+ChunkedTerrain::uint32 ChunkedTerrain::Update(float scrollPosition, uint32 maxBuilds)
+{
+	const int first = (int)std::floor(scrollPosition / mDesc.ChunkDepth) - (int)mDesc.ChunksBehind;
+	const int last = first + (int)mDesc.ChunkCount;
+
+	// Which chunks of the window are already held; the others need a slot.
+	std::vector<bool> held(mDesc.ChunkCount, false);
+	for (Slot& slot : mSlots)
+	{
+		if (slot.Chunk == NoChunk)
+			continue;
+
+		if (slot.Chunk < first || slot.Chunk >= last)
+		{
+			slot.Chunk = NoChunk;
+			slot.Dirty = false;
+		}
+		else
+			held[slot.Chunk - first] = true;
+	}
+
+	uint32 built = 0;
+	size_t freeSlot = 0;
+	for (int chunk = first; chunk < last && built < maxBuilds; ++chunk)
+	{
+		if (held[chunk - first])
+			continue;
+
+		while (mSlots[freeSlot].Chunk != NoChunk)
+			++freeSlot;
+
+		BuildChunk(mSlots[freeSlot], chunk);
+		++built;
+	}
+
+	return built;
+}
+
+float ChunkedTerrain::GetChunkCenter(int chunk)const
+{
+	return ((float)chunk + 0.5f) * mDesc.ChunkDepth;
+}
+
+ChunkedTerrain::uint32 ChunkedTerrain::GetSlotCount()const
+{
+	return (uint32)mSlots.size();
+}
+
+ChunkedTerrain::Slot& ChunkedTerrain::GetSlot(uint32 slot)
+{
+	return mSlots[slot];
+}
+
+const ChunkedTerrain::Slot& ChunkedTerrain::GetSlot(uint32 slot)const
+{
+	return mSlots[slot];
+}
+
+const ChunkedTerrain::Desc& ChunkedTerrain::GetDesc()const
+{
+	return mDesc;
+}
+
+ChunkedTerrain::uint32 ChunkedTerrain::GetBuildCount()const
+{
+	return mBuildCount;
+}
+
+void ChunkedTerrain::BuildChunk(Slot& slot, int chunk)
+{
+	GeometryGenerator geoGen;
+	slot.Mesh = geoGen.CreateGrid(mDesc.ChunkWidth, mDesc.ChunkDepth, mDesc.ChunkQuads + 1, mDesc.ChunkQuads + 1);
+
+	const float centerZ = GetChunkCenter(chunk);
+
+	// Central differences over half a quad for the slopes.
+	const float step = 0.5f * std::min(mDesc.ChunkWidth, mDesc.ChunkDepth) / mDesc.ChunkQuads;
+
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (GeometryGenerator::Vertex& v : slot.Mesh.Vertices)
+	{
+		float x = v.Position.x;
+		float z = centerZ + v.Position.z;
+
+		v.Position.y = mHeight(x, z);
+
+		float dhdx = (mHeight(x + step, z) - mHeight(x - step, z)) / (2.0f * step);
+		float dhdz = (mHeight(x, z + step) - mHeight(x, z - step)) / (2.0f * step);
+
+		float normalScale = 1.0f / std::sqrt(dhdx * dhdx + 1.0f + dhdz * dhdz);
+		v.Normal = XMFLOAT3(-dhdx * normalScale, normalScale, -dhdz * normalScale);
+
+		float tangentScale = 1.0f / std::sqrt(1.0f + dhdx * dhdx);
+		v.TangentU = XMFLOAT3(tangentScale, dhdx * tangentScale, 0.0f);
+
+		boundsMin.x = std::min(boundsMin.x, v.Position.x);
+		boundsMin.y = std::min(boundsMin.y, v.Position.y);
+		boundsMin.z = std::min(boundsMin.z, v.Position.z);
+		boundsMax.x = std::max(boundsMax.x, v.Position.x);
+		boundsMax.y = std::max(boundsMax.y, v.Position.y);
+		boundsMax.z = std::max(boundsMax.z, v.Position.z);
+	}
+
+	slot.BoundsCenter = XMFLOAT3(0.5f * (boundsMin.x + boundsMax.x), 0.5f * (boundsMin.y + boundsMax.y), 0.5f * (boundsMin.z + boundsMax.z));
+	slot.BoundsExtents = XMFLOAT3(0.5f * (boundsMax.x - boundsMin.x), 0.5f * (boundsMax.y - boundsMin.y), 0.5f * (boundsMax.z - boundsMin.z));
+
+	slot.Chunk = chunk;
+	slot.Dirty = true;
+	++mBuildCount;
+}
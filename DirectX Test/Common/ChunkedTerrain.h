@@ -0,0 +1,96 @@
+//***************************************************************************************
+// ChunkedTerrain.h
+//
+// Streaming terrain for a level that scrolls along +z.  The level is an endless row of
+// equal chunks, each a CreateGrid heightfield; chunk i covers level z in
+// [i * ChunkDepth, (i + 1) * ChunkDepth) and the full ChunkWidth in x.
+//
+// Only a fixed pool of ChunkCount slots exists.  Update keeps the slots holding the
+// window of chunks from ChunksBehind chunks behind the scroll position onwards: a chunk
+// that falls out of the window behind gives its slot to the next one needed ahead, which
+// is generated right away.  Memory and the work per frame are therefore set by the pool
+// and the chunk resolution, never by the length of the level.
+//
+// Heights come from a function of level x and z, so neighbouring chunks agree on their
+// shared edge and normals are taken from the function rather than from the grid.
+// ChunkedTerrain only produces the CPU meshes; the caller uploads the slots whose Dirty
+// flag is set and clears it.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <climits>
+#include <functional>
+
+class ChunkedTerrain
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	// Height above the grid plane at level (x, z).
+	using HeightFunction = std::function<float(float x, float z)>;
+
+	static const int NoChunk = INT_MIN;
+
+	struct Desc
+	{
+		// Size of a chunk across (x) and along (z) the scroll direction.
+		float ChunkWidth = 10.0f;
+		float ChunkDepth = 20.0f;
+
+		// Quads along each side of a chunk.
+		uint32 ChunkQuads = 32;
+
+		// Slots in the pool, and how many of them stay behind the scroll position.
+		uint32 ChunkCount = 8;
+		uint32 ChunksBehind = 2;
+	};
+
+	struct Slot
+	{
+		// Level chunk held by the slot, or NoChunk while it is free.
+		int Chunk = NoChunk;
+
+		// Grid of the chunk, centred on the chunk's centre.
+		GeometryGenerator::MeshData Mesh;
+
+		// Axis-aligned bounds of Mesh.
+		DirectX::XMFLOAT3 BoundsCenter = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 BoundsExtents = { 0.0f, 0.0f, 0.0f };
+
+		// Set when the slot got a new chunk that has not been uploaded yet.
+		bool Dirty = false;
+	};
+
+	ChunkedTerrain(const Desc& desc, HeightFunction height);
+
+	// Frees the slots of chunks outside the window at scrollPosition and generates up to
+	// maxBuilds of the chunks missing from it, nearest to the window start first.
+	// Returns how many were generated.
+	uint32 Update(float scrollPosition, uint32 maxBuilds);
+
+	// Level z of the centre of chunk.
+	float GetChunkCenter(int chunk)const;
+
+	uint32 GetSlotCount()const;
+	Slot& GetSlot(uint32 slot);
+	const Slot& GetSlot(uint32 slot)const;
+
+	const Desc& GetDesc()const;
+
+	// Chunks generated since construction.
+	uint32 GetBuildCount()const;
+
+private:
+
+	void BuildChunk(Slot& slot, int chunk);
+
+private:
+
+	Desc mDesc;
+	HeightFunction mHeight;
+	std::vector<Slot> mSlots;
+	uint32 mBuildCount = 0;
+};
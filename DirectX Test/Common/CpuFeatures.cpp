@@ -0,0 +1,85 @@
+//***************************************************************************************
+// CpuFeatures.cpp
+//***************************************************************************************
+
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#if CPU_FEATURES_X86
+	void Cpuid(unsigned int leaf, unsigned int regs[4])
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, (int)leaf, 0);
+		for (int i = 0; i < 4; ++i)
+			regs[i] = (unsigned int)info[i];
+#else
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+		if (leaf <= __get_cpuid_max(0, nullptr))
+			__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	unsigned long long Xgetbv()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int low, high;
+		__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return ((unsigned long long)high << 32) | low;
+#endif
+	}
+#endif
+
+	CpuFeatures Detect()
+	{
+		CpuFeatures features;
+#if CPU_FEATURES_X86
+		unsigned int leaf0[4];
+		Cpuid(0, leaf0);
+		const unsigned int maxLeaf = leaf0[0];
+
+		unsigned int leaf1[4];
+		Cpuid(1, leaf1);
+		features.Sse2 = (leaf1[3] & (1u << 26)) != 0;
+
+		// Without OSXSAVE the OS saves no AVX state and none of the rest can be used.
+		const bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+		if (!osxsave)
+			return features;
+
+		const unsigned long long xcr0 = Xgetbv();
+		const bool ymmSaved = (xcr0 & 0x6) == 0x6;
+		const bool zmmSaved = (xcr0 & 0xe6) == 0xe6;
+
+		features.Avx = ymmSaved && (leaf1[2] & (1u << 28)) != 0;
+		features.Fma = features.Avx && (leaf1[2] & (1u << 12)) != 0;
+
+		if (maxLeaf >= 7)
+		{
+			unsigned int leaf7[4];
+			Cpuid(7, leaf7);
+			features.Avx2 = features.Avx && (leaf7[1] & (1u << 5)) != 0;
+			features.Avx512F = zmmSaved && (leaf7[1] & (1u << 16)) != 0;
+		}
+#endif
+		return features;
+	}
+}
+
+const CpuFeatures& CpuFeatures::Get()
+{
+	static const CpuFeatures features = Detect();
+	return features;
+}
@@ -0,0 +1,25 @@
+//***************************************************************************************
+// CpuFeatures.h
+//
+// Instruction set extensions of the machine the program runs on, read once with cpuid.
+//
+// The SIMD code in Common is compiled for every instruction set it has a path for and
+// picks one at run time from these flags, so a single executable uses AVX where it is
+// available and still runs where it is not.  The AVX flags are only set when the OS also
+// saves the wider registers on a context switch (xgetbv); a CPU that has AVX-512 under
+// an OS that does not know about it reports Avx512F as false.
+//***************************************************************************************
+
+#pragma once
+
+struct CpuFeatures
+{
+	bool Sse2 = false;
+	bool Avx = false;
+	bool Avx2 = false;
+	bool Fma = false;
+	bool Avx512F = false;
+
+	// Features of this machine, detected on the first call.
+	static const CpuFeatures& Get();
+};
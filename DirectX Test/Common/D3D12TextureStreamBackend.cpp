@@ -0,0 +1,132 @@
+//***************************************************************************************
+// D3D12TextureStreamBackend.cpp
+//***************************************************************************************
+
+#include "D3D12TextureStreamBackend.h"
+
+using Microsoft::WRL::ComPtr;
+
+D3D12TextureStreamBackend::D3D12TextureStreamBackend(ID3D12Device* device, ID3D12DescriptorHeap* srvHeap,
+	UINT firstSrvIndex, UINT srvCount)
+	: mDevice(device)
+	, mSrvHeap(srvHeap)
+	, mFirstSrvIndex(firstSrvIndex)
+	, mDescriptorSize(device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV))
+{
+	assert(srvCount > 1);
+
+	// Slot 0 is the null SRV; hand the others out lowest first.
+	for (UINT slot = srvCount - 1; slot > 0; --slot)
+		mFreeSlots.push_back(slot);
+
+	// A null SRV reads as zero, which is what a texture with nothing resident shows.
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = 1;
+	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
+	hDescriptor.Offset(mFirstSrvIndex, mDescriptorSize);
+	mDevice->CreateShaderResourceView(nullptr, &srvDesc, hDescriptor);
+}
+
+D3D12TextureStreamBackend::~D3D12TextureStreamBackend()
+{
+}
+
+void D3D12TextureStreamBackend::BeginFrame(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence, UINT64 completedFence)
+{
+	mCmdList = cmdList;
+	mFrameFence = frameFence;
+
+	for (size_t i = 0; i < mRetired.size(); )
+	{
+		if (mRetired[i].Fence <= completedFence)
+		{
+			if (mRetired[i].Slot != 0)
+				mFreeSlots.push_back(mRetired[i].Slot);
+
+			mRetired[i] = std::move(mRetired.back());
+			mRetired.pop_back();
+		}
+		else
+			++i;
+	}
+}
+
+bool D3D12TextureStreamBackend::SetResidentMip(UINT id, const TextureStreamer::StreamedTexture& texture, UINT firstMip)
+{
+	if (id >= mResident.size())
+		mResident.resize(id + 1);
+
+	Resident& r = mResident[id];
+
+	if (firstMip >= texture.MipCount)
+	{
+		if (r.Slot != 0)
+			Retire(r.Resource, r.Slot);
+		r.Resource = nullptr;
+		r.Slot = 0;
+		return true;
+	}
+
+	if (mFreeSlots.empty() || mCmdList == nullptr)
+		return false;
+
+	// The loader skips every mip larger than maxsize, which leaves exactly the range
+	// [firstMip, MipCount) in a smaller texture.  UVs are normalised, so the shader
+	// does not notice the difference.
+	UINT maxsize = MathHelper::Max(MathHelper::Max(texture.Width >> firstMip, texture.Height >> firstMip), 1u);
+
+	ComPtr<ID3D12Resource> resource;
+	ComPtr<ID3D12Resource> uploadHeap;
+	if (FAILED(DirectX::CreateDDSTextureFromMemory12(mDevice, mCmdList, texture.DdsData, texture.DdsSize,
+		resource, uploadHeap, maxsize)))
+		return false;
+
+	UINT slot = mFreeSlots.back();
+	mFreeSlots.pop_back();
+
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = desc.MipLevels;
+	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
+	hDescriptor.Offset(mFirstSrvIndex + slot, mDescriptorSize);
+	mDevice->CreateShaderResourceView(resource.Get(), &srvDesc, hDescriptor);
+
+	// Frames already recorded still use the old resource and descriptor.
+	if (r.Slot != 0)
+		Retire(r.Resource, r.Slot);
+
+	// The upload heap is only needed until this frame's copies have executed.
+	Retire(uploadHeap, 0);
+
+	r.Resource = resource;
+	r.Slot = slot;
+	return true;
+}
+
+int D3D12TextureStreamBackend::GetSrvHeapIndex(UINT id)const
+{
+	UINT slot = id < mResident.size() ? mResident[id].Slot : 0;
+	return (int)(mFirstSrvIndex + slot);
+}
+
+void D3D12TextureStreamBackend::Retire(ComPtr<ID3D12Resource> resource, UINT slot)
+{
+	Retired retired;
+	retired.Resource = resource;
+	retired.Slot = slot;
+	retired.Fence = mFrameFence;
+	mRetired.push_back(retired);
+}
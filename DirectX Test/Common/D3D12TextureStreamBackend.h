@@ -0,0 +1,65 @@
+//***************************************************************************************
+// D3D12TextureStreamBackend.h
+//
+// TextureStreamer backend that keeps the streamed mips in Direct3D 12 textures.  Each
+// residency change recreates the texture with the new mip range from the DDS data and
+// hands out a fresh SRV slot; the old resource and slot are retired until the GPU has
+// finished the frames that may still reference them.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "TextureStreamer.h"
+
+class D3D12TextureStreamBackend : public TextureStreamer::Backend
+{
+public:
+	// Uses srvCount descriptors of srvHeap starting at firstSrvIndex.  The first one is
+	// kept as a null SRV for textures with nothing resident.
+	D3D12TextureStreamBackend(ID3D12Device* device, ID3D12DescriptorHeap* srvHeap,
+		UINT firstSrvIndex, UINT srvCount);
+	D3D12TextureStreamBackend(const D3D12TextureStreamBackend& rhs) = delete;
+	D3D12TextureStreamBackend& operator=(const D3D12TextureStreamBackend& rhs) = delete;
+	~D3D12TextureStreamBackend();
+
+	// Uploads for this frame are recorded into cmdList.  frameFence is the fence value the
+	// frame will signal; everything retired before completedFence is released.
+	void BeginFrame(ID3D12GraphicsCommandList* cmdList, UINT64 frameFence, UINT64 completedFence);
+
+	virtual bool SetResidentMip(UINT id, const TextureStreamer::StreamedTexture& texture, UINT firstMip)override;
+
+	// SRV heap index to bind for the texture this frame.
+	int GetSrvHeapIndex(UINT id)const;
+
+private:
+
+	struct Resident
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT Slot = 0;
+	};
+
+	struct Retired
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT Slot = 0;
+		UINT64 Fence = 0;
+	};
+
+	void Retire(Microsoft::WRL::ComPtr<ID3D12Resource> resource, UINT slot);
+
+private:
+
+	ID3D12Device* mDevice;
+	ID3D12DescriptorHeap* mSrvHeap;
+	UINT mFirstSrvIndex;
+	UINT mDescriptorSize;
+
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+	UINT64 mFrameFence = 0;
+
+	std::vector<Resident> mResident;
+	std::vector<UINT> mFreeSlots;
+	std::vector<Retired> mRetired;
+};
@@ -25,6 +25,7 @@
 #include <wrl.h>
 #include <d3d11_1.h>
 #include "d3dx12.h"
+#include "DDSInfo.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4005)
@@ -92,6 +93,30 @@ namespace DirectX
 		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                               );
 
+	// For DDS data that is decompressed anyway, so that it is written once, straight into
+	// the memory the GPU copies from.  CreateDDSUploadBuffer12 creates and maps a buffer
+	// for ddsDataSize bytes in a write-back heap, which the CPU can read back quickly (the
+	// LZ4 decoder reads what it has written), placed so that the mips of a DDS with the
+	// standard header start on D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.  Once the caller
+	// has filled ddsData, CreateDDSTextureFromUploadBuffer12 copies every mip whose rows
+	// are pitch aligned straight from it and repacks only the others (the small mips)
+	// into repackHeap, which stays null when there are none.  Both buffers must live
+	// until the copies have executed.
+	HRESULT CreateDDSUploadBuffer12(_In_ ID3D12Device* device,
+	                                _In_ size_t ddsDataSize,
+	                                _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+	                                _Outptr_ uint8_t** ddsData
+	                                );
+
+	HRESULT CreateDDSTextureFromUploadBuffer12(_In_ ID3D12Device* device,
+	                                           _In_ ID3D12GraphicsCommandList* cmdList,
+	                                           _In_ ID3D12Resource* uploadBuffer,
+	                                           _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+	                                           _In_ size_t ddsDataSize,
+	                                           _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+	                                           _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& repackHeap
+	                                           );
+
     // Standard version with optional auto-gen mipmap support
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -0,0 +1,358 @@
+//***************************************************************************************
+// FrustumCuller.cpp
+//***************************************************************************************
+
+#include "FrustumCuller.h"
+#include "CpuFeatures.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLER_SSE2 1
+#define FRUSTUM_CULLER_AVX 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+// MSVC emits AVX for AVX intrinsics whatever /arch says.
+#define FRUSTUM_CULLER_TARGET_AVX
+#else
+#define FRUSTUM_CULLER_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	size_t CountBits(std::uint32_t v)
+	{
+		v = v - ((v >> 1) & 0x55555555);
+		v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+		return (size_t)((((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+	}
+
+	FrustumCuller::Path ResolvePath(FrustumCuller::Path path)
+	{
+		FrustumCuller::Path best = FrustumCuller::GetBestPath();
+		if (path == FrustumCuller::Path::Auto || (int)path > (int)best)
+			return best;
+		return path;
+	}
+
+	// Bounds [begin, end) one at a time.
+	void CullSpheresScalar(const Frustum& f, const FrustumCuller::SphereBounds& b, size_t begin, size_t end,
+		std::uint32_t* mask)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			XMFLOAT3 center(b.CenterX[i], b.CenterY[i], b.CenterZ[i]);
+			if (f.IntersectsSphere(center, b.Radius[i]))
+				mask[i / 32] |= 1u << (i % 32);
+		}
+	}
+
+	void CullBoxesScalar(const Frustum& f, const FrustumCuller::BoxBounds& b, size_t begin, size_t end,
+		std::uint32_t* mask)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			XMFLOAT3 center(b.CenterX[i], b.CenterY[i], b.CenterZ[i]);
+			XMFLOAT3 extents(b.ExtentX[i], b.ExtentY[i], b.ExtentZ[i]);
+			if (f.IntersectsBox(center, extents))
+				mask[i / 32] |= 1u << (i % 32);
+		}
+	}
+
+#if FRUSTUM_CULLER_SSE2
+	// Returns the index of the first bounds left for the scalar path.
+	size_t CullSpheresSse2(const Frustum& f, const FrustumCuller::SphereBounds& b, std::uint32_t* mask)
+	{
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; ++p)
+		{
+			planes[p][0] = _mm_set1_ps(f.Planes[p].x);
+			planes[p][1] = _mm_set1_ps(f.Planes[p].y);
+			planes[p][2] = _mm_set1_ps(f.Planes[p].z);
+			planes[p][3] = _mm_set1_ps(f.Planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		size_t i = 0;
+		for (; i + 4 <= b.Count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(b.CenterX + i);
+			__m128 y = _mm_loadu_ps(b.CenterY + i);
+			__m128 z = _mm_loadu_ps(b.CenterZ + i);
+			__m128 r = _mm_loadu_ps(b.Radius + i);
+
+			__m128 outside = zero;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_mul_ps(planes[p][2], z)), planes[p][3]);
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+			}
+
+			std::uint32_t visible = (std::uint32_t)(~_mm_movemask_ps(outside) & 0xf);
+			mask[i / 32] |= visible << (i % 32);
+		}
+		return i;
+	}
+
+	size_t CullBoxesSse2(const Frustum& f, const FrustumCuller::BoxBounds& b, std::uint32_t* mask)
+	{
+		__m128 planes[6][4];
+		__m128 absNormals[6][3];
+		for (int p = 0; p < 6; ++p)
+		{
+			planes[p][0] = _mm_set1_ps(f.Planes[p].x);
+			planes[p][1] = _mm_set1_ps(f.Planes[p].y);
+			planes[p][2] = _mm_set1_ps(f.Planes[p].z);
+			planes[p][3] = _mm_set1_ps(f.Planes[p].w);
+			absNormals[p][0] = _mm_set1_ps(fabsf(f.Planes[p].x));
+			absNormals[p][1] = _mm_set1_ps(fabsf(f.Planes[p].y));
+			absNormals[p][2] = _mm_set1_ps(fabsf(f.Planes[p].z));
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		size_t i = 0;
+		for (; i + 4 <= b.Count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(b.CenterX + i);
+			__m128 y = _mm_loadu_ps(b.CenterY + i);
+			__m128 z = _mm_loadu_ps(b.CenterZ + i);
+			__m128 ex = _mm_loadu_ps(b.ExtentX + i);
+			__m128 ey = _mm_loadu_ps(b.ExtentY + i);
+			__m128 ez = _mm_loadu_ps(b.ExtentZ + i);
+
+			__m128 outside = zero;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_mul_ps(planes[p][2], z)), planes[p][3]);
+				__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormals[p][0], ex), _mm_mul_ps(absNormals[p][1], ey)),
+					_mm_mul_ps(absNormals[p][2], ez));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+			}
+
+			std::uint32_t visible = (std::uint32_t)(~_mm_movemask_ps(outside) & 0xf);
+			mask[i / 32] |= visible << (i % 32);
+		}
+		return i;
+	}
+#endif
+
+#if FRUSTUM_CULLER_AVX
+	FRUSTUM_CULLER_TARGET_AVX
+	size_t CullSpheresAvx(const Frustum& f, const FrustumCuller::SphereBounds& b, std::uint32_t* mask)
+	{
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; ++p)
+		{
+			planes[p][0] = _mm256_set1_ps(f.Planes[p].x);
+			planes[p][1] = _mm256_set1_ps(f.Planes[p].y);
+			planes[p][2] = _mm256_set1_ps(f.Planes[p].z);
+			planes[p][3] = _mm256_set1_ps(f.Planes[p].w);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		size_t i = 0;
+		for (; i + 8 <= b.Count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(b.CenterX + i);
+			__m256 y = _mm256_loadu_ps(b.CenterY + i);
+			__m256 z = _mm256_loadu_ps(b.CenterZ + i);
+			__m256 r = _mm256_loadu_ps(b.Radius + i);
+
+			__m256 outside = zero;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x),
+					_mm256_mul_ps(planes[p][1], y)), _mm256_mul_ps(planes[p][2], z)), planes[p][3]);
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+			}
+
+			std::uint32_t visible = (std::uint32_t)(~_mm256_movemask_ps(outside) & 0xff);
+			mask[i / 32] |= visible << (i % 32);
+		}
+		_mm256_zeroupper();
+		return i;
+	}
+
+	FRUSTUM_CULLER_TARGET_AVX
+	size_t CullBoxesAvx(const Frustum& f, const FrustumCuller::BoxBounds& b, std::uint32_t* mask)
+	{
+		__m256 planes[6][4];
+		__m256 absNormals[6][3];
+		for (int p = 0; p < 6; ++p)
+		{
+			planes[p][0] = _mm256_set1_ps(f.Planes[p].x);
+			planes[p][1] = _mm256_set1_ps(f.Planes[p].y);
+			planes[p][2] = _mm256_set1_ps(f.Planes[p].z);
+			planes[p][3] = _mm256_set1_ps(f.Planes[p].w);
+			absNormals[p][0] = _mm256_set1_ps(fabsf(f.Planes[p].x));
+			absNormals[p][1] = _mm256_set1_ps(fabsf(f.Planes[p].y));
+			absNormals[p][2] = _mm256_set1_ps(fabsf(f.Planes[p].z));
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		size_t i = 0;
+		for (; i + 8 <= b.Count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(b.CenterX + i);
+			__m256 y = _mm256_loadu_ps(b.CenterY + i);
+			__m256 z = _mm256_loadu_ps(b.CenterZ + i);
+			__m256 ex = _mm256_loadu_ps(b.ExtentX + i);
+			__m256 ey = _mm256_loadu_ps(b.ExtentY + i);
+			__m256 ez = _mm256_loadu_ps(b.ExtentZ + i);
+
+			__m256 outside = zero;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x),
+					_mm256_mul_ps(planes[p][1], y)), _mm256_mul_ps(planes[p][2], z)), planes[p][3]);
+				__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absNormals[p][0], ex),
+					_mm256_mul_ps(absNormals[p][1], ey)), _mm256_mul_ps(absNormals[p][2], ez));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+			}
+
+			std::uint32_t visible = (std::uint32_t)(~_mm256_movemask_ps(outside) & 0xff);
+			mask[i / 32] |= visible << (i % 32);
+		}
+		_mm256_zeroupper();
+		return i;
+	}
+#endif
+
+	size_t CountVisible(const std::uint32_t* mask, size_t count)
+	{
+		size_t visible = 0;
+		for (size_t w = 0; w < FrustumCuller::GetMaskWords(count); ++w)
+			visible += CountBits(mask[w]);
+		return visible;
+	}
+}
+
+Frustum Frustum::FromViewProj(const XMFLOAT4X4& m)
+{
+	// With row vectors, clip = p * m, so each clip coordinate is p dotted with a column.
+	float c[4][4];
+	for (int col = 0; col < 4; ++col)
+	{
+		for (int row = 0; row < 4; ++row)
+			c[col][row] = m.m[row][col];
+	}
+
+	// -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+	const float planeSigns[6][4] =
+	{
+		{ 1.0f, 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f, 1.0f },
+		{ 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, -1.0f, 0.0f, 1.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f, 1.0f },
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < 6; ++i)
+	{
+		float p[4];
+		for (int k = 0; k < 4; ++k)
+			p[k] = planeSigns[i][0] * c[0][k] + planeSigns[i][1] * c[1][k] + planeSigns[i][2] * c[2][k] + planeSigns[i][3] * c[3][k];
+
+		float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		frustum.Planes[i] = XMFLOAT4(p[0] * scale, p[1] * scale, p[2] * scale, p[3] * scale);
+	}
+	return frustum;
+}
+
+bool Frustum::IntersectsSphere(const XMFLOAT3& center, float radius)const
+{
+	for (const XMFLOAT4& plane : Planes)
+	{
+		float d = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		if (d + radius < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::IntersectsBox(const XMFLOAT3& center, const XMFLOAT3& extents)const
+{
+	for (const XMFLOAT4& plane : Planes)
+	{
+		float d = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float r = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+		if (d + r < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+size_t FrustumCuller::GetMaskWords(size_t count)
+{
+	return (count + 31) / 32;
+}
+
+size_t FrustumCuller::CullSpheres(const Frustum& frustum, const SphereBounds& bounds,
+	std::uint32_t* visibleMask, Path path)
+{
+	if (bounds.Count > 0)
+		std::memset(visibleMask, 0, GetMaskWords(bounds.Count) * sizeof(std::uint32_t));
+
+	size_t first = 0;
+	switch (ResolvePath(path))
+	{
+#if FRUSTUM_CULLER_AVX
+	case Path::Avx:
+		first = CullSpheresAvx(frustum, bounds, visibleMask);
+		break;
+#endif
+#if FRUSTUM_CULLER_SSE2
+	case Path::Sse2:
+		first = CullSpheresSse2(frustum, bounds, visibleMask);
+		break;
+#endif
+	default:
+		break;
+	}
+	CullSpheresScalar(frustum, bounds, first, bounds.Count, visibleMask);
+
+	return CountVisible(visibleMask, bounds.Count);
+}
+
+size_t FrustumCuller::CullBoxes(const Frustum& frustum, const BoxBounds& bounds,
+	std::uint32_t* visibleMask, Path path)
+{
+	if (bounds.Count > 0)
+		std::memset(visibleMask, 0, GetMaskWords(bounds.Count) * sizeof(std::uint32_t));
+
+	size_t first = 0;
+	switch (ResolvePath(path))
+	{
+#if FRUSTUM_CULLER_AVX
+	case Path::Avx:
+		first = CullBoxesAvx(frustum, bounds, visibleMask);
+		break;
+#endif
+#if FRUSTUM_CULLER_SSE2
+	case Path::Sse2:
+		first = CullBoxesSse2(frustum, bounds, visibleMask);
+		break;
+#endif
+	default:
+		break;
+	}
+	CullBoxesScalar(frustum, bounds, first, bounds.Count, visibleMask);
+
+	return CountVisible(visibleMask, bounds.Count);
+}
+
+FrustumCuller::Path FrustumCuller::GetBestPath()
+{
+	static const Path best = CpuFeatures::Get().Avx ? Path::Avx :
+#if FRUSTUM_CULLER_SSE2
+		Path::Sse2;
+#else
+		Path::Scalar;
+#endif
+	return best;
+}
@@ -0,0 +1,85 @@
+//***************************************************************************************
+// FrustumCuller.h
+//
+// View frustum in world space and batch visibility tests against it.
+//
+// Frustum holds the six planes of a view * projection matrix, normalised and facing
+// inwards (Gribb and Hartmann).  Camera keeps one up to date with its matrices.
+//
+// FrustumCuller tests many bounding spheres or axis-aligned boxes at once.  The bounds
+// are passed as structure-of-arrays, one float array per component, so that a SIMD
+// register holds the same component of 4 (SSE2) or 8 (AVX) bounds and every plane is
+// tested against all of them with a handful of instructions.  The result is a bitmask,
+// bit i of word i / 32 set when bounds i may be visible.  The AVX path is only taken
+// when the CPU and the OS support it; the scalar path gives the same answers and is
+// there for other targets and for reference.
+//
+// Like any plane test this is conservative: bounds near a frustum corner can be
+// reported visible although they are outside, but visible bounds are never rejected.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+
+struct Frustum
+{
+	// dot(plane.xyz, p) + plane.w >= 0 inside: left, right, bottom, top, near, far.
+	DirectX::XMFLOAT4 Planes[6];
+
+	// Planes of a view * projection matrix (row vectors, D3D clip space 0 <= z <= w),
+	// in the space the matrix starts from.
+	static Frustum FromViewProj(const DirectX::XMFLOAT4X4& viewProj);
+
+	bool IntersectsSphere(const DirectX::XMFLOAT3& center, float radius)const;
+	bool IntersectsBox(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents)const;
+};
+
+class FrustumCuller
+{
+public:
+
+	enum class Path
+	{
+		Auto,
+		Scalar,
+		Sse2,
+		Avx
+	};
+
+	// Count floats per array.
+	struct SphereBounds
+	{
+		const float* CenterX = nullptr;
+		const float* CenterY = nullptr;
+		const float* CenterZ = nullptr;
+		const float* Radius = nullptr;
+		size_t Count = 0;
+	};
+
+	struct BoxBounds
+	{
+		const float* CenterX = nullptr;
+		const float* CenterY = nullptr;
+		const float* CenterZ = nullptr;
+		const float* ExtentX = nullptr;
+		const float* ExtentY = nullptr;
+		const float* ExtentZ = nullptr;
+		size_t Count = 0;
+	};
+
+	// Words needed for the visibility mask of count bounds.
+	static size_t GetMaskWords(size_t count);
+
+	// Writes GetMaskWords(bounds.Count) words to visibleMask and returns how many bounds
+	// may be visible.  Unused bits of the last word are zero.
+	static size_t CullSpheres(const Frustum& frustum, const SphereBounds& bounds,
+		std::uint32_t* visibleMask, Path path = Path::Auto);
+	static size_t CullBoxes(const Frustum& frustum, const BoxBounds& bounds,
+		std::uint32_t* visibleMask, Path path = Path::Auto);
+
+	// Widest path this machine supports.
+	static Path GetBestPath();
+};
@@ -0,0 +1,344 @@
+//***************************************************************************************
+// GeometryArena.cpp
+//***************************************************************************************
+
+#include "GeometryArena.h"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// The moves within one of the arena's buffers and the scratch buffer they go through.
+	struct ScratchCopy
+	{
+		ID3D12Resource* Buffer = nullptr;
+		UINT64 Stride = 0;
+		std::vector<std::pair<GeometryArena::Range, GeometryArena::Range>> Moves;
+		ComPtr<ID3D12Resource> Scratch;
+	};
+}
+
+GeometryArena::GeometryArena(ID3D12Device* device, UINT vertexByteStride, UINT vertexCapacity,
+	UINT indexCapacity, UINT wideIndexCapacity)
+	: mDevice(device)
+	, mVertexByteStride(vertexByteStride)
+	, mLayout(vertexCapacity, indexCapacity, wideIndexCapacity)
+{
+	mVertexBuffer = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT,
+		(UINT64)vertexCapacity * vertexByteStride, D3D12_RESOURCE_STATE_COMMON);
+	mIndexBuffer = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT,
+		(UINT64)indexCapacity * sizeof(std::uint16_t), D3D12_RESOURCE_STATE_COMMON);
+	if (wideIndexCapacity > 0)
+		mWideIndexBuffer = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT,
+			(UINT64)wideIndexCapacity * sizeof(std::uint32_t), D3D12_RESOURCE_STATE_COMMON);
+}
+
+GeometryArena::~GeometryArena()
+{
+}
+
+void GeometryArena::BeginFrame(UINT64 frameFence, UINT64 completedFence)
+{
+	mFrameFence = frameFence;
+
+	for (size_t i = 0; i < mPending.size(); )
+	{
+		if (mPending[i].Fence <= completedFence)
+		{
+			mPending[i] = std::move(mPending.back());
+			mPending.pop_back();
+		}
+		else
+			++i;
+	}
+}
+
+UINT GeometryArena::Allocate(ID3D12GraphicsCommandList* cmdList, const void* vertices, UINT vertexCount,
+	const std::vector<std::uint32_t>& indices, bool pinned)
+{
+	std::vector<std::uint8_t> indexBytes;
+	PackIndices(indices, vertexCount, indexBytes);
+
+	return Upload(cmdList, vertices, vertexCount, indexBytes.data(), (UINT)indices.size(), pinned);
+}
+
+UINT GeometryArena::Allocate(ID3D12GraphicsCommandList* cmdList, const void* vertices, UINT vertexCount,
+	const void* indices, UINT indexCount, DXGI_FORMAT indexFormat, bool pinned)
+{
+	if (indexFormat != NarrowestIndexFormat(vertexCount))
+	{
+		std::vector<std::uint32_t> widened(indexCount);
+		for (UINT i = 0; i < indexCount; ++i)
+		{
+			widened[i] = indexFormat == DXGI_FORMAT_R16_UINT ?
+				((const std::uint16_t*)indices)[i] : ((const std::uint32_t*)indices)[i];
+		}
+		return Allocate(cmdList, vertices, vertexCount, widened, pinned);
+	}
+
+	CheckIndices(indices, indexCount, indexFormat, vertexCount);
+
+	return Upload(cmdList, vertices, vertexCount, indices, indexCount, pinned);
+}
+
+void GeometryArena::Free(UINT id)
+{
+	mLayout.Free(id);
+}
+
+UINT GeometryArena::Compact(ID3D12GraphicsCommandList* cmdList)
+{
+	std::vector<GeometryArenaLayout::Move> moves = mLayout.Compact();
+	if (moves.empty())
+		return 0;
+
+	// Copying a buffer onto itself is undefined when the regions overlap, so the moved
+	// data goes through scratch copies at the new offsets and then back.
+	ScratchCopy copies[3];
+	copies[0].Buffer = mVertexBuffer.Get();
+	copies[0].Stride = mVertexByteStride;
+	copies[1].Buffer = mIndexBuffer.Get();
+	copies[1].Stride = sizeof(std::uint16_t);
+	copies[2].Buffer = mWideIndexBuffer.Get();
+	copies[2].Stride = sizeof(std::uint32_t);
+	for (const GeometryArenaLayout::Move& move : moves)
+	{
+		if (move.NewVertices.Count > 0)
+			copies[0].Moves.push_back(std::make_pair(move.OldVertices, move.NewVertices));
+		if (move.NewIndices.Count > 0)
+			copies[move.Wide ? 2 : 1].Moves.push_back(std::make_pair(move.OldIndices, move.NewIndices));
+	}
+
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+	for (ScratchCopy& copy : copies)
+	{
+		if (copy.Moves.empty())
+			continue;
+
+		UINT64 byteSize = 4;
+		for (const auto& move : copy.Moves)
+			byteSize = MathHelper::Max(byteSize, (UINT64)(move.second.Offset + move.second.Count) * copy.Stride);
+
+		copy.Scratch = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, byteSize, D3D12_RESOURCE_STATE_COMMON);
+		barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(copy.Scratch.Get(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	}
+	if (!barriers.empty())
+		cmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+	Transition(cmdList, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	for (const ScratchCopy& copy : copies)
+	{
+		for (const auto& move : copy.Moves)
+			cmdList->CopyBufferRegion(copy.Scratch.Get(), move.second.Offset * copy.Stride,
+				copy.Buffer, move.first.Offset * copy.Stride, move.second.Count * copy.Stride);
+	}
+
+	barriers.clear();
+	for (const ScratchCopy& copy : copies)
+	{
+		if (copy.Scratch != nullptr)
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(copy.Scratch.Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	}
+	if (!barriers.empty())
+		cmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+	Transition(cmdList, D3D12_RESOURCE_STATE_COPY_DEST);
+
+	for (const ScratchCopy& copy : copies)
+	{
+		for (const auto& move : copy.Moves)
+			cmdList->CopyBufferRegion(copy.Buffer, move.second.Offset * copy.Stride,
+				copy.Scratch.Get(), move.second.Offset * copy.Stride, move.second.Count * copy.Stride);
+	}
+
+	Transition(cmdList, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	for (ScratchCopy& copy : copies)
+	{
+		if (copy.Scratch != nullptr)
+			Retire(copy.Scratch);
+	}
+
+	++mCompactions;
+
+	return (UINT)moves.size();
+}
+
+SubmeshGeometry GeometryArena::Place(UINT id, const SubmeshGeometry& localSubmesh)const
+{
+	SubmeshGeometry submesh = localSubmesh;
+	mLayout.Place(id, submesh.StartIndexLocation, submesh.BaseVertexLocation);
+	return submesh;
+}
+
+void GeometryArena::Bind(MeshGeometry& geo, DXGI_FORMAT indexFormat)const
+{
+	const bool wide = indexFormat == DXGI_FORMAT_R32_UINT;
+	const GeometryArenaLayout::FreeList& indices = wide ? mLayout.GetFreeWideIndices() : mLayout.GetFreeIndices();
+
+	geo.VertexBufferGPU = mVertexBuffer;
+	geo.IndexBufferGPU = wide ? mWideIndexBuffer : mIndexBuffer;
+	geo.VertexByteStride = mVertexByteStride;
+	geo.VertexBufferByteSize = mLayout.GetFreeVertices().GetCapacity() * mVertexByteStride;
+	geo.IndexFormat = indexFormat;
+	geo.IndexBufferByteSize = indices.GetCapacity() * (UINT)IndexByteSize(indexFormat);
+}
+
+const GeometryArena::Range& GeometryArena::GetVertexRange(UINT id)const
+{
+	return mLayout.GetVertexRange(id);
+}
+
+const GeometryArena::Range& GeometryArena::GetIndexRange(UINT id)const
+{
+	return mLayout.GetIndexRange(id);
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryArena::VertexBufferView()const
+{
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = mVertexBuffer->GetGPUVirtualAddress();
+	vbv.StrideInBytes = mVertexByteStride;
+	vbv.SizeInBytes = mLayout.GetFreeVertices().GetCapacity() * mVertexByteStride;
+
+	return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryArena::IndexBufferView(DXGI_FORMAT indexFormat)const
+{
+	const bool wide = indexFormat == DXGI_FORMAT_R32_UINT;
+	const GeometryArenaLayout::FreeList& indices = wide ? mLayout.GetFreeWideIndices() : mLayout.GetFreeIndices();
+
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = GetIndexBuffer(wide)->GetGPUVirtualAddress();
+	ibv.Format = indexFormat;
+	ibv.SizeInBytes = indices.GetCapacity() * (UINT)IndexByteSize(indexFormat);
+
+	return ibv;
+}
+
+DXGI_FORMAT GeometryArena::GetIndexFormat(UINT id)const
+{
+	return mLayout.IsWide(id) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+}
+
+UINT GeometryArena::GetVersion()const
+{
+	return mLayout.GetVersion();
+}
+
+GeometryArena::Stats GeometryArena::GetStats()const
+{
+	Stats stats;
+	stats.MeshCount = mLayout.GetMeshCount();
+	stats.VertexCapacity = mLayout.GetFreeVertices().GetCapacity();
+	stats.VertexCount = stats.VertexCapacity - mLayout.GetFreeVertices().GetFreeCount();
+	stats.IndexCapacity = mLayout.GetFreeIndices().GetCapacity();
+	stats.IndexCount = stats.IndexCapacity - mLayout.GetFreeIndices().GetFreeCount();
+	stats.WideIndexCapacity = mLayout.GetFreeWideIndices().GetCapacity();
+	stats.WideIndexCount = stats.WideIndexCapacity - mLayout.GetFreeWideIndices().GetFreeCount();
+	stats.Compactions = mCompactions;
+	return stats;
+}
+
+UINT GeometryArena::Upload(ID3D12GraphicsCommandList* cmdList, const void* vertices, UINT vertexCount,
+	const void* indices, UINT indexCount, bool pinned)
+{
+	const bool wide = vertexCount > GeometryArenaLayout::MaxNarrowVertices;
+	if (wide && mWideIndexBuffer == nullptr)
+		throw std::overflow_error("GeometryArena::Allocate: more than 65536 vertices and no 32-bit indices");
+
+	const UINT64 indexByteSize = wide ? sizeof(std::uint32_t) : sizeof(std::uint16_t);
+	const UINT64 ibByteSize = (UINT64)indexCount * indexByteSize;
+
+	UINT id;
+	if (!mLayout.Allocate(vertexCount, indexCount, pinned, id))
+	{
+		if (!mLayout.FitsAfterCompact(vertexCount, indexCount))
+			throw std::length_error("GeometryArena::Allocate: arena is full");
+
+		Compact(cmdList);
+		mLayout.Allocate(vertexCount, indexCount, pinned, id);
+	}
+	const Range& vertexRange = mLayout.GetVertexRange(id);
+	const Range& indexRange = mLayout.GetIndexRange(id);
+
+	// One upload buffer for both, indices 4-byte aligned after the vertices.
+	UINT64 vbByteSize = (UINT64)vertexCount * mVertexByteStride;
+	UINT64 ibOffset = (vbByteSize + 3) & ~3ull;
+	UINT64 uploadByteSize = ibOffset + ibByteSize;
+
+	if (uploadByteSize > 0)
+	{
+		ComPtr<ID3D12Resource> upload = CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, uploadByteSize,
+			D3D12_RESOURCE_STATE_GENERIC_READ);
+
+		std::uint8_t* mapped = nullptr;
+		ThrowIfFailed(upload->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+		if (vbByteSize > 0)
+			std::memcpy(mapped, vertices, (size_t)vbByteSize);
+		if (ibByteSize > 0)
+			std::memcpy(mapped + ibOffset, indices, (size_t)ibByteSize);
+		upload->Unmap(0, nullptr);
+
+		Transition(cmdList, D3D12_RESOURCE_STATE_COPY_DEST);
+		if (vbByteSize > 0)
+			cmdList->CopyBufferRegion(mVertexBuffer.Get(), (UINT64)vertexRange.Offset * mVertexByteStride,
+				upload.Get(), 0, vbByteSize);
+		if (ibByteSize > 0)
+			cmdList->CopyBufferRegion(GetIndexBuffer(wide), (UINT64)indexRange.Offset * indexByteSize,
+				upload.Get(), ibOffset, ibByteSize);
+		Transition(cmdList, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+		Retire(upload);
+	}
+
+	return id;
+}
+
+ID3D12Resource* GeometryArena::GetIndexBuffer(bool wide)const
+{
+	return wide ? mWideIndexBuffer.Get() : mIndexBuffer.Get();
+}
+
+ComPtr<ID3D12Resource> GeometryArena::CreateBuffer(D3D12_HEAP_TYPE heapType, UINT64 byteSize,
+	D3D12_RESOURCE_STATES state)
+{
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(heapType),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		state,
+		nullptr,
+		IID_PPV_ARGS(buffer.GetAddressOf())));
+	return buffer;
+}
+
+void GeometryArena::Transition(ID3D12GraphicsCommandList* cmdList, D3D12_RESOURCE_STATES state)
+{
+	if (mState == state)
+		return;
+
+	D3D12_RESOURCE_BARRIER barriers[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(mVertexBuffer.Get(), mState, state),
+		CD3DX12_RESOURCE_BARRIER::Transition(mIndexBuffer.Get(), mState, state),
+		CD3DX12_RESOURCE_BARRIER::Transition(mWideIndexBuffer.Get(), mState, state),
+	};
+	cmdList->ResourceBarrier(mWideIndexBuffer != nullptr ? 3 : 2, barriers);
+
+	mState = state;
+}
+
+void GeometryArena::Retire(ComPtr<ID3D12Resource> resource)
+{
+	Pending pending;
+	pending.Resource = resource;
+	pending.Fence = mFrameFence;
+	mPending.push_back(pending);
+}
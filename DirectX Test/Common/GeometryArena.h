@@ -0,0 +1,136 @@
+//***************************************************************************************
+// GeometryArena.h
+//
+// Sub-allocates meshes out of one shared vertex buffer and one shared index buffer, so
+// that every mesh in the arena is drawn with the same IASetVertexBuffers /
+// IASetIndexBuffer binding and only the draw arguments change.
+//
+// Each mesh gets a contiguous range of vertices and of indices, found first-fit in a
+// free list whose neighbouring ranges are merged on Free.  Indices stay relative to the
+// mesh and are offset by BaseVertexLocation at draw time, so the 16-bit index buffer
+// holds any number of meshes as long as each one has at most 65536 vertices.  Larger
+// meshes go to a second, 32-bit index buffer when the arena was created with one, and
+// are drawn with that bound instead; GetIndexFormat tells which a mesh needs.
+//
+// When a mesh does not fit anywhere although enough space is free in total, the arena
+// is compacted: the live meshes are moved towards the front of the buffers on the GPU.
+// This changes their offsets; Place() gives the current ones and GetVersion() changes
+// whenever they move.  Meshes allocated pinned are never moved, so their draw arguments
+// can be copied into render items once.  GeometryArenaLayout does the bookkeeping.
+//
+// All writes to the buffers are GPU copies recorded in the caller's command list, so
+// they are ordered after the frames already submitted and freed space can be reused at
+// once.  Only the upload and scratch buffers have to wait for the GPU; BeginFrame
+// releases them once their frame has completed.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "GeometryArenaLayout.h"
+#include "IndexPacking.h"
+
+class GeometryArena
+{
+public:
+
+	typedef GeometryArenaLayout::Range Range;
+
+	struct Stats
+	{
+		UINT MeshCount = 0;
+		UINT VertexCount = 0;
+		UINT VertexCapacity = 0;
+		UINT IndexCount = 0;
+		UINT IndexCapacity = 0;
+		UINT WideIndexCount = 0;
+		UINT WideIndexCapacity = 0;
+		UINT Compactions = 0;
+	};
+
+	static const UINT InvalidId = GeometryArenaLayout::InvalidId;
+
+	// indexCapacity 16-bit indices and wideIndexCapacity 32-bit ones; without the latter
+	// no mesh may have more than 65536 vertices.
+	GeometryArena(ID3D12Device* device, UINT vertexByteStride, UINT vertexCapacity,
+		UINT indexCapacity, UINT wideIndexCapacity = 0);
+	GeometryArena(const GeometryArena& rhs) = delete;
+	GeometryArena& operator=(const GeometryArena& rhs) = delete;
+	~GeometryArena();
+
+	// Releases the upload and scratch buffers of frames up to completedFence.  Buffers
+	// created until the next call belong to the frame signalling frameFence.
+	void BeginFrame(UINT64 frameFence, UINT64 completedFence);
+
+	// Copies vertexCount vertices of the arena's stride and the mesh-relative indices
+	// into the arena.  Throws std::length_error when the arena is full even after
+	// compaction, std::overflow_error when a mesh has more than 65536 vertices and the
+	// arena has no 32-bit indices, std::out_of_range when an index is not below
+	// vertexCount.  A pinned mesh keeps its offsets until it is freed.
+	UINT Allocate(ID3D12GraphicsCommandList* cmdList, const void* vertices, UINT vertexCount,
+		const std::vector<std::uint32_t>& indices, bool pinned = false);
+
+	// Same for indices that are already packed, e.g. read from the mesh cache.  They are
+	// copied as they are when indexFormat is the one the mesh's vertex count calls for
+	// and repacked otherwise; either way they are range-checked.
+	UINT Allocate(ID3D12GraphicsCommandList* cmdList, const void* vertices, UINT vertexCount,
+		const void* indices, UINT indexCount, DXGI_FORMAT indexFormat, bool pinned = false);
+
+	void Free(UINT id);
+
+	// Moves the live meshes that are not pinned towards the front of the buffers.
+	// Returns how many moved.
+	UINT Compact(ID3D12GraphicsCommandList* cmdList);
+
+	// Turns a submesh with offsets relative to the mesh into one with arena offsets.
+	SubmeshGeometry Place(UINT id, const SubmeshGeometry& localSubmesh)const;
+
+	// Points geo at the arena buffers, for code that binds per MeshGeometry.  Meshes
+	// drawn through geo must all have indices of indexFormat.
+	void Bind(MeshGeometry& geo, DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT)const;
+
+	const Range& GetVertexRange(UINT id)const;
+	const Range& GetIndexRange(UINT id)const;
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView(DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT)const;
+
+	// R16_UINT, or R32_UINT for a mesh of more than 65536 vertices.
+	DXGI_FORMAT GetIndexFormat(UINT id)const;
+	UINT GetVersion()const;
+	Stats GetStats()const;
+
+private:
+
+	struct Pending
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		UINT64 Fence = 0;
+	};
+
+	UINT Upload(ID3D12GraphicsCommandList* cmdList, const void* vertices, UINT vertexCount,
+		const void* indices, UINT indexCount, bool pinned);
+
+	ID3D12Resource* GetIndexBuffer(bool wide)const;
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(D3D12_HEAP_TYPE heapType, UINT64 byteSize,
+		D3D12_RESOURCE_STATES state);
+	void Transition(ID3D12GraphicsCommandList* cmdList, D3D12_RESOURCE_STATES state);
+	void Retire(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
+
+private:
+
+	ID3D12Device* mDevice;
+	UINT mVertexByteStride;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mVertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> mIndexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> mWideIndexBuffer;
+	D3D12_RESOURCE_STATES mState = D3D12_RESOURCE_STATE_COMMON;
+
+	GeometryArenaLayout mLayout;
+
+	UINT64 mFrameFence = 0;
+	std::vector<Pending> mPending;
+
+	UINT mCompactions = 0;
+};
@@ -0,0 +1,345 @@
+//***************************************************************************************
+// GeometryArenaLayout.cpp
+//***************************************************************************************
+
+#include "GeometryArenaLayout.h"
+#include <algorithm>
+
+namespace
+{
+	// Largest free range left between ranges, which need not be sorted.
+	std::uint32_t LargestGap(std::vector<GeometryArenaLayout::Range> used, std::uint32_t capacity)
+	{
+		std::sort(used.begin(), used.end(),
+			[](const GeometryArenaLayout::Range& a, const GeometryArenaLayout::Range& b) { return a.Offset < b.Offset; });
+
+		std::uint32_t largest = 0;
+		std::uint32_t end = 0;
+		for (const GeometryArenaLayout::Range& r : used)
+		{
+			if (r.Offset > end)
+				largest = std::max(largest, r.Offset - end);
+			end = std::max(end, r.Offset + r.Count);
+		}
+		return std::max(largest, capacity - end);
+	}
+}
+
+GeometryArenaLayout::FreeList::FreeList(std::uint32_t capacity)
+	: mCapacity(capacity)
+	, mFreeCount(0)
+{
+	Reset(std::vector<Range>());
+}
+
+bool GeometryArenaLayout::FreeList::Allocate(std::uint32_t count, std::uint32_t& offset)
+{
+	if (count == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	for (size_t i = 0; i < mFree.size(); ++i)
+	{
+		Range& r = mFree[i];
+		if (r.Count < count)
+			continue;
+
+		offset = r.Offset;
+		r.Offset += count;
+		r.Count -= count;
+		if (r.Count == 0)
+			mFree.erase(mFree.begin() + i);
+
+		mFreeCount -= count;
+		return true;
+	}
+
+	return false;
+}
+
+void GeometryArenaLayout::FreeList::Free(std::uint32_t offset, std::uint32_t count)
+{
+	if (count == 0)
+		return;
+
+	auto next = std::lower_bound(mFree.begin(), mFree.end(), offset,
+		[](const Range& r, std::uint32_t o) { return r.Offset < o; });
+
+	// Merge with the range before and/or after instead of inserting where possible.
+	bool mergePrev = next != mFree.begin() && (next - 1)->Offset + (next - 1)->Count == offset;
+	bool mergeNext = next != mFree.end() && offset + count == next->Offset;
+
+	if (mergePrev && mergeNext)
+	{
+		(next - 1)->Count += count + next->Count;
+		mFree.erase(next);
+	}
+	else if (mergePrev)
+	{
+		(next - 1)->Count += count;
+	}
+	else if (mergeNext)
+	{
+		next->Offset = offset;
+		next->Count += count;
+	}
+	else
+	{
+		Range r;
+		r.Offset = offset;
+		r.Count = count;
+		mFree.insert(next, r);
+	}
+
+	mFreeCount += count;
+}
+
+void GeometryArenaLayout::FreeList::Reset(const std::vector<Range>& used)
+{
+	mFree.clear();
+	mFreeCount = 0;
+
+	std::uint32_t end = 0;
+	for (size_t i = 0; i <= used.size(); ++i)
+	{
+		std::uint32_t next = i < used.size() ? used[i].Offset : mCapacity;
+		if (next > end)
+		{
+			Range r;
+			r.Offset = end;
+			r.Count = next - end;
+			mFree.push_back(r);
+			mFreeCount += r.Count;
+		}
+		if (i < used.size())
+			end = std::max(end, used[i].Offset + used[i].Count);
+	}
+}
+
+std::uint32_t GeometryArenaLayout::FreeList::GetCapacity()const
+{
+	return mCapacity;
+}
+
+std::uint32_t GeometryArenaLayout::FreeList::GetFreeCount()const
+{
+	return mFreeCount;
+}
+
+std::uint32_t GeometryArenaLayout::FreeList::GetLargestFreeRange()const
+{
+	std::uint32_t largest = 0;
+	for (const Range& r : mFree)
+		largest = std::max(largest, r.Count);
+	return largest;
+}
+
+GeometryArenaLayout::GeometryArenaLayout(std::uint32_t vertexCapacity, std::uint32_t indexCapacity,
+	std::uint32_t wideIndexCapacity)
+	: mFreeVertices(vertexCapacity)
+	, mFreeIndices(indexCapacity)
+	, mFreeWideIndices(wideIndexCapacity)
+{
+}
+
+bool GeometryArenaLayout::Allocate(std::uint32_t vertexCount, std::uint32_t indexCount, bool pinned, std::uint32_t& id)
+{
+	const bool wide = vertexCount > MaxNarrowVertices;
+	FreeList& freeIndices = IndexFreeList(wide);
+	if (mFreeVertices.GetLargestFreeRange() < vertexCount || freeIndices.GetLargestFreeRange() < indexCount)
+		return false;
+
+	Mesh mesh;
+	mesh.Vertices.Count = vertexCount;
+	mesh.Indices.Count = indexCount;
+	mesh.Live = true;
+	mesh.Pinned = pinned;
+	mesh.Wide = wide;
+	mFreeVertices.Allocate(vertexCount, mesh.Vertices.Offset);
+	freeIndices.Allocate(indexCount, mesh.Indices.Offset);
+
+	if (!mFreeIds.empty())
+	{
+		id = mFreeIds.back();
+		mFreeIds.pop_back();
+		mMeshes[id] = mesh;
+	}
+	else
+	{
+		id = (std::uint32_t)mMeshes.size();
+		mMeshes.push_back(mesh);
+	}
+
+	return true;
+}
+
+void GeometryArenaLayout::Free(std::uint32_t id)
+{
+	if (id >= mMeshes.size() || !mMeshes[id].Live)
+		return;
+
+	Mesh& mesh = mMeshes[id];
+	mFreeVertices.Free(mesh.Vertices.Offset, mesh.Vertices.Count);
+	IndexFreeList(mesh.Wide).Free(mesh.Indices.Offset, mesh.Indices.Count);
+	mesh.Live = false;
+
+	mFreeIds.push_back(id);
+}
+
+bool GeometryArenaLayout::FitsAfterCompact(std::uint32_t vertexCount, std::uint32_t indexCount)const
+{
+	const bool wide = vertexCount > MaxNarrowVertices;
+	const FreeList& freeIndices = wide ? mFreeWideIndices : mFreeIndices;
+	if (mFreeVertices.GetFreeCount() < vertexCount || freeIndices.GetFreeCount() < indexCount)
+		return false;
+
+	// Pinned meshes can leave the free space in pieces even after compaction.
+	return LargestGap(Slide(GetLiveMeshes(Meshes::All), &Mesh::Vertices), mFreeVertices.GetCapacity()) >= vertexCount &&
+		LargestGap(Slide(GetLiveMeshes(wide ? Meshes::Wide : Meshes::Narrow), &Mesh::Indices), freeIndices.GetCapacity()) >= indexCount;
+}
+
+std::vector<std::uint32_t> GeometryArenaLayout::GetLiveMeshes(Meshes which)const
+{
+	std::vector<std::uint32_t> meshes;
+	for (std::uint32_t id = 0; id < (std::uint32_t)mMeshes.size(); ++id)
+	{
+		const Mesh& mesh = mMeshes[id];
+		if (mesh.Live && (which == Meshes::All || mesh.Wide == (which == Meshes::Wide)))
+			meshes.push_back(id);
+	}
+	return meshes;
+}
+
+std::vector<GeometryArenaLayout::Range> GeometryArenaLayout::Slide(const std::vector<std::uint32_t>& meshes,
+	Range Mesh::* range)const
+{
+	std::vector<std::uint32_t> order = meshes;
+	std::sort(order.begin(), order.end(),
+		[&](std::uint32_t a, std::uint32_t b) { return (mMeshes[a].*range).Offset < (mMeshes[b].*range).Offset; });
+
+	// Walking in offset order, a mesh slid back to the end of the one before still ends
+	// before the next pinned mesh, so pinned meshes never need to move.
+	std::vector<Range> slid(mMeshes.size());
+	std::uint32_t end = 0;
+	for (std::uint32_t id : order)
+	{
+		const Range& current = mMeshes[id].*range;
+		slid[id].Offset = mMeshes[id].Pinned ? current.Offset : end;
+		slid[id].Count = current.Count;
+		end = slid[id].Offset + slid[id].Count;
+	}
+	return slid;
+}
+
+std::vector<GeometryArenaLayout::Move> GeometryArenaLayout::Compact()
+{
+	std::vector<Range> newVertices = Slide(GetLiveMeshes(Meshes::All), &Mesh::Vertices);
+	std::vector<Range> newIndices = Slide(GetLiveMeshes(Meshes::Narrow), &Mesh::Indices);
+	std::vector<Range> newWideIndices = Slide(GetLiveMeshes(Meshes::Wide), &Mesh::Indices);
+	for (std::uint32_t id = 0; id < (std::uint32_t)mMeshes.size(); ++id)
+	{
+		if (mMeshes[id].Wide)
+			newIndices[id] = newWideIndices[id];
+	}
+
+	std::vector<Move> moves;
+	std::vector<Range> usedVertices;
+	std::vector<Range> usedIndices;
+	std::vector<Range> usedWideIndices;
+	for (std::uint32_t id = 0; id < (std::uint32_t)mMeshes.size(); ++id)
+	{
+		Mesh& mesh = mMeshes[id];
+		if (!mesh.Live)
+			continue;
+
+		if (newVertices[id].Offset != mesh.Vertices.Offset || newIndices[id].Offset != mesh.Indices.Offset)
+		{
+			Move move;
+			move.Id = id;
+			move.Wide = mesh.Wide;
+			move.OldVertices = mesh.Vertices;
+			move.NewVertices = newVertices[id];
+			move.OldIndices = mesh.Indices;
+			move.NewIndices = newIndices[id];
+			moves.push_back(move);
+
+			mesh.Vertices = newVertices[id];
+			mesh.Indices = newIndices[id];
+		}
+
+		usedVertices.push_back(mesh.Vertices);
+		(mesh.Wide ? usedWideIndices : usedIndices).push_back(mesh.Indices);
+	}
+
+	if (moves.empty())
+		return moves;
+
+	auto byOffset = [](const Range& a, const Range& b) { return a.Offset < b.Offset; };
+	std::sort(usedVertices.begin(), usedVertices.end(), byOffset);
+	std::sort(usedIndices.begin(), usedIndices.end(), byOffset);
+	std::sort(usedWideIndices.begin(), usedWideIndices.end(), byOffset);
+	mFreeVertices.Reset(usedVertices);
+	mFreeIndices.Reset(usedIndices);
+	mFreeWideIndices.Reset(usedWideIndices);
+
+	++mVersion;
+	return moves;
+}
+
+void GeometryArenaLayout::Place(std::uint32_t id, std::uint32_t& startIndexLocation, std::int32_t& baseVertexLocation)const
+{
+	startIndexLocation += mMeshes[id].Indices.Offset;
+	baseVertexLocation += (std::int32_t)mMeshes[id].Vertices.Offset;
+}
+
+const GeometryArenaLayout::Range& GeometryArenaLayout::GetVertexRange(std::uint32_t id)const
+{
+	return mMeshes[id].Vertices;
+}
+
+const GeometryArenaLayout::Range& GeometryArenaLayout::GetIndexRange(std::uint32_t id)const
+{
+	return mMeshes[id].Indices;
+}
+
+bool GeometryArenaLayout::IsPinned(std::uint32_t id)const
+{
+	return mMeshes[id].Pinned;
+}
+
+bool GeometryArenaLayout::IsWide(std::uint32_t id)const
+{
+	return mMeshes[id].Wide;
+}
+
+const GeometryArenaLayout::FreeList& GeometryArenaLayout::GetFreeVertices()const
+{
+	return mFreeVertices;
+}
+
+const GeometryArenaLayout::FreeList& GeometryArenaLayout::GetFreeIndices()const
+{
+	return mFreeIndices;
+}
+
+const GeometryArenaLayout::FreeList& GeometryArenaLayout::GetFreeWideIndices()const
+{
+	return mFreeWideIndices;
+}
+
+std::uint32_t GeometryArenaLayout::GetMeshCount()const
+{
+	return (std::uint32_t)(mMeshes.size() - mFreeIds.size());
+}
+
+std::uint32_t GeometryArenaLayout::GetVersion()const
+{
+	return mVersion;
+}
+
+GeometryArenaLayout::FreeList& GeometryArenaLayout::IndexFreeList(bool wide)
+{
+	return wide ? mFreeWideIndices : mFreeIndices;
+}
@@ -0,0 +1,135 @@
+//***************************************************************************************
+// GeometryArenaLayout.h
+//
+// Where GeometryArena keeps each mesh: the vertex and index ranges of the meshes, the
+// free lists they are allocated from and how compaction moves them.  It is only
+// bookkeeping, without the buffers or any GPU copies, so it builds and is tested
+// without Direct3D.
+//
+// Indices stay relative to their mesh, so 16-bit indices serve any number of meshes of
+// up to MaxNarrowVertices vertices each.  The indices of larger meshes are kept in a
+// second, 32-bit index buffer with a free list of its own.
+//
+// Compaction slides every live mesh towards the front of the buffers, keeping their
+// order, except pinned meshes: those keep their offsets for as long as they live.
+// Meshes whose draw arguments are copied into render items and never looked up again
+// must be pinned; the others call Place again whenever GetVersion changes.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class GeometryArenaLayout
+{
+public:
+
+	struct Range
+	{
+		std::uint32_t Offset = 0;
+		std::uint32_t Count = 0;
+	};
+
+	// First-fit allocator over [0, capacity) elements.
+	class FreeList
+	{
+	public:
+		explicit FreeList(std::uint32_t capacity);
+
+		bool Allocate(std::uint32_t count, std::uint32_t& offset);
+		void Free(std::uint32_t offset, std::uint32_t count);
+
+		// Marks the given ranges allocated and the rest free.  used must be sorted by
+		// offset and must not overlap.
+		void Reset(const std::vector<Range>& used);
+
+		std::uint32_t GetCapacity()const;
+		std::uint32_t GetFreeCount()const;
+		std::uint32_t GetLargestFreeRange()const;
+
+	private:
+		// Sorted by offset, never adjacent.
+		std::vector<Range> mFree;
+		std::uint32_t mCapacity;
+		std::uint32_t mFreeCount;
+	};
+
+	// A mesh that compaction moved, with its ranges before and after.
+	struct Move
+	{
+		std::uint32_t Id = 0;
+		bool Wide = false;
+		Range OldVertices;
+		Range NewVertices;
+		Range OldIndices;
+		Range NewIndices;
+	};
+
+	static const std::uint32_t InvalidId = 0xffffffff;
+
+	// Largest mesh whose indices are 16-bit.
+	static const std::uint32_t MaxNarrowVertices = 65536;
+
+	GeometryArenaLayout(std::uint32_t vertexCapacity, std::uint32_t indexCapacity,
+		std::uint32_t wideIndexCapacity = 0);
+
+	// Meshes of more than MaxNarrowVertices vertices get their indices from the 32-bit
+	// range.  Returns false, changing nothing, when either range does not fit in one
+	// piece.
+	bool Allocate(std::uint32_t vertexCount, std::uint32_t indexCount, bool pinned, std::uint32_t& id);
+	void Free(std::uint32_t id);
+
+	// True when the meshes would fit after compacting, although they do not now.
+	bool FitsAfterCompact(std::uint32_t vertexCount, std::uint32_t indexCount)const;
+
+	// Slides the live meshes that are not pinned to the front and returns those that
+	// moved.  Changes the version when any did.
+	std::vector<Move> Compact();
+
+	// Offsets a submesh relative to the mesh by where the mesh is now.
+	void Place(std::uint32_t id, std::uint32_t& startIndexLocation, std::int32_t& baseVertexLocation)const;
+
+	const Range& GetVertexRange(std::uint32_t id)const;
+	const Range& GetIndexRange(std::uint32_t id)const;
+	bool IsPinned(std::uint32_t id)const;
+	bool IsWide(std::uint32_t id)const;
+
+	const FreeList& GetFreeVertices()const;
+	const FreeList& GetFreeIndices()const;
+	const FreeList& GetFreeWideIndices()const;
+	std::uint32_t GetMeshCount()const;
+	std::uint32_t GetVersion()const;
+
+private:
+
+	struct Mesh
+	{
+		Range Vertices;
+		Range Indices;
+		bool Live = false;
+		bool Pinned = false;
+		bool Wide = false;
+	};
+
+	// Live meshes with indices of the given width, or all live meshes.
+	enum class Meshes { Narrow, Wide, All };
+	std::vector<std::uint32_t> GetLiveMeshes(Meshes which)const;
+
+	// New ranges of meshes in one buffer, indexed by id; range selects the vertex or
+	// index one.  The other entries are empty.
+	std::vector<Range> Slide(const std::vector<std::uint32_t>& meshes, Range Mesh::* range)const;
+
+	FreeList& IndexFreeList(bool wide);
+
+private:
+
+	FreeList mFreeVertices;
+	FreeList mFreeIndices;
+	FreeList mFreeWideIndices;
+
+	std::vector<Mesh> mMeshes;
+	std::vector<std::uint32_t> mFreeIds;
+
+	std::uint32_t mVersion = 0;
+};
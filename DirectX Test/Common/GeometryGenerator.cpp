@@ -4,9 +4,81 @@
 
 #include "GeometryGenerator.h"
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
 
 using namespace DirectX;
 
+namespace
+{
+	using uint32 = GeometryGenerator::uint32;
+
+	// Vertices (or quads) per task when a generator is split across threads.  Meshes
+	// smaller than this are built on the calling thread.
+	const uint32 ParallelChunkSize = 16384;
+
+	// Calls body(first, last) over consecutive rows [first, last) covering [0, rowCount),
+	// spread over all hardware threads when the rows add up to more than one chunk.
+	// Every row must write its own part of the output only.
+	void ParallelRows(uint32 rowCount, uint32 rowSize, const std::function<void(uint32, uint32)>& body)
+	{
+		uint32 rowsPerChunk = std::max(ParallelChunkSize / std::max(rowSize, 1u), 1u);
+		uint32 chunkCount = (rowCount + rowsPerChunk - 1) / rowsPerChunk;
+		uint32 threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), chunkCount);
+
+		if(threadCount <= 1)
+		{
+			if(rowCount > 0)
+				body(0, rowCount);
+			return;
+		}
+
+		std::atomic<uint32> nextChunk(0);
+		auto worker = [&]()
+		{
+			for(uint32 i = nextChunk++; i < chunkCount; i = nextChunk++)
+				body(i*rowsPerChunk, std::min((i+1)*rowsPerChunk, rowCount));
+		};
+
+		// The calling thread takes a share of the chunks too.
+		std::vector<std::thread> threads;
+		for(uint32 i = 1; i < threadCount; ++i)
+			threads.emplace_back(worker);
+		worker();
+		for(std::thread& t : threads)
+			t.join();
+	}
+
+	// sines[i] = sin(i*step) and cosines[i] = cos(i*step) for i in [0, count), four
+	// angles per XMVectorSinCos.
+	void SinCosTable(float step, uint32 count, std::vector<float>& sines, std::vector<float>& cosines)
+	{
+		sines.resize(count);
+		cosines.resize(count);
+
+		for(uint32 i = 0; i < count; i += 4)
+		{
+			XMVECTOR angles = XMVectorSet(i*step, (i+1)*step, (i+2)*step, (i+3)*step);
+			XMVECTOR s, c;
+			XMVectorSinCos(&s, &c, angles);
+
+			XMFLOAT4 s4, c4;
+			XMStoreFloat4(&s4, s);
+			XMStoreFloat4(&c4, c);
+
+			const float* sp = &s4.x;
+			const float* cp = &c4.x;
+			for(uint32 k = 0; k < 4 && i + k < count; ++k)
+			{
+				sines[i + k] = sp[k];
+				cosines[i + k] = cp[k];
+			}
+		}
+	}
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
     MeshData meshData;
@@ -114,98 +186,120 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices.push_back( topVertex );
-
 	float phiStep   = XM_PI/stackCount;
 	float thetaStep = 2.0f*XM_PI/sliceCount;
 
+	// Every vertex of a ring shares sin/cos(phi) and every vertex of a slice shares
+	// sin/cos(theta), so the trigonometry is done once per ring and once per slice.
+	// The last slice repeats the first exactly so that the seam is closed.
+	std::vector<float> sinPhi, cosPhi, sinTheta, cosTheta;
+	SinCosTable(phiStep, stackCount, sinPhi, cosPhi);
+	SinCosTable(thetaStep, sliceCount + 1, sinTheta, cosTheta);
+	sinTheta[sliceCount] = sinTheta[0];
+	cosTheta[sliceCount] = cosTheta[0];
+
+	uint32 ringVertexCount = sliceCount + 1;
+	uint32 ringCount = stackCount - 1;
+
+	meshData.Vertices.resize(ringCount*ringVertexCount + 2);
+	meshData.Vertices.front() = topVertex;
+	meshData.Vertices.back() = bottomVertex;
+
 	// Compute vertices for each stack ring (do not count the poles as rings).
-	for(uint32 i = 1; i <= stackCount-1; ++i)
+	ParallelRows(ringCount, ringVertexCount, [&](uint32 firstRing, uint32 lastRing)
 	{
-		float phi = i*phiStep;
-
-		// Vertices of ring.
-        for(uint32 j = 0; j <= sliceCount; ++j)
+		for(uint32 ring = firstRing; ring < lastRing; ++ring)
 		{
-			float theta = j*thetaStep;
+			uint32 i = ring + 1;
+			float sp = sinPhi[i];
+			float cp = cosPhi[i];
+			Vertex* ringVertices = &meshData.Vertices[1 + ring*ringVertexCount];
 
-			Vertex v;
+			// Vertices of ring.
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				float st = sinTheta[j];
+				float ct = cosTheta[j];
 
-			// spherical to cartesian
-			v.Position.x = radius*sinf(phi)*cosf(theta);
-			v.Position.y = radius*cosf(phi);
-			v.Position.z = radius*sinf(phi)*sinf(theta);
+				Vertex& v = ringVertices[j];
 
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+				// spherical to cartesian
+				v.Position.x = radius*sp*ct;
+				v.Position.y = radius*cp;
+				v.Position.z = radius*sp*st;
 
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+				// Partial derivative of P with respect to theta, normalised; sin(phi) > 0
+				// away from the poles.
+				v.TangentU = XMFLOAT3(-st, 0.0f, ct);
 
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+				v.Normal = XMFLOAT3(sp*ct, cp, sp*st);
 
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
-
-			meshData.Vertices.push_back( v );
+				v.TexC.x = (float)j/sliceCount;
+				v.TexC.y = (float)i/stackCount;
+			}
 		}
-	}
+	});
+
+	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
 
-	meshData.Vertices.push_back( bottomVertex );
+	// Top fan, the stacks in between, then the bottom fan.
+	uint32 innerStackCount = stackCount - 2;
+	uint32 topIndexCount = 3*sliceCount;
+	uint32 stackIndexCount = 6*sliceCount;
+	meshData.Indices32.resize(2*topIndexCount + innerStackCount*stackIndexCount);
 
 	//
 	// Compute indices for top stack.  The top stack was written first to the vertex buffer
 	// and connects the top pole to the first ring.
 	//
 
-    for(uint32 i = 1; i <= sliceCount; ++i)
+	uint32* indices = meshData.Indices32.data();
+	for(uint32 i = 1; i <= sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i+1);
-		meshData.Indices32.push_back(i);
+		*indices++ = 0;
+		*indices++ = i+1;
+		*indices++ = i;
 	}
-	
+
 	//
 	// Compute indices for inner stacks (not connected to poles).
 	//
 
 	// Offset the indices to the index of the first vertex in the first ring.
 	// This is just skipping the top pole vertex.
-    uint32 baseIndex = 1;
-    uint32 ringVertexCount = sliceCount + 1;
-	for(uint32 i = 0; i < stackCount-2; ++i)
+	uint32 baseIndex = 1;
+	ParallelRows(innerStackCount, sliceCount, [&](uint32 firstStack, uint32 lastStack)
 	{
-		for(uint32 j = 0; j < sliceCount; ++j)
+		for(uint32 i = firstStack; i < lastStack; ++i)
 		{
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			uint32* stackIndices = &meshData.Indices32[topIndexCount + i*stackIndexCount];
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				*stackIndices++ = baseIndex + i*ringVertexCount + j;
+				*stackIndices++ = baseIndex + i*ringVertexCount + j+1;
+				*stackIndices++ = baseIndex + (i+1)*ringVertexCount + j;
+
+				*stackIndices++ = baseIndex + (i+1)*ringVertexCount + j;
+				*stackIndices++ = baseIndex + i*ringVertexCount + j+1;
+				*stackIndices++ = baseIndex + (i+1)*ringVertexCount + j+1;
+			}
 		}
-	}
+	});
 
 	//
 	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
 	// and connects the bottom pole to the bottom ring.
 	//
 
-	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
-
 	// Offset the indices to the index of the first vertex in the last ring.
 	baseIndex = southPoleIndex - ringVertexCount;
-	
+
+	indices = &meshData.Indices32[topIndexCount + innerStackCount*stackIndexCount];
 	for(uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex+i);
-		meshData.Indices32.push_back(baseIndex+i+1);
+		*indices++ = southPoleIndex;
+		*indices++ = baseIndex+i;
+		*indices++ = baseIndex+i+1;
 	}
 
     return meshData;
@@ -213,12 +307,40 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
+	// The original vertices stay where they are and become the corners of the new
+	// triangles; only the index list is rebuilt.
+	std::vector<uint32> inputIndices;
+	inputIndices.swap(meshData.Indices32);
+
+	uint32 numTris = (uint32)inputIndices.size()/3;
 
+	// A closed mesh has 1.5 edges per triangle and every edge gets one midpoint.
+	size_t numEdges = (size_t)numTris*3/2 + 3;
+	meshData.Vertices.reserve(meshData.Vertices.size() + numEdges);
+	meshData.Indices32.reserve((size_t)numTris*12);
 
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
+	// Midpoint vertex of each edge, keyed by its corner indices (smaller first), so the
+	// two triangles sharing an edge share its midpoint too.
+	std::unordered_map<std::uint64_t, uint32> midPoints;
+	midPoints.reserve(numEdges);
+
+	auto getMidPoint = [&](uint32 a, uint32 b)
+	{
+		std::uint64_t key = a < b ?
+			((std::uint64_t)a << 32) | b :
+			((std::uint64_t)b << 32) | a;
+
+		auto it = midPoints.find(key);
+		if(it != midPoints.end())
+			return it->second;
+
+		Vertex m = MidPoint(meshData.Vertices[a], meshData.Vertices[b]);
+
+		uint32 index = (uint32)meshData.Vertices.size();
+		meshData.Vertices.push_back(m);
+		midPoints.emplace(key, index);
+		return index;
+	};
 
 	//       v1
 	//       *
@@ -230,47 +352,39 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
 	for(uint32 i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
+		uint32 v0 = inputIndices[i*3+0];
+		uint32 v1 = inputIndices[i*3+1];
+		uint32 v2 = inputIndices[i*3+2];
 
 		//
 		// Generate the midpoints.
 		//
 
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
+		uint32 m0 = getMidPoint(v0, v1);
+		uint32 m1 = getMidPoint(v1, v2);
+		uint32 m2 = getMidPoint(v0, v2);
 
 		//
 		// Add new geometry.
 		//
 
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
+		meshData.Indices32.push_back(v0);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(m2);
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(m1);
+		meshData.Indices32.push_back(m2);
 
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
+		meshData.Indices32.push_back(m2);
+		meshData.Indices32.push_back(m1);
+		meshData.Indices32.push_back(v2);
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(v1);
+		meshData.Indices32.push_back(m1);
 	}
 }
 
@@ -394,78 +508,93 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 
 	uint32 ringCount = stackCount+1;
 
+	// Add one because we duplicate the first and last vertex per ring
+	// since the texture coordinates are different.
+	uint32 ringVertexCount = sliceCount+1;
+
+	// Rings, then two caps of a ring plus a center vertex each.
+	meshData.Vertices.reserve(ringCount*ringVertexCount + 2*(ringVertexCount + 1));
+	meshData.Indices32.reserve(6*sliceCount*stackCount + 2*3*sliceCount);
+	meshData.Vertices.resize(ringCount*ringVertexCount);
+
+	// All rings share the same angles; the last repeats the first to close the seam.
+	float dTheta = 2.0f*XM_PI/sliceCount;
+	std::vector<float> sines, cosines;
+	SinCosTable(dTheta, ringVertexCount, sines, cosines);
+	sines[sliceCount] = sines[0];
+	cosines[sliceCount] = cosines[0];
+
+	// Cylinder can be parameterized as follows, where we introduce v
+	// parameter that goes in the same direction as the v tex-coord
+	// so that the bitangent goes in the same direction as the v tex-coord.
+	//   Let r0 be the bottom radius and let r1 be the top radius.
+	//   y(v) = h - hv for v in [0,1].
+	//   r(v) = r1 + (r0-r1)v
+	//
+	//   x(t, v) = r(v)*cos(t)
+	//   y(t, v) = h - hv
+	//   z(t, v) = r(v)*sin(t)
+	// 
+	//  dx/dt = -r(v)*sin(t)
+	//  dy/dt = 0
+	//  dz/dt = +r(v)*cos(t)
+	//
+	//  dx/dv = (r0-r1)*cos(t)
+	//  dy/dv = -h
+	//  dz/dv = (r0-r1)*sin(t)
+	//
+	// The tangent (-sin(t), 0, cos(t)) is unit length, and its cross product with the
+	// bitangent is (h*cos(t), r0-r1, h*sin(t)), so the normal only needs one scale.
+	float dr = bottomRadius-topRadius;
+	float normalScale = 1.0f / sqrtf(height*height + dr*dr);
+
 	// Compute vertices for each stack ring starting at the bottom and moving up.
-	for(uint32 i = 0; i < ringCount; ++i)
+	ParallelRows(ringCount, ringVertexCount, [&](uint32 firstRing, uint32 lastRing)
 	{
-		float y = -0.5f*height + i*stackHeight;
-		float r = bottomRadius + i*radiusStep;
-
-		// vertices of ring
-		float dTheta = 2.0f*XM_PI/sliceCount;
-		for(uint32 j = 0; j <= sliceCount; ++j)
+		for(uint32 i = firstRing; i < lastRing; ++i)
 		{
-			Vertex vertex;
-
-			float c = cosf(j*dTheta);
-			float s = sinf(j*dTheta);
-
-			vertex.Position = XMFLOAT3(r*c, y, r*s);
-
-			vertex.TexC.x = (float)j/sliceCount;
-			vertex.TexC.y = 1.0f - (float)i/stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			// 
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius-topRadius;
-			XMFLOAT3 bitangent(dr*c, -height, dr*s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
-		}
-	}
+			float y = -0.5f*height + i*stackHeight;
+			float r = bottomRadius + i*radiusStep;
+			Vertex* ringVertices = &meshData.Vertices[i*ringVertexCount];
 
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount+1;
+			// vertices of ring
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				Vertex& vertex = ringVertices[j];
+
+				float c = cosines[j];
+				float s = sines[j];
+
+				vertex.Position = XMFLOAT3(r*c, y, r*s);
+
+				vertex.TexC.x = (float)j/sliceCount;
+				vertex.TexC.y = 1.0f - (float)i/stackCount;
+
+				vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
+				vertex.Normal = XMFLOAT3(height*c*normalScale, dr*normalScale, height*s*normalScale);
+			}
+		}
+	});
 
 	// Compute indices for each stack.
-	for(uint32 i = 0; i < stackCount; ++i)
+	meshData.Indices32.resize(6*sliceCount*stackCount);
+	ParallelRows(stackCount, sliceCount, [&](uint32 firstStack, uint32 lastStack)
 	{
-		for(uint32 j = 0; j < sliceCount; ++j)
+		for(uint32 i = firstStack; i < lastStack; ++i)
 		{
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
-
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
-			meshData.Indices32.push_back(i*ringVertexCount + j+1);
+			uint32* stackIndices = &meshData.Indices32[6*sliceCount*i];
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				*stackIndices++ = i*ringVertexCount + j;
+				*stackIndices++ = (i+1)*ringVertexCount + j;
+				*stackIndices++ = (i+1)*ringVertexCount + j+1;
+
+				*stackIndices++ = i*ringVertexCount + j;
+				*stackIndices++ = (i+1)*ringVertexCount + j+1;
+				*stackIndices++ = i*ringVertexCount + j+1;
+			}
 		}
-	}
+	});
 
 	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
 	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
@@ -569,22 +698,26 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float dv = 1.0f / (m-1);
 
 	meshData.Vertices.resize(vertexCount);
-	for(uint32 i = 0; i < m; ++i)
+	ParallelRows(m, n, [&](uint32 firstRow, uint32 lastRow)
 	{
-		float z = halfDepth - i*dz;
-		for(uint32 j = 0; j < n; ++j)
+		for(uint32 i = firstRow; i < lastRow; ++i)
 		{
-			float x = -halfWidth + j*dx;
-
-			meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			// Stretch texture over grid.
-			meshData.Vertices[i*n+j].TexC.x = j*du;
-			meshData.Vertices[i*n+j].TexC.y = i*dv;
+			float z = halfDepth - i*dz;
+			Vertex* row = &meshData.Vertices[i*n];
+			for(uint32 j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j*dx;
+
+				row[j].Position = XMFLOAT3(x, 0.0f, z);
+				row[j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				row[j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+				// Stretch texture over grid.
+				row[j].TexC.x = j*du;
+				row[j].TexC.y = i*dv;
+			}
 		}
-	}
+	});
  
     //
 	// Create the indices.
@@ -592,23 +725,27 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 
 	meshData.Indices32.resize(faceCount*3); // 3 indices per face
 
-	// Iterate over each quad and compute indices.
-	uint32 k = 0;
-	for(uint32 i = 0; i < m-1; ++i)
+	// Iterate over each quad and compute indices.  Row i of quads starts at index
+	// 6*(n-1)*i, so the rows can be written independently.
+	ParallelRows(m-1, n-1, [&](uint32 firstRow, uint32 lastRow)
 	{
-		for(uint32 j = 0; j < n-1; ++j)
+		for(uint32 i = firstRow; i < lastRow; ++i)
 		{
-			meshData.Indices32[k]   = i*n+j;
-			meshData.Indices32[k+1] = i*n+j+1;
-			meshData.Indices32[k+2] = (i+1)*n+j;
-
-			meshData.Indices32[k+3] = (i+1)*n+j;
-			meshData.Indices32[k+4] = i*n+j+1;
-			meshData.Indices32[k+5] = (i+1)*n+j+1;
-
-			k += 6; // next quad
+			uint32 k = 6*(n-1)*i;
+			for(uint32 j = 0; j < n-1; ++j)
+			{
+				meshData.Indices32[k]   = i*n+j;
+				meshData.Indices32[k+1] = i*n+j+1;
+				meshData.Indices32[k+2] = (i+1)*n+j;
+
+				meshData.Indices32[k+3] = (i+1)*n+j;
+				meshData.Indices32[k+4] = i*n+j+1;
+				meshData.Indices32[k+5] = (i+1)*n+j+1;
+
+				k += 6; // next quad
+			}
 		}
-	}
+	});
 
     return meshData;
 }
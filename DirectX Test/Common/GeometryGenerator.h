@@ -17,6 +17,7 @@
 
 #include <cstdint>
 #include <DirectXMath.h>
+#include <stdexcept>
 #include <vector>
 
 class GeometryGenerator
@@ -26,6 +27,9 @@ public:
     using uint16 = std::uint16_t;
     using uint32 = std::uint32_t;
 
+    // Bumped whenever a generator's output changes, which invalidates cached meshes.
+    static const uint32 Version = 2;
+
 	struct Vertex
 	{
 		Vertex(){}
@@ -59,8 +63,20 @@ public:
 		std::vector<Vertex> Vertices;
         std::vector<uint32> Indices32;
 
+        // Largest vertex count that 16-bit indices can address.
+        static const uint32 MaxVertices16 = 65536;
+
+        bool FitsIndices16()const
+        {
+            return Vertices.size() <= MaxVertices16;
+        }
+
         std::vector<uint16>& GetIndices16()
         {
+			// Truncating the indices would silently draw the wrong vertices.
+			if(!FitsIndices16())
+				throw std::overflow_error("MeshData::GetIndices16: more than 65536 vertices, use Indices32");
+
 			if(mIndices16.empty())
 			{
 				mIndices16.resize(Indices32.size());
@@ -0,0 +1,44 @@
+//***************************************************************************************
+// Hash.h
+//
+// 64-bit FNV-1a, the one hash behind asset pack names, resource ids and the mesh, shader
+// and pipeline cache keys.  Those keys are stored in files, so changing the hash invalidates every
+// cache and pack written before.
+//
+// FNV-1a works a byte at a time, so data hashed in pieces, each call seeded with the
+// result of the one before, hashes the same as the pieces laid end to end.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr std::uint64_t Fnv1aOffsetBasis = 14695981039346656037ull;
+constexpr std::uint64_t Fnv1aPrime = 1099511628211ull;
+
+inline std::uint64_t Fnv1a(const void* data, std::size_t size, std::uint64_t seed = Fnv1aOffsetBasis)
+{
+	const std::uint8_t* bytes = (const std::uint8_t*)data;
+
+	std::uint64_t hash = seed;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= Fnv1aPrime;
+	}
+	return hash;
+}
+
+// Fnv1a of a zero terminated string, without the terminator.  constexpr so that a string
+// literal is hashed by the compiler; recursive so that it stays a single return
+// statement, as C++11 constexpr functions must be.
+constexpr std::uint64_t Fnv1aString(const char* s, std::uint64_t hash = Fnv1aOffsetBasis)
+{
+	return *s == '\0' ? hash : Fnv1aString(s + 1, (hash ^ (std::uint8_t)*s) * Fnv1aPrime);
+}
+
+// Reference values of 64-bit FNV-1a.
+static_assert(Fnv1aString("") == 0xcbf29ce484222325ull, "FNV-1a offset basis");
+static_assert(Fnv1aString("a") == 0xaf63dc4c8601ec8cull, "FNV-1a of \"a\"");
+static_assert(Fnv1aString("foobar") == 0x85944171f73967e8ull, "FNV-1a of \"foobar\"");
@@ -0,0 +1,69 @@
+//***************************************************************************************
+// IndexPacking.cpp
+//***************************************************************************************
+
+#include "IndexPacking.h"
+#include <stdexcept>
+
+DXGI_FORMAT NarrowestIndexFormat(size_t vertexCount)
+{
+	return vertexCount <= 65536 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
+size_t IndexByteSize(DXGI_FORMAT format)
+{
+	return format == DXGI_FORMAT_R16_UINT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+DXGI_FORMAT PackIndices(
+	const std::vector<std::uint32_t>& indices,
+	size_t vertexCount,
+	std::vector<std::uint8_t>& bytes)
+{
+	const DXGI_FORMAT format = NarrowestIndexFormat(vertexCount);
+	bytes.resize(indices.size() * IndexByteSize(format));
+
+	if (format == DXGI_FORMAT_R16_UINT)
+	{
+		std::uint16_t* dst = reinterpret_cast<std::uint16_t*>(bytes.data());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			if (indices[i] >= vertexCount)
+				throw std::out_of_range("PackIndices: index out of range");
+			dst[i] = static_cast<std::uint16_t>(indices[i]);
+		}
+	}
+	else
+	{
+		std::uint32_t* dst = reinterpret_cast<std::uint32_t*>(bytes.data());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			if (indices[i] >= vertexCount)
+				throw std::out_of_range("PackIndices: index out of range");
+			dst[i] = indices[i];
+		}
+	}
+
+	return format;
+}
+
+void CheckIndices(const void* indices, size_t count, DXGI_FORMAT format, size_t vertexCount)
+{
+	// The largest index decides, so the loops have no early exit to vectorise around.
+	std::uint32_t largest = 0;
+	if (format == DXGI_FORMAT_R16_UINT)
+	{
+		const std::uint16_t* src = static_cast<const std::uint16_t*>(indices);
+		for (size_t i = 0; i < count; ++i)
+			largest = src[i] > largest ? src[i] : largest;
+	}
+	else
+	{
+		const std::uint32_t* src = static_cast<const std::uint32_t*>(indices);
+		for (size_t i = 0; i < count; ++i)
+			largest = src[i] > largest ? src[i] : largest;
+	}
+
+	if (count > 0 && largest >= vertexCount)
+		throw std::out_of_range("CheckIndices: index out of range");
+}
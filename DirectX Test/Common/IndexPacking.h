@@ -0,0 +1,33 @@
+//***************************************************************************************
+// IndexPacking.h
+//
+// Index buffer data in R16_UINT or R32_UINT.  Meshes of up to 65536 vertices get 16-bit
+// indices and larger ones 32-bit indices; in both formats every index is checked
+// against the vertex count, so a bad index throws here instead of reaching the GPU.
+//
+// Only the DXGI_FORMAT values are needed, so this builds without Direct3D; on Linux
+// dxgiformat.h comes from DirectX-Headers.
+//***************************************************************************************
+
+#pragma once
+
+#include <dxgiformat.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// R16_UINT up to 65536 vertices, R32_UINT above.
+DXGI_FORMAT NarrowestIndexFormat(size_t vertexCount);
+
+// Size of one index of format, which must be R16_UINT or R32_UINT.
+size_t IndexByteSize(DXGI_FORMAT format);
+
+// Writes indices in NarrowestIndexFormat(vertexCount) and returns that format.  Throws
+// std::out_of_range if an index is not below vertexCount.
+DXGI_FORMAT PackIndices(
+	const std::vector<std::uint32_t>& indices,
+	size_t vertexCount,
+	std::vector<std::uint8_t>& bytes);
+
+// Throws std::out_of_range if one of count indices of format is not below vertexCount.
+void CheckIndices(const void* indices, size_t count, DXGI_FORMAT format, size_t vertexCount);
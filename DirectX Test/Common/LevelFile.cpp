@@ -0,0 +1,527 @@
+//***************************************************************************************
+// LevelFile.cpp
+//***************************************************************************************
+
+#include "LevelFile.h"
+#include <windows.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+static_assert(sizeof(LevelHeader) == 56, "LevelHeader must not change size");
+static_assert(sizeof(LevelTexture) == 12, "LevelTexture must not change size");
+static_assert(sizeof(LevelMaterial) == 40, "LevelMaterial must not change size");
+static_assert(sizeof(LevelNode) == 80, "LevelNode must not change size");
+static_assert(sizeof(LevelWave) == 12, "LevelWave must not change size");
+
+namespace
+{
+	const std::uint32_t SectionAlignment = 8;
+
+	// Limits on what a header may claim, so that a damaged file cannot make the game
+	// build millions of nodes.
+	const std::uint32_t MaxRecords = 1 << 20;
+
+	std::uint32_t AlignUp(std::uint32_t offset)
+	{
+		return (offset + SectionAlignment - 1) & ~(SectionAlignment - 1);
+	}
+
+	bool SectionFits(std::uint32_t offset, std::uint32_t count, size_t recordSize, size_t fileSize)
+	{
+		return count <= MaxRecords && offset % SectionAlignment == 0 &&
+			(std::uint64_t)offset + (std::uint64_t)count * recordSize <= fileSize;
+	}
+
+	// Collects zero terminated strings, each stored once.
+	class StringTable
+	{
+	public:
+		StringTable()
+		{
+			Add("");
+		}
+
+		std::uint32_t Add(const std::string& s)
+		{
+			auto it = mOffsets.find(s);
+			if (it != mOffsets.end())
+				return it->second;
+
+			std::uint32_t offset = (std::uint32_t)mData.size();
+			mData.insert(mData.end(), s.begin(), s.end());
+			mData.push_back('\0');
+			mOffsets.emplace(s, offset);
+			return offset;
+		}
+
+		const std::vector<char>& GetData()const { return mData; }
+
+	private:
+		std::vector<char> mData;
+		std::unordered_map<std::string, std::uint32_t> mOffsets;
+	};
+
+	// Parses one line and reports errors with its location.
+	class LineReader
+	{
+	public:
+		LineReader(const std::string& line, const std::string& location)
+			: mStream(line)
+			, mLocation(location)
+		{
+		}
+
+		bool Next(std::string& token)
+		{
+			return (bool)(mStream >> token);
+		}
+
+		std::string Word(const char* what)
+		{
+			std::string token;
+			if (!Next(token))
+				Fail(std::string("expected ") + what);
+			return token;
+		}
+
+		float Number(const char* what)
+		{
+			std::string token = Word(what);
+			char* end = nullptr;
+			float value = std::strtof(token.c_str(), &end);
+			if (end == token.c_str() || *end != '\0')
+				Fail(std::string("expected ") + what + ", found '" + token + "'");
+			return value;
+		}
+
+		DirectX::XMFLOAT3 Float3(const char* what)
+		{
+			DirectX::XMFLOAT3 v;
+			v.x = Number(what);
+			v.y = Number(what);
+			v.z = Number(what);
+			return v;
+		}
+
+		[[noreturn]] void Fail(const std::string& message)const
+		{
+			throw std::runtime_error(mLocation + ": " + message);
+		}
+
+	private:
+		std::istringstream mStream;
+		std::string mLocation;
+	};
+
+	struct ParsedNode
+	{
+		LevelNode Node;
+		std::string Name;
+		std::string ParentName;
+		std::string MaterialName;
+		std::string Location;
+	};
+
+	bool IsNodeKeyword(const std::string& token)
+	{
+		return token == "name" || token == "parent" || token == "material" ||
+			token == "position" || token == "rotation" || token == "scale";
+	}
+
+	template <typename T>
+	void AppendSection(std::vector<std::uint8_t>& data, const std::vector<T>& records, std::uint32_t& offset)
+	{
+		data.resize(AlignUp((std::uint32_t)data.size()));
+		offset = (std::uint32_t)data.size();
+		if (!records.empty())
+		{
+			const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(records.data());
+			data.insert(data.end(), bytes, bytes + records.size() * sizeof(T));
+		}
+	}
+}
+
+bool LevelFile::Load(const std::wstring& filename)
+{
+	std::ifstream fin(filename, std::ios::binary | std::ios::ate);
+	if (!fin)
+		return false;
+
+	std::streamoff size = fin.tellg();
+	if (size < (std::streamoff)sizeof(LevelHeader) || size > 0x7fffffff)
+		return false;
+
+	// The only allocation: the records are used in place.
+	std::vector<std::uint8_t> data((size_t)size);
+	fin.seekg(0);
+	if (!fin.read(reinterpret_cast<char*>(data.data()), size))
+		return false;
+
+	return Load(std::move(data));
+}
+
+bool LevelFile::Load(std::vector<std::uint8_t> data)
+{
+	mHeader = nullptr;
+	mData = std::move(data);
+	if (mData.size() < sizeof(LevelHeader))
+		return false;
+
+	const std::uint8_t* base = mData.data();
+	const LevelHeader* header = reinterpret_cast<const LevelHeader*>(base);
+	if (header->Magic != LevelHeader::MagicValue ||
+		header->Version != LevelHeader::CurrentVersion ||
+		!SectionFits(header->TextureOffset, header->TextureCount, sizeof(LevelTexture), mData.size()) ||
+		!SectionFits(header->MaterialOffset, header->MaterialCount, sizeof(LevelMaterial), mData.size()) ||
+		!SectionFits(header->NodeOffset, header->NodeCount, sizeof(LevelNode), mData.size()) ||
+		!SectionFits(header->WaveOffset, header->WaveCount, sizeof(LevelWave), mData.size()) ||
+		header->StringSize == 0 ||
+		(std::uint64_t)header->StringOffset + header->StringSize > mData.size())
+		return false;
+
+	mTextures = reinterpret_cast<const LevelTexture*>(base + header->TextureOffset);
+	mMaterials = reinterpret_cast<const LevelMaterial*>(base + header->MaterialOffset);
+	mNodes = reinterpret_cast<const LevelNode*>(base + header->NodeOffset);
+	mWaves = reinterpret_cast<const LevelWave*>(base + header->WaveOffset);
+	mStrings = reinterpret_cast<const char*>(base + header->StringOffset);
+	mHeader = header;
+
+	if (!Validate())
+	{
+		mHeader = nullptr;
+		return false;
+	}
+	return true;
+}
+
+std::uint32_t LevelFile::GetStartNodeCount()const
+{
+	return mHeader->WaveCount > 0 ? mWaves[0].FirstNode : mHeader->NodeCount;
+}
+
+bool LevelFile::Validate()const
+{
+	const LevelHeader& header = *mHeader;
+	if (mStrings[header.StringSize - 1] != '\0')
+		return false;
+
+	auto validString = [&](std::uint32_t offset) { return offset < header.StringSize; };
+
+	for (std::uint32_t i = 0; i < header.TextureCount; ++i)
+	{
+		const LevelTexture& texture = mTextures[i];
+		if (!validString(texture.Name) || !validString(texture.File) || texture.Kind > LevelTexture_Streamed)
+			return false;
+	}
+
+	for (std::uint32_t i = 0; i < header.MaterialCount; ++i)
+	{
+		if (!validString(mMaterials[i].Name) || mMaterials[i].Texture >= header.TextureCount)
+			return false;
+	}
+
+	// The waves tile the end of the node array in order.
+	std::uint32_t next = header.NodeCount;
+	for (std::uint32_t w = header.WaveCount; w-- > 0; )
+	{
+		const LevelWave& wave = mWaves[w];
+		if (wave.NodeCount > next || wave.FirstNode != next - wave.NodeCount ||
+			(w > 0 && mWaves[w - 1].Time > wave.Time))
+			return false;
+		next = wave.FirstNode;
+	}
+
+	for (std::uint32_t i = 0; i < header.NodeCount; ++i)
+	{
+		const LevelNode& node = mNodes[i];
+		if (!validString(node.Type) || !validString(node.Variant) || !validString(node.Name))
+			return false;
+
+		bool inWave = node.Wave != LevelNoIndex;
+		if (inWave != (i >= next) ||
+			(inWave && (node.Wave >= header.WaveCount || i - mWaves[node.Wave].FirstNode >= mWaves[node.Wave].NodeCount)))
+			return false;
+
+		if (node.Parent != LevelNoIndex && (node.Parent >= i || mNodes[node.Parent].Wave != node.Wave))
+			return false;
+
+		if (node.Material != LevelNoIndex && node.Material >= header.MaterialCount)
+			return false;
+	}
+	return true;
+}
+
+std::vector<std::uint8_t> LevelCompiler::Compile(std::istream& text, const std::string& sourceName)
+{
+	LevelHeader header;
+	StringTable strings;
+	std::vector<LevelTexture> textures;
+	std::vector<LevelMaterial> materials;
+	std::vector<ParsedNode> nodes;
+	std::vector<float> waveTimes;
+
+	std::unordered_map<std::string, std::uint32_t> textureIndices;
+	std::unordered_map<std::string, std::uint32_t> materialIndices;
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(text, line); ++lineNumber)
+	{
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		LineReader reader(line, sourceName + "(" + std::to_string(lineNumber) + ")");
+		std::string keyword;
+		if (!reader.Next(keyword))
+			continue;
+
+		if (keyword == "scroll")
+		{
+			header.ScrollSpeed = reader.Number("scroll speed");
+		}
+		else if (keyword == "texture")
+		{
+			std::string name = reader.Word("texture name");
+			LevelTexture texture;
+			texture.Name = strings.Add(name);
+			texture.File = strings.Add(reader.Word("texture file"));
+
+			std::string kind = reader.Word("sprite or streamed");
+			if (kind == "sprite")
+				texture.Kind = LevelTexture_Sprite;
+			else if (kind == "streamed")
+				texture.Kind = LevelTexture_Streamed;
+			else
+				reader.Fail("unknown texture kind '" + kind + "'");
+
+			if (!textureIndices.emplace(name, (std::uint32_t)textures.size()).second)
+				reader.Fail("texture '" + name + "' is declared twice");
+			textures.push_back(texture);
+		}
+		else if (keyword == "material")
+		{
+			std::string name = reader.Word("material name");
+			std::string textureName = reader.Word("texture name");
+			auto texture = textureIndices.find(textureName);
+			if (texture == textureIndices.end())
+				reader.Fail("unknown texture '" + textureName + "'");
+
+			LevelMaterial material;
+			material.Name = strings.Add(name);
+			material.Texture = texture->second;
+
+			std::string property;
+			while (reader.Next(property))
+			{
+				if (property == "albedo")
+				{
+					material.DiffuseAlbedo.x = reader.Number("albedo");
+					material.DiffuseAlbedo.y = reader.Number("albedo");
+					material.DiffuseAlbedo.z = reader.Number("albedo");
+					material.DiffuseAlbedo.w = reader.Number("albedo");
+				}
+				else if (property == "fresnel")
+					material.FresnelR0 = reader.Float3("fresnel");
+				else if (property == "roughness")
+					material.Roughness = reader.Number("roughness");
+				else
+					reader.Fail("unknown material property '" + property + "'");
+			}
+
+			if (!materialIndices.emplace(name, (std::uint32_t)materials.size()).second)
+				reader.Fail("material '" + name + "' is declared twice");
+			materials.push_back(material);
+		}
+		else if (keyword == "wave")
+		{
+			waveTimes.push_back(reader.Number("wave time"));
+		}
+		else if (keyword == "node")
+		{
+			ParsedNode parsed;
+			parsed.Location = sourceName + "(" + std::to_string(lineNumber) + ")";
+
+			std::string type = reader.Word("node type");
+			parsed.Node.Type = strings.Add(type);
+			parsed.Node.TypeId = ResourceId(type.c_str());
+			parsed.Node.VariantId = ResourceId("");
+			parsed.Node.Wave = waveTimes.empty() ? LevelNoIndex : (std::uint32_t)waveTimes.size() - 1;
+
+			std::string property;
+			bool first = true;
+			while (reader.Next(property))
+			{
+				if (property == "name")
+					parsed.Name = reader.Word("node name");
+				else if (property == "parent")
+					parsed.ParentName = reader.Word("parent name");
+				else if (property == "material")
+					parsed.MaterialName = reader.Word("material name");
+				else if (property == "position")
+					parsed.Node.Position = reader.Float3("position");
+				else if (property == "rotation")
+				{
+					DirectX::XMFLOAT3 degrees = reader.Float3("rotation");
+					const float toRadians = DirectX::XM_PI / 180.0f;
+					parsed.Node.Rotation = DirectX::XMFLOAT3(degrees.x * toRadians, degrees.y * toRadians, degrees.z * toRadians);
+				}
+				else if (property == "scale")
+					parsed.Node.Scale = reader.Float3("scale");
+				else if (first && !IsNodeKeyword(property))
+				{
+					parsed.Node.Variant = strings.Add(property);
+					parsed.Node.VariantId = ResourceId(property.c_str());
+				}
+				else
+					reader.Fail("unknown node property '" + property + "'");
+				first = false;
+			}
+
+			parsed.Node.Name = strings.Add(parsed.Name);
+			nodes.push_back(parsed);
+		}
+		else
+		{
+			reader.Fail("unknown keyword '" + keyword + "'");
+		}
+	}
+
+	// Waves are stored by time; nodes are grouped by wave, keeping the declared order
+	// inside each group so that parents still come before their children.
+	std::vector<std::uint32_t> waveOrder(waveTimes.size());
+	for (std::uint32_t i = 0; i < (std::uint32_t)waveTimes.size(); ++i)
+		waveOrder[i] = i;
+	std::stable_sort(waveOrder.begin(), waveOrder.end(),
+		[&](std::uint32_t a, std::uint32_t b) { return waveTimes[a] < waveTimes[b]; });
+
+	std::vector<std::uint32_t> waveRank(waveTimes.size());
+	for (std::uint32_t rank = 0; rank < (std::uint32_t)waveOrder.size(); ++rank)
+		waveRank[waveOrder[rank]] = rank;
+
+	auto group = [&](const ParsedNode& n) { return n.Node.Wave == LevelNoIndex ? 0u : waveRank[n.Node.Wave] + 1; };
+
+	std::vector<std::uint32_t> nodeOrder(nodes.size());
+	for (std::uint32_t i = 0; i < (std::uint32_t)nodes.size(); ++i)
+		nodeOrder[i] = i;
+	std::stable_sort(nodeOrder.begin(), nodeOrder.end(),
+		[&](std::uint32_t a, std::uint32_t b) { return group(nodes[a]) < group(nodes[b]); });
+
+	std::vector<std::uint32_t> nodeIndex(nodes.size());
+	for (std::uint32_t i = 0; i < (std::uint32_t)nodeOrder.size(); ++i)
+		nodeIndex[nodeOrder[i]] = i;
+
+	// Names resolve to the last node declared before the reference.
+	std::unordered_map<std::string, std::uint32_t> declaredNodes;
+	std::vector<LevelNode> nodeRecords(nodes.size());
+	for (std::uint32_t declared = 0; declared < (std::uint32_t)nodes.size(); ++declared)
+	{
+		const ParsedNode& parsed = nodes[declared];
+		LevelNode node = parsed.Node;
+
+		if (!parsed.ParentName.empty())
+		{
+			auto parent = declaredNodes.find(parsed.ParentName);
+			if (parent == declaredNodes.end())
+				throw std::runtime_error(parsed.Location + ": unknown parent '" + parsed.ParentName + "'");
+
+			if (nodes[parent->second].Node.Wave != parsed.Node.Wave)
+				throw std::runtime_error(parsed.Location + ": parent '" + parsed.ParentName + "' spawns in another wave");
+			node.Parent = nodeIndex[parent->second];
+		}
+
+		if (!parsed.MaterialName.empty())
+		{
+			auto material = materialIndices.find(parsed.MaterialName);
+			if (material == materialIndices.end())
+				throw std::runtime_error(parsed.Location + ": unknown material '" + parsed.MaterialName + "'");
+			node.Material = material->second;
+		}
+
+		if (node.Wave != LevelNoIndex)
+			node.Wave = waveRank[node.Wave];
+
+		nodeRecords[nodeIndex[declared]] = node;
+		if (!parsed.Name.empty())
+			declaredNodes[parsed.Name] = declared;
+	}
+
+	std::vector<LevelWave> waveRecords(waveTimes.size());
+	for (std::uint32_t rank = 0; rank < (std::uint32_t)waveRecords.size(); ++rank)
+	{
+		waveRecords[rank].Time = waveTimes[waveOrder[rank]];
+		waveRecords[rank].FirstNode = (std::uint32_t)nodes.size();
+	}
+	for (std::uint32_t i = (std::uint32_t)nodeRecords.size(); i-- > 0; )
+	{
+		std::uint32_t wave = nodeRecords[i].Wave;
+		if (wave == LevelNoIndex)
+			break;
+		waveRecords[wave].FirstNode = i;
+		++waveRecords[wave].NodeCount;
+	}
+	// Waves without nodes start where the next one does.
+	for (std::uint32_t rank = (std::uint32_t)waveRecords.size(); rank-- > 1; )
+	{
+		if (waveRecords[rank - 1].NodeCount == 0)
+			waveRecords[rank - 1].FirstNode = waveRecords[rank].FirstNode;
+	}
+
+	header.TextureCount = (std::uint32_t)textures.size();
+	header.MaterialCount = (std::uint32_t)materials.size();
+	header.NodeCount = (std::uint32_t)nodeRecords.size();
+	header.WaveCount = (std::uint32_t)waveRecords.size();
+	header.StringSize = (std::uint32_t)strings.GetData().size();
+
+	std::vector<std::uint8_t> data(sizeof(LevelHeader));
+	AppendSection(data, textures, header.TextureOffset);
+	AppendSection(data, materials, header.MaterialOffset);
+	AppendSection(data, nodeRecords, header.NodeOffset);
+	AppendSection(data, waveRecords, header.WaveOffset);
+	AppendSection(data, strings.GetData(), header.StringOffset);
+	std::memcpy(data.data(), &header, sizeof(header));
+	return data;
+}
+
+void LevelCompiler::CompileFile(const std::wstring& textFile, const std::wstring& binaryFile)
+{
+	std::ifstream fin(textFile);
+	if (!fin)
+		throw std::runtime_error("LevelCompiler: cannot read " + std::string(textFile.begin(), textFile.end()));
+
+	std::wstring leafName = textFile.substr(textFile.find_last_of(L"/\\") + 1);
+	std::vector<std::uint8_t> data = Compile(fin, std::string(leafName.begin(), leafName.end()));
+
+	// Written under a temporary name and renamed, so a failed write never leaves a
+	// truncated level that looks up to date.
+	std::wstring tempFile = binaryFile + L".tmp";
+	{
+		std::ofstream fout(tempFile, std::ios::binary | std::ios::trunc);
+		fout.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+		if (!fout)
+			throw std::runtime_error("LevelCompiler: cannot write " + std::string(tempFile.begin(), tempFile.end()));
+	}
+
+	if (!MoveFileExW(tempFile.c_str(), binaryFile.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(tempFile.c_str());
+		throw std::runtime_error("LevelCompiler: cannot write " + std::string(binaryFile.begin(), binaryFile.end()));
+	}
+}
+
+bool LevelCompiler::IsOutOfDate(const std::wstring& textFile, const std::wstring& binaryFile)
+{
+	WIN32_FILE_ATTRIBUTE_DATA text;
+	if (!GetFileAttributesExW(textFile.c_str(), GetFileExInfoStandard, &text))
+		return false;
+
+	WIN32_FILE_ATTRIBUTE_DATA binary;
+	if (!GetFileAttributesExW(binaryFile.c_str(), GetFileExInfoStandard, &binary))
+		return true;
+
+	return CompareFileTime(&text.ftLastWriteTime, &binary.ftLastWriteTime) > 0;
+}
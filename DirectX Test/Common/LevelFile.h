@@ -0,0 +1,187 @@
+//***************************************************************************************
+// LevelFile.h
+//
+// Compact binary description of a level: the textures and materials it uses, its scene
+// nodes and their transforms, and the waves in which nodes spawn while it plays.
+//
+// Levels are authored as text and compiled to binary by LevelCompiler, offline or by the
+// game when the text is newer than the binary.  The text has one item per line; blank
+// lines and everything after '#' are ignored, and names and paths cannot contain spaces:
+//   scroll <speed>
+//   texture <name> <file> sprite|streamed
+//   material <name> <texture> [albedo r g b a] [fresnel r g b] [roughness r]
+//   wave <seconds>
+//   node <type> [<variant>] [name <name>] [parent <name>] [material <name>]
+//        [position x y z] [rotation x y z] [scale x y z]
+// Rotations are in degrees in the text and radians in the binary.  Nodes before the
+// first "wave" line are present from the start; the others spawn with the wave above
+// them.  A parent must be declared before its children and spawn with them.
+//
+// File layout (all offsets are absolute, little endian, sections 8 byte aligned):
+//   LevelHeader
+//   LevelTexture[TextureCount]
+//   LevelMaterial[MaterialCount]
+//   LevelNode[NodeCount]         the nodes present from the start, then the nodes of
+//                                each wave in wave order
+//   LevelWave[WaveCount]         sorted by Time
+//   char Strings[StringSize]     zero terminated; offset 0 is the empty string
+//
+// LevelFile reads the whole file into one allocation with a single read, checks it and
+// then hands out pointers into it, so loading costs no parsing and no allocation per
+// record.  Node types and variants are stored with their ResourceId: the game knows the
+// node classes and switches on the ids, the format does not.
+//***************************************************************************************
+
+#pragma once
+
+#include "ResourceRegistry.h"
+#include <DirectXMath.h>
+#include <istream>
+
+enum LevelTextureKind : std::uint32_t
+{
+	// Loaded whole and packed into the sprite atlas.
+	LevelTexture_Sprite = 0,
+
+	// Streamed by mip level through the TextureStreamer.
+	LevelTexture_Streamed = 1,
+};
+
+struct LevelHeader
+{
+	static const std::uint32_t MagicValue = 0x4C56454C; // "LEVL"
+	static const std::uint32_t CurrentVersion = 1;
+
+	std::uint32_t Magic = MagicValue;
+	std::uint32_t Version = CurrentVersion;
+	std::uint32_t TextureCount = 0;
+	std::uint32_t MaterialCount = 0;
+	std::uint32_t NodeCount = 0;
+	std::uint32_t WaveCount = 0;
+	std::uint32_t StringSize = 0;
+	float ScrollSpeed = 1.0f;
+	std::uint32_t TextureOffset = 0;
+	std::uint32_t MaterialOffset = 0;
+	std::uint32_t NodeOffset = 0;
+	std::uint32_t WaveOffset = 0;
+	std::uint32_t StringOffset = 0;
+	std::uint32_t Reserved = 0;
+};
+
+// Index fields use this for "none".
+static const std::uint32_t LevelNoIndex = 0xffffffff;
+
+struct LevelTexture
+{
+	// Offsets into the string table.
+	std::uint32_t Name = 0;
+	std::uint32_t File = 0;
+
+	// LevelTextureKind.
+	std::uint32_t Kind = LevelTexture_Sprite;
+};
+
+struct LevelMaterial
+{
+	std::uint32_t Name = 0;
+
+	// Index of the diffuse texture.
+	std::uint32_t Texture = 0;
+
+	DirectX::XMFLOAT4 DiffuseAlbedo = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	DirectX::XMFLOAT3 FresnelR0 = DirectX::XMFLOAT3(0.05f, 0.05f, 0.05f);
+	float Roughness = 0.2f;
+};
+
+struct LevelNode
+{
+	// ResourceId of the type and variant names; the variant id is ResourceId("") when
+	// the node has none.
+	std::uint64_t TypeId = 0;
+	std::uint64_t VariantId = 0;
+
+	// Offsets into the string table.
+	std::uint32_t Type = 0;
+	std::uint32_t Variant = 0;
+	std::uint32_t Name = 0;
+
+	// Indices of the parent node, which always comes first and is in the same wave, the
+	// material that overrides the one of the node type, and the wave.  LevelNoIndex if
+	// none.
+	std::uint32_t Parent = LevelNoIndex;
+	std::uint32_t Material = LevelNoIndex;
+	std::uint32_t Wave = LevelNoIndex;
+
+	// Relative to the parent.  Rotation is in radians.
+	DirectX::XMFLOAT3 Position = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	DirectX::XMFLOAT3 Rotation = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	DirectX::XMFLOAT3 Scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+	std::uint32_t Reserved = 0;
+};
+
+struct LevelWave
+{
+	// Seconds after the level starts.
+	float Time = 0.0f;
+
+	// Range of the wave's nodes in the node array.
+	std::uint32_t FirstNode = 0;
+	std::uint32_t NodeCount = 0;
+};
+
+class LevelFile
+{
+public:
+
+	// Reads a compiled level.  Returns false if the file is missing or malformed.
+	bool Load(const std::wstring& filename);
+
+	// Takes over a compiled level held in memory.  Returns false if it is malformed.
+	bool Load(std::vector<std::uint8_t> data);
+
+	bool IsLoaded()const { return mHeader != nullptr; }
+
+	const LevelHeader& GetHeader()const { return *mHeader; }
+	const LevelTexture* GetTextures()const { return mTextures; }
+	const LevelMaterial* GetMaterials()const { return mMaterials; }
+	const LevelNode* GetNodes()const { return mNodes; }
+	const LevelWave* GetWaves()const { return mWaves; }
+
+	// Nodes [0, GetStartNodeCount()) are present from the start.
+	std::uint32_t GetStartNodeCount()const;
+
+	const char* GetString(std::uint32_t offset)const { return mStrings + offset; }
+
+private:
+
+	bool Validate()const;
+
+private:
+
+	// The whole file; everything below points into it.
+	std::vector<std::uint8_t> mData;
+
+	const LevelHeader* mHeader = nullptr;
+	const LevelTexture* mTextures = nullptr;
+	const LevelMaterial* mMaterials = nullptr;
+	const LevelNode* mNodes = nullptr;
+	const LevelWave* mWaves = nullptr;
+	const char* mStrings = nullptr;
+};
+
+class LevelCompiler
+{
+public:
+
+	// Compiles the text form.  Throws std::runtime_error naming the source and line of
+	// the first error.
+	static std::vector<std::uint8_t> Compile(std::istream& text, const std::string& sourceName);
+
+	// Compiles textFile into binaryFile.  Throws if either cannot be read or written, or
+	// if the text has errors.
+	static void CompileFile(const std::wstring& textFile, const std::wstring& binaryFile);
+
+	// True if textFile exists and binaryFile is missing or older.
+	static bool IsOutOfDate(const std::wstring& textFile, const std::wstring& binaryFile);
+};
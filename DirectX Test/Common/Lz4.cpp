@@ -0,0 +1,195 @@
+//***************************************************************************************
+// Lz4.cpp
+//***************************************************************************************
+
+#include "Lz4.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const int HashLog = 12;
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+
+	// The format requires the last 5 bytes to be literals and the last match to
+	// start at least 12 bytes before the end of the block.
+	const size_t LastLiterals = 5;
+	const size_t MatchFindLimit = 12;
+
+	std::uint32_t Read32(const std::uint8_t* p)
+	{
+		std::uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	std::uint32_t Hash(std::uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashLog);
+	}
+
+	bool WriteLength(size_t length, std::uint8_t*& op, const std::uint8_t* end)
+	{
+		while (length >= 255)
+		{
+			if (op >= end)
+				return false;
+			*op++ = 255;
+			length -= 255;
+		}
+		if (op >= end)
+			return false;
+		*op++ = (std::uint8_t)length;
+		return true;
+	}
+
+	bool WriteSequence(const std::uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength,
+		std::uint8_t*& op, const std::uint8_t* end)
+	{
+		if (op >= end)
+			return false;
+
+		std::uint8_t* token = op++;
+		*token = (std::uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+		if (literalLength >= 15 && !WriteLength(literalLength - 15, op, end))
+			return false;
+
+		if ((size_t)(end - op) < literalLength)
+			return false;
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		// The final sequence carries literals only.
+		if (matchLength == 0)
+			return true;
+
+		if (end - op < 2)
+			return false;
+		*op++ = (std::uint8_t)(offset & 0xFF);
+		*op++ = (std::uint8_t)(offset >> 8);
+
+		size_t ml = matchLength - MinMatch;
+		*token |= (std::uint8_t)(ml >= 15 ? 15 : ml);
+		if (ml >= 15 && !WriteLength(ml - 15, op, end))
+			return false;
+
+		return true;
+	}
+
+	bool ReadLength(size_t& length, const std::uint8_t*& ip, const std::uint8_t* end)
+	{
+		std::uint8_t b;
+		do
+		{
+			if (ip >= end)
+				return false;
+			b = *ip++;
+			length += b;
+		} while (b == 255);
+		return true;
+	}
+}
+
+size_t Lz4::Compress(const std::uint8_t* src, size_t srcSize, std::uint8_t* dst, size_t dstCapacity)
+{
+	std::uint8_t* op = dst;
+	const std::uint8_t* end = dst + dstCapacity;
+
+	size_t anchor = 0;
+
+	if (srcSize > MatchFindLimit)
+	{
+		std::vector<std::uint32_t> table(1 << HashLog, 0);
+
+		const size_t matchFindLimit = srcSize - MatchFindLimit;
+		const size_t matchLimit = srcSize - LastLiterals;
+
+		size_t ip = 0;
+		while (ip < matchFindLimit)
+		{
+			std::uint32_t sequence = Read32(src + ip);
+			std::uint32_t h = Hash(sequence);
+			size_t ref = table[h];
+			table[h] = (std::uint32_t)ip;
+
+			if (ref >= ip || ip - ref > MaxOffset || Read32(src + ref) != sequence)
+			{
+				++ip;
+				continue;
+			}
+
+			size_t length = MinMatch;
+			while (ip + length < matchLimit && src[ref + length] == src[ip + length])
+				++length;
+
+			if (!WriteSequence(src + anchor, ip - anchor, ip - ref, length, op, end))
+				return 0;
+
+			ip += length;
+			anchor = ip;
+		}
+	}
+
+	if (!WriteSequence(src + anchor, srcSize - anchor, 0, 0, op, end))
+		return 0;
+
+	return (size_t)(op - dst);
+}
+
+bool Lz4::Decompress(const std::uint8_t* src, size_t srcSize, std::uint8_t* dst, size_t rawSize)
+{
+	const std::uint8_t* ip = src;
+	const std::uint8_t* ipEnd = src + srcSize;
+	std::uint8_t* op = dst;
+	std::uint8_t* opEnd = dst + rawSize;
+
+	while (ip < ipEnd)
+	{
+		std::uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(literalLength, ip, ipEnd))
+			return false;
+
+		if ((size_t)(ipEnd - ip) < literalLength || (size_t)(opEnd - op) < literalLength)
+			return false;
+		memcpy(op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		// End of block: the last sequence has no match part.
+		if (ip == ipEnd)
+			break;
+
+		if (ipEnd - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(matchLength, ip, ipEnd))
+			return false;
+		matchLength += MinMatch;
+
+		if ((size_t)(opEnd - op) < matchLength)
+			return false;
+
+		const std::uint8_t* match = op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else
+		{
+			// Overlapping copy repeats the last 'offset' bytes.
+			for (size_t i = 0; i < matchLength; ++i)
+				*op++ = *match++;
+		}
+	}
+
+	return op == opEnd;
+}
@@ -0,0 +1,29 @@
+//***************************************************************************************
+// Lz4.h
+//
+// Self-contained LZ4 block format codec used for compressed asset pack payloads.
+// The compressor is a single pass greedy matcher (fast, moderate ratio); the
+// decompressor is bounds checked so a corrupt pack fails instead of overrunning.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Lz4
+{
+public:
+
+	// Worst case compressed size of srcSize bytes.
+	static size_t CompressBound(size_t srcSize)
+	{
+		return srcSize + srcSize / 255 + 16;
+	}
+
+	// Returns the number of bytes written, or 0 if dst is too small.
+	static size_t Compress(const std::uint8_t* src, size_t srcSize, std::uint8_t* dst, size_t dstCapacity);
+
+	// Returns true only if the block decodes to exactly rawSize bytes.
+	static bool Decompress(const std::uint8_t* src, size_t srcSize, std::uint8_t* dst, size_t rawSize);
+};
@@ -4,7 +4,16 @@
 
 #include "MathHelper.h"
 #include <float.h>
+#include <atomic>
 #include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MATH_HELPER_SSE2 1
+#include <emmintrin.h>
+#else
+#define MATH_HELPER_SSE2 0
+#endif
 
 using namespace DirectX;
 
@@ -35,48 +44,159 @@ float MathHelper::AngleFromXY(float x, float y)
 
 XMVECTOR MathHelper::RandUnitVec3()
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
+	// Archimedes: z is uniform in [-1, 1] on the unit sphere, and the angle around z
+	// is uniform too, so no points need to be thrown away.
+	RandomEngine& engine = GetRandomEngine();
+	float z = 2.0f*engine.NextFloat() - 1.0f;
+	float phi = 2.0f*Pi*engine.NextFloat();
+	float r = sqrtf(Max(0.0f, 1.0f - z*z));
+
+	return XMVectorSet(r*cosf(phi), r*sinf(phi), z, 0.0f);
+}
+
+XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
+{
+	// Reflecting the points of the bottom half onto the top half keeps the density
+	// even.
+	XMVECTOR v = RandUnitVec3();
+	if( XMVector3Less( XMVector3Dot(n, v), XMVectorZero() ) )
+		v = XMVectorNegate(v);
+
+	return v;
+}
 
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
+RandomEngine& MathHelper::GetRandomEngine()
+{
+	// Threads are numbered in the order they first ask for a number.
+	static std::atomic<std::uint64_t> nextThread(0);
+	thread_local RandomEngine engine(nextThread.fetch_add(1));
+	return engine;
+}
+
+namespace
+{
+	std::uint64_t SplitMix64(std::uint64_t& x)
 	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
+		std::uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// 23 random bits as the mantissa of a float in [1, 2), moved down to [0, 1).
+	float BitsToFloat(std::uint32_t bits)
+	{
+		std::uint32_t u = (bits >> 9) | 0x3F800000u;
+		float f;
+		std::memcpy(&f, &u, sizeof(f));
+		return f - 1.0f;
+	}
+}
+
+RandomEngine::RandomEngine(std::uint64_t seed)
+{
+	Seed(seed);
+}
 
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
+void RandomEngine::Seed(std::uint64_t seed)
+{
+	std::uint64_t x = seed;
+	for (std::uint64_t& word : mState)
+		word = SplitMix64(x);
 
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
+	for (int stream = 0; stream < 2; ++stream)
+		for (int word = 0; word < 4; ++word)
+			mWideState[word][stream] = SplitMix64(x);
+}
 
-		return XMVector3Normalize(v);
+std::uint32_t RandomEngine::NextBounded(std::uint32_t range)
+{
+	std::uint64_t m = (Next() >> 32) * range;
+	std::uint32_t low = (std::uint32_t)m;
+	if (low < range)
+	{
+		// 2^32 mod range: products whose low word falls below it would make the
+		// smaller results more likely.
+		std::uint32_t threshold = (0u - range) % range;
+		while (low < threshold)
+		{
+			m = (Next() >> 32) * range;
+			low = (std::uint32_t)m;
+		}
 	}
+	return (std::uint32_t)(m >> 32);
 }
 
-XMVECTOR MathHelper::RandHemisphereUnitVec3(XMVECTOR n)
+void RandomEngine::FillUniform(float* out, size_t count)
 {
-	XMVECTOR One  = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-	XMVECTOR Zero = XMVectorZero();
+#if MATH_HELPER_SSE2
+	__m128i s0 = _mm_load_si128((const __m128i*)mWideState[0]);
+	__m128i s1 = _mm_load_si128((const __m128i*)mWideState[1]);
+	__m128i s2 = _mm_load_si128((const __m128i*)mWideState[2]);
+	__m128i s3 = _mm_load_si128((const __m128i*)mWideState[3]);
+
+	const __m128i exponent = _mm_set1_epi32(0x3F800000);
+	const __m128 one = _mm_set1_ps(1.0f);
 
-	// Keep trying until we get a point on/in the hemisphere.
-	while(true)
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
 	{
-		// Generate random point in the cube [-1,1]^3.
-		XMVECTOR v = XMVectorSet(MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), MathHelper::RandF(-1.0f, 1.0f), 0.0f);
+		// rotl(s0 + s3, 23) + s0 in both lanes.
+		__m128i sum = _mm_add_epi64(s0, s3);
+		__m128i result = _mm_add_epi64(_mm_or_si128(_mm_slli_epi64(sum, 23), _mm_srli_epi64(sum, 41)), s0);
+
+		__m128i t = _mm_slli_epi64(s1, 17);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));
+
+		// Each 32-bit half of a result becomes one float, as in BitsToFloat.
+		__m128i bits = _mm_or_si128(_mm_srli_epi32(result, 9), exponent);
+		_mm_storeu_ps(out + i, _mm_sub_ps(_mm_castsi128_ps(bits), one));
+	}
 
-		// Ignore points outside the unit sphere in order to get an even distribution 
-		// over the unit sphere.  Otherwise points will clump more on the sphere near 
-		// the corners of the cube.
-		
-		if( XMVector3Greater( XMVector3LengthSq(v), One) )
-			continue;
+	_mm_store_si128((__m128i*)mWideState[0], s0);
+	_mm_store_si128((__m128i*)mWideState[1], s1);
+	_mm_store_si128((__m128i*)mWideState[2], s2);
+	_mm_store_si128((__m128i*)mWideState[3], s3);
 
-		// Ignore points in the bottom hemisphere.
-		if( XMVector3Less( XMVector3Dot(n, v), Zero ) )
-			continue;
+	FillUniformScalar(out + i, count - i);
+#else
+	FillUniformScalar(out, count);
+#endif
+}
 
-		return XMVector3Normalize(v);
+void RandomEngine::FillUniformScalar(float* out, size_t count)
+{
+	// One step of both streams per four floats, the same order as the SSE2 path; a
+	// partial step still advances the streams.
+	for (size_t i = 0; i < count; i += 4)
+	{
+		float values[4];
+		for (int stream = 0; stream < 2; ++stream)
+		{
+			std::uint64_t s[4] = { mWideState[0][stream], mWideState[1][stream], mWideState[2][stream], mWideState[3][stream] };
+
+			const std::uint64_t result = Rotl(s[0] + s[3], 23) + s[0];
+			const std::uint64_t t = s[1] << 17;
+			s[2] ^= s[0];
+			s[3] ^= s[1];
+			s[1] ^= s[2];
+			s[0] ^= s[3];
+			s[2] ^= t;
+			s[3] = Rotl(s[3], 45);
+
+			for (int word = 0; word < 4; ++word)
+				mWideState[word][stream] = s[word];
+
+			values[2 * stream] = BitsToFloat((std::uint32_t)result);
+			values[2 * stream + 1] = BitsToFloat((std::uint32_t)(result >> 32));
+		}
+
+		for (size_t j = 0; j < 4 && i + j < count; ++j)
+			out[i + j] = values[j];
 	}
-}
\ No newline at end of file
+}
@@ -2,21 +2,98 @@
 // MathHelper.h 
 //
 // Helper math class.
+//
+// Random numbers come from RandomEngine, a xoshiro256++ generator: 256 bits of state,
+// a handful of adds, shifts and xors per 64-bit result, and output that passes the
+// usual statistical test suites, unlike rand().  Every thread owns one engine, so the
+// MathHelper::Rand* functions need no locking and never disturb other threads.  A thread
+// starts from a seed made of its creation order; call SeedRandom for a sequence that
+// must replay exactly.
 //***************************************************************************************
 
 #pragma once
 
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 #include <DirectXMath.h>
+#include <cstddef>
 #include <cstdint>
 
+class RandomEngine
+{
+public:
+	explicit RandomEngine(std::uint64_t seed = 0);
+
+	// Restarts the sequence.  The state is expanded from seed with SplitMix64, so
+	// nearby seeds still give unrelated sequences.
+	void Seed(std::uint64_t seed);
+
+	std::uint64_t Next()
+	{
+		const std::uint64_t result = Rotl(mState[0] + mState[3], 23) + mState[0];
+		const std::uint64_t t = mState[1] << 17;
+
+		mState[2] ^= mState[0];
+		mState[3] ^= mState[1];
+		mState[1] ^= mState[2];
+		mState[0] ^= mState[3];
+		mState[2] ^= t;
+		mState[3] = Rotl(mState[3], 45);
+
+		return result;
+	}
+
+	// Uniform in [0, 1), from the top 24 bits so every value is exact.
+	float NextFloat()
+	{
+		return (float)(Next() >> 40) * (1.0f / 16777216.0f);
+	}
+
+	// Uniform in [0, range) without the modulo bias, by Lemire's multiply and reject.
+	// Retries are rare: at most range / 2^32 of the draws.
+	std::uint32_t NextBounded(std::uint32_t range);
+
+	// Writes count floats uniform in [0, 1) with 23 bits each.  They come from two
+	// extra xoshiro256++ streams advanced side by side, two 64-bit lanes of an SSE2
+	// register giving four floats per step; other targets compute the same numbers
+	// one lane at a time.  The streams are seeded with the engine but independent of
+	// Next.
+	void FillUniform(float* out, size_t count);
+
+	// Scalar reference of FillUniform.
+	void FillUniformScalar(float* out, size_t count);
+
+private:
+	static std::uint64_t Rotl(std::uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+private:
+	std::uint64_t mState[4];
+
+	// State word i of wide stream j is mWideState[i][j], so each row loads as one
+	// SSE2 register.
+	alignas(16) std::uint64_t mWideState[4][2];
+};
+
 class MathHelper
 {
 public:
+	// Engine of the calling thread, for loops that draw many numbers.
+	static RandomEngine& GetRandomEngine();
+
+	// Restarts the calling thread's sequence.
+	static void SeedRandom(std::uint64_t seed)
+	{
+		GetRandomEngine().Seed(seed);
+	}
+
 	// Returns random float in [0, 1).
 	static float RandF()
 	{
-		return (float)(rand()) / (float)RAND_MAX;
+		return GetRandomEngine().NextFloat();
 	}
 
 	// Returns random float in [a, b).
@@ -25,10 +102,20 @@ public:
 		return a + RandF()*(b-a);
 	}
 
-    static int Rand(int a, int b)
-    {
-        return a + rand() % ((b - a) + 1);
-    }
+	// Returns random int in [a, b], every value equally likely.
+	static int Rand(int a, int b)
+	{
+		// The range wraps to 0 when it covers every int.
+		std::uint32_t range = (std::uint32_t)b - (std::uint32_t)a + 1u;
+		std::uint32_t offset = range != 0 ? GetRandomEngine().NextBounded(range) : (std::uint32_t)GetRandomEngine().Next();
+		return (int)((std::uint32_t)a + offset);
+	}
+
+	// Fills out with count random floats in [0, 1).
+	static void FillUniform(float* out, size_t count)
+	{
+		GetRandomEngine().FillUniform(out, count);
+	}
 
 	template<typename T>
 	static T Min(const T& a, const T& b)
@@ -89,6 +176,8 @@ public:
         return I;
     }
 
+    // Uniform on the unit sphere, and on the half of it facing along n.  Both take a
+    // fixed two random numbers per call.
     static DirectX::XMVECTOR RandUnitVec3();
     static DirectX::XMVECTOR RandHemisphereUnitVec3(DirectX::XMVECTOR n);
 
@@ -0,0 +1,224 @@
+//***************************************************************************************
+// MeshCache.cpp
+//***************************************************************************************
+
+#include "MeshCache.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// Limits on what a header may claim before anything is allocated for it.
+	const std::uint32_t MaxSubmeshes = 1024;
+	const std::uint32_t MaxNameLength = 1024;
+
+	template <typename T>
+	bool Read(std::ifstream& fin, T& value)
+	{
+		return (bool)fin.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	void Write(std::ofstream& fout, const T& value)
+	{
+		fout.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	UINT IndexByteSize(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_R16_UINT ? 2 : 4;
+	}
+
+	// Takes byteSize off what is left of the file, failing when that is less.
+	bool Consume(UINT64& remaining, UINT64 byteSize)
+	{
+		if (byteSize > remaining)
+			return false;
+
+		remaining -= byteSize;
+		return true;
+	}
+
+	// Every meshlet's indices must lie within its submesh.
+	bool ValidMeshlets(const MeshletSet& meshlets, std::uint32_t submeshIndexCount)
+	{
+		for (const Meshlet& meshlet : meshlets.Meshlets)
+		{
+			if ((UINT64)meshlet.IndexOffset + meshlet.IndexCount > submeshIndexCount)
+				return false;
+		}
+		return true;
+	}
+}
+
+UINT MeshCache::Mesh::GetVertexCount()const
+{
+	return VertexData != nullptr && VertexByteStride > 0 ? (UINT)(VertexData->GetBufferSize() / VertexByteStride) : 0;
+}
+
+UINT MeshCache::Mesh::GetIndexCount()const
+{
+	return IndexData != nullptr ? (UINT)(IndexData->GetBufferSize() / IndexByteSize(IndexFormat)) : 0;
+}
+
+MeshCache::MeshCache(const std::wstring& directory, std::uint64_t pipelineHash)
+	: mDirectory(directory)
+	, mPipelineHash(pipelineHash)
+{
+}
+
+bool MeshCache::Load(std::uint64_t key, Mesh& mesh)const
+{
+	std::ifstream fin(GetPath(key), std::ios::binary | std::ios::ate);
+	if (!fin)
+		return false;
+
+	// Every size the file claims is checked against what it holds before anything is
+	// allocated for it, so a truncated or damaged entry is a miss rather than a huge
+	// allocation or a read past the end.
+	UINT64 remaining = (UINT64)fin.tellg();
+	fin.seekg(0, std::ios::beg);
+
+	MeshCacheHeader header;
+	if (!Read(fin, header) || !Consume(remaining, sizeof(header)) ||
+		header.Magic != MeshCacheHeader::MagicValue ||
+		header.Version != MeshCacheHeader::CurrentVersion ||
+		header.Key != key ||
+		header.PipelineHash != mPipelineHash ||
+		header.VertexByteStride == 0 ||
+		(header.IndexFormat != DXGI_FORMAT_R16_UINT && header.IndexFormat != DXGI_FORMAT_R32_UINT) ||
+		header.SubmeshCount > MaxSubmeshes ||
+		header.VertexBytes % header.VertexByteStride != 0 ||
+		header.IndexBytes % IndexByteSize((DXGI_FORMAT)header.IndexFormat) != 0 ||
+		!Consume(remaining, header.VertexBytes) ||
+		!Consume(remaining, header.IndexBytes))
+		return false;
+
+	Mesh result;
+	result.VertexByteStride = header.VertexByteStride;
+	result.IndexFormat = (DXGI_FORMAT)header.IndexFormat;
+
+	UINT64 indexCount = header.IndexBytes / IndexByteSize(result.IndexFormat);
+
+	for (std::uint32_t i = 0; i < header.SubmeshCount; ++i)
+	{
+		MeshCacheSubmesh record;
+		if (!Consume(remaining, sizeof(record)) || !Read(fin, record) || record.NameLength > MaxNameLength ||
+			(UINT64)record.StartIndexLocation + record.IndexCount > indexCount ||
+			record.MeshletCount > record.IndexCount / 3 ||
+			!Consume(remaining, record.NameLength) ||
+			!Consume(remaining, (UINT64)record.MeshletCount * sizeof(Meshlet)))
+			return false;
+
+		NamedSubmesh named;
+		named.Name.resize(record.NameLength);
+		if (record.NameLength > 0 && !fin.read(&named.Name[0], record.NameLength))
+			return false;
+
+		SubmeshGeometry& submesh = named.Submesh;
+		submesh.IndexCount = record.IndexCount;
+		submesh.StartIndexLocation = record.StartIndexLocation;
+		submesh.BaseVertexLocation = record.BaseVertexLocation;
+		submesh.LodError = record.LodError;
+		submesh.Bounds.Center = record.BoundsCenter;
+		submesh.Bounds.Extents = record.BoundsExtents;
+
+		if (record.MeshletCount > 0)
+		{
+			auto meshlets = std::make_shared<MeshletSet>();
+			meshlets->Meshlets.resize(record.MeshletCount);
+			if (!fin.read(reinterpret_cast<char*>(meshlets->Meshlets.data()), record.MeshletCount * sizeof(Meshlet)) ||
+				!ValidMeshlets(*meshlets, record.IndexCount))
+				return false;
+			submesh.Meshlets = meshlets;
+		}
+
+		result.Submeshes.push_back(named);
+	}
+
+	ThrowIfFailed(D3DCreateBlob((SIZE_T)header.VertexBytes, result.VertexData.GetAddressOf()));
+	ThrowIfFailed(D3DCreateBlob((SIZE_T)header.IndexBytes, result.IndexData.GetAddressOf()));
+
+	if (!fin.read((char*)result.VertexData->GetBufferPointer(), (std::streamsize)header.VertexBytes) ||
+		!fin.read((char*)result.IndexData->GetBufferPointer(), (std::streamsize)header.IndexBytes))
+		return false;
+
+	mesh = std::move(result);
+	return true;
+}
+
+bool MeshCache::Store(std::uint64_t key, const Mesh& mesh)const
+{
+	CreateDirectoryW(mDirectory.c_str(), nullptr);
+
+	// Written under a temporary name and renamed, so an interrupted write never leaves
+	// a truncated entry behind.
+	std::wstring path = GetPath(key);
+	std::wstring tempPath = path + L".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+
+		MeshCacheHeader header;
+		header.Key = key;
+		header.PipelineHash = mPipelineHash;
+		header.VertexByteStride = mesh.VertexByteStride;
+		header.IndexFormat = (std::uint32_t)mesh.IndexFormat;
+		header.VertexBytes = mesh.VertexData != nullptr ? mesh.VertexData->GetBufferSize() : 0;
+		header.IndexBytes = mesh.IndexData != nullptr ? mesh.IndexData->GetBufferSize() : 0;
+		header.SubmeshCount = (std::uint32_t)mesh.Submeshes.size();
+		Write(fout, header);
+
+		for (const NamedSubmesh& named : mesh.Submeshes)
+		{
+			const SubmeshGeometry& submesh = named.Submesh;
+
+			MeshCacheSubmesh record;
+			record.IndexCount = submesh.IndexCount;
+			record.StartIndexLocation = submesh.StartIndexLocation;
+			record.BaseVertexLocation = submesh.BaseVertexLocation;
+			record.LodError = submesh.LodError;
+			record.BoundsCenter = submesh.Bounds.Center;
+			record.BoundsExtents = submesh.Bounds.Extents;
+			record.NameLength = (std::uint32_t)named.Name.size();
+			record.MeshletCount = submesh.Meshlets != nullptr ? (std::uint32_t)submesh.Meshlets->Meshlets.size() : 0;
+			Write(fout, record);
+
+			fout.write(named.Name.data(), named.Name.size());
+			if (record.MeshletCount > 0)
+				fout.write(reinterpret_cast<const char*>(submesh.Meshlets->Meshlets.data()), record.MeshletCount * sizeof(Meshlet));
+		}
+
+		if (header.VertexBytes > 0)
+			fout.write((const char*)mesh.VertexData->GetBufferPointer(), (std::streamsize)header.VertexBytes);
+		if (header.IndexBytes > 0)
+			fout.write((const char*)mesh.IndexData->GetBufferPointer(), (std::streamsize)header.IndexBytes);
+
+		if (!fout)
+			return false;
+	}
+
+	if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+std::uint64_t MeshCache::Key(const std::string& generator, std::initializer_list<float> parameters)
+{
+	std::uint64_t hash = Fnv1a(generator.data(), generator.size());
+	for (float parameter : parameters)
+		hash = Fnv1a(&parameter, sizeof(parameter), hash);
+	return hash;
+}
+
+std::wstring MeshCache::GetPath(std::uint64_t key)const
+{
+	wchar_t name[32];
+	swprintf_s(name, L"%016llx.mesh", (unsigned long long)key);
+	return mDirectory + L"/" + name;
+}
@@ -0,0 +1,102 @@
+//***************************************************************************************
+// MeshCache.h
+//
+// On-disk cache of fully processed meshes, so that a warm start skips generating,
+// optimising, simplifying and quantising geometry and only reads two blobs.
+//
+// An entry is keyed by a hash of the generator and its parameters (Key) and is only
+// accepted when it was written by the same processing pipeline: the cache is created
+// with a hash of everything else that shapes the output (stage versions, vertex
+// format), and entries written under another one are ignored and overwritten.
+//
+// File layout, one file per key named <key as 16 hex digits>.mesh:
+//   MeshCacheHeader
+//   per submesh: MeshCacheSubmesh, name (NameLength bytes), Meshlet[MeshletCount]
+//   vertex data (VertexBytes)
+//   index data (IndexBytes)
+//
+// The vertex and index data are read straight into the ID3DBlobs that become the
+// MeshGeometry's system memory copies.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "Hash.h"
+#include "MeshletBuilder.h"
+#include <initializer_list>
+
+struct MeshCacheHeader
+{
+	static const std::uint32_t MagicValue = 0x4853454D; // "MESH"
+	static const std::uint32_t CurrentVersion = 1;
+
+	std::uint32_t Magic = MagicValue;
+	std::uint32_t Version = CurrentVersion;
+	std::uint64_t Key = 0;
+	std::uint64_t PipelineHash = 0;
+	std::uint32_t VertexByteStride = 0;
+	std::uint32_t IndexFormat = 0;
+	std::uint64_t VertexBytes = 0;
+	std::uint64_t IndexBytes = 0;
+	std::uint32_t SubmeshCount = 0;
+	std::uint32_t Reserved = 0;
+};
+
+struct MeshCacheSubmesh
+{
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+	float LodError = 0.0f;
+	DirectX::XMFLOAT3 BoundsCenter = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 BoundsExtents = { 0.0f, 0.0f, 0.0f };
+	std::uint32_t NameLength = 0;
+	std::uint32_t MeshletCount = 0;
+};
+
+class MeshCache
+{
+public:
+
+	struct NamedSubmesh
+	{
+		std::string Name;
+
+		// Offsets relative to the start of the mesh's vertex and index data.
+		SubmeshGeometry Submesh;
+	};
+
+	struct Mesh
+	{
+		Microsoft::WRL::ComPtr<ID3DBlob> VertexData;
+		Microsoft::WRL::ComPtr<ID3DBlob> IndexData;
+		UINT VertexByteStride = 0;
+		DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;
+		std::vector<NamedSubmesh> Submeshes;
+
+		UINT GetVertexCount()const;
+		UINT GetIndexCount()const;
+	};
+
+	MeshCache(const std::wstring& directory, std::uint64_t pipelineHash);
+
+	// Returns false, leaving mesh untouched, when there is no valid entry for key.
+	bool Load(std::uint64_t key, Mesh& mesh)const;
+
+	// Returns false if the entry could not be written; the cache is optional, so callers
+	// may ignore it.
+	bool Store(std::uint64_t key, const Mesh& mesh)const;
+
+	// Key of a generator call, e.g. Key("CreateBox", { width, height, depth, subdivisions }).
+	static std::uint64_t Key(const std::string& generator, std::initializer_list<float> parameters);
+
+private:
+
+	std::wstring GetPath(std::uint64_t key)const;
+
+private:
+
+	std::wstring mDirectory;
+	std::uint64_t mPipelineHash;
+};
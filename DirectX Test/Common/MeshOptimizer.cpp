@@ -0,0 +1,467 @@
+//***************************************************************************************
+// MeshOptimizer.cpp
+//***************************************************************************************
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = MeshOptimizer::uint32;
+
+	// Cache size the Forsyth scores are tuned for.  Larger than any real post-transform
+	// cache on purpose: it only has to rank triangles, not model the hardware.
+	const uint32 ForsythCacheSize = 32;
+	const float ForsythCacheDecayPower = 1.5f;
+	const float ForsythLastTriScore = 0.75f;
+	const float ForsythValenceBoostScale = 2.0f;
+	const float ForsythValenceBoostPower = 0.5f;
+
+	const uint32 NotInCache = 0xffffffff;
+	const uint32 NoTriangle = 0xffffffff;
+
+	float ForsythVertexScore(uint32 cachePosition, uint32 remainingTriangles)
+	{
+		// Vertices with no triangles left must never attract more triangles.
+		if(remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if(cachePosition != NotInCache)
+		{
+			// The three vertices of the last triangle get a fixed score so that the next
+			// triangle does not simply reuse the same edge over and over.
+			if(cachePosition < 3)
+			{
+				score = ForsythLastTriScore;
+			}
+			else
+			{
+				float scale = 1.0f / (ForsythCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scale, ForsythCacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few triangles left so that they are finished off and drop
+		// out of the working set instead of lingering as holes in the mesh.
+		score += ForsythValenceBoostScale * powf((float)remainingTriangles, -ForsythValenceBoostPower);
+
+		return score;
+	}
+
+	// FIFO post-transform cache.  Each vertex remembers when it entered the cache, so
+	// testing membership is one compare and resetting the cache is one add.
+	class FifoCache
+	{
+	public:
+		FifoCache(uint32 vertexCount, uint32 cacheSize) :
+			mTimestamps(vertexCount, 0), mTime(cacheSize + 1), mCacheSize(cacheSize)
+		{
+		}
+
+		// Returns 1 if the vertex had to be transformed.
+		uint32 Access(uint32 v)
+		{
+			if(mTime - mTimestamps[v] > mCacheSize)
+			{
+				mTimestamps[v] = mTime++;
+				return 1;
+			}
+			return 0;
+		}
+
+		void Reset()
+		{
+			mTime += mCacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32> mTimestamps;
+		uint32 mTime;
+		uint32 mCacheSize;
+	};
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(GeometryGenerator::MeshData& meshData, float overdrawThreshold)
+{
+	Report report;
+	report.Before = AnalyzeVertexCache(meshData.Indices32, (uint32)meshData.Vertices.size());
+
+	OptimizeVertexCache(meshData.Indices32, (uint32)meshData.Vertices.size());
+	OptimizeOverdraw(meshData.Indices32, meshData.Vertices, overdrawThreshold);
+	OptimizeVertexFetch(meshData);
+
+	report.After = AnalyzeVertexCache(meshData.Indices32, (uint32)meshData.Vertices.size());
+	return report;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32>& indices, uint32 vertexCount)
+{
+	uint32 triCount = (uint32)indices.size() / 3;
+	if(triCount == 0)
+		return;
+
+	//
+	// Triangles adjacent to each vertex, packed into one array.  The first
+	// remaining[v] entries of a vertex's range are the triangles not yet emitted.
+	//
+
+	std::vector<uint32> remaining(vertexCount, 0);
+	for(uint32 i = 0; i < triCount * 3; ++i)
+		remaining[indices[i]]++;
+
+	std::vector<uint32> adjacencyOffset(vertexCount + 1, 0);
+	for(uint32 v = 0; v < vertexCount; ++v)
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+
+	std::vector<uint32> adjacency(triCount * 3);
+	{
+		std::vector<uint32> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for(uint32 t = 0; t < triCount; ++t)
+		{
+			for(uint32 k = 0; k < 3; ++k)
+			{
+				uint32 v = indices[t * 3 + k];
+				adjacency[fill[v]++] = t;
+			}
+		}
+	}
+
+	std::vector<uint32> cachePosition(vertexCount, NotInCache);
+	std::vector<float> vertexScore(vertexCount);
+	for(uint32 v = 0; v < vertexCount; ++v)
+		vertexScore[v] = ForsythVertexScore(NotInCache, remaining[v]);
+
+	auto triScore = [&](uint32 t)
+	{
+		return vertexScore[indices[t * 3 + 0]] +
+			vertexScore[indices[t * 3 + 1]] +
+			vertexScore[indices[t * 3 + 2]];
+	};
+
+	// Start with the triangle that has the lowest valence vertices, i.e. at a border.
+	uint32 bestTri = 0;
+	for(uint32 t = 1; t < triCount; ++t)
+	{
+		if(triScore(t) > triScore(bestTri))
+			bestTri = t;
+	}
+
+	std::vector<bool> emitted(triCount, false);
+
+	// The cache holds up to ForsythCacheSize vertices, plus room for the three vertices
+	// of the triangle being added before the oldest entries are pushed out.
+	std::vector<uint32> cache;
+	std::vector<uint32> newCache;
+	cache.reserve(ForsythCacheSize + 3);
+	newCache.reserve(ForsythCacheSize + 3);
+
+	std::vector<uint32> output;
+	output.reserve(triCount * 3);
+
+	uint32 scanCursor = 0;
+
+	for(uint32 n = 0; n < triCount; ++n)
+	{
+		if(bestTri == NoTriangle)
+		{
+			// Nothing in the cache touches a remaining triangle (the previous cluster is
+			// finished).  Start the next one at the first triangle not yet emitted; it is
+			// as good a seed as any and keeps this pass linear.
+			while(emitted[scanCursor])
+				++scanCursor;
+			bestTri = scanCursor;
+		}
+
+		const uint32* tri = &indices[bestTri * 3];
+		output.push_back(tri[0]);
+		output.push_back(tri[1]);
+		output.push_back(tri[2]);
+		emitted[bestTri] = true;
+
+		// Remove the triangle from the remaining lists of its vertices.
+		for(uint32 k = 0; k < 3; ++k)
+		{
+			uint32 v = tri[k];
+			uint32* begin = &adjacency[adjacencyOffset[v]];
+			uint32* end = begin + remaining[v];
+			uint32* it = std::find(begin, end, bestTri);
+			std::swap(*it, *(end - 1));
+			remaining[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the cache.
+		newCache.clear();
+		newCache.push_back(tri[0]);
+		newCache.push_back(tri[1]);
+		newCache.push_back(tri[2]);
+		for(uint32 v : cache)
+		{
+			if(v != tri[0] && v != tri[1] && v != tri[2])
+				newCache.push_back(v);
+		}
+		std::swap(cache, newCache);
+
+		// Update scores of everything that is or just was in the cache.
+		for(uint32 i = 0; i < (uint32)cache.size(); ++i)
+		{
+			uint32 v = cache[i];
+			cachePosition[v] = i < ForsythCacheSize ? i : NotInCache;
+			vertexScore[v] = ForsythVertexScore(cachePosition[v], remaining[v]);
+		}
+
+		bestTri = NoTriangle;
+		float bestScore = -1.0f;
+		for(uint32 v : cache)
+		{
+			const uint32* adjacent = &adjacency[adjacencyOffset[v]];
+			for(uint32 i = 0; i < remaining[v]; ++i)
+			{
+				uint32 t = adjacent[i];
+				float score = triScore(t);
+				if(score > bestScore)
+				{
+					bestScore = score;
+					bestTri = t;
+				}
+			}
+		}
+
+		if(cache.size() > ForsythCacheSize)
+			cache.resize(ForsythCacheSize);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32>& indices,
+	const std::vector<GeometryGenerator::Vertex>& vertices, float threshold)
+{
+	uint32 triCount = (uint32)indices.size() / 3;
+	if(triCount == 0)
+		return;
+
+	uint32 vertexCount = (uint32)vertices.size();
+
+	//
+	// Hard boundaries: triangles that miss the cache on all three vertices.  The cache
+	// is cold there anyway, so the order of what follows costs nothing to change.
+	//
+
+	std::vector<uint32> hardClusters;
+	{
+		FifoCache cache(vertexCount, DefaultCacheSize);
+		for(uint32 t = 0; t < triCount; ++t)
+		{
+			uint32 misses = cache.Access(indices[t * 3 + 0]) +
+				cache.Access(indices[t * 3 + 1]) +
+				cache.Access(indices[t * 3 + 2]);
+
+			if(t == 0 || misses == 3)
+				hardClusters.push_back(t);
+		}
+	}
+	hardClusters.push_back(triCount);
+
+	//
+	// Soft boundaries: inside each hard cluster, cut as soon as the piece so far has an
+	// ACMR within `threshold` of the whole cluster's.  Restarting the cache there costs at
+	// most that much, and smaller clusters sort better.
+	//
+
+	std::vector<uint32> clusters;
+	{
+		FifoCache cache(vertexCount, DefaultCacheSize);
+		for(size_t c = 0; c + 1 < hardClusters.size(); ++c)
+		{
+			uint32 begin = hardClusters[c];
+			uint32 end = hardClusters[c + 1];
+
+			cache.Reset();
+			uint32 clusterMisses = 0;
+			for(uint32 t = begin; t < end; ++t)
+			{
+				clusterMisses += cache.Access(indices[t * 3 + 0]) +
+					cache.Access(indices[t * 3 + 1]) +
+					cache.Access(indices[t * 3 + 2]);
+			}
+			float clusterAcmr = (float)clusterMisses / (end - begin);
+
+			cache.Reset();
+			clusters.push_back(begin);
+			uint32 pieceMisses = 0;
+			uint32 pieceTris = 0;
+			for(uint32 t = begin; t < end; ++t)
+			{
+				pieceMisses += cache.Access(indices[t * 3 + 0]) +
+					cache.Access(indices[t * 3 + 1]) +
+					cache.Access(indices[t * 3 + 2]);
+				pieceTris++;
+
+				if(t + 1 < end && pieceMisses <= threshold * clusterAcmr * pieceTris)
+				{
+					clusters.push_back(t + 1);
+					cache.Reset();
+					pieceMisses = 0;
+					pieceTris = 0;
+				}
+			}
+		}
+	}
+	uint32 clusterCount = (uint32)clusters.size();
+	clusters.push_back(triCount);
+
+	//
+	// Sort key: how far the cluster faces away from the middle of the mesh.  Clusters on
+	// the outside, facing out, are drawn first and occlude the ones behind them.
+	//
+
+	std::vector<XMFLOAT3> clusterCentroid(clusterCount);
+	std::vector<XMFLOAT3> clusterNormal(clusterCount);
+	XMFLOAT3 meshCentroid(0.0f, 0.0f, 0.0f);
+	float meshArea = 0.0f;
+
+	for(uint32 c = 0; c < clusterCount; ++c)
+	{
+		XMFLOAT3 centroid(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 normal(0.0f, 0.0f, 0.0f);
+		float area = 0.0f;
+
+		for(uint32 t = clusters[c]; t < clusters[c + 1]; ++t)
+		{
+			const XMFLOAT3& p0 = vertices[indices[t * 3 + 0]].Position;
+			const XMFLOAT3& p1 = vertices[indices[t * 3 + 1]].Position;
+			const XMFLOAT3& p2 = vertices[indices[t * 3 + 2]].Position;
+
+			float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+			float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+
+			// Cross product; its length is twice the triangle area.  Clockwise winding
+			// is front facing, hence e1 x e2 points out of the mesh.
+			float nx = e1y * e2z - e1z * e2y;
+			float ny = e1z * e2x - e1x * e2z;
+			float nz = e1x * e2y - e1y * e2x;
+			float triArea = sqrtf(nx * nx + ny * ny + nz * nz);
+
+			centroid.x += (p0.x + p1.x + p2.x) * triArea;
+			centroid.y += (p0.y + p1.y + p2.y) * triArea;
+			centroid.z += (p0.z + p1.z + p2.z) * triArea;
+			normal.x += nx;
+			normal.y += ny;
+			normal.z += nz;
+			area += triArea;
+		}
+
+		meshCentroid.x += centroid.x;
+		meshCentroid.y += centroid.y;
+		meshCentroid.z += centroid.z;
+		meshArea += area;
+
+		float inv = area > 0.0f ? 1.0f / (3.0f * area) : 0.0f;
+		clusterCentroid[c] = XMFLOAT3(centroid.x * inv, centroid.y * inv, centroid.z * inv);
+
+		float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+		float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+		clusterNormal[c] = XMFLOAT3(normal.x * invLength, normal.y * invLength, normal.z * invLength);
+	}
+
+	float invMeshArea = meshArea > 0.0f ? 1.0f / (3.0f * meshArea) : 0.0f;
+	meshCentroid = XMFLOAT3(meshCentroid.x * invMeshArea, meshCentroid.y * invMeshArea, meshCentroid.z * invMeshArea);
+
+	std::vector<float> sortKey(clusterCount);
+	for(uint32 c = 0; c < clusterCount; ++c)
+	{
+		sortKey[c] =
+			(clusterCentroid[c].x - meshCentroid.x) * clusterNormal[c].x +
+			(clusterCentroid[c].y - meshCentroid.y) * clusterNormal[c].y +
+			(clusterCentroid[c].z - meshCentroid.z) * clusterNormal[c].z;
+	}
+
+	std::vector<uint32> order(clusterCount);
+	for(uint32 c = 0; c < clusterCount; ++c)
+		order[c] = c;
+
+	std::stable_sort(order.begin(), order.end(),
+		[&](uint32 a, uint32 b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<uint32> output;
+	output.reserve(indices.size());
+	for(uint32 c : order)
+		output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexCacheRange(std::vector<uint32>& indices, uint32 first, uint32 count)
+{
+	// Number the range's vertices from 0, so that the pass sizes its tables for the few
+	// vertices of a meshlet rather than for the whole mesh.
+	std::unordered_map<uint32, uint32> remap;
+	std::vector<uint32> localIndices(count);
+	std::vector<uint32> globalIndices;
+
+	for(uint32 i = 0; i < count; ++i)
+	{
+		uint32 index = indices[first + i];
+		auto it = remap.find(index);
+		if(it == remap.end())
+		{
+			it = remap.emplace(index, (uint32)globalIndices.size()).first;
+			globalIndices.push_back(index);
+		}
+		localIndices[i] = it->second;
+	}
+
+	const uint32 vertexCount = (uint32)globalIndices.size();
+	const std::vector<uint32> original = localIndices;
+	OptimizeVertexCache(localIndices, vertexCount);
+
+	if(AnalyzeVertexCache(localIndices, vertexCount).VerticesTransformed >=
+		AnalyzeVertexCache(original, vertexCount).VerticesTransformed)
+		return;
+
+	for(uint32 i = 0; i < count; ++i)
+		indices[first + i] = globalIndices[localIndices[i]];
+}
+
+void MeshOptimizer::OptimizeVertexFetch(GeometryGenerator::MeshData& meshData)
+{
+	std::vector<uint32> remap(meshData.Vertices.size(), NotInCache);
+	std::vector<GeometryGenerator::Vertex> vertices;
+	vertices.reserve(meshData.Vertices.size());
+
+	for(uint32& index : meshData.Indices32)
+	{
+		if(remap[index] == NotInCache)
+		{
+			remap[index] = (uint32)vertices.size();
+			vertices.push_back(meshData.Vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	meshData.Vertices.swap(vertices);
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32>& indices,
+	uint32 vertexCount, uint32 cacheSize)
+{
+	VertexCacheStats stats;
+	stats.TriangleCount = (uint32)indices.size() / 3;
+	stats.VertexCount = vertexCount;
+
+	FifoCache cache(vertexCount, cacheSize);
+	for(uint32 i = 0; i < stats.TriangleCount * 3; ++i)
+		stats.VerticesTransformed += cache.Access(indices[i]);
+
+	if(stats.TriangleCount > 0)
+		stats.Acmr = (float)stats.VerticesTransformed / stats.TriangleCount;
+	if(vertexCount > 0)
+		stats.Atvr = (float)stats.VerticesTransformed / vertexCount;
+
+	return stats;
+}
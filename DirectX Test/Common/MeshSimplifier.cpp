@@ -0,0 +1,556 @@
+//***************************************************************************************
+// MeshSimplifier.cpp
+//***************************************************************************************
+
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <tuple>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = MeshSimplifier::uint32;
+
+	// Border edges are held in place by a plane through the edge, perpendicular to its
+	// triangle.  The weight makes sliding off the border much dearer than flattening.
+	const double BorderWeight = 10.0;
+
+	// Symmetric 4x4 quadric: error(p) = p^T A p + 2 b.p + c.
+	struct Quadric
+	{
+		double A00 = 0.0, A11 = 0.0, A22 = 0.0, A01 = 0.0, A02 = 0.0, A12 = 0.0;
+		double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+		double C = 0.0;
+
+		// Total weight (area) of the planes, to turn the sum back into a squared distance.
+		double Weight = 0.0;
+
+		void AddPlane(double nx, double ny, double nz, double d, double weight)
+		{
+			A00 += weight * nx * nx; A11 += weight * ny * ny; A22 += weight * nz * nz;
+			A01 += weight * nx * ny; A02 += weight * nx * nz; A12 += weight * ny * nz;
+			B0 += weight * nx * d; B1 += weight * ny * d; B2 += weight * nz * d;
+			C += weight * d * d;
+			Weight += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A11 += q.A11; A22 += q.A22;
+			A01 += q.A01; A02 += q.A02; A12 += q.A12;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			Weight += q.Weight;
+		}
+
+		// Mean squared distance of p to the planes.
+		double Evaluate(const XMFLOAT3& p)const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double error =
+				A00 * x * x + A11 * y * y + A22 * z * z +
+				2.0 * (A01 * x * y + A02 * x * z + A12 * y * z) +
+				2.0 * (B0 * x + B1 * y + B2 * z) + C;
+
+			return Weight > 0.0 ? std::max(error, 0.0) / Weight : 0.0;
+		}
+	};
+
+	XMFLOAT3 TriangleCross(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+		float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+
+		return XMFLOAT3(
+			e1y * e2z - e1z * e2y,
+			e1z * e2x - e1x * e2z,
+			e1x * e2y - e1y * e2x);
+	}
+
+	enum EdgeKind
+	{
+		// One triangle.
+		Edge_Border,
+
+		// Two triangles using the same vertices.
+		Edge_Shared,
+
+		// Two triangles using different vertices at both ends.
+		Edge_Seam,
+
+		// Anything else: more triangles, or a seam that ends here.
+		Edge_Complex
+	};
+
+	enum GroupKind
+	{
+		Group_Manifold,
+		Group_Border,
+		Group_Seam,
+		Group_Locked
+	};
+
+	// One triangle side, between groups GroupA < GroupB.
+	struct EdgeRecord
+	{
+		uint32 GroupA;
+		uint32 GroupB;
+		uint32 VertexA;
+		uint32 VertexB;
+		uint32 Triangle;
+	};
+
+	// Connectivity of the current index list, rebuilt every pass.
+	struct Topology
+	{
+		// Records sorted by (GroupA, GroupB).  Edge e owns Records[EdgeStart[e], EdgeStart[e+1]).
+		std::vector<EdgeRecord> Records;
+		std::vector<uint32> EdgeStart;
+		std::vector<EdgeKind> EdgeKinds;
+
+		std::vector<GroupKind> GroupKinds;
+
+		// Triangles using each group, packed like the edges.
+		std::vector<uint32> FanStart;
+		std::vector<uint32> Fan;
+	};
+
+	void BuildTopology(const std::vector<uint32>& indices, const std::vector<uint32>& groupOf,
+		uint32 groupCount, Topology& topology)
+	{
+		uint32 triCount = (uint32)indices.size() / 3;
+
+		topology.Records.clear();
+		topology.Records.reserve(indices.size());
+		for(uint32 t = 0; t < triCount; ++t)
+		{
+			for(uint32 k = 0; k < 3; ++k)
+			{
+				uint32 a = indices[t * 3 + k];
+				uint32 b = indices[t * 3 + (k + 1) % 3];
+				if(groupOf[a] > groupOf[b])
+					std::swap(a, b);
+
+				topology.Records.push_back({ groupOf[a], groupOf[b], a, b, t });
+			}
+		}
+
+		std::sort(topology.Records.begin(), topology.Records.end(),
+			[](const EdgeRecord& x, const EdgeRecord& y)
+			{
+				return x.GroupA != y.GroupA ? x.GroupA < y.GroupA : x.GroupB < y.GroupB;
+			});
+
+		std::vector<uint32> borderEdges(groupCount, 0);
+		std::vector<uint32> seamEdges(groupCount, 0);
+		std::vector<uint32> complexEdges(groupCount, 0);
+
+		topology.EdgeStart.clear();
+		topology.EdgeKinds.clear();
+
+		const std::vector<EdgeRecord>& records = topology.Records;
+		for(uint32 begin = 0; begin < (uint32)records.size(); )
+		{
+			uint32 end = begin + 1;
+			while(end < (uint32)records.size() &&
+				records[end].GroupA == records[begin].GroupA &&
+				records[end].GroupB == records[begin].GroupB)
+			{
+				++end;
+			}
+
+			EdgeKind kind = Edge_Complex;
+			if(end - begin == 1)
+			{
+				kind = Edge_Border;
+			}
+			else if(end - begin == 2)
+			{
+				const EdgeRecord& r0 = records[begin];
+				const EdgeRecord& r1 = records[begin + 1];
+
+				if(r0.VertexA == r1.VertexA && r0.VertexB == r1.VertexB)
+					kind = Edge_Shared;
+				else if(r0.VertexA != r1.VertexA && r0.VertexB != r1.VertexB)
+					kind = Edge_Seam;
+			}
+
+			uint32 groups[2] = { records[begin].GroupA, records[begin].GroupB };
+			for(uint32 g : groups)
+			{
+				if(kind == Edge_Border)
+					borderEdges[g]++;
+				else if(kind == Edge_Seam)
+					seamEdges[g]++;
+				else if(kind == Edge_Complex)
+					complexEdges[g]++;
+			}
+
+			topology.EdgeStart.push_back(begin);
+			topology.EdgeKinds.push_back(kind);
+			begin = end;
+		}
+		topology.EdgeStart.push_back((uint32)records.size());
+
+		//
+		// Classify groups by how many of their vertices are still in use.
+		//
+
+		std::vector<uint32> vertexCount(groupCount, 0);
+		std::vector<uint32> usedVertices(indices.begin(), indices.end());
+		std::sort(usedVertices.begin(), usedVertices.end());
+		usedVertices.erase(std::unique(usedVertices.begin(), usedVertices.end()), usedVertices.end());
+		for(uint32 v : usedVertices)
+			vertexCount[groupOf[v]]++;
+
+		topology.GroupKinds.assign(groupCount, Group_Locked);
+		for(uint32 g = 0; g < groupCount; ++g)
+		{
+			if(complexEdges[g] != 0)
+				continue;
+
+			if(vertexCount[g] == 1 && seamEdges[g] == 0)
+			{
+				if(borderEdges[g] == 0)
+					topology.GroupKinds[g] = Group_Manifold;
+				else if(borderEdges[g] == 2)
+					topology.GroupKinds[g] = Group_Border;
+			}
+			else if(vertexCount[g] == 2 && borderEdges[g] == 0 && seamEdges[g] == 2)
+			{
+				topology.GroupKinds[g] = Group_Seam;
+			}
+		}
+
+		//
+		// Triangle fans.
+		//
+
+		topology.FanStart.assign(groupCount + 1, 0);
+		for(uint32 v : indices)
+			topology.FanStart[groupOf[v] + 1]++;
+		for(uint32 g = 0; g < groupCount; ++g)
+			topology.FanStart[g + 1] += topology.FanStart[g];
+
+		topology.Fan.resize(indices.size());
+		std::vector<uint32> fill(topology.FanStart.begin(), topology.FanStart.end() - 1);
+		for(uint32 i = 0; i < (uint32)indices.size(); ++i)
+			topology.Fan[fill[groupOf[indices[i]]]++] = i / 3;
+	}
+
+	bool CanCollapse(GroupKind from, EdgeKind edge)
+	{
+		return (from == Group_Manifold && edge == Edge_Shared) ||
+			(from == Group_Border && edge == Edge_Border) ||
+			(from == Group_Seam && edge == Edge_Seam);
+	}
+
+	struct Collapse
+	{
+		uint32 Edge;
+		uint32 From;
+		uint32 To;
+		double Cost;
+	};
+}
+
+MeshSimplifier::Lod MeshSimplifier::Simplify(const GeometryGenerator::MeshData& meshData,
+	const std::vector<uint32>& inputIndices, uint32 targetIndexCount, float maxError)
+{
+	const std::vector<GeometryGenerator::Vertex>& vertices = meshData.Vertices;
+	uint32 vertexCount = (uint32)vertices.size();
+
+	Lod lod;
+	std::vector<uint32>& indices = lod.Indices;
+
+	//
+	// Weld vertices that differ only in texture coordinates and tangents.  Every
+	// vertex belongs to exactly one group; collapses work on groups.
+	//
+
+	std::vector<uint32> groupOf(vertexCount);
+	std::vector<uint32> groupVertex;
+	{
+		auto key = [&](uint32 v)
+		{
+			const GeometryGenerator::Vertex& x = vertices[v];
+			return std::make_tuple(x.Position.x, x.Position.y, x.Position.z, x.Normal.x, x.Normal.y, x.Normal.z);
+		};
+
+		std::vector<uint32> order(vertexCount);
+		for(uint32 v = 0; v < vertexCount; ++v)
+			order[v] = v;
+		std::sort(order.begin(), order.end(), [&](uint32 a, uint32 b) { return key(a) < key(b); });
+
+		for(uint32 i = 0; i < vertexCount; ++i)
+		{
+			if(i == 0 || key(order[i - 1]) < key(order[i]))
+				groupVertex.push_back(order[i]);
+
+			groupOf[order[i]] = (uint32)groupVertex.size() - 1;
+		}
+	}
+	uint32 groupCount = (uint32)groupVertex.size();
+
+	auto groupPosition = [&](uint32 g) -> const XMFLOAT3& { return vertices[groupVertex[g]].Position; };
+
+	//
+	// Drop triangles that cover nothing; they would only lock their vertices.
+	//
+
+	indices.reserve(inputIndices.size());
+
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for(size_t i = 0; i + 2 < inputIndices.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = vertices[inputIndices[i + 0]].Position;
+		const XMFLOAT3& p1 = vertices[inputIndices[i + 1]].Position;
+		const XMFLOAT3& p2 = vertices[inputIndices[i + 2]].Position;
+
+		XMFLOAT3 n = TriangleCross(p0, p1, p2);
+		if(n.x == 0.0f && n.y == 0.0f && n.z == 0.0f)
+			continue;
+
+		for(const XMFLOAT3* p : { &p0, &p1, &p2 })
+		{
+			boundsMin = XMFLOAT3(std::min(boundsMin.x, p->x), std::min(boundsMin.y, p->y), std::min(boundsMin.z, p->z));
+			boundsMax = XMFLOAT3(std::max(boundsMax.x, p->x), std::max(boundsMax.y, p->y), std::max(boundsMax.z, p->z));
+		}
+
+		indices.insert(indices.end(), inputIndices.begin() + i, inputIndices.begin() + i + 3);
+	}
+
+	if(indices.empty())
+		return lod;
+
+	float extent = std::max(boundsMax.x - boundsMin.x,
+		std::max(boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z));
+	double maxErrorSq = (double)maxError * extent * maxError * extent;
+
+	//
+	// Quadrics: the planes of the triangles around each group, plus border planes.
+	//
+
+	std::vector<Quadric> quadrics(groupCount);
+
+	Topology topology;
+	BuildTopology(indices, groupOf, groupCount, topology);
+
+	for(size_t i = 0; i < indices.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = vertices[indices[i + 0]].Position;
+		XMFLOAT3 n = TriangleCross(p0, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position);
+
+		double length = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+		double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+		double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+		double area = 0.5 * length;
+
+		for(uint32 k = 0; k < 3; ++k)
+			quadrics[groupOf[indices[i + k]]].AddPlane(nx, ny, nz, d, area);
+	}
+
+	for(uint32 e = 0; e + 1 < (uint32)topology.EdgeStart.size(); ++e)
+	{
+		if(topology.EdgeKinds[e] != Edge_Border)
+			continue;
+
+		const EdgeRecord& r = topology.Records[topology.EdgeStart[e]];
+		const XMFLOAT3& pa = vertices[r.VertexA].Position;
+		const XMFLOAT3& pb = vertices[r.VertexB].Position;
+
+		uint32 t = r.Triangle;
+		XMFLOAT3 n = TriangleCross(vertices[indices[t * 3 + 0]].Position,
+			vertices[indices[t * 3 + 1]].Position, vertices[indices[t * 3 + 2]].Position);
+
+		double ex = pb.x - pa.x, ey = pb.y - pa.y, ez = pb.z - pa.z;
+		double bx = ey * n.z - ez * n.y;
+		double by = ez * n.x - ex * n.z;
+		double bz = ex * n.y - ey * n.x;
+		double length = sqrt(bx * bx + by * by + bz * bz);
+		if(length == 0.0)
+			continue;
+
+		bx /= length; by /= length; bz /= length;
+		double d = -(bx * pa.x + by * pa.y + bz * pa.z);
+		double weight = BorderWeight * (ex * ex + ey * ey + ez * ez);
+
+		quadrics[r.GroupA].AddPlane(bx, by, bz, d, weight);
+		quadrics[r.GroupB].AddPlane(bx, by, bz, d, weight);
+	}
+
+	//
+	// Collapse passes.  Each pass ranks every legal collapse by cost and applies the
+	// cheapest ones whose triangle fans do not overlap, so the costs and flip tests
+	// computed at the start of the pass stay valid.
+	//
+
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched(groupCount);
+	std::vector<uint32> remap(vertexCount);
+	double resultErrorSq = 0.0;
+
+	for(bool firstPass = true; indices.size() > targetIndexCount; firstPass = false)
+	{
+		if(!firstPass)
+			BuildTopology(indices, groupOf, groupCount, topology);
+
+		collapses.clear();
+		for(uint32 e = 0; e + 1 < (uint32)topology.EdgeStart.size(); ++e)
+		{
+			const EdgeRecord& r = topology.Records[topology.EdgeStart[e]];
+			EdgeKind kind = topology.EdgeKinds[e];
+
+			Collapse best = { e, 0, 0, -1.0 };
+			uint32 ends[2][2] = { { r.GroupA, r.GroupB }, { r.GroupB, r.GroupA } };
+			for(auto& end : ends)
+			{
+				if(!CanCollapse(topology.GroupKinds[end[0]], kind))
+					continue;
+
+				double cost = quadrics[end[0]].Evaluate(groupPosition(end[1]));
+				if(best.Cost < 0.0 || cost < best.Cost)
+					best = { e, end[0], end[1], cost };
+			}
+
+			if(best.Cost >= 0.0 && best.Cost <= maxErrorSq)
+				collapses.push_back(best);
+		}
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+		std::fill(touched.begin(), touched.end(), false);
+		for(uint32 v = 0; v < vertexCount; ++v)
+			remap[v] = v;
+
+		uint32 triCount = (uint32)indices.size() / 3;
+		uint32 targetTriCount = targetIndexCount / 3;
+		uint32 applied = 0;
+
+		for(const Collapse& c : collapses)
+		{
+			if(triCount <= targetTriCount)
+				break;
+
+			const uint32* fanBegin = &topology.Fan[topology.FanStart[c.From]];
+			const uint32* fanEnd = fanBegin + (topology.FanStart[c.From + 1] - topology.FanStart[c.From]);
+
+			// Skip if a collapse this pass already changed one of the triangles.
+			bool blocked = false;
+			for(const uint32* t = fanBegin; t != fanEnd && !blocked; ++t)
+			{
+				for(uint32 k = 0; k < 3; ++k)
+					blocked = blocked || touched[groupOf[indices[*t * 3 + k]]];
+			}
+			if(blocked)
+				continue;
+
+			// Reject collapses that turn a surviving triangle over.
+			bool flips = false;
+			for(const uint32* t = fanBegin; t != fanEnd && !flips; ++t)
+			{
+				XMFLOAT3 p[3];
+				bool collapsing = false;
+				for(uint32 k = 0; k < 3; ++k)
+				{
+					uint32 g = groupOf[indices[*t * 3 + k]];
+					collapsing = collapsing || g == c.To;
+					p[k] = groupPosition(g == c.From ? c.To : g);
+				}
+
+				// Triangles on the collapsed edge disappear.
+				if(collapsing)
+					continue;
+
+				XMFLOAT3 before = TriangleCross(
+					vertices[indices[*t * 3 + 0]].Position,
+					vertices[indices[*t * 3 + 1]].Position,
+					vertices[indices[*t * 3 + 2]].Position);
+				XMFLOAT3 after = TriangleCross(p[0], p[1], p[2]);
+
+				flips = before.x * after.x + before.y * after.y + before.z * after.z <= 0.0f;
+			}
+			if(flips)
+				continue;
+
+			// Merge every vertex of the From group into its partner on the edge.  A seam
+			// edge has two records and moves both sides of the seam.
+			for(uint32 i = topology.EdgeStart[c.Edge]; i < topology.EdgeStart[c.Edge + 1]; ++i)
+			{
+				const EdgeRecord& r = topology.Records[i];
+				if(r.GroupA == c.From)
+					remap[r.VertexA] = r.VertexB;
+				else
+					remap[r.VertexB] = r.VertexA;
+			}
+
+			quadrics[c.To].Add(quadrics[c.From]);
+			resultErrorSq = std::max(resultErrorSq, c.Cost);
+
+			for(const uint32* t = fanBegin; t != fanEnd; ++t)
+			{
+				for(uint32 k = 0; k < 3; ++k)
+					touched[groupOf[indices[*t * 3 + k]]] = true;
+			}
+
+			triCount -= topology.EdgeStart[c.Edge + 1] - topology.EdgeStart[c.Edge];
+			applied++;
+		}
+
+		if(applied == 0)
+			break;
+
+		// Rewrite the index list, dropping triangles that lost a corner.
+		size_t write = 0;
+		for(size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32 a = remap[indices[i + 0]];
+			uint32 b = remap[indices[i + 1]];
+			uint32 c = remap[indices[i + 2]];
+			if(a == b || b == c || a == c)
+				continue;
+
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+	}
+
+	lod.Error = extent > 0.0f ? (float)(sqrt(resultErrorSq) / extent) : 0.0f;
+	return lod;
+}
+
+std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLodChain(const GeometryGenerator::MeshData& meshData,
+	const std::vector<float>& triangleRatios, float maxError)
+{
+	std::vector<Lod> lods;
+
+	const std::vector<uint32>* previous = &meshData.Indices32;
+	float error = 0.0f;
+
+	for(float ratio : triangleRatios)
+	{
+		uint32 targetIndexCount = (uint32)(meshData.Indices32.size() / 3 * ratio) * 3;
+
+		Lod lod = Simplify(meshData, *previous, targetIndexCount, maxError);
+		if(lod.Indices.empty() || lod.Indices.size() > previous->size() * 9 / 10)
+			break;
+
+		// Simplify measures against its input, which is already the previous LOD, so the
+		// errors add up along the chain.
+		error += lod.Error;
+		lod.Error = error;
+
+		lods.push_back(std::move(lod));
+		previous = &lods.back().Indices;
+	}
+
+	return lods;
+}
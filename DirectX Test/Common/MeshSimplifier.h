@@ -0,0 +1,56 @@
+//***************************************************************************************
+// MeshSimplifier.h
+//
+// Quadric error mesh simplification (Garland and Heckbert, "Surface Simplification
+// Using Quadric Error Metrics") for GeometryGenerator::MeshData, and LOD chains built
+// from it.
+//
+// Edges are removed with half-edge collapses: one endpoint is merged into the other,
+// which stays where it is.  No vertex is ever moved or created, so every LOD is just
+// another index list into the original vertex buffer and can be stored as an extra
+// submesh of the same MeshGeometry.
+//
+// Vertices that differ only in texture coordinates (e.g. the seam of a sphere) are
+// collapsed together so the seam stays closed.  Vertices at a position with a split
+// normal (e.g. box edges) are treated as the border of each face and only slide along
+// it.  Anything more complicated is locked in place.
+//
+// Errors are reported as a distance relative to the largest extent of the mesh bounds,
+// so an LOD with error e may be drawn as long as e * (projected size in pixels) stays
+// below the tolerated pixel error.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+class MeshSimplifier
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	// Part of the mesh cache key: raise it when the LODs come out differently.
+	static const uint32 Version = 1;
+
+	struct Lod
+	{
+		std::vector<uint32> Indices;
+
+		// Relative distance between this LOD and the full-detail mesh.
+		float Error = 0.0f;
+	};
+
+	// Collapses edges, cheapest first, until at most targetIndexCount indices are left or
+	// the next collapse would exceed maxError.  Zero-area triangles are dropped first.
+	// Returns the new index list into meshData.Vertices.
+	static Lod Simplify(const GeometryGenerator::MeshData& meshData,
+		const std::vector<uint32>& indices, uint32 targetIndexCount, float maxError = 1.0f);
+
+	// One LOD per entry of triangleRatios (fractions of the full-detail triangle count,
+	// decreasing).  Each LOD is simplified from the previous one, so errors only grow.
+	// LODs that fail to get at least 10% below the previous one are left out.
+	// The full-detail mesh itself is not included.
+	static std::vector<Lod> BuildLodChain(const GeometryGenerator::MeshData& meshData,
+		const std::vector<float>& triangleRatios, float maxError = 1.0f);
+};
@@ -0,0 +1,298 @@
+//***************************************************************************************
+// MeshletBuilder.cpp
+//***************************************************************************************
+
+#include "MeshletBuilder.h"
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = MeshletBuilder::uint32;
+
+	const uint32 NotInMeshlet = 0xffffffff;
+
+	float Det3(float a0, float a1, float a2, float b0, float b1, float b2, float c0, float c1, float c2)
+	{
+		return a0 * (b1 * c2 - b2 * c1) - a1 * (b0 * c2 - b2 * c0) + a2 * (b0 * c1 - b1 * c0);
+	}
+
+	// Bounding sphere and normal cone of the triangles in indices[first, first + count).
+	void ComputeBounds(Meshlet& meshlet, const std::vector<uint32>& indices, uint32 first, uint32 count,
+		const std::vector<GeometryGenerator::Vertex>& vertices, const std::vector<uint32>& meshletVertices)
+	{
+		XMVECTOR center = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
+		for(uint32 v : meshletVertices)
+			center = center + XMLoadFloat3(&vertices[v].Position);
+		center = center * (1.0f / meshletVertices.size());
+
+		float radius = 0.0f;
+		for(uint32 v : meshletVertices)
+		{
+			float d = XMVectorGetX(XMVector3Length(XMLoadFloat3(&vertices[v].Position) - center));
+			radius = std::max(radius, d);
+		}
+
+		XMStoreFloat3(&meshlet.Center, center);
+		meshlet.Radius = radius;
+
+		// The cone axis is the mean face normal; the cone has to open wide enough for the
+		// normal furthest from it.  Degenerate triangles have no normal and are skipped.
+		std::vector<XMVECTOR> normals;
+		normals.reserve(count / 3);
+		XMVECTOR axis = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
+		for(uint32 i = first; i < first + count; i += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[i + 0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[i + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[i + 2]].Position);
+
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			float length = XMVectorGetX(XMVector3Length(n));
+			if(length <= 1e-12f)
+				continue;
+
+			n = n * (1.0f / length);
+			normals.push_back(n);
+			axis = axis + n;
+		}
+
+		meshlet.ConeCutoff = 1.0f;
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if(normals.empty() || axisLength <= 1e-6f)
+			return;
+
+		axis = axis * (1.0f / axisLength);
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+
+		float minDot = 1.0f;
+		for(const XMVECTOR& n : normals)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(n, axis)));
+
+		if(minDot > 0.0f)
+			meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+MeshletSet MeshletBuilder::Build(std::vector<uint32>& indices, const std::vector<GeometryGenerator::Vertex>& vertices,
+	uint32 maxVertices, uint32 maxTriangles)
+{
+	MeshletSet result;
+
+	const uint32 triangleCount = (uint32)indices.size() / 3;
+	const uint32 vertexCount = (uint32)vertices.size();
+	if(triangleCount == 0)
+		return result;
+
+	// Triangles around each vertex.
+	std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+	for(uint32 i = 0; i < triangleCount * 3; ++i)
+		++adjacencyOffsets[indices[i] + 1];
+	for(uint32 v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<uint32> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for(uint32 i = 0; i < triangleCount * 3; ++i)
+			adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+
+	// Meshlet a vertex was last added to, so membership is one compare.
+	std::vector<uint32> vertexMeshlet(vertexCount, NotInMeshlet);
+
+	std::vector<uint32> newIndices;
+	newIndices.reserve(triangleCount * 3);
+
+	std::vector<uint32> meshletVertices;
+	std::vector<uint32> candidates;
+	uint32 seed = 0;
+
+	while(true)
+	{
+		while(seed < triangleCount && emitted[seed])
+			++seed;
+		if(seed == triangleCount)
+			break;
+
+		const uint32 id = (uint32)result.Meshlets.size();
+		const uint32 first = (uint32)newIndices.size();
+		meshletVertices.clear();
+		candidates.clear();
+
+		uint32 triangle = seed;
+		while(triangle != NotInMeshlet)
+		{
+			emitted[triangle] = true;
+			for(uint32 k = 0; k < 3; ++k)
+			{
+				uint32 v = indices[triangle * 3 + k];
+				newIndices.push_back(v);
+
+				if(vertexMeshlet[v] != id)
+				{
+					vertexMeshlet[v] = id;
+					meshletVertices.push_back(v);
+
+					for(uint32 a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+					{
+						if(!emitted[adjacency[a]])
+							candidates.push_back(adjacency[a]);
+					}
+				}
+			}
+
+			triangle = NotInMeshlet;
+			if((newIndices.size() - first) / 3 >= maxTriangles)
+				break;
+
+			// Neighbour that adds the fewest new vertices; the oldest candidate wins ties,
+			// which grows the cluster breadth first and keeps it round.
+			uint32 bestNew = 4;
+			size_t kept = 0;
+			for(size_t c = 0; c < candidates.size(); ++c)
+			{
+				uint32 t = candidates[c];
+				if(emitted[t])
+					continue;
+				candidates[kept++] = t;
+
+				uint32 newVertices = 0;
+				for(uint32 k = 0; k < 3; ++k)
+					newVertices += vertexMeshlet[indices[t * 3 + k]] != id ? 1 : 0;
+
+				if(newVertices < bestNew && meshletVertices.size() + newVertices <= maxVertices)
+				{
+					bestNew = newVertices;
+					triangle = t;
+				}
+			}
+			candidates.resize(kept);
+		}
+
+		Meshlet meshlet;
+		meshlet.IndexOffset = first;
+		meshlet.IndexCount = (uint32)newIndices.size() - first;
+		meshlet.VertexCount = (uint32)meshletVertices.size();
+		ComputeBounds(meshlet, newIndices, first, meshlet.IndexCount, vertices, meshletVertices);
+
+		result.Meshlets.push_back(meshlet);
+	}
+
+	indices.swap(newIndices);
+
+	return result;
+}
+
+MeshletBuilder::CullView MeshletBuilder::MakeCullView(const XMFLOAT4X4& m)
+{
+	// With row vectors, clip = p * m, so each clip coordinate is p dotted with a column.
+	float c[4][4];
+	for(int col = 0; col < 4; ++col)
+	{
+		for(int row = 0; row < 4; ++row)
+			c[col][row] = m.m[row][col];
+	}
+
+	CullView view;
+	Frustum frustum = Frustum::FromViewProj(m);
+	for(int i = 0; i < 6; ++i)
+		view.Planes[i] = frustum.Planes[i];
+
+	// The eye is the point with clip x = y = w = 0: orthogonal to those three columns.
+	// A parallel projection puts it at infinity, which leaves the view direction.
+	const float* a = c[0];
+	const float* b = c[1];
+	const float* d = c[3];
+	float e[4] =
+	{
+		 Det3(a[1], a[2], a[3], b[1], b[2], b[3], d[1], d[2], d[3]),
+		-Det3(a[0], a[2], a[3], b[0], b[2], b[3], d[0], d[2], d[3]),
+		 Det3(a[0], a[1], a[3], b[0], b[1], b[3], d[0], d[1], d[3]),
+		-Det3(a[0], a[1], a[2], b[0], b[1], b[2], d[0], d[1], d[2]),
+	};
+
+	// Orient it so that it maps to positive clip z, i.e. looks into the scene.
+	float z = e[0] * c[2][0] + e[1] * c[2][1] + e[2] * c[2][2] + e[3] * c[2][3];
+	if(z < 0.0f)
+	{
+		for(float& x : e)
+			x = -x;
+	}
+
+	float scale = sqrtf(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+	if(fabsf(e[3]) > 1e-6f * scale)
+		view.Eye = XMFLOAT4(e[0] / e[3], e[1] / e[3], e[2] / e[3], 1.0f);
+	else if(scale > 0.0f)
+		view.Eye = XMFLOAT4(e[0] / scale, e[1] / scale, e[2] / scale, 0.0f);
+	else
+		view.Eye = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	return view;
+}
+
+MeshletBuilder::uint32 MeshletBuilder::Cull(const MeshletSet& meshlets, const CullView& view, std::vector<IndexRange>& ranges)
+{
+	ranges.clear();
+	uint32 visibleIndices = 0;
+
+	for(const Meshlet& meshlet : meshlets.Meshlets)
+	{
+		const XMFLOAT3& center = meshlet.Center;
+
+		bool outside = false;
+		for(const XMFLOAT4& plane : view.Planes)
+		{
+			if(plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -meshlet.Radius)
+			{
+				outside = true;
+				break;
+			}
+		}
+		if(outside)
+			continue;
+
+		// Back-facing when every direction from the eye into the sphere is within 90
+		// degrees minus the cone angle of the axis:
+		// dot(normalize(center - eye), axis) >= sin(cone angle) + sin(sphere angle).
+		if(meshlet.ConeCutoff < 1.0f)
+		{
+			const XMFLOAT3& axis = meshlet.ConeAxis;
+			if(view.Eye.w != 0.0f)
+			{
+				float dx = center.x - view.Eye.x;
+				float dy = center.y - view.Eye.y;
+				float dz = center.z - view.Eye.z;
+				float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+				if(dx * axis.x + dy * axis.y + dz * axis.z >= meshlet.ConeCutoff * distance + meshlet.Radius)
+					continue;
+			}
+			else if(view.Eye.x * axis.x + view.Eye.y * axis.y + view.Eye.z * axis.z >= meshlet.ConeCutoff)
+			{
+				continue;
+			}
+		}
+
+		if(!ranges.empty() && ranges.back().IndexOffset + ranges.back().IndexCount == meshlet.IndexOffset)
+		{
+			ranges.back().IndexCount += meshlet.IndexCount;
+		}
+		else
+		{
+			IndexRange range;
+			range.IndexOffset = meshlet.IndexOffset;
+			range.IndexCount = meshlet.IndexCount;
+			ranges.push_back(range);
+		}
+
+		visibleIndices += meshlet.IndexCount;
+	}
+
+	return visibleIndices;
+}
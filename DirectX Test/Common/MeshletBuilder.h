@@ -0,0 +1,89 @@
+//***************************************************************************************
+// MeshletBuilder.h
+//
+// Splits a triangle list into meshlets: small clusters of at most 64 vertices and 124
+// triangles that are culled as a unit on the CPU before the draw is issued.
+//
+// Build reorders the index list so that every meshlet is a contiguous index range and
+// gives each one a bounding sphere and a normal cone.  Cull then tests the meshlets of
+// a submesh against the view and returns the index ranges still worth drawing,
+// neighbouring ranges merged, so a large mesh seen partly or from one side is drawn with
+// a few DrawIndexedInstanced calls over the visible part only.
+//
+// A meshlet is rejected when its sphere is outside the frustum, or when its normal cone
+// shows that every triangle faces away from the eye (Shirman and Abi-Ezzi, "The Cone of
+// Normals Technique for Fast Processing of Curved Patches").  Both tests are
+// conservative: nothing visible is ever culled.
+//
+// Clusters are grown from a seed triangle by always adding the neighbouring triangle
+// that brings the fewest new vertices, which keeps them compact on regular meshes.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+struct Meshlet
+{
+	// Index range of the meshlet, relative to the start of its submesh.
+	std::uint32_t IndexOffset = 0;
+	std::uint32_t IndexCount = 0;
+
+	// Distinct vertices referenced by the meshlet.
+	std::uint32_t VertexCount = 0;
+
+	DirectX::XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+	float Radius = 0.0f;
+
+	// Every face normal n has dot(n, ConeAxis) >= cos(a) for the cone half-angle a.
+	// ConeCutoff is sin(a), or 1 when the normals span a hemisphere or more and the
+	// meshlet can never be back-facing as a whole.
+	DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 1.0f };
+	float ConeCutoff = 1.0f;
+};
+
+struct MeshletSet
+{
+	std::vector<Meshlet> Meshlets;
+};
+
+class MeshletBuilder
+{
+public:
+
+	using uint32 = GeometryGenerator::uint32;
+
+	static const uint32 MaxVertices = 64;
+	static const uint32 MaxTriangles = 124;
+
+	// Meshlets are stored in the mesh cache; a new version makes it rebuild them.
+	static const uint32 Version = 1;
+
+	struct IndexRange
+	{
+		uint32 IndexOffset = 0;
+		uint32 IndexCount = 0;
+	};
+
+	// View in the local space of a mesh.
+	struct CullView
+	{
+		// Normalised planes, dot(plane.xyz, p) + plane.w >= 0 inside.
+		DirectX::XMFLOAT4 Planes[6];
+
+		// The eye as w = 1, or for parallel projections the view direction as w = 0.
+		DirectX::XMFLOAT4 Eye;
+	};
+
+	// Reorders indices into meshlets and returns them.
+	static MeshletSet Build(std::vector<uint32>& indices, const std::vector<GeometryGenerator::Vertex>& vertices,
+		uint32 maxVertices = MaxVertices, uint32 maxTriangles = MaxTriangles);
+
+	// Frustum and eye of a world * view * projection matrix (row vectors), expressed in
+	// the local space the matrix starts from.
+	static CullView MakeCullView(const DirectX::XMFLOAT4X4& worldViewProj);
+
+	// Replaces ranges with the index ranges of the meshlets that may be visible and
+	// returns their total index count.
+	static uint32 Cull(const MeshletSet& meshlets, const CullView& view, std::vector<IndexRange>& ranges);
+};
@@ -0,0 +1,326 @@
+//***************************************************************************************
+// PipelineCache.cpp
+//***************************************************************************************
+
+#include "PipelineCache.h"
+#include "Hash.h"
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	template <typename T>
+	std::uint64_t HashValue(const T& value, std::uint64_t hash)
+	{
+		return Fnv1a(&value, sizeof(T), hash);
+	}
+
+	std::uint64_t HashString(const char* s, std::uint64_t hash)
+	{
+		return s != nullptr ? Fnv1a(s, std::strlen(s) + 1, hash) : HashValue('\0', hash);
+	}
+
+	std::uint64_t HashBytecode(const D3D12_SHADER_BYTECODE& bytecode, std::uint64_t hash)
+	{
+		hash = HashValue((std::uint64_t)bytecode.BytecodeLength, hash);
+		return Fnv1a(bytecode.pShaderBytecode, bytecode.BytecodeLength, hash);
+	}
+
+	std::wstring GetPipelineName(std::uint64_t key)
+	{
+		wchar_t name[32];
+		swprintf_s(name, L"%016llx", (unsigned long long)key);
+		return name;
+	}
+}
+
+PipelineCache::PipelineCache(ID3D12Device* device, const std::wstring& libraryPath)
+	: mDevice(device)
+	, mLibraryPath(libraryPath)
+{
+	ReadLibrary();
+	mWorker = std::thread(&PipelineCache::WorkerMain, this);
+}
+
+PipelineCache::~PipelineCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mStopping = true;
+	}
+	mQueueChanged.notify_one();
+	mWorker.join();
+}
+
+ID3D12PipelineState* PipelineCache::Get(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash)
+{
+	const std::uint64_t key = Hash(desc, rootSignatureHash);
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mPipelines.find(key);
+		if (it != mPipelines.end())
+		{
+			++mStats.MemoryHits;
+			return it->second.Get();
+		}
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const std::wstring name = GetPipelineName(key);
+
+	// Loading from the library is fast, so it is done under the lock that also
+	// serialises StorePipeline and Serialize; creation is not.
+	ComPtr<ID3D12PipelineState> pipeline;
+	bool fromLibrary = false;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mLibrary != nullptr)
+			fromLibrary = SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(pipeline.GetAddressOf())));
+	}
+
+	if (!fromLibrary)
+		ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipeline.GetAddressOf())));
+
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.CreateMs += ms;
+
+	// Another thread may have made the same pipeline meanwhile; keep the first.
+	auto inserted = mPipelines.emplace(key, pipeline);
+	if (!inserted.second)
+	{
+		++mStats.MemoryHits;
+		return inserted.first->second.Get();
+	}
+
+	if (fromLibrary)
+	{
+		++mStats.LibraryHits;
+	}
+	else
+	{
+		++mStats.Created;
+		if (mLibrary != nullptr && SUCCEEDED(mLibrary->StorePipeline(name.c_str(), pipeline.Get())))
+			mLibraryChanged = true;
+	}
+
+	return pipeline.Get();
+}
+
+ID3D12PipelineState* PipelineCache::GetAsync(std::uint64_t requestKey, std::function<ID3D12PipelineState*()> build)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mAsyncResults.find(requestKey);
+		if (it != mAsyncResults.end())
+		{
+			if (!it->second.Done || it->second.Pipeline == nullptr)
+				++mStats.AsyncFallbacks;
+			return it->second.Pipeline;
+		}
+
+		mAsyncResults.emplace(requestKey, AsyncResult());
+		++mStats.AsyncPending;
+		++mStats.AsyncFallbacks;
+	}
+
+	AsyncRequest request;
+	request.Key = requestKey;
+	request.Build = std::move(build);
+	{
+		std::lock_guard<std::mutex> lock(mQueueMutex);
+		mQueue.push_back(std::move(request));
+	}
+	mQueueChanged.notify_one();
+
+	return nullptr;
+}
+
+bool PipelineCache::Save()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mLibrary == nullptr || !mLibraryChanged)
+		return true;
+
+	std::vector<char> data(mLibrary->GetSerializedSize());
+	if (FAILED(mLibrary->Serialize(data.data(), data.size())))
+		return false;
+
+	// Written under a temporary name and renamed, so an interrupted write never leaves
+	// a truncated library behind.
+	std::wstring tempPath = mLibraryPath + L".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+
+		fout.write(data.data(), (std::streamsize)data.size());
+		if (!fout)
+			return false;
+	}
+
+	if (!MoveFileExW(tempPath.c_str(), mLibraryPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(tempPath.c_str());
+		return false;
+	}
+
+	mLibraryChanged = false;
+	return true;
+}
+
+PipelineCache::Stats PipelineCache::GetStats()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+std::uint64_t PipelineCache::Hash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash)
+{
+	std::uint64_t hash = Fnv1a(&rootSignatureHash, sizeof(rootSignatureHash));
+
+	hash = HashBytecode(desc.VS, hash);
+	hash = HashBytecode(desc.PS, hash);
+	hash = HashBytecode(desc.DS, hash);
+	hash = HashBytecode(desc.HS, hash);
+	hash = HashBytecode(desc.GS, hash);
+
+	const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+	hash = HashValue(so.NumEntries, hash);
+	for (UINT i = 0; i < so.NumEntries; ++i)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+		hash = HashValue(entry.Stream, hash);
+		hash = HashString(entry.SemanticName, hash);
+		hash = HashValue(entry.SemanticIndex, hash);
+		hash = HashValue(entry.StartComponent, hash);
+		hash = HashValue(entry.ComponentCount, hash);
+		hash = HashValue(entry.OutputSlot, hash);
+	}
+	hash = HashValue(so.NumStrides, hash);
+	if (so.NumStrides > 0)
+		hash = Fnv1a(so.pBufferStrides, so.NumStrides * sizeof(UINT), hash);
+	hash = HashValue(so.RasterizedStream, hash);
+
+	// Field by field where the structure has padding, whose bytes are undefined.
+	hash = HashValue(desc.BlendState.AlphaToCoverageEnable, hash);
+	hash = HashValue(desc.BlendState.IndependentBlendEnable, hash);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& target : desc.BlendState.RenderTarget)
+	{
+		hash = HashValue(target.BlendEnable, hash);
+		hash = HashValue(target.LogicOpEnable, hash);
+		hash = HashValue(target.SrcBlend, hash);
+		hash = HashValue(target.DestBlend, hash);
+		hash = HashValue(target.BlendOp, hash);
+		hash = HashValue(target.SrcBlendAlpha, hash);
+		hash = HashValue(target.DestBlendAlpha, hash);
+		hash = HashValue(target.BlendOpAlpha, hash);
+		hash = HashValue(target.LogicOp, hash);
+		hash = HashValue(target.RenderTargetWriteMask, hash);
+	}
+	hash = HashValue(desc.SampleMask, hash);
+	hash = HashValue(desc.RasterizerState, hash);
+
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	hash = HashValue(depthStencil.DepthEnable, hash);
+	hash = HashValue(depthStencil.DepthWriteMask, hash);
+	hash = HashValue(depthStencil.DepthFunc, hash);
+	hash = HashValue(depthStencil.StencilEnable, hash);
+	hash = HashValue(depthStencil.StencilReadMask, hash);
+	hash = HashValue(depthStencil.StencilWriteMask, hash);
+	hash = HashValue(depthStencil.FrontFace, hash);
+	hash = HashValue(depthStencil.BackFace, hash);
+
+	hash = HashValue(desc.InputLayout.NumElements, hash);
+	for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		hash = HashString(element.SemanticName, hash);
+		hash = HashValue(element.SemanticIndex, hash);
+		hash = HashValue(element.Format, hash);
+		hash = HashValue(element.InputSlot, hash);
+		hash = HashValue(element.AlignedByteOffset, hash);
+		hash = HashValue(element.InputSlotClass, hash);
+		hash = HashValue(element.InstanceDataStepRate, hash);
+	}
+
+	hash = HashValue(desc.IBStripCutValue, hash);
+	hash = HashValue(desc.PrimitiveTopologyType, hash);
+	hash = HashValue(desc.NumRenderTargets, hash);
+	hash = HashValue(desc.RTVFormats, hash);
+	hash = HashValue(desc.DSVFormat, hash);
+	hash = HashValue(desc.SampleDesc, hash);
+	hash = HashValue(desc.NodeMask, hash);
+	hash = HashValue(desc.Flags, hash);
+	return hash;
+}
+
+void PipelineCache::ReadLibrary()
+{
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(mDevice.As(&device1)))
+		return;
+
+	std::ifstream fin(mLibraryPath, std::ios::binary);
+	if (fin)
+	{
+		mLibraryData.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		if (!mLibraryData.empty() &&
+			SUCCEEDED(device1->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(mLibrary.GetAddressOf()))))
+			return;
+	}
+
+	// Missing, damaged or written by another driver: start an empty library.
+	mLibraryData.clear();
+	mLibrary = nullptr;
+	if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(mLibrary.GetAddressOf()))))
+		mLibrary = nullptr;
+}
+
+void PipelineCache::WorkerMain()
+{
+	for (;;)
+	{
+		AsyncRequest request;
+		{
+			std::unique_lock<std::mutex> lock(mQueueMutex);
+			mQueueChanged.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+			if (mStopping)
+				return;
+
+			request = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+
+		// A failed job leaves its request falling back for good rather than retrying
+		// every frame.
+		ID3D12PipelineState* pipeline = nullptr;
+		try
+		{
+			pipeline = request.Build();
+		}
+		catch (DxException& e)
+		{
+			OutputDebugStringW((L"PipelineCache: " + e.ToString() + L"\n").c_str());
+		}
+		catch (std::exception& e)
+		{
+			OutputDebugStringA((std::string("PipelineCache: ") + e.what() + "\n").c_str());
+		}
+		catch (...)
+		{
+			// Anything else would end the thread and leave the request pending forever.
+			OutputDebugStringA("PipelineCache: unknown exception while building a pipeline\n");
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		AsyncResult& result = mAsyncResults[request.Key];
+		result.Done = true;
+		result.Pipeline = pipeline;
+		--mStats.AsyncPending;
+	}
+}
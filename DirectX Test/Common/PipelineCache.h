@@ -0,0 +1,117 @@
+//***************************************************************************************
+// PipelineCache.h
+//
+// Graphics pipeline states keyed by a hash of their full description, kept in memory,
+// persisted in a D3D12 pipeline library on disk and, on request, created on a worker
+// thread so that a new combination never stalls a frame.
+//
+// The key covers every field of D3D12_GRAPHICS_PIPELINE_STATE_DESC that decides the
+// pipeline: the shader bytecode and input layout by content, the fixed-function state
+// by value, and the root signature through a hash the caller provides (a root
+// signature cannot be read back, so hash the blob it was created from).  Two equal
+// descriptions therefore share one pipeline state however they were built.
+//
+// On disk the pipeline states are an ID3D12PipelineLibrary, named by key.  The driver
+// rejects a library written by another driver or adapter; the cache then starts empty
+// and Save overwrites it.  Without ID3D12Device1 (older runtimes) nothing is persisted.
+//
+// Get blocks until the pipeline state exists.  GetAsync never blocks: the first call
+// for a request queues a job for the worker thread, which typically compiles shaders
+// and calls Get, and every call returns null until the job has finished, so the caller
+// draws with a fallback pipeline state in the meantime.  Get may be called from any
+// thread.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class PipelineCache
+{
+public:
+
+	struct Stats
+	{
+		// Get calls answered from memory, from the pipeline library, and by creating
+		// the pipeline state.
+		UINT MemoryHits = 0;
+		UINT LibraryHits = 0;
+		UINT Created = 0;
+
+		// Time spent creating or loading pipeline states, on all threads.
+		double CreateMs = 0.0;
+
+		// Async jobs queued and not finished yet, and GetAsync calls that had to fall back.
+		UINT AsyncPending = 0;
+		UINT AsyncFallbacks = 0;
+	};
+
+	PipelineCache(ID3D12Device* device, const std::wstring& libraryPath);
+	~PipelineCache();
+
+	PipelineCache(const PipelineCache& rhs) = delete;
+	PipelineCache& operator=(const PipelineCache& rhs) = delete;
+
+	// The pipeline state of desc, created if necessary.  Throws if creation fails.
+	ID3D12PipelineState* Get(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash);
+
+	// The pipeline state built by the job for requestKey, or null while the job is queued
+	// or running (or if it failed).  The job runs on the worker thread and must only use
+	// data that outlives the cache.
+	ID3D12PipelineState* GetAsync(std::uint64_t requestKey, std::function<ID3D12PipelineState*()> build);
+
+	// Writes the pipeline library if pipeline states were added since it was loaded.
+	// Returns false if it could not be written; the cache is optional, so callers may
+	// ignore it.
+	bool Save();
+
+	Stats GetStats()const;
+
+	static std::uint64_t Hash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureHash);
+
+private:
+
+	struct AsyncRequest
+	{
+		std::uint64_t Key = 0;
+		std::function<ID3D12PipelineState*()> Build;
+	};
+
+	struct AsyncResult
+	{
+		bool Done = false;
+		ID3D12PipelineState* Pipeline = nullptr;
+	};
+
+	void ReadLibrary();
+	void WorkerMain();
+
+private:
+
+	Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+	std::wstring mLibraryPath;
+
+	// Guards everything below except the worker queue.
+	mutable std::mutex mMutex;
+
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+
+	// The library reads pipelines from this memory for as long as it exists.
+	std::vector<char> mLibraryData;
+	bool mLibraryChanged = false;
+
+	std::unordered_map<std::uint64_t, Microsoft::WRL::ComPtr<ID3D12PipelineState>> mPipelines;
+	std::unordered_map<std::uint64_t, AsyncResult> mAsyncResults;
+	Stats mStats;
+
+	std::mutex mQueueMutex;
+	std::condition_variable mQueueChanged;
+	std::deque<AsyncRequest> mQueue;
+	bool mStopping = false;
+	std::thread mWorker;
+};
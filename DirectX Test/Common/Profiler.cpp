@@ -0,0 +1,199 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Profiler::mEnabled(false);
+
+namespace
+{
+	struct ProfileEvent
+	{
+		const char* Name;
+		std::uint64_t Start;
+		std::uint64_t End;
+	};
+
+	struct ThreadRing
+	{
+		std::unique_ptr<ProfileEvent[]> Events{ new ProfileEvent[Profiler::EventsPerThread] };
+
+		// Events written so far; slot of event i is i % EventsPerThread.  Only the
+		// owning thread stores to it.
+		std::atomic<std::uint64_t> Head{ 0 };
+
+		// Events before this one were cleared.
+		std::atomic<std::uint64_t> ClearedTo{ 0 };
+
+		std::uint32_t ThreadId = 0;
+		std::string Name;
+	};
+
+	// Rings are kept after their thread exits, so its zones still reach the trace.
+	struct Registry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadRing>> Rings;
+
+		// Time stamp counter and clock read together when profiling first started.
+		bool Calibrated = false;
+		std::uint64_t AnchorTicks = 0;
+		std::chrono::steady_clock::time_point AnchorTime;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	ThreadRing& GetThreadRing()
+	{
+		thread_local ThreadRing* ring = nullptr;
+		if (ring == nullptr)
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.Mutex);
+
+			std::unique_ptr<ThreadRing> newRing(new ThreadRing());
+			newRing->ThreadId = (std::uint32_t)registry.Rings.size();
+			newRing->Name = "Thread " + std::to_string(newRing->ThreadId);
+			ring = newRing.get();
+			registry.Rings.push_back(std::move(newRing));
+		}
+		return *ring;
+	}
+
+	void WriteJsonString(std::ofstream& fout, const char* s)
+	{
+		fout << '"';
+		for (; *s != '\0'; ++s)
+		{
+			unsigned char c = (unsigned char)*s;
+			if (c == '"' || c == '\\')
+				fout << '\\' << (char)c;
+			else if (c < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				fout << escaped;
+			}
+			else
+				fout << (char)c;
+		}
+		fout << '"';
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	if (enabled)
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+		if (!registry.Calibrated)
+		{
+			registry.AnchorTicks = Now();
+			registry.AnchorTime = std::chrono::steady_clock::now();
+			registry.Calibrated = true;
+		}
+	}
+
+	mEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::Record(const char* name, std::uint64_t start, std::uint64_t end)
+{
+	ThreadRing& ring = GetThreadRing();
+
+	std::uint64_t head = ring.Head.load(std::memory_order_relaxed);
+	ProfileEvent& e = ring.Events[head & (EventsPerThread - 1)];
+	e.Name = name;
+	e.Start = start;
+	e.End = end;
+	ring.Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadRing& ring = GetThreadRing();
+
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	ring.Name = name;
+}
+
+void Profiler::Clear()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+	for (auto& ring : registry.Rings)
+		ring->ClearedTo.store(ring->Head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	std::ofstream fout(path, std::ios::trunc);
+	if (!fout || !registry.Calibrated)
+		return false;
+
+	// Ticks per microsecond over everything since calibration.
+	const std::uint64_t nowTicks = Now();
+	const double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - registry.AnchorTime).count();
+	const double ticksPerUs = elapsedUs > 0.0 ? (double)(nowTicks - registry.AnchorTicks) / elapsedUs : 1.0;
+
+	fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	char line[128];
+	bool first = true;
+	std::vector<ProfileEvent> events;
+	for (auto& ring : registry.Rings)
+	{
+		fout << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << ring->ThreadId << ",\"args\":{\"name\":";
+		WriteJsonString(fout, ring->Name.c_str());
+		fout << "}}";
+		first = false;
+
+		// Copy the live part of the ring, then drop what the owner may have overwritten
+		// meanwhile: it can be writing slot head, one lap behind the copy.
+		const std::uint64_t head = ring->Head.load(std::memory_order_acquire);
+		const std::uint64_t oldest = std::max(head > EventsPerThread ? head - EventsPerThread : 0,
+			ring->ClearedTo.load(std::memory_order_relaxed));
+
+		events.clear();
+		for (std::uint64_t i = oldest; i < head; ++i)
+			events.push_back(ring->Events[i & (EventsPerThread - 1)]);
+
+		const std::uint64_t headAfter = ring->Head.load(std::memory_order_acquire);
+		const std::uint64_t firstIntact = headAfter >= EventsPerThread ? headAfter + 1 - EventsPerThread : 0;
+		const size_t skip = firstIntact > oldest ? (size_t)std::min<std::uint64_t>(firstIntact - oldest, events.size()) : 0;
+
+		for (size_t i = skip; i < events.size(); ++i)
+		{
+			const ProfileEvent& e = events[i];
+			if (e.Start < registry.AnchorTicks || e.End < e.Start)
+				continue;
+
+			double ts = (double)(e.Start - registry.AnchorTicks) / ticksPerUs;
+			double dur = (double)(e.End - e.Start) / ticksPerUs;
+
+			fout << ",\n{\"ph\":\"X\",\"name\":";
+			WriteJsonString(fout, e.Name);
+			snprintf(line, sizeof(line), ",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", ring->ThreadId, ts, dur);
+			fout << line;
+		}
+	}
+
+	fout << "\n]}\n";
+	return (bool)fout;
+}
@@ -0,0 +1,107 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Scoped CPU timing zones, exported as Chrome trace event JSON.
+//
+// PROFILE_ZONE("Name") at the top of a block records when the block was entered and
+// left.  While the profiler is disabled a zone costs one relaxed atomic load and a
+// branch, so zones can stay in shipping code and be switched on in a running game.
+//
+// Timestamps are read from the CPU time stamp counter (rdtsc), which takes a few
+// cycles and is constant-rate on every CPU the renderer supports; they are converted
+// to microseconds only when a trace is written, against std::chrono::steady_clock.
+// Every thread records into its own fixed ring of events: a zone is written to the
+// next slot and published with a single release store, with no lock and no
+// allocation, and once the ring is full the oldest zones are overwritten.  A trace
+// therefore holds the last EventsPerThread zones of each thread, which is what is
+// needed to see what led up to a spike.
+//
+// WriteChromeTrace may run while other threads record.  The traces open in
+// chrome://tracing and in ui.perfetto.dev.
+//
+// Zone names are not copied and must outlive the profiler: use string literals.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_RDTSC 1
+#else
+#include <chrono>
+#endif
+
+class Profiler
+{
+public:
+	// Zones kept per thread; a power of two.
+	static const size_t EventsPerThread = 1 << 16;
+
+	// Enabling for the first time also starts the clock calibration.
+	static void SetEnabled(bool enabled);
+
+	static bool IsEnabled()
+	{
+		return mEnabled.load(std::memory_order_relaxed);
+	}
+
+	// Current time in profiler ticks.
+	static std::uint64_t Now()
+	{
+#if PROFILER_RDTSC
+		return __rdtsc();
+#else
+		return (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	// Adds a finished zone to the calling thread's ring.
+	static void Record(const char* name, std::uint64_t start, std::uint64_t end);
+
+	// Name of the calling thread in traces; the default is "Thread n".
+	static void SetThreadName(const char* name);
+
+	// Forgets every zone recorded so far.
+	static void Clear();
+
+	// Writes the zones in all rings, threads that have exited included.
+	static bool WriteChromeTrace(const std::string& path);
+
+private:
+	static std::atomic<bool> mEnabled;
+};
+
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+		: mName(name)
+		, mStart(Profiler::IsEnabled() ? Profiler::Now() : 0)
+	{
+	}
+
+	~ProfileZone()
+	{
+		if (mStart != 0)
+			Profiler::Record(mName, mStart, Profiler::Now());
+	}
+
+	ProfileZone(const ProfileZone& rhs) = delete;
+	ProfileZone& operator=(const ProfileZone& rhs) = delete;
+
+private:
+	const char* mName;
+	std::uint64_t mStart;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
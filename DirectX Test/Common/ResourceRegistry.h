@@ -0,0 +1,113 @@
+//***************************************************************************************
+// ResourceRegistry.h
+//
+// Dense handle tables for resources that are named while loading and indexed while
+// running.
+//
+// A resource is registered under a 64-bit FNV-1a hash of its name, the same hash
+// AssetPack::HashName uses.  ResourceName computes it with constexpr, so a name written
+// as a literal is hashed by the compiler.  Resolving a name gives a handle, which is an
+// index into a vector; code that resolves its handles once while loading never touches
+// a hash table afterwards.
+//
+// Unlike std::unordered_map::operator[], a lookup of a name that was never registered
+// does not insert anything: Find returns an invalid handle and Resolve throws
+// std::out_of_range with the name in the message.  Registering a name twice, or two
+// names with the same hash, throws as well.
+//***************************************************************************************
+
+#pragma once
+
+#include "Hash.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Id of a name.  AssetPack::HashName gives a name the same hash, which AssetPackTests
+// checks.
+constexpr std::uint64_t ResourceId(const char* name)
+{
+	return Fnv1aString(name);
+}
+
+// A name and its hash.  Converts implicitly from a string literal, hashing it at
+// compile time when the ResourceName is constexpr or the compiler folds it.  The name
+// is only kept for error messages and must outlive the ResourceName.
+struct ResourceName
+{
+	constexpr ResourceName(const char* name)
+		: Name(name)
+		, Id(ResourceId(name))
+	{
+	}
+
+	const char* Name;
+	std::uint64_t Id;
+};
+
+template <typename T>
+struct ResourceHandle
+{
+	static const std::uint32_t InvalidIndex = 0xffffffff;
+
+	std::uint32_t Index = InvalidIndex;
+
+	bool IsValid()const { return Index != InvalidIndex; }
+};
+
+template <typename T>
+class ResourceRegistry
+{
+public:
+
+	typedef ResourceHandle<T> Handle;
+
+	Handle Add(ResourceName name, T resource)
+	{
+		Handle handle;
+		handle.Index = (std::uint32_t)mResources.size();
+		if (!mIndices.emplace(name.Id, handle.Index).second)
+			throw std::invalid_argument(std::string("ResourceRegistry: ") + name.Name + " is registered twice or its hash collides");
+
+		mResources.push_back(std::move(resource));
+		return handle;
+	}
+
+	// Invalid if no resource has the name.
+	Handle Find(ResourceName name)const
+	{
+		Handle handle;
+		auto it = mIndices.find(name.Id);
+		if (it != mIndices.end())
+			handle.Index = it->second;
+		return handle;
+	}
+
+	Handle Resolve(ResourceName name)const
+	{
+		Handle handle = Find(name);
+		if (!handle.IsValid())
+			throw std::out_of_range(std::string("ResourceRegistry: no resource named ") + name.Name);
+		return handle;
+	}
+
+	const T& Get(Handle handle)const { return mResources[handle.Index]; }
+	T& Get(Handle handle) { return mResources[handle.Index]; }
+
+	std::uint32_t GetCount()const { return (std::uint32_t)mResources.size(); }
+
+	void Clear()
+	{
+		mResources.clear();
+		mIndices.clear();
+	}
+
+private:
+
+	std::vector<T> mResources;
+
+	// Name hash -> index into mResources; only read by Find and Resolve.
+	std::unordered_map<std::uint64_t, std::uint32_t> mIndices;
+};
@@ -0,0 +1,237 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include "Hash.h"
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	bool ReadText(const std::wstring& filename, std::string& text)
+	{
+		std::ifstream fin(filename, std::ios::binary);
+		if (!fin)
+			return false;
+
+		text.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	bool FileExists(const std::wstring& filename)
+	{
+		DWORD attributes = GetFileAttributesW(filename.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+	}
+
+	// Directory part of a path including the trailing separator, or "" for a bare name.
+	std::wstring GetDirectory(const std::wstring& path)
+	{
+		size_t slash = path.find_last_of(L"\\/");
+		return slash == std::wstring::npos ? std::wstring() : path.substr(0, slash + 1);
+	}
+
+	std::wstring Widen(const std::string& s)
+	{
+		return std::wstring(s.begin(), s.end());
+	}
+
+	// Names in the #include "name" and #include <name> lines of text.  Includes inside
+	// inactive #if blocks are found too, which can only make the key stricter.
+	void FindIncludes(const std::string& text, std::vector<std::string>& includes)
+	{
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			size_t i = line.find_first_not_of(" \t");
+			if (i == std::string::npos || line[i] != '#')
+				continue;
+
+			i = line.find_first_not_of(" \t", i + 1);
+			if (i == std::string::npos || line.compare(i, 7, "include") != 0)
+				continue;
+
+			i = line.find_first_not_of(" \t", i + 7);
+			if (i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+				continue;
+
+			char close = line[i] == '"' ? '"' : '>';
+			size_t end = line.find(close, i + 1);
+			if (end != std::string::npos)
+				includes.push_back(line.substr(i + 1, end - i - 1));
+		}
+	}
+
+	bool IsBytecode(ID3DBlob* blob)
+	{
+		return blob != nullptr && blob->GetBufferSize() >= 4 &&
+			std::memcmp(blob->GetBufferPointer(), "DXBC", 4) == 0;
+	}
+}
+
+ShaderCache::ShaderCache(const std::wstring& directory)
+	: mDirectory(directory)
+{
+}
+
+ComPtr<ID3DBlob> ShaderCache::Get(
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target)
+{
+	std::uint64_t key = Key(filename, defines, entrypoint, target);
+	std::wstring path = GetPath(key);
+
+	if (FileExists(path))
+	{
+		ComPtr<ID3DBlob> byteCode = d3dUtil::LoadBinary(path);
+		if (IsBytecode(byteCode.Get()))
+		{
+			++mHitCount;
+			return byteCode;
+		}
+	}
+
+	ComPtr<ID3DBlob> byteCode = d3dUtil::CompileShader(filename, defines, entrypoint, target);
+	++mCompileCount;
+
+	Store(key, byteCode.Get());
+	return byteCode;
+}
+
+UINT ShaderCache::BuildFromManifest(const std::wstring& manifest)
+{
+	std::ifstream fin(manifest);
+	if (!fin)
+		throw std::runtime_error("ShaderCache::BuildFromManifest: cannot read the manifest");
+
+	const UINT compiledBefore = mCompileCount.load();
+
+	std::string line;
+	while (std::getline(fin, line))
+	{
+		std::istringstream tokens(line);
+		std::string filename, entrypoint, target;
+		if (!(tokens >> filename) || filename[0] == '#')
+			continue;
+		if (!(tokens >> entrypoint >> target))
+			throw std::runtime_error("ShaderCache::BuildFromManifest: expected <file> <entry point> <target> in \"" + line + "\"");
+
+		// NAME=VALUE pairs, or a bare NAME defined as "1".
+		std::vector<std::string> names;
+		std::vector<std::string> values;
+		std::string define;
+		while (tokens >> define)
+		{
+			size_t equals = define.find('=');
+			names.push_back(define.substr(0, equals));
+			values.push_back(equals == std::string::npos ? "1" : define.substr(equals + 1));
+		}
+
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (size_t i = 0; i < names.size(); ++i)
+			macros.push_back({ names[i].c_str(), values[i].c_str() });
+		macros.push_back({ nullptr, nullptr });
+
+		Get(Widen(filename), macros.data(), entrypoint, target);
+	}
+
+	return mCompileCount - compiledBefore;
+}
+
+bool ShaderCache::Store(std::uint64_t key, ID3DBlob* byteCode)const
+{
+	if (byteCode == nullptr)
+		return false;
+
+	CreateDirectoryW(mDirectory.c_str(), nullptr);
+
+	// Written under a temporary name and renamed, so an interrupted write never leaves
+	// a truncated entry behind.  The name is per thread, as two threads can compile the
+	// same shader.
+	std::wstring path = GetPath(key);
+	std::wstring tempPath = path + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+
+		fout.write((const char*)byteCode->GetBufferPointer(), (std::streamsize)byteCode->GetBufferSize());
+		if (!fout)
+			return false;
+	}
+
+	if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+std::uint64_t ShaderCache::Key(
+	const std::wstring& filename,
+	const D3D_SHADER_MACRO* defines,
+	const std::string& entrypoint,
+	const std::string& target)
+{
+	const std::uint32_t header[] = { Version, d3dUtil::GetShaderCompileFlags() };
+	std::uint64_t hash = Fnv1a(header, sizeof(header));
+
+	// The source and its include closure, each file once, in the order they are found.
+	// An include is looked up next to the file that includes it and then in the working
+	// directory, as D3D_COMPILE_STANDARD_FILE_INCLUDE does; one that cannot be found
+	// only contributes its name, and the compiler will report it.
+	std::vector<std::wstring> pending(1, filename);
+	std::unordered_set<std::wstring> visited;
+	std::string text;
+	std::vector<std::string> includes;
+	while (!pending.empty())
+	{
+		std::wstring path = pending.back();
+		pending.pop_back();
+		if (!visited.insert(path).second)
+			continue;
+
+		hash = Fnv1a(path.data(), path.size() * sizeof(wchar_t), hash);
+		if (!ReadText(path, text))
+			continue;
+
+		hash = Fnv1a(text.data(), text.size(), hash);
+
+		includes.clear();
+		FindIncludes(text, includes);
+		for (auto it = includes.rbegin(); it != includes.rend(); ++it)
+		{
+			std::wstring local = GetDirectory(path) + Widen(*it);
+			pending.push_back(FileExists(local) ? local : Widen(*it));
+		}
+	}
+
+	// Defines as NAME\0VALUE\0 pairs; the terminator keeps "A"+"BC" apart from "AB"+"C".
+	for (const D3D_SHADER_MACRO* macro = defines; macro != nullptr && macro->Name != nullptr; ++macro)
+	{
+		const char* value = macro->Definition != nullptr ? macro->Definition : "";
+		hash = Fnv1a(macro->Name, std::strlen(macro->Name) + 1, hash);
+		hash = Fnv1a(value, std::strlen(value) + 1, hash);
+	}
+
+	hash = Fnv1a(entrypoint.c_str(), entrypoint.size() + 1, hash);
+	hash = Fnv1a(target.c_str(), target.size() + 1, hash);
+	return hash;
+}
+
+std::wstring ShaderCache::GetPath(std::uint64_t key)const
+{
+	wchar_t name[32];
+	swprintf_s(name, L"%016llx.cso", (unsigned long long)key);
+	return mDirectory + L"/" + name;
+}
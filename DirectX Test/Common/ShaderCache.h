@@ -0,0 +1,75 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// On-disk cache of compiled shader bytecode, so that a warm start loads .cso files
+// instead of running the HLSL compiler.
+//
+// An entry is keyed by a hash of everything that decides the bytecode: the source
+// file, every file it includes (followed recursively), the macro defines, the entry
+// point, the target profile and the compile flags.  Editing a shader or any header it
+// pulls in therefore gives a new key, and the stale entry is simply never read again.
+// Finding the includes only means reading the sources, which is cheap next to
+// compiling them.
+//
+// Entries are plain bytecode, one file per key named <key as 16 hex digits>.cso, read
+// back with d3dUtil::LoadBinary.
+//
+// The cache can also be filled offline from a manifest, one shader per line:
+//   <file> <entry point> <target> [NAME=VALUE ...]
+// Blank lines and lines starting with '#' are ignored; paths are relative to the
+// working directory, as in d3dUtil::CompileShader.
+//
+// Get may be called from several threads at once.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <atomic>
+
+class ShaderCache
+{
+public:
+
+	// Changes with the key layout, so that entries written under another one are rebuilt.
+	static const std::uint32_t Version = 1;
+
+	explicit ShaderCache(const std::wstring& directory);
+
+	// Bytecode from the cache, or compiled with d3dUtil::CompileShader and stored.
+	// Compile errors throw, as they do from CompileShader.
+	Microsoft::WRL::ComPtr<ID3DBlob> Get(
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target);
+
+	// Compiles every shader in the manifest that is not cached yet and returns how many
+	// were compiled.  Throws if the manifest cannot be read.
+	UINT BuildFromManifest(const std::wstring& manifest);
+
+	// Returns false if the entry could not be written; the cache is optional, so callers
+	// may ignore it.
+	bool Store(std::uint64_t key, ID3DBlob* byteCode)const;
+
+	static std::uint64_t Key(
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target);
+
+	// Lookups answered from disk and shaders compiled since the cache was created.
+	UINT GetHitCount()const { return mHitCount.load(); }
+	UINT GetCompileCount()const { return mCompileCount.load(); }
+
+private:
+
+	std::wstring GetPath(std::uint64_t key)const;
+
+private:
+
+	std::wstring mDirectory;
+
+	std::atomic<UINT> mHitCount{ 0 };
+	std::atomic<UINT> mCompileCount{ 0 };
+};
@@ -0,0 +1,352 @@
+//***************************************************************************************
+// TextureAtlas.cpp
+//***************************************************************************************
+
+#include "TextureAtlas.h"
+
+using Microsoft::WRL::ComPtr;
+using namespace DirectX;
+
+TextureAtlas::TextureAtlas(UINT padding, UINT mipLevels, UINT blockSize, UINT maxSize)
+	: mPadding(padding)
+	, mMipLevels(mipLevels > 0 ? mipLevels : 1)
+	, mBlockSize(blockSize > 0 ? blockSize : 1)
+	, mMaxSize(maxSize)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+void TextureAtlas::Add(const std::string& name, UINT width, UINT height)
+{
+	assert(mRegionLookup.find(name) == mRegionLookup.end());
+
+	Region r;
+	r.Name = name;
+	r.Width = width;
+	r.Height = height;
+
+	mRegionLookup[name] = mRegions.size();
+	mRegions.push_back(r);
+}
+
+UINT TextureAtlas::Align(UINT x)const
+{
+	// Every mip of every region has to start on a block boundary, so align to the
+	// block size as seen from the smallest mip we keep.
+	UINT alignment = mBlockSize << (mMipLevels - 1);
+	return (x + alignment - 1) / alignment * alignment;
+}
+
+bool TextureAtlas::Pack()
+{
+	if (mRegions.empty())
+		return false;
+
+	UINT gutter = Align(mPadding << (mMipLevels - 1));
+
+	// Start from the smallest power of two that can hold the largest region and the
+	// total padded area, then grow one side at a time.
+	UINT64 area = 0;
+	UINT largest = 0;
+	for (const Region& r : mRegions)
+	{
+		UINT w = Align(r.Width) + 2 * gutter;
+		UINT h = Align(r.Height) + 2 * gutter;
+		area += (UINT64)w * h;
+		largest = MathHelper::Max(largest, MathHelper::Max(w, h));
+	}
+
+	UINT width = 1;
+	while (width < largest)
+		width <<= 1;
+	UINT height = width;
+	while ((UINT64)width * height < area)
+	{
+		if (width <= height)
+			width <<= 1;
+		else
+			height <<= 1;
+	}
+
+	while (width <= mMaxSize && height <= mMaxSize)
+	{
+		if (PackInto(width, height))
+		{
+			mWidth = width;
+			mHeight = height;
+			UpdateUVRects();
+			return true;
+		}
+
+		if (width <= height)
+			width <<= 1;
+		else
+			height <<= 1;
+	}
+
+	return false;
+}
+
+bool TextureAtlas::PackInto(UINT width, UINT height)
+{
+	UINT gutter = Align(mPadding << (mMipLevels - 1));
+
+	// Tallest first gives the skyline heuristic its best results.
+	std::vector<size_t> order(mRegions.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+	{
+		if (mRegions[a].Height != mRegions[b].Height)
+			return mRegions[a].Height > mRegions[b].Height;
+		return mRegions[a].Width > mRegions[b].Width;
+	});
+
+	std::vector<SkylineNode> skyline;
+	skyline.push_back({ 0, 0, width });
+
+	for (size_t index : order)
+	{
+		Region& region = mRegions[index];
+		UINT w = Align(region.Width) + 2 * gutter;
+		UINT h = Align(region.Height) + 2 * gutter;
+
+		// Find the skyline node that gives the lowest top edge (bottom-left rule).
+		size_t bestNode = skyline.size();
+		UINT bestTop = UINT_MAX;
+		UINT bestWidth = UINT_MAX;
+		UINT bestY = 0;
+
+		for (size_t i = 0; i < skyline.size(); ++i)
+		{
+			UINT x = skyline[i].X;
+			if (x + w > width)
+				break;
+
+			UINT y = 0;
+			UINT widthLeft = w;
+			size_t j = i;
+			bool fits = true;
+			while (widthLeft > 0)
+			{
+				y = MathHelper::Max(y, skyline[j].Y);
+				if (y + h > height)
+				{
+					fits = false;
+					break;
+				}
+
+				widthLeft = skyline[j].Width >= widthLeft ? 0 : widthLeft - skyline[j].Width;
+				++j;
+			}
+
+			if (!fits)
+				continue;
+
+			if (y + h < bestTop || (y + h == bestTop && skyline[i].Width < bestWidth))
+			{
+				bestNode = i;
+				bestTop = y + h;
+				bestWidth = skyline[i].Width;
+				bestY = y;
+			}
+		}
+
+		if (bestNode == skyline.size())
+			return false;
+
+		UINT x = skyline[bestNode].X;
+		region.X = x + gutter;
+		region.Y = bestY + gutter;
+
+		// Raise the skyline over the new rectangle and trim the nodes it covers.
+		skyline.insert(skyline.begin() + bestNode, { x, bestY + h, w });
+		for (size_t i = bestNode + 1; i < skyline.size(); )
+		{
+			const SkylineNode& prev = skyline[i - 1];
+			if (skyline[i].X >= prev.X + prev.Width)
+				break;
+
+			UINT shrink = prev.X + prev.Width - skyline[i].X;
+			if (skyline[i].Width <= shrink)
+			{
+				skyline.erase(skyline.begin() + i);
+				continue;
+			}
+
+			skyline[i].X += shrink;
+			skyline[i].Width -= shrink;
+			break;
+		}
+
+		// Merge neighbours at the same height.
+		for (size_t i = 0; i + 1 < skyline.size(); )
+		{
+			if (skyline[i].Y == skyline[i + 1].Y)
+			{
+				skyline[i].Width += skyline[i + 1].Width;
+				skyline.erase(skyline.begin() + i + 1);
+			}
+			else
+				++i;
+		}
+	}
+
+	return true;
+}
+
+void TextureAtlas::UpdateUVRects()
+{
+	float invW = 1.0f / mWidth;
+	float invH = 1.0f / mHeight;
+
+	// Half a texel of the smallest mip, in mip 0 texels.  A bilinear sample reads the
+	// texels within half a texel of its coordinate, so this keeps every kept mip away
+	// from the gutter.
+	float inset = 0.5f * (float)(1u << (mMipLevels - 1));
+
+	for (Region& r : mRegions)
+	{
+		float insetX = MathHelper::Min(inset, 0.5f * r.Width);
+		float insetY = MathHelper::Min(inset, 0.5f * r.Height);
+
+		r.UVRect = XMFLOAT4(
+			(r.X + insetX) * invW,
+			(r.Y + insetY) * invH,
+			(r.X + r.Width - insetX) * invW,
+			(r.Y + r.Height - insetY) * invH);
+	}
+}
+
+void TextureAtlas::WriteLayout(std::ostream& out)const
+{
+	out << "atlas " << mWidth << " " << mHeight << " " << mMipLevels << "\n";
+	for (const Region& r : mRegions)
+		out << r.Name << " " << r.X << " " << r.Y << " " << r.Width << " " << r.Height << "\n";
+}
+
+bool TextureAtlas::ReadLayout(std::istream& in)
+{
+	std::string tag;
+	if (!(in >> tag >> mWidth >> mHeight >> mMipLevels) || tag != "atlas")
+		return false;
+
+	mRegions.clear();
+	mRegionLookup.clear();
+
+	Region r;
+	while (in >> r.Name >> r.X >> r.Y >> r.Width >> r.Height)
+	{
+		mRegionLookup[r.Name] = mRegions.size();
+		mRegions.push_back(r);
+	}
+
+	UpdateUVRects();
+	return !mRegions.empty();
+}
+
+UINT TextureAtlas::GetWidth()const
+{
+	return mWidth;
+}
+
+UINT TextureAtlas::GetHeight()const
+{
+	return mHeight;
+}
+
+UINT TextureAtlas::GetMipLevels()const
+{
+	return mMipLevels;
+}
+
+bool TextureAtlas::HasRegion(const std::string& name)const
+{
+	return mRegionLookup.find(name) != mRegionLookup.end();
+}
+
+const TextureAtlas::Region& TextureAtlas::GetRegion(const std::string& name)const
+{
+	return mRegions[mRegionLookup.at(name)];
+}
+
+const std::vector<TextureAtlas::Region>& TextureAtlas::GetRegions()const
+{
+	return mRegions;
+}
+
+XMFLOAT4X4 TextureAtlas::GetMatTransform(const std::string& name)const
+{
+	const XMFLOAT4& uv = GetRegion(name).UVRect;
+
+	XMFLOAT4X4 M;
+	XMStoreFloat4x4(&M,
+		XMMatrixScaling(uv.z - uv.x, uv.w - uv.y, 1.0f) *
+		XMMatrixTranslation(uv.x, uv.y, 0.0f));
+	return M;
+}
+
+void TextureAtlas::BuildResource(
+	ID3D12Device* device,
+	ID3D12GraphicsCommandList* cmdList,
+	const std::unordered_map<std::string, std::unique_ptr<Texture>>& sources,
+	ComPtr<ID3D12Resource>& atlas)
+{
+	assert(!mRegions.empty() && mWidth > 0 && mHeight > 0);
+
+	D3D12_RESOURCE_DESC firstDesc = sources.at(mRegions[0].Name)->Resource->GetDesc();
+
+	// Never copy mips the sources do not have.
+	UINT mipLevels = mMipLevels;
+	for (const Region& r : mRegions)
+		mipLevels = MathHelper::Min<UINT>(mipLevels, sources.at(r.Name)->Resource->GetDesc().MipLevels);
+
+	D3D12_RESOURCE_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Alignment = 0;
+	texDesc.Width = mWidth;
+	texDesc.Height = mHeight;
+	texDesc.DepthOrArraySize = 1;
+	texDesc.MipLevels = (UINT16)mipLevels;
+	texDesc.Format = firstDesc.Format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	// Committed resources are zero initialised, so the gutters come out transparent black;
+	// the inset UV rectangles never sample them.
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(atlas.ReleaseAndGetAddressOf())));
+
+	for (const Region& r : mRegions)
+	{
+		ID3D12Resource* src = sources.at(r.Name)->Resource.Get();
+		assert(src->GetDesc().Format == texDesc.Format);
+
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(src,
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+		for (UINT mip = 0; mip < mipLevels; ++mip)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION dst(atlas.Get(), mip);
+			CD3DX12_TEXTURE_COPY_LOCATION srcLoc(src, mip);
+			cmdList->CopyTextureRegion(&dst, r.X >> mip, r.Y >> mip, 0, &srcLoc, nullptr);
+		}
+
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(src,
+			D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(atlas.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+}
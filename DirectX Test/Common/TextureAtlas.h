@@ -0,0 +1,117 @@
+//***************************************************************************************
+// TextureAtlas.h
+//
+// Packs many sprite textures into a single atlas texture so that every sprite material
+// can share one SRV.  Each packed region is exposed as a UV rectangle plus a ready made
+// texture transform that plugs straight into Material::MatTransform.
+//
+// Packing uses the skyline bottom-left heuristic.  It only needs the region sizes, so
+// the same code runs offline (WriteLayout/ReadLayout) and at load time (Pack).
+//
+// Padding and mip-bleed policy:
+//   -Every region is surrounded by a gutter of Padding texels *at the smallest mip*,
+//    i.e. Padding << (MipLevels-1) texels at mip 0.
+//   -Region positions and padded sizes are rounded up to BlockSize << (MipLevels-1)
+//    so that every mip of every region starts on a block boundary (required to copy
+//    block compressed data) and regions never share a texel at any mip.
+//   -The atlas mip chain is truncated to MipLevels, so the coarse mips where whole
+//    sprites would collapse into each other are never generated.
+//   -The gutters stay transparent black: block compressed texels cannot be copied one
+//    by one, so edge texels are not replicated into them.  Instead UVRect is inset by
+//    half a texel of the smallest mip, so bilinear filtering at any kept mip reads
+//    only the region's own texels and never reaches a gutter.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class TextureAtlas
+{
+public:
+
+	struct Region
+	{
+		std::string Name;
+
+		// Size of the source image at mip 0, in texels.
+		UINT Width = 0;
+		UINT Height = 0;
+
+		// Top-left corner of the image inside the atlas at mip 0, in texels.
+		UINT X = 0;
+		UINT Y = 0;
+
+		// (u0, v0, u1, v1) of the image inside the atlas, inset by half a texel of the
+		// smallest mip.
+		DirectX::XMFLOAT4 UVRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+	};
+
+	TextureAtlas(UINT padding = 1, UINT mipLevels = 4, UINT blockSize = 4, UINT maxSize = 8192);
+	TextureAtlas(const TextureAtlas& rhs) = delete;
+	TextureAtlas& operator=(const TextureAtlas& rhs) = delete;
+	~TextureAtlas();
+
+	// Adds an image to be packed.  Call Pack() once all images have been added.
+	void Add(const std::string& name, UINT width, UINT height);
+
+	// Packs all added images, growing the atlas in powers of two until they fit.
+	// Returns false if they do not fit into maxSize x maxSize.
+	bool Pack();
+
+	// Offline layout.  The text format is one "name x y w h" line per region after a
+	// "atlas width height mips" header, so it can be produced by a build step and
+	// reloaded at runtime without repacking.
+	void WriteLayout(std::ostream& out)const;
+	bool ReadLayout(std::istream& in);
+
+	UINT GetWidth()const;
+	UINT GetHeight()const;
+	UINT GetMipLevels()const;
+
+	bool HasRegion(const std::string& name)const;
+	const Region& GetRegion(const std::string& name)const;
+	const std::vector<Region>& GetRegions()const;
+
+	// Scale/offset texture transform mapping [0,1]^2 onto the region.  Matches the
+	// row-vector convention used by gMatTransform in Default.hlsl.
+	DirectX::XMFLOAT4X4 GetMatTransform(const std::string& name)const;
+
+	// Creates the atlas texture and records copies of the first GetMipLevels() mips of
+	// every source texture into it.  All sources must share the same format and be in
+	// the PIXEL_SHADER_RESOURCE state (as left by CreateDDSTextureFromFile12), and must
+	// stay alive until the command list has executed.
+	void BuildResource(
+		ID3D12Device* device,
+		ID3D12GraphicsCommandList* cmdList,
+		const std::unordered_map<std::string, std::unique_ptr<Texture>>& sources,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& atlas);
+
+private:
+
+	// Skyline packing of the current regions into a width x height rectangle.
+	bool PackInto(UINT width, UINT height);
+	void UpdateUVRects();
+
+	UINT Align(UINT x)const;
+
+private:
+
+	struct SkylineNode
+	{
+		UINT X;
+		UINT Y;
+		UINT Width;
+	};
+
+	UINT mPadding;
+	UINT mMipLevels;
+	UINT mBlockSize;
+	UINT mMaxSize;
+
+	UINT mWidth = 0;
+	UINT mHeight = 0;
+
+	std::vector<Region> mRegions;
+	std::unordered_map<std::string, size_t> mRegionLookup;
+};
@@ -0,0 +1,305 @@
+//***************************************************************************************
+// TextureStreamer.cpp
+//***************************************************************************************
+
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+TextureStreamer::TextureStreamer(std::uint64_t budgetBytes, std::uint32_t tailSize, std::uint32_t maxLoadsPerUpdate)
+	: mBudget(budgetBytes)
+	, mTailSize(tailSize > 0 ? tailSize : 1)
+	, mMaxLoadsPerUpdate(maxLoadsPerUpdate > 0 ? maxLoadsPerUpdate : 1)
+{
+	mStats.BudgetBytes = budgetBytes;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+void TextureStreamer::SetBackend(Backend* backend)
+{
+	mBackend = backend;
+}
+
+std::uint32_t TextureStreamer::AddTexture(const std::string& name, const std::uint8_t* ddsData, size_t ddsSize)
+{
+	DirectX::DDS_TEXTURE_INFO info;
+	if (!DirectX::GetDDSTextureInfoFromMemory(ddsData, ddsSize, info))
+		throw std::runtime_error("TextureStreamer: " + name + " is not a plain 2D DDS texture");
+
+	StreamedTexture t;
+	t.Name = name;
+	t.DdsData = ddsData;
+	t.DdsSize = ddsSize;
+	t.Width = info.width;
+	t.Height = info.height;
+	t.MipCount = info.mipCount;
+	t.MipBytes.assign(info.mipBytes, info.mipBytes + info.mipCount);
+
+	t.TailMip = t.MipCount - 1;
+	for (std::uint32_t mip = 0; mip < t.MipCount; ++mip)
+	{
+		if (std::max(t.Width >> mip, t.Height >> mip) <= mTailSize)
+		{
+			t.TailMip = mip;
+			break;
+		}
+	}
+
+	Residency r;
+	r.ResidentMip = t.MipCount;
+	r.WantedMip = t.TailMip;
+
+	mTextures.push_back(t);
+	mResidency.push_back(r);
+
+	return (std::uint32_t)mTextures.size() - 1;
+}
+
+void TextureStreamer::Request(std::uint32_t id, float screenSize)
+{
+	Residency& r = mResidency[id];
+	r.RequestedSize = r.Requested ? std::max(r.RequestedSize, screenSize) : screenSize;
+	r.Requested = true;
+}
+
+void TextureStreamer::Update()
+{
+	if (mBackend == nullptr)
+		return;
+
+	++mFrame;
+
+	std::vector<std::uint32_t> loads;
+	for (std::uint32_t id = 0; id < (std::uint32_t)mTextures.size(); ++id)
+	{
+		const StreamedTexture& t = mTextures[id];
+		Residency& r = mResidency[id];
+
+		if (r.Requested)
+		{
+			r.WantedMip = MipForScreenSize(t.Width, t.Height, t.TailMip, r.RequestedSize);
+			r.LastRequestFrame = mFrame;
+		}
+		else
+		{
+			r.WantedMip = t.TailMip;
+		}
+
+		// Tails are small and a visible texture must never be drawn without one, so
+		// they are loaded right away and do not count against the per-update limit.
+		if (r.Requested && r.ResidentMip > t.TailMip)
+		{
+			MakeRoom(BytesFrom(id, t.TailMip) - BytesFrom(id, r.ResidentMip), id);
+			SetResidentMip(id, t.TailMip);
+		}
+
+		if (r.WantedMip < r.ResidentMip)
+			loads.push_back(id);
+	}
+
+	// Finer mips of textures on screen, biggest shortfall first.  These only ever
+	// replace memory, never exceed the budget.
+	std::sort(loads.begin(), loads.end(), [&](std::uint32_t a, std::uint32_t b)
+	{
+		const Residency& ra = mResidency[a];
+		const Residency& rb = mResidency[b];
+		if (ra.Requested != rb.Requested)
+			return ra.Requested;
+		return ra.ResidentMip - ra.WantedMip > rb.ResidentMip - rb.WantedMip;
+	});
+
+	std::uint32_t loadCount = 0;
+	bool starved = false;
+	for (std::uint32_t id : loads)
+	{
+		Residency& r = mResidency[id];
+		std::uint64_t current = BytesFrom(id, r.ResidentMip);
+		std::uint32_t target = r.WantedMip;
+
+		if (r.Requested)
+		{
+			if (loadCount == mMaxLoadsPerUpdate)
+				continue;
+
+			MakeRoom(BytesFrom(id, target) - current, id);
+
+			// Settle for the finest mip that fits.
+			while (target < r.ResidentMip && mStats.ResidentBytes - current + BytesFrom(id, target) > mBudget)
+				++target;
+
+			if (target < r.ResidentMip && SetResidentMip(id, target))
+				++loadCount;
+
+			starved |= r.ResidentMip > r.WantedMip;
+		}
+		else if (!starved && mStats.ResidentBytes - current + BytesFrom(id, target) <= mBudget)
+		{
+			// Off-screen textures preload their tail into spare budget, but not while a
+			// visible texture is short of mips, or the two would evict each other every
+			// frame.  This is also all that the first update after startup loads.
+			SetResidentMip(id, target);
+		}
+	}
+
+	// Only needed if the tails of visible textures pushed us over.
+	MakeRoom(0, UINT_MAX);
+
+	for (Residency& r : mResidency)
+	{
+		r.Requested = false;
+		r.RequestedSize = 0.0f;
+	}
+}
+
+bool TextureStreamer::MakeRoom(std::uint64_t bytes, std::uint32_t keep)
+{
+	while (mStats.ResidentBytes + bytes > mBudget)
+	{
+		// Surplus mips above what a texture wants go first, least recently used first.
+		// Only then are whole tails of textures that are off screen released.
+		std::uint32_t victim = UINT_MAX;
+		std::uint32_t victimTarget = 0;
+		bool victimIsTail = true;
+		std::uint64_t victimFrame = 0;
+
+		for (std::uint32_t id = 0; id < (std::uint32_t)mTextures.size(); ++id)
+		{
+			if (id == keep)
+				continue;
+
+			const Residency& r = mResidency[id];
+			std::uint32_t target;
+			bool isTail;
+			if (r.ResidentMip < r.WantedMip)
+			{
+				target = r.WantedMip;
+				isTail = false;
+			}
+			else if (!r.Requested && r.ResidentMip < mTextures[id].MipCount)
+			{
+				target = mTextures[id].MipCount;
+				isTail = true;
+			}
+			else
+			{
+				continue;
+			}
+
+			if (victim == UINT_MAX || (victimIsTail && !isTail) ||
+				(victimIsTail == isTail && r.LastRequestFrame < victimFrame))
+			{
+				victim = id;
+				victimTarget = target;
+				victimIsTail = isTail;
+				victimFrame = r.LastRequestFrame;
+			}
+		}
+
+		if (victim == UINT_MAX || !SetResidentMip(victim, victimTarget))
+			return false;
+	}
+
+	return true;
+}
+
+bool TextureStreamer::SetResidentMip(std::uint32_t id, std::uint32_t firstMip)
+{
+	Residency& r = mResidency[id];
+
+	if (!mBackend->SetResidentMip(id, mTextures[id], firstMip))
+	{
+		++mStats.FailedUpdates;
+		return false;
+	}
+
+	if (firstMip < r.ResidentMip)
+		mStats.MipLoads += r.ResidentMip - firstMip;
+	else
+		mStats.MipEvictions += firstMip - r.ResidentMip;
+
+	mStats.ResidentBytes -= BytesFrom(id, r.ResidentMip);
+	mStats.ResidentBytes += BytesFrom(id, firstMip);
+	r.ResidentMip = firstMip;
+
+	return true;
+}
+
+std::uint64_t TextureStreamer::BytesFrom(std::uint32_t id, std::uint32_t firstMip)const
+{
+	const StreamedTexture& t = mTextures[id];
+
+	std::uint64_t bytes = 0;
+	for (std::uint32_t mip = firstMip; mip < t.MipCount; ++mip)
+		bytes += t.MipBytes[mip];
+	return bytes;
+}
+
+std::uint32_t TextureStreamer::GetTextureCount()const
+{
+	return (std::uint32_t)mTextures.size();
+}
+
+const TextureStreamer::StreamedTexture& TextureStreamer::GetTexture(std::uint32_t id)const
+{
+	return mTextures[id];
+}
+
+std::uint32_t TextureStreamer::GetResidentMip(std::uint32_t id)const
+{
+	return mResidency[id].ResidentMip;
+}
+
+std::uint32_t TextureStreamer::GetWantedMip(std::uint32_t id)const
+{
+	return mResidency[id].WantedMip;
+}
+
+const TextureStreamer::Stats& TextureStreamer::GetStats()const
+{
+	return mStats;
+}
+
+std::uint32_t TextureStreamer::MipForScreenSize(std::uint32_t width, std::uint32_t height, std::uint32_t tailMip, float screenSize)
+{
+	float texels = (float)std::max(width, height);
+	if (screenSize <= 0.0f)
+		return tailMip;
+	if (screenSize >= texels)
+		return 0;
+
+	// One mip per halving of the texel-to-pixel ratio.
+	std::uint32_t mip = (std::uint32_t)floorf(log2f(texels / screenSize));
+	return std::min(mip, tailMip);
+}
+
+//
+// NullTextureStreamBackend
+//
+
+bool NullTextureStreamBackend::SetResidentMip(std::uint32_t id, const TextureStreamer::StreamedTexture& texture, std::uint32_t firstMip)
+{
+	if (id >= mResidentMips.size())
+		mResidentMips.resize(id + 1, UINT_MAX);
+
+	// Mirror the D3D12 backend, which uploads the whole new mip range.
+	for (std::uint32_t mip = firstMip; mip < texture.MipCount; ++mip)
+		mUploadedBytes += texture.MipBytes[mip];
+
+	mResidentMips[id] = firstMip;
+	return true;
+}
+
+std::uint32_t NullTextureStreamBackend::GetResidentMip(std::uint32_t id)const
+{
+	return id < mResidentMips.size() ? mResidentMips[id] : UINT_MAX;
+}
+
+std::uint64_t NullTextureStreamBackend::GetUploadedBytes()const
+{
+	return mUploadedBytes;
+}
@@ -0,0 +1,150 @@
+//***************************************************************************************
+// TextureStreamer.h
+//
+// Mip-level texture streaming.  Only the small mip tail of each texture is loaded up
+// front; finer mips are brought in when a render item shows the texture large enough
+// on screen to need them, and are dropped again least-recently-used first when the
+// resident total would exceed a global byte budget.
+//
+// TextureStreamer only decides which mips should be resident.  A backend makes it so:
+//   -D3D12TextureStreamBackend (D3D12TextureStreamBackend.h) recreates the texture with
+//    the new mip range from the DDS data and hands out a fresh SRV slot, retiring the
+//    old resource and slot once the GPU has finished the frames that may still
+//    reference them.
+//   -NullTextureStreamBackend only records the residency, so the streaming policy can
+//    run on a machine without a GPU.
+//
+// Neither the streamer nor the backend interface needs Direct3D; like DDSInfo.h they
+// build with only dxgiformat.h.
+//
+// A texture is either not resident at all or holds a contiguous range of mips
+// [ResidentMip, MipCount).  Textures not requested in a frame keep their mips until
+// the budget needs the memory, then drop to the tail and finally to nothing, so the
+// resident total is bounded by the budget plus the tails of the textures on screen.
+//***************************************************************************************
+
+#pragma once
+
+#include "DDSInfo.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TextureStreamer
+{
+public:
+
+	struct StreamedTexture
+	{
+		std::string Name;
+
+		// DDS file contents.  Owned by the caller and must outlive the streamer.
+		const std::uint8_t* DdsData = nullptr;
+		size_t DdsSize = 0;
+
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+		std::uint32_t MipCount = 0;
+
+		// Coarsest mip that is still streamed; mips from here down are the tail.
+		std::uint32_t TailMip = 0;
+
+		// MipBytes[i] is the size of mip i.
+		std::vector<std::uint64_t> MipBytes;
+	};
+
+	class Backend
+	{
+	public:
+		virtual ~Backend() = default;
+
+		// Replaces the GPU copy of the texture with one holding mips [firstMip, MipCount).
+		// firstMip == MipCount releases the texture.  Returns false if the backend is out
+		// of resources this frame; the streamer retries later.
+		virtual bool SetResidentMip(std::uint32_t id, const StreamedTexture& texture, std::uint32_t firstMip) = 0;
+	};
+
+	struct Stats
+	{
+		std::uint64_t ResidentBytes = 0;
+		std::uint64_t BudgetBytes = 0;
+		std::uint32_t MipLoads = 0;
+		std::uint32_t MipEvictions = 0;
+		std::uint32_t FailedUpdates = 0;
+	};
+
+	TextureStreamer(std::uint64_t budgetBytes, std::uint32_t tailSize = 64, std::uint32_t maxLoadsPerUpdate = 2);
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer();
+
+	void SetBackend(Backend* backend);
+
+	// Registers a texture without loading anything.  Returns its id.
+	std::uint32_t AddTexture(const std::string& name, const std::uint8_t* ddsData, size_t ddsSize);
+
+	// Reports that the texture is drawn this frame so that one repeat of it covers
+	// screenSize pixels along its largest axis.  Several requests keep the largest.
+	void Request(std::uint32_t id, float screenSize);
+
+	// Evicts and loads mips for this frame's requests, then clears them.
+	void Update();
+
+	std::uint32_t GetTextureCount()const;
+	const StreamedTexture& GetTexture(std::uint32_t id)const;
+
+	// MipCount when nothing is resident.
+	std::uint32_t GetResidentMip(std::uint32_t id)const;
+	std::uint32_t GetWantedMip(std::uint32_t id)const;
+
+	const Stats& GetStats()const;
+
+	// Finest mip worth having when one repeat of a width x height texture covers
+	// screenSize pixels, clamped to [0, tailMip].
+	static std::uint32_t MipForScreenSize(std::uint32_t width, std::uint32_t height, std::uint32_t tailMip, float screenSize);
+
+private:
+
+	struct Residency
+	{
+		std::uint32_t ResidentMip = 0;
+		std::uint32_t WantedMip = 0;
+		float RequestedSize = 0.0f;
+		bool Requested = false;
+		std::uint64_t LastRequestFrame = 0;
+	};
+
+	std::uint64_t BytesFrom(std::uint32_t id, std::uint32_t firstMip)const;
+	bool SetResidentMip(std::uint32_t id, std::uint32_t firstMip);
+
+	// Frees memory until `bytes` more fit in the budget, never touching `keep`.
+	bool MakeRoom(std::uint64_t bytes, std::uint32_t keep);
+
+private:
+
+	Backend* mBackend = nullptr;
+
+	std::uint64_t mBudget;
+	std::uint32_t mTailSize;
+	std::uint32_t mMaxLoadsPerUpdate;
+
+	std::uint64_t mFrame = 0;
+
+	std::vector<StreamedTexture> mTextures;
+	std::vector<Residency> mResidency;
+
+	Stats mStats;
+};
+
+class NullTextureStreamBackend : public TextureStreamer::Backend
+{
+public:
+	virtual bool SetResidentMip(std::uint32_t id, const TextureStreamer::StreamedTexture& texture, std::uint32_t firstMip)override;
+
+	std::uint32_t GetResidentMip(std::uint32_t id)const;
+	std::uint64_t GetUploadedBytes()const;
+
+private:
+	std::vector<std::uint32_t> mResidentMips;
+	std::uint64_t mUploadedBytes = 0;
+};
@@ -55,6 +55,13 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Writes byteSize bytes at byteOffset into an element, for fields that change more
+    // often than the rest of it.
+    void CopyData(int elementIndex, size_t byteOffset, const void* data, size_t byteSize)
+    {
+        memcpy(&mMappedData[elementIndex*mElementByteSize + byteOffset], data, byteSize);
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
@@ -0,0 +1,346 @@
+//***************************************************************************************
+// VertexQuantizer.cpp
+//***************************************************************************************
+
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define VERTEX_QUANTIZER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	using uint16 = std::uint16_t;
+	using uint32 = std::uint32_t;
+
+	uint32 FloatBits(float f)
+	{
+		uint32 u;
+		memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	float BitsFloat(uint32 u)
+	{
+		float f;
+		memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	// Quantisation scale for one axis: maps center - extents to 0 and center + extents
+	// to 65535.  Flat axes encode everything to the middle.
+	float PositionScale(float extents)
+	{
+		return extents > 0.0f ? 65535.0f / (2.0f * extents) : 0.0f;
+	}
+
+	float PositionBias(float center, float extents)
+	{
+		return extents > 0.0f ? 65535.0f * 0.5f - center * PositionScale(extents) : 32767.0f;
+	}
+
+	uint16 QuantizeUnorm16(float value)
+	{
+		value = std::min(std::max(value, 0.0f), 65535.0f);
+		return (uint16)(uint32)(value + 0.5f);
+	}
+
+	std::int16_t QuantizeSnorm16(float value)
+	{
+		// Round to nearest, ties to even, the same as the SSE2 conversion.
+		return (std::int16_t)std::nearbyint(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+	}
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+std::uint16_t VertexQuantizer::FloatToHalf(float value)
+{
+	// Round to nearest even, with overflow to infinity and NaNs kept as quiet NaNs.
+	// Mirrors the SSE2 path in Encode bit for bit.
+	uint32 bits = FloatBits(value);
+	uint32 sign = (bits >> 16) & 0x8000;
+	bits &= 0x7fffffff;
+
+	if(bits >= ((127 + 16) << 23))
+		return (uint16)(sign | (bits > 0x7f800000 ? 0x7e00 : 0x7c00));
+
+	if(bits < ((127 - 14) << 23))
+	{
+		// The result is subnormal: let the FPU round the mantissa into place.
+		const uint32 magic = ((127 - 15) + (23 - 10) + 1) << 23;
+		return (uint16)(sign | (FloatBits(BitsFloat(bits) + BitsFloat(magic)) - magic));
+	}
+
+	uint32 mantissaOdd = (bits >> 13) & 1;
+	bits += 0xfff - ((127 - 15) << 23);
+	bits += mantissaOdd;
+	return (uint16)(sign | (bits >> 13));
+}
+
+float VertexQuantizer::HalfToFloat(std::uint16_t value)
+{
+	uint32 sign = (uint32)(value & 0x8000) << 16;
+	uint32 exponent = (value >> 10) & 0x1f;
+	uint32 mantissa = value & 0x3ff;
+
+	if(exponent == 0)
+	{
+		// Zero or subnormal: mantissa * 2^-24.
+		float f = mantissa * (1.0f / 16777216.0f);
+		return BitsFloat(FloatBits(f) | sign);
+	}
+
+	if(exponent == 31)
+		return BitsFloat(sign | 0x7f800000 | (mantissa << 13));
+
+	return BitsFloat(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+}
+
+void VertexQuantizer::EncodeScalar(const GeometryGenerator::Vertex* vertices, size_t count,
+	const XMFLOAT3& center, const XMFLOAT3& extents, PackedVertex* out)
+{
+	float scale[3] = { PositionScale(extents.x), PositionScale(extents.y), PositionScale(extents.z) };
+	float bias[3] = {
+		PositionBias(center.x, extents.x),
+		PositionBias(center.y, extents.y),
+		PositionBias(center.z, extents.z) };
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		const GeometryGenerator::Vertex& v = vertices[i];
+		PackedVertex& p = out[i];
+
+		p.Position[0] = QuantizeUnorm16(v.Position.x * scale[0] + bias[0]);
+		p.Position[1] = QuantizeUnorm16(v.Position.y * scale[1] + bias[1]);
+		p.Position[2] = QuantizeUnorm16(v.Position.z * scale[2] + bias[2]);
+		p.Position[3] = 0;
+
+		// Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over
+		// the diagonals.
+		float length = fabsf(v.Normal.x) + fabsf(v.Normal.y) + fabsf(v.Normal.z);
+		float inv = length > 0.0f ? 1.0f / length : 0.0f;
+		float ox = v.Normal.x * inv;
+		float oy = v.Normal.y * inv;
+		if(v.Normal.z < 0.0f)
+		{
+			float fx = (1.0f - fabsf(oy)) * SignNotZero(ox);
+			float fy = (1.0f - fabsf(ox)) * SignNotZero(oy);
+			ox = fx;
+			oy = fy;
+		}
+		p.Normal[0] = QuantizeSnorm16(ox);
+		p.Normal[1] = QuantizeSnorm16(oy);
+
+		p.TexC[0] = FloatToHalf(v.TexC.x);
+		p.TexC[1] = FloatToHalf(v.TexC.y);
+	}
+}
+
+#if VERTEX_QUANTIZER_SSE2
+
+namespace
+{
+	__m128i FloatToHalf4(__m128 f)
+	{
+		const __m128i maxRegular = _mm_set1_epi32((127 + 16) << 23);
+		const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+		const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+		const __m128i infinity = _mm_set1_epi32(0x7c00);
+		const __m128i quietNan = _mm_set1_epi32(0x200);
+
+		__m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)));
+		__m128 absF = _mm_xor_ps(f, sign);
+		__m128i absBits = _mm_castps_si128(absF);
+
+		__m128i isRegular = _mm_cmpgt_epi32(maxRegular, absBits);
+		__m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absBits);
+		__m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absF, absF));
+
+		__m128i special = _mm_or_si128(infinity, _mm_and_si128(isNan, quietNan));
+
+		__m128i subnormal = _mm_sub_epi32(
+			_mm_castps_si128(_mm_add_ps(absF, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+		__m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+		__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), mantissaOdd), 13);
+
+		__m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+		__m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+
+		// The sign lands in bit 15, with bits 16-31 set for negative values so that the
+		// signed saturating pack to 16 bits keeps the pattern.
+		return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+	}
+
+	// Packs four int32 lanes holding 0..65535 into the low 8 bytes.
+	__m128i PackUnorm16(__m128i v)
+	{
+		const __m128i bias = _mm_set1_epi32(32768);
+		__m128i packed = _mm_packs_epi32(_mm_sub_epi32(v, bias), _mm_setzero_si128());
+		return _mm_xor_si128(packed, _mm_set1_epi16((short)0x8000));
+	}
+
+	__m128 Select4(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// Compares rather than copying the sign bit, so that -0 gives 1 as in the scalar code.
+	__m128 SignNotZero4(__m128 v)
+	{
+		return Select4(_mm_cmpge_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f), _mm_set1_ps(-1.0f));
+	}
+
+	void Encode4(const GeometryGenerator::Vertex* v, const __m128 scale[3], const __m128 bias[3], PackedVertex* out)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+		//
+		// Positions.
+		//
+
+		__m128 px = _mm_setr_ps(v[0].Position.x, v[1].Position.x, v[2].Position.x, v[3].Position.x);
+		__m128 py = _mm_setr_ps(v[0].Position.y, v[1].Position.y, v[2].Position.y, v[3].Position.y);
+		__m128 pz = _mm_setr_ps(v[0].Position.z, v[1].Position.z, v[2].Position.z, v[3].Position.z);
+
+		const __m128 maxUnorm = _mm_set1_ps(65535.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		__m128i qx = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(px, scale[0]), bias[0]), zero), maxUnorm), half));
+		__m128i qy = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(py, scale[1]), bias[1]), zero), maxUnorm), half));
+		__m128i qz = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(pz, scale[2]), bias[2]), zero), maxUnorm), half));
+
+		__m128i xy = _mm_unpacklo_epi16(PackUnorm16(qx), PackUnorm16(qy));
+		__m128i zw = _mm_unpacklo_epi16(PackUnorm16(qz), _mm_setzero_si128());
+		__m128i position01 = _mm_unpacklo_epi32(xy, zw);
+		__m128i position23 = _mm_unpackhi_epi32(xy, zw);
+
+		//
+		// Octahedral normals.
+		//
+
+		__m128 nx = _mm_setr_ps(v[0].Normal.x, v[1].Normal.x, v[2].Normal.x, v[3].Normal.x);
+		__m128 ny = _mm_setr_ps(v[0].Normal.y, v[1].Normal.y, v[2].Normal.y, v[3].Normal.y);
+		__m128 nz = _mm_setr_ps(v[0].Normal.z, v[1].Normal.z, v[2].Normal.z, v[3].Normal.z);
+
+		__m128 length = _mm_add_ps(_mm_add_ps(_mm_and_ps(nx, absMask), _mm_and_ps(ny, absMask)), _mm_and_ps(nz, absMask));
+		__m128 inv = _mm_and_ps(_mm_cmpgt_ps(length, zero), _mm_div_ps(one, length));
+		__m128 ox = _mm_mul_ps(nx, inv);
+		__m128 oy = _mm_mul_ps(ny, inv);
+
+		__m128 foldX = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(oy, absMask)), SignNotZero4(ox));
+		__m128 foldY = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(ox, absMask)), SignNotZero4(oy));
+		__m128 lower = _mm_cmplt_ps(nz, zero);
+		ox = Select4(lower, foldX, ox);
+		oy = Select4(lower, foldY, oy);
+
+		const __m128 maxSnorm = _mm_set1_ps(32767.0f);
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		__m128i sx = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(ox, minusOne), one), maxSnorm));
+		__m128i sy = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(oy, minusOne), one), maxSnorm));
+		__m128i normal = _mm_unpacklo_epi16(_mm_packs_epi32(sx, sx), _mm_packs_epi32(sy, sy));
+
+		//
+		// Half float texture coordinates.
+		//
+
+		__m128 tu = _mm_setr_ps(v[0].TexC.x, v[1].TexC.x, v[2].TexC.x, v[3].TexC.x);
+		__m128 tv = _mm_setr_ps(v[0].TexC.y, v[1].TexC.y, v[2].TexC.y, v[3].TexC.y);
+		__m128i hu = FloatToHalf4(tu);
+		__m128i hv = FloatToHalf4(tv);
+		__m128i texC = _mm_unpacklo_epi16(_mm_packs_epi32(hu, hu), _mm_packs_epi32(hv, hv));
+
+		//
+		// Interleave into four 16 byte vertices.
+		//
+
+		__m128i normalTexC01 = _mm_unpacklo_epi32(normal, texC);
+		__m128i normalTexC23 = _mm_unpackhi_epi32(normal, texC);
+
+		_mm_storeu_si128((__m128i*)&out[0], _mm_unpacklo_epi64(position01, normalTexC01));
+		_mm_storeu_si128((__m128i*)&out[1], _mm_unpackhi_epi64(position01, normalTexC01));
+		_mm_storeu_si128((__m128i*)&out[2], _mm_unpacklo_epi64(position23, normalTexC23));
+		_mm_storeu_si128((__m128i*)&out[3], _mm_unpackhi_epi64(position23, normalTexC23));
+	}
+}
+
+void VertexQuantizer::Encode(const GeometryGenerator::Vertex* vertices, size_t count,
+	const XMFLOAT3& center, const XMFLOAT3& extents, PackedVertex* out)
+{
+	__m128 scale[3] = {
+		_mm_set1_ps(PositionScale(extents.x)),
+		_mm_set1_ps(PositionScale(extents.y)),
+		_mm_set1_ps(PositionScale(extents.z)) };
+	__m128 bias[3] = {
+		_mm_set1_ps(PositionBias(center.x, extents.x)),
+		_mm_set1_ps(PositionBias(center.y, extents.y)),
+		_mm_set1_ps(PositionBias(center.z, extents.z)) };
+
+	size_t i = 0;
+	for(; i + 4 <= count; i += 4)
+		Encode4(vertices + i, scale, bias, out + i);
+
+	if(i < count)
+	{
+		// Run the last few vertices through the same kernel, padded with copies of the
+		// final vertex, so the tail gets the same rounding as the rest.
+		GeometryGenerator::Vertex tail[4];
+		PackedVertex packed[4];
+		for(size_t k = 0; k < 4; ++k)
+			tail[k] = vertices[std::min(i + k, count - 1)];
+
+		Encode4(tail, scale, bias, packed);
+		std::copy(packed, packed + (count - i), out + i);
+	}
+}
+
+#else
+
+void VertexQuantizer::Encode(const GeometryGenerator::Vertex* vertices, size_t count,
+	const XMFLOAT3& center, const XMFLOAT3& extents, PackedVertex* out)
+{
+	EncodeScalar(vertices, count, center, extents, out);
+}
+
+#endif
+
+XMFLOAT3 VertexQuantizer::DecodePosition(const PackedVertex& v, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	return XMFLOAT3(
+		center.x + (v.Position[0] / 65535.0f * 2.0f - 1.0f) * extents.x,
+		center.y + (v.Position[1] / 65535.0f * 2.0f - 1.0f) * extents.y,
+		center.z + (v.Position[2] / 65535.0f * 2.0f - 1.0f) * extents.z);
+}
+
+XMFLOAT3 VertexQuantizer::DecodeNormal(const PackedVertex& v)
+{
+	// SNORM maps -32768 and -32767 both to -1.
+	float x = std::max(v.Normal[0] / 32767.0f, -1.0f);
+	float y = std::max(v.Normal[1] / 32767.0f, -1.0f);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half.
+	float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = sqrtf(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
+XMFLOAT2 VertexQuantizer::DecodeTexC(const PackedVertex& v)
+{
+	return XMFLOAT2(HalfToFloat(v.TexC[0]), HalfToFloat(v.TexC[1]));
+}
@@ -0,0 +1,59 @@
+//***************************************************************************************
+// VertexQuantizer.h
+//
+// Compact 16 byte vertex format for GPU upload, half the size of the 32 byte
+// position/normal/uv vertex:
+//
+//   Position  R16G16B16A16_UNORM  xyz quantised to 16 bits inside the submesh bounds,
+//                                 w unused.  pos = center + (2 * unorm - 1) * extents.
+//   Normal    R16G16_SNORM        octahedral encoding (Cigolle et al., "A Survey of
+//                                 Efficient Representations for Independent Unit Vectors").
+//   TexC      R16G16_FLOAT        half floats.
+//
+// Error bounds, all from rounding to nearest:
+//   -position: half a quantisation step, extents / 65535 per axis (plus float rounding).
+//   -normal: below 0.05 degrees.
+//   -uv: relative 2^-11, i.e. about 0.0005 for coordinates in [0, 1].
+//
+// Encode converts four vertices at a time with SSE2 where available and falls back to
+// scalar code elsewhere; both produce identical bits.  The Decode* functions mirror the
+// shader and are used to measure the error on the CPU.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+struct PackedVertex
+{
+	std::uint16_t Position[4];
+	std::int16_t Normal[2];
+	std::uint16_t TexC[2];
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match the input layout");
+
+class VertexQuantizer
+{
+public:
+
+	// Version of the PackedVertex encoding, hashed into the mesh cache's pipeline hash.
+	static const std::uint32_t Version = 1;
+
+	// Packs count vertices.  Positions are quantised inside the box center +- extents,
+	// which should enclose them all; positions outside are clamped to it.
+	static void Encode(const GeometryGenerator::Vertex* vertices, size_t count,
+		const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents, PackedVertex* out);
+
+	// Scalar reference of Encode.
+	static void EncodeScalar(const GeometryGenerator::Vertex* vertices, size_t count,
+		const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents, PackedVertex* out);
+
+	static DirectX::XMFLOAT3 DecodePosition(const PackedVertex& v,
+		const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+	static DirectX::XMFLOAT3 DecodeNormal(const PackedVertex& v);
+	static DirectX::XMFLOAT2 DecodeTexC(const PackedVertex& v);
+
+	static std::uint16_t FloatToHalf(float value);
+	static float HalfToFloat(std::uint16_t value);
+};
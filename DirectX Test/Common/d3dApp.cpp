@@ -74,6 +74,7 @@ int D3DApp::Run()
 	MSG msg = {0};
  
 	mTimer.Reset();
+	Profiler::SetThreadName("Main");
 
 	while(msg.message != WM_QUIT)
 	{
@@ -90,9 +91,16 @@ int D3DApp::Run()
 
 			if( !mAppPaused )
 			{
+				PROFILE_ZONE("Frame");
 				CalculateFrameStats();
-				Update(mTimer);	
-                Draw(mTimer);
+				{
+					PROFILE_ZONE("Update");
+					Update(mTimer);
+				}
+				{
+					PROFILE_ZONE("Draw");
+					Draw(mTimer);
+				}
 			}
 			else
 			{
@@ -364,6 +372,8 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+        else if((int)wParam == VK_F3)
+            ToggleProfiling();
 
         return 0;
 	}
@@ -588,6 +598,22 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView()const
 	return mDsvHeap->GetCPUDescriptorHandleForHeapStart();
 }
 
+void D3DApp::ToggleProfiling()
+{
+	// The first press starts a capture; the second stops it and writes what the rings
+	// still hold.
+	if(!Profiler::IsEnabled())
+	{
+		Profiler::Clear();
+		Profiler::SetEnabled(true);
+	}
+	else
+	{
+		Profiler::SetEnabled(false);
+		Profiler::WriteChromeTrace(mProfileTracePath);
+	}
+}
+
 void D3DApp::CalculateFrameStats()
 {
 	// Code computes the average frames per second, and also the 
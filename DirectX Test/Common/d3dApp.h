@@ -9,6 +9,7 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "Profiler.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -66,6 +67,9 @@ protected:
 
 	void CalculateFrameStats();
 
+	// F3 starts a profiler capture and stops it into mProfileTracePath.
+	void ToggleProfiling();
+
     void LogAdapters();
     void LogAdapterOutputs(IDXGIAdapter* adapter);
     void LogOutputDisplayModes(IDXGIOutput* output, DXGI_FORMAT format);
@@ -122,5 +126,8 @@ protected:
     DXGI_FORMAT mDepthStencilFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	int mClientWidth = 800;
 	int mClientHeight = 600;
+
+	// Chrome trace written when a profiler capture stops.
+	std::string mProfileTracePath = "Profile.json";
 };
 
@@ -117,6 +117,9 @@ public:
 		UINT64 byteSize,
 		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
+	// D3DCOMPILE flags CompileShader uses in this build.
+	static UINT GetShaderCompileFlags();
+
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
 		const D3D_SHADER_MACRO* defines,
@@ -138,6 +141,8 @@ public:
 	int LineNumber = -1;
 };
 
+struct MeshletSet;
+
 // Defines a subrange of geometry in a MeshGeometry.  This is for when multiple
 // geometries are stored in one vertex and index buffer.  It provides the offsets
 // and data needed to draw a subset of geometry stores in the vertex and index 
@@ -151,6 +156,14 @@ struct SubmeshGeometry
 	// Bounding box of the geometry defined by this submesh. 
 	// This is used in later chapters of the book.
 	DirectX::BoundingBox Bounds;
+
+	// For "<name>_lod<n>" submeshes: distance from the full-detail mesh, relative to
+	// the largest extent of Bounds.  0 for full detail.
+	float LodError = 0.0f;
+
+	// Meshlets of the submesh, with index offsets relative to StartIndexLocation, for
+	// culling parts of it on the CPU.  Null if it was not split.
+	std::shared_ptr<const MeshletSet> Meshlets;
 };
 
 struct MeshGeometry
@@ -278,6 +291,10 @@ struct Material
 	// Index into SRV heap for normal texture.
 	int NormalSrvHeapIndex = -1;
 
+	// Texture streamer id of the diffuse texture, or -1 if it is fully resident.  When
+	// set, DiffuseSrvHeapIndex is refreshed from the streamer every frame.
+	int DiffuseStreamId = -1;
+
 	// Dirty flag indicating the material has changed and we need to update the constant buffer.
 	// Because we have a material constant buffer for each FrameResource, we have to apply the
 	// update to each FrameResource.  Thus, when we modify a material we should set 
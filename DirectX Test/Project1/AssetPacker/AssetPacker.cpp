@@ -0,0 +1,86 @@
+//***************************************************************************************
+// AssetPacker.cpp
+//
+// Offline tool that builds an AssetPack from every file under a directory.
+//
+//   AssetPacker [-lz4] <output.pak> <input directory>
+//
+// -lz4 compresses every entry in independent chunks; entries that do not shrink
+// are stored raw.
+// Entry names are the paths relative to the input directory, e.g. "Eagle.dds".
+// Existing .pak files in the directory are skipped.
+//***************************************************************************************
+
+#include "../../Common/AssetPack.h"
+#include <cstdio>
+
+static std::string NarrowString(const std::wstring& str)
+{
+	char buffer[MAX_PATH];
+	WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, buffer, MAX_PATH, nullptr, nullptr);
+	return std::string(buffer);
+}
+
+static bool EndsWith(const std::wstring& str, const std::wstring& suffix)
+{
+	return str.size() >= suffix.size() &&
+		_wcsicmp(str.c_str() + str.size() - suffix.size(), suffix.c_str()) == 0;
+}
+
+static void AddDirectory(AssetPackBuilder& builder, const std::wstring& root, const std::wstring& relative, bool compress)
+{
+	WIN32_FIND_DATAW data;
+	HANDLE find = FindFirstFileW((root + relative + L"*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		std::wstring name = data.cFileName;
+		if (name == L"." || name == L"..")
+			continue;
+
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			AddDirectory(builder, root, relative + name + L"\\", compress);
+		}
+		else if (!EndsWith(name, L".pak"))
+		{
+			wprintf(L"  %s%s\n", relative.c_str(), name.c_str());
+			builder.AddFile(NarrowString(relative + name), root + relative + name, compress);
+		}
+	} while (FindNextFileW(find, &data));
+
+	FindClose(find);
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	bool compress = argc > 1 && wcscmp(argv[1], L"-lz4") == 0;
+	if (compress)
+	{
+		--argc;
+		++argv;
+	}
+
+	if (argc != 3)
+	{
+		wprintf(L"usage: AssetPacker [-lz4] <output.pak> <input directory>\n");
+		return 1;
+	}
+
+	std::wstring root = argv[2];
+	if (!root.empty() && root.back() != L'\\' && root.back() != L'/')
+		root += L"\\";
+
+	AssetPackBuilder builder;
+	AddDirectory(builder, root, L"", compress);
+
+	if (!builder.Write(argv[1]))
+	{
+		wprintf(L"failed to write %s\n", argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,753 @@
+//***************************************************************************************
+// Benchmarks.cpp
+//
+// Console tool that times engine code which does not need a GPU.
+//
+//   Benchmarks [iterations] [--json file] [--textures dir]
+//
+// Every case runs once to warm up and then `iterations` times (default 20); the
+// fastest and the median run are reported, since the fastest is the least disturbed
+// by the rest of the machine and the median shows how noisy the runs were.  With
+// --json the same numbers are also written as one record per case, so runs on
+// different days or machines can be compared by a script.
+//
+// Nothing here needs Direct3D, so besides Benchmarks.vcxproj the tool builds with the
+// CMakeLists.txt at the root of the tree, on Windows or on Linux with GCC or Clang
+// against DirectXMath and DirectX-Headers:
+//
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target Benchmarks
+//***************************************************************************************
+
+#include "../../Common/BatchMath.h"
+#include "../../Common/Camera.h"
+#include "../../Common/DDSInfo.h"
+#include "../../Common/GeometryGenerator.h"
+#include "../../Common/MathHelper.h"
+#include "../../Common/MeshOptimizer.h"
+#include "../../Common/VertexQuantizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <DirectXCollision.h>
+#include "../Project1/SceneNode.hpp"
+#include "../Project1/ObjectConstants.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+struct Timing
+{
+	double BestMs = 0.0;
+	double MedianMs = 0.0;
+};
+
+struct Result
+{
+	std::string Suite;
+	std::string Case;
+	Timing Time;
+};
+
+static std::vector<Result> gResults;
+
+// Keeps a timing for the JSON report.
+static void Report(const char* suite, const std::string& name, const Timing& timing)
+{
+	Result result;
+	result.Suite = suite;
+	result.Case = name;
+	result.Time = timing;
+	gResults.push_back(result);
+}
+
+static std::string Format(const char* format, ...)
+{
+	char text[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	return text;
+}
+
+static Timing Measure(int iterations, const std::function<void()>& body)
+{
+	body();
+
+	std::vector<double> times;
+	times.reserve(iterations);
+	for (int i = 0; i < iterations; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	Timing timing;
+	timing.BestMs = times.front();
+	timing.MedianMs = times[times.size() / 2];
+	return timing;
+}
+
+// CreateGeosphere is an icosahedron run through Subdivide `level` times, so this
+// covers Subdivide together with the final projection onto the sphere.
+static void BenchmarkGeosphere(int iterations)
+{
+	printf("CreateGeosphere\n");
+	printf("  %5s %10s %10s %10s %10s\n", "level", "vertices", "triangles", "best ms", "median ms");
+
+	GeometryGenerator geoGen;
+	for (GeometryGenerator::uint32 level = 0; level <= 6; ++level)
+	{
+		size_t vertexCount = 0;
+		size_t triangleCount = 0;
+
+		Timing timing = Measure(iterations, [&]()
+		{
+			GeometryGenerator::MeshData sphere = geoGen.CreateGeosphere(1.0f, level);
+			vertexCount = sphere.Vertices.size();
+			triangleCount = sphere.Indices32.size() / 3;
+		});
+
+		printf("  %5u %10zu %10zu %10.3f %10.3f\n", level, vertexCount, triangleCount,
+			timing.BestMs, timing.MedianMs);
+		Report("CreateGeosphere", Format("level %u", level), timing);
+	}
+}
+
+// CreateSphere, CreateCylinder and CreateGrid at increasing tessellation.  Each one
+// spreads its rows over all hardware threads once a mesh is large enough.
+static void BenchmarkPrimitives(int iterations)
+{
+	printf("Primitives\n");
+	printf("  %-10s %10s %10s %10s %10s %10s\n", "primitive", "size", "vertices", "triangles", "best ms", "median ms");
+
+	GeometryGenerator geoGen;
+
+	struct Primitive
+	{
+		const char* Name;
+		std::function<GeometryGenerator::MeshData(GeometryGenerator::uint32)> Create;
+	};
+
+	Primitive primitives[] =
+	{
+		{ "sphere", [&](GeometryGenerator::uint32 size) { return geoGen.CreateSphere(1.0f, size, size); } },
+		{ "cylinder", [&](GeometryGenerator::uint32 size) { return geoGen.CreateCylinder(1.0f, 0.5f, 2.0f, size, size); } },
+		{ "grid", [&](GeometryGenerator::uint32 size) { return geoGen.CreateGrid(10.0f, 10.0f, size, size); } },
+	};
+
+	for (Primitive& primitive : primitives)
+	{
+		for (GeometryGenerator::uint32 size = 64; size <= 4096; size *= 4)
+		{
+			size_t vertexCount = 0;
+			size_t triangleCount = 0;
+
+			Timing timing = Measure(iterations, [&]()
+			{
+				GeometryGenerator::MeshData mesh = primitive.Create(size);
+				vertexCount = mesh.Vertices.size();
+				triangleCount = mesh.Indices32.size() / 3;
+			});
+
+			printf("  %-10s %10u %10zu %10zu %10.3f %10.3f\n", primitive.Name, size, vertexCount, triangleCount,
+				timing.BestMs, timing.MedianMs);
+			Report("Primitives", Format("%s %u", primitive.Name, size), timing);
+		}
+	}
+
+	// CreateBox runs Subdivide numSubdivisions times on its 12 triangles.
+	for (GeometryGenerator::uint32 subdivisions = 0; subdivisions <= 6; ++subdivisions)
+	{
+		size_t vertexCount = 0;
+		size_t triangleCount = 0;
+
+		Timing timing = Measure(iterations, [&]()
+		{
+			GeometryGenerator::MeshData mesh = geoGen.CreateBox(1.0f, 1.0f, 1.0f, subdivisions);
+			vertexCount = mesh.Vertices.size();
+			triangleCount = mesh.Indices32.size() / 3;
+		});
+
+		printf("  %-10s %10u %10zu %10zu %10.3f %10.3f\n", "box", subdivisions, vertexCount, triangleCount,
+			timing.BestMs, timing.MedianMs);
+		Report("Primitives", Format("box %u", subdivisions), timing);
+	}
+
+	// A quad is too small to time once; 10000 of them per run.
+	Timing quad = Measure(iterations, [&]()
+	{
+		for (int i = 0; i < 10000; ++i)
+			geoGen.CreateQuad(0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
+	});
+	printf("  %-10s %10s %10d %10d %10.3f %10.3f\n", "quad x10000", "-", 4, 2, quad.BestMs, quad.MedianMs);
+	Report("Primitives", "quad x10000", quad);
+}
+
+// One Subdivide pass over meshes of growing size: every triangle becomes four.
+static void BenchmarkSubdivide(int iterations)
+{
+	printf("Subdivide\n");
+	printf("  %-16s %10s %10s %10s\n", "mesh", "triangles", "best ms", "median ms");
+
+	struct NamedMesh
+	{
+		const char* Name;
+		GeometryGenerator::MeshData Mesh;
+	};
+
+	GeometryGenerator geoGen;
+	NamedMesh meshes[] =
+	{
+		{ "geosphere 3", geoGen.CreateGeosphere(1.0f, 3) },
+		{ "geosphere 5", geoGen.CreateGeosphere(1.0f, 5) },
+		{ "grid 256x256", geoGen.CreateGrid(10.0f, 10.0f, 256, 256) },
+	};
+
+	for (NamedMesh& mesh : meshes)
+	{
+		Timing timing = Measure(iterations, [&]()
+		{
+			GeometryGenerator::MeshData copy = mesh.Mesh;
+			geoGen.Subdivide(copy);
+		});
+
+		printf("  %-16s %10zu %10.3f %10.3f\n", mesh.Name, mesh.Mesh.Indices32.size() / 3,
+			timing.BestMs, timing.MedianMs);
+		Report("Subdivide", mesh.Name, timing);
+	}
+}
+
+// Post-transform cache efficiency of every primitive before and after MeshOptimizer,
+// plus the time the optimizer takes.
+static void BenchmarkMeshOptimizer(int iterations)
+{
+	printf("MeshOptimizer\n");
+	printf("  %-16s %10s %13s %13s %10s %10s\n", "mesh", "triangles", "ACMR", "ATVR", "best ms", "median ms");
+
+	struct NamedMesh
+	{
+		const char* Name;
+		GeometryGenerator::MeshData Mesh;
+	};
+
+	GeometryGenerator geoGen;
+	NamedMesh meshes[] =
+	{
+		{ "box 3", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3) },
+		{ "sphere 64x64", geoGen.CreateSphere(1.0f, 64, 64) },
+		{ "geosphere 5", geoGen.CreateGeosphere(1.0f, 5) },
+		{ "cylinder 64x32", geoGen.CreateCylinder(1.0f, 0.5f, 2.0f, 64, 32) },
+		{ "grid 256x256", geoGen.CreateGrid(10.0f, 10.0f, 256, 256) },
+	};
+
+	for (NamedMesh& mesh : meshes)
+	{
+		MeshOptimizer::Report report;
+		Timing timing = Measure(iterations, [&]()
+		{
+			GeometryGenerator::MeshData copy = mesh.Mesh;
+			report = MeshOptimizer::Optimize(copy);
+		});
+
+		printf("  %-16s %10u %6.3f->%5.3f %6.3f->%5.3f %10.3f %10.3f\n", mesh.Name,
+			report.Before.TriangleCount, report.Before.Acmr, report.After.Acmr,
+			report.Before.Atvr, report.After.Atvr, timing.BestMs, timing.MedianMs);
+		Report("MeshOptimizer", mesh.Name, timing);
+	}
+}
+
+// PackedVertex encoding speed, SIMD against scalar, and the largest decode error.
+static void BenchmarkVertexQuantizer(int iterations)
+{
+	printf("VertexQuantizer\n");
+	printf("  %-16s %10s %12s %12s %12s %12s %12s\n", "mesh", "vertices", "simd ms", "scalar ms",
+		"pos error", "normal deg", "uv error");
+
+	struct NamedMesh
+	{
+		const char* Name;
+		GeometryGenerator::MeshData Mesh;
+	};
+
+	GeometryGenerator geoGen;
+	NamedMesh meshes[] =
+	{
+		{ "geosphere 6", geoGen.CreateGeosphere(1.0f, 6) },
+		{ "grid 512x512", geoGen.CreateGrid(100.0f, 100.0f, 512, 512) },
+	};
+
+	for (NamedMesh& mesh : meshes)
+	{
+		const std::vector<GeometryGenerator::Vertex>& vertices = mesh.Mesh.Vertices;
+
+		DirectX::XMFLOAT3 boundsMin = vertices[0].Position;
+		DirectX::XMFLOAT3 boundsMax = vertices[0].Position;
+		for (const GeometryGenerator::Vertex& v : vertices)
+		{
+			boundsMin = DirectX::XMFLOAT3(std::min(boundsMin.x, v.Position.x), std::min(boundsMin.y, v.Position.y), std::min(boundsMin.z, v.Position.z));
+			boundsMax = DirectX::XMFLOAT3(std::max(boundsMax.x, v.Position.x), std::max(boundsMax.y, v.Position.y), std::max(boundsMax.z, v.Position.z));
+		}
+		DirectX::XMFLOAT3 center(0.5f * (boundsMin.x + boundsMax.x), 0.5f * (boundsMin.y + boundsMax.y), 0.5f * (boundsMin.z + boundsMax.z));
+		DirectX::XMFLOAT3 extents(0.5f * (boundsMax.x - boundsMin.x), 0.5f * (boundsMax.y - boundsMin.y), 0.5f * (boundsMax.z - boundsMin.z));
+
+		std::vector<PackedVertex> packed(vertices.size());
+		Timing scalar = Measure(iterations, [&]()
+		{
+			VertexQuantizer::EncodeScalar(vertices.data(), vertices.size(), center, extents, packed.data());
+		});
+		Timing simd = Measure(iterations, [&]()
+		{
+			VertexQuantizer::Encode(vertices.data(), vertices.size(), center, extents, packed.data());
+		});
+
+		// Position error relative to the extents, normal error as an angle.
+		float positionError = 0.0f;
+		float normalError = 0.0f;
+		float texCError = 0.0f;
+		float largestExtent = std::max(extents.x, std::max(extents.y, extents.z));
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const GeometryGenerator::Vertex& v = vertices[i];
+
+			DirectX::XMFLOAT3 p = VertexQuantizer::DecodePosition(packed[i], center, extents);
+			positionError = std::max(positionError, std::max(fabsf(p.x - v.Position.x),
+				std::max(fabsf(p.y - v.Position.y), fabsf(p.z - v.Position.z))) / largestExtent);
+
+			DirectX::XMFLOAT3 n = VertexQuantizer::DecodeNormal(packed[i]);
+			float cosAngle = n.x * v.Normal.x + n.y * v.Normal.y + n.z * v.Normal.z;
+			normalError = std::max(normalError, acosf(std::min(cosAngle, 1.0f)) * 180.0f / DirectX::XM_PI);
+
+			DirectX::XMFLOAT2 t = VertexQuantizer::DecodeTexC(packed[i]);
+			texCError = std::max(texCError, std::max(fabsf(t.x - v.TexC.x), fabsf(t.y - v.TexC.y)));
+		}
+
+		printf("  %-16s %10zu %12.3f %12.3f %12.2e %12.4f %12.2e\n", mesh.Name, vertices.size(),
+			simd.BestMs, scalar.BestMs, positionError, normalError, texCError);
+		Report("VertexQuantizer", std::string(mesh.Name) + " simd", simd);
+		Report("VertexQuantizer", std::string(mesh.Name) + " scalar", scalar);
+	}
+}
+
+// A million floats in [0, 1) from C rand(), from MathHelper::RandF and from the bulk
+// FillUniform path.
+static void BenchmarkRandom(int iterations)
+{
+	printf("Random\n");
+	printf("  %-16s %10s %10s\n", "source", "best ms", "median ms");
+
+	const size_t count = 1000000;
+	std::vector<float> values(count);
+
+	Timing crt = Measure(iterations, [&]()
+	{
+		for (size_t i = 0; i < count; ++i)
+			values[i] = (float)rand() / ((float)RAND_MAX + 1.0f);
+	});
+	Timing randF = Measure(iterations, [&]()
+	{
+		RandomEngine& engine = MathHelper::GetRandomEngine();
+		for (size_t i = 0; i < count; ++i)
+			values[i] = engine.NextFloat();
+	});
+	Timing fill = Measure(iterations, [&]()
+	{
+		MathHelper::FillUniform(values.data(), count);
+	});
+
+	printf("  %-16s %10.3f %10.3f\n", "rand()", crt.BestMs, crt.MedianMs);
+	printf("  %-16s %10.3f %10.3f\n", "NextFloat", randF.BestMs, randF.MedianMs);
+	printf("  %-16s %10.3f %10.3f\n", "FillUniform", fill.BestMs, fill.MedianMs);
+	Report("Random", "rand()", crt);
+	Report("Random", "NextFloat", randF);
+	Report("Random", "FillUniform", fill);
+}
+
+// BatchMath kernels over a million elements on every path the machine supports.
+static void BenchmarkBatchMath(int iterations)
+{
+	printf("BatchMath\n");
+	printf("  %-16s %10s %10s %10s %10s\n", "kernel", "scalar ms", "sse2 ms", "avx2 ms", "avx512 ms");
+
+	const size_t count = 1000000;
+	std::vector<float> x(count), y(count), z(count), outX(count), outY(count), outZ(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		x[i] = MathHelper::RandF(-100.0f, 100.0f);
+		y[i] = MathHelper::RandF(-100.0f, 100.0f);
+		z[i] = MathHelper::RandF(-100.0f, 100.0f);
+	}
+
+	DirectX::XMFLOAT4X4 m = MathHelper::Identity4x4();
+	m._12 = 0.5f;
+	m._41 = 3.0f;
+
+	BatchMath::ConstFloat3Array in(x.data(), y.data(), z.data());
+	BatchMath::Float3Array out;
+	out.X = outX.data();
+	out.Y = outY.data();
+	out.Z = outZ.data();
+
+	struct Kernel
+	{
+		const char* Name;
+		std::function<void(BatchMath::Path)> Run;
+	};
+
+	Kernel kernels[] =
+	{
+		{ "TransformPoints", [&](BatchMath::Path path) { BatchMath::TransformPoints(m, in, out, count, path); } },
+		{ "Normalize", [&](BatchMath::Path path) { BatchMath::Normalize(in, out, count, path); } },
+		{ "Lerp", [&](BatchMath::Path path) { BatchMath::Lerp(x.data(), y.data(), 0.25f, outX.data(), count, path); } },
+		{ "MultiplyAdd", [&](BatchMath::Path path) { BatchMath::MultiplyAdd(x.data(), y.data(), 0.016f, outX.data(), count, path); } },
+		{ "Clamp", [&](BatchMath::Path path) { BatchMath::Clamp(x.data(), -1.0f, 1.0f, outX.data(), count, path); } },
+		{ "AngleFromXY", [&](BatchMath::Path path) { BatchMath::AngleFromXY(x.data(), y.data(), outX.data(), count, path); } },
+	};
+
+	const BatchMath::Path paths[] = { BatchMath::Path::Scalar, BatchMath::Path::Sse2, BatchMath::Path::Avx2, BatchMath::Path::Avx512 };
+	const char* pathNames[] = { "scalar", "sse2", "avx2", "avx512" };
+
+	for (Kernel& kernel : kernels)
+	{
+		printf("  %-16s", kernel.Name);
+		for (int p = 0; p < 4; ++p)
+		{
+			BatchMath::Path path = paths[p];
+			if ((int)path > (int)BatchMath::GetBestPath())
+			{
+				printf(" %10s", "-");
+				continue;
+			}
+
+			Timing timing = Measure(iterations, [&]() { kernel.Run(path); });
+			printf(" %10.3f", timing.BestMs);
+			Report("BatchMath", std::string(kernel.Name) + " " + pathNames[p], timing);
+		}
+		printf("\n");
+	}
+}
+
+// Camera::UpdateViewMatrix after a small turn, which rebuilds the view, its inverse,
+// view * proj and the frustum planes, 100000 times per run.
+static void BenchmarkCamera(int iterations)
+{
+	printf("Camera\n");
+	printf("  %-24s %10s %10s %10s\n", "case", "best ms", "median ms", "ns/update");
+
+	const int updates = 100000;
+
+	Camera camera;
+	camera.SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+	camera.LookAt(DirectX::XMFLOAT3(0.0f, 5.0f, -20.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+	Timing timing = Measure(iterations, [&]()
+	{
+		for (int i = 0; i < updates; ++i)
+		{
+			camera.RotateY(1e-4f);
+			camera.UpdateViewMatrix();
+		}
+	});
+
+	printf("  %-24s %10.3f %10.3f %10.1f\n", "RotateY + UpdateViewMatrix", timing.BestMs, timing.MedianMs,
+		timing.BestMs * 1e6 / updates);
+	Report("Camera", "UpdateViewMatrix x100000", timing);
+}
+
+// SceneNode::update over trees of plain nodes, and getWorldTransform of every leaf, which
+// walks up to the root.  Deep trees make the walks long, wide ones make many of them.
+static void BenchmarkSceneGraph(int iterations)
+{
+	printf("SceneGraph\n");
+	printf("  %5s %5s %10s %10s %14s %14s\n", "depth", "width", "nodes", "leaves", "update ms", "world ms");
+
+	struct Shape
+	{
+		int Depth;
+		int Width;
+	};
+
+	const Shape shapes[] = { { 1, 10000 }, { 4, 10 }, { 8, 3 }, { 16, 2 }, { 64, 1 } };
+
+	GameTimer timer;
+	for (const Shape& shape : shapes)
+	{
+		SceneNode root(nullptr);
+		std::vector<SceneNode*> level(1, &root);
+		size_t nodeCount = 1;
+		for (int depth = 0; depth < shape.Depth; ++depth)
+		{
+			std::vector<SceneNode*> next;
+			for (SceneNode* parent : level)
+			{
+				for (int child = 0; child < shape.Width; ++child)
+				{
+					SceneNode::Ptr node(new SceneNode(nullptr));
+					next.push_back(node.get());
+					parent->attachChild(std::move(node));
+				}
+			}
+			nodeCount += next.size();
+			level.swap(next);
+		}
+
+		Timing update = Measure(iterations, [&]()
+		{
+			root.update(timer);
+		});
+
+		DirectX::XMFLOAT4X4 sink;
+		Timing world = Measure(iterations, [&]()
+		{
+			for (SceneNode* leaf : level)
+				sink = leaf->getWorldTransform();
+		});
+
+		printf("  %5d %5d %10zu %10zu %14.3f %14.3f\n", shape.Depth, shape.Width, nodeCount, level.size(),
+			update.BestMs, world.BestMs);
+		Report("SceneGraph", Format("update depth %d width %d", shape.Depth, shape.Width), update);
+		Report("SceneGraph", Format("getWorldTransform depth %d width %d", shape.Depth, shape.Width), world);
+	}
+}
+
+// Object constants as Game::UpdateObjectCBs writes them, into ordinary memory with the
+// 256 byte element stride of an upload buffer instead of a mapped D3D12 resource.
+static void BenchmarkObjectConstants(int iterations)
+{
+	printf("ObjectConstants\n");
+	printf("  %10s %10s %10s\n", "items", "best ms", "median ms");
+
+	struct PlainObjectBuffer
+	{
+		std::vector<std::uint8_t> Data;
+
+		// d3dUtil::CalcConstantBufferByteSize
+		std::uint32_t ElementByteSize = (sizeof(ObjectConstants) + 255) & ~255;
+
+		void CopyData(int elementIndex, const ObjectConstants& data)
+		{
+			memcpy(&Data[elementIndex * ElementByteSize], &data, sizeof(ObjectConstants));
+		}
+	};
+
+	// The RenderItem and Material fields UpdateObjectConstants reads, without the
+	// Direct3D ones.
+	struct PlainMaterial
+	{
+		int MatCBIndex = 0;
+	};
+
+	struct PlainItem
+	{
+		DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+		DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+		int NumFramesDirty = 0;
+		std::uint32_t ObjCBIndex = 0;
+		PlainMaterial* Mat = nullptr;
+		DirectX::BoundingBox Bounds;
+	};
+
+	const int frameResourceCount = 3;
+	PlainMaterial material;
+
+	for (std::uint32_t count = 1000; count <= 100000; count *= 10)
+	{
+		std::vector<std::unique_ptr<PlainItem>> items;
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			std::unique_ptr<PlainItem> item(new PlainItem());
+			item->ObjCBIndex = i;
+			item->Mat = &material;
+			DirectX::XMStoreFloat4x4(&item->World, DirectX::XMMatrixTranslation((float)i, 0.0f, 0.0f));
+			items.push_back(std::move(item));
+		}
+
+		PlainObjectBuffer buffer;
+		buffer.Data.resize((size_t)count * buffer.ElementByteSize);
+
+		// Every item changed this frame.
+		Timing timing = Measure(iterations, [&]()
+		{
+			for (auto& item : items)
+				item->NumFramesDirty = frameResourceCount;
+			UpdateObjectConstants(items, buffer);
+		});
+
+		printf("  %10u %10.3f %10.3f\n", count, timing.BestMs, timing.MedianMs);
+		Report("ObjectConstants", Format("%u items", count), timing);
+	}
+}
+
+// Names of the .dds files in a folder.
+static std::vector<std::string> ListDdsFiles(const std::string& dir)
+{
+	std::vector<std::string> names;
+
+#if defined(_WIN32)
+	WIN32_FIND_DATAA find;
+	HANDLE handle = FindFirstFileA((dir + "/*.dds").c_str(), &find);
+	if (handle == INVALID_HANDLE_VALUE)
+		return names;
+
+	do
+	{
+		names.push_back(find.cFileName);
+	}
+	while (FindNextFileA(handle, &find));
+
+	FindClose(handle);
+#else
+	DIR* folder = opendir(dir.c_str());
+	if (folder == nullptr)
+		return names;
+
+	while (dirent* entry = readdir(folder))
+	{
+		std::string name = entry->d_name;
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, ".dds") == 0)
+			names.push_back(name);
+	}
+
+	closedir(folder);
+#endif
+
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+// GetDDSTextureInfoFromMemory on every DDS file in the textures folder: the header
+// checks, the format lookup and GetSurfaceInfo for each mip, 10000 times per run.
+static void BenchmarkDdsInfo(int iterations, const std::string& textureDir)
+{
+	printf("DDS info\n");
+	printf("  %-20s %10s %6s %10s %10s\n", "texture", "size", "mips", "best ms", "median ms");
+
+	std::vector<std::string> names = ListDdsFiles(textureDir);
+	if (names.empty())
+	{
+		printf("  no textures in %s\n", textureDir.c_str());
+		return;
+	}
+
+	for (const std::string& name : names)
+	{
+		std::ifstream fin(textureDir + "/" + name, std::ios::binary);
+		std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+		DirectX::DDS_TEXTURE_INFO info;
+		if (!DirectX::GetDDSTextureInfoFromMemory(data.data(), data.size(), info))
+		{
+			printf("  %-20s not a plain 2D texture\n", name.c_str());
+			continue;
+		}
+
+		Timing timing = Measure(iterations, [&]()
+		{
+			for (int i = 0; i < 10000; ++i)
+				DirectX::GetDDSTextureInfoFromMemory(data.data(), data.size(), info);
+		});
+
+		printf("  %-20s %4ux%-5u %6u %10.3f %10.3f\n", name.c_str(), info.width, info.height, info.mipCount,
+			timing.BestMs, timing.MedianMs);
+		Report("DdsInfo", name, timing);
+	}
+}
+
+static std::string JsonString(const std::string& s)
+{
+	std::string quoted = "\"";
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+// {"timestamp", "platform", "iterations", "results": [{"suite", "case", "best_ms", "median_ms"}]}
+static bool WriteJson(const std::string& path, int iterations)
+{
+	std::ofstream fout(path, std::ios::trunc);
+	if (!fout)
+		return false;
+
+	char timestamp[32];
+	std::time_t now = std::time(nullptr);
+	std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#if defined(_WIN32)
+	const char* platform = "windows";
+#elif defined(__linux__)
+	const char* platform = "linux";
+#else
+	const char* platform = "other";
+#endif
+
+	fout << "{\n  \"timestamp\": " << JsonString(timestamp) << ",\n  \"platform\": " << JsonString(platform)
+		<< ",\n  \"iterations\": " << iterations << ",\n  \"results\": [\n";
+
+	for (size_t i = 0; i < gResults.size(); ++i)
+	{
+		const Result& r = gResults[i];
+		fout << "    {\"suite\": " << JsonString(r.Suite) << ", \"case\": " << JsonString(r.Case)
+			<< Format(", \"best_ms\": %.6f, \"median_ms\": %.6f}", r.Time.BestMs, r.Time.MedianMs)
+			<< (i + 1 < gResults.size() ? ",\n" : "\n");
+	}
+
+	fout << "  ]\n}\n";
+	return (bool)fout;
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = 20;
+	std::string jsonPath;
+	std::string textureDir = "../../Textures";
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--json" && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (arg == "--textures" && i + 1 < argc)
+			textureDir = argv[++i];
+		else
+			iterations = std::max(1, atoi(argv[i]));
+	}
+
+	BenchmarkGeosphere(iterations);
+	BenchmarkPrimitives(iterations);
+	BenchmarkSubdivide(iterations);
+	BenchmarkMeshOptimizer(iterations);
+	BenchmarkVertexQuantizer(iterations);
+	BenchmarkRandom(iterations);
+	BenchmarkBatchMath(iterations);
+	BenchmarkCamera(iterations);
+	BenchmarkSceneGraph(iterations);
+	BenchmarkObjectConstants(iterations);
+	BenchmarkDdsInfo(iterations, textureDir);
+
+	if (!jsonPath.empty() && !WriteJson(jsonPath, iterations))
+	{
+		printf("cannot write %s\n", jsonPath.c_str());
+		return 1;
+	}
+
+	return 0;
+}
@@ -4,18 +4,6 @@
 Aircraft::Aircraft(Type type, Game* game) : Entity(game)
 , mType(type)
 {
-	switch (type)
-	{
-	case (Eagle):
-		mSprite = "Eagle";
-		break;
-	case (Raptor):
-		mSprite = "Raptor";
-		break;
-	default:
-		mSprite = "Eagle";
-		break;
-	}
 }
 
 void Aircraft::updateCurrent(const GameTimer& gt)
@@ -30,14 +18,12 @@ void Aircraft::buildCurrent()
 {
 	auto render = std::make_unique<RenderItem>();
 	renderer = render.get();
-	renderer->World = getTransform();
+	renderer->World = getWorldTransform();
 	renderer->ObjCBIndex = game->getRenderItems().size();
-	renderer->Mat = game->getMaterials()[mSprite].get();
-	renderer->Geo = game->getGeometries()["boxGeo"].get();
+	const SceneResources& resources = game->getSceneResources();
+	renderer->Mat = game->getMaterial(mMaterial.IsValid() ? mMaterial : resources.AircraftSprites[mType]);
 	renderer->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	renderer->IndexCount = renderer->Geo->DrawArgs["box"].IndexCount;
-	renderer->StartIndexLocation = renderer->Geo->DrawArgs["box"].StartIndexLocation;
-	renderer->BaseVertexLocation = renderer->Geo->DrawArgs["box"].BaseVertexLocation;
+	SetRenderItemSubmesh(*renderer, game->getSubmesh(resources.Box));
 
 	game->getItemLayers(RenderLayer::Transparent).push_back(render.get());
 	game->getRenderItems().push_back(std::move(render));
@@ -9,6 +9,7 @@ public:
 	{
 		Eagle,
 		Raptor,
+		TypeCount
 	};
 
 public:
@@ -21,5 +22,4 @@ private:
 
 private:
 	Type mType;
-	std::string mSprite;
 };
\ No newline at end of file
@@ -20,6 +20,11 @@ XMFLOAT2 Entity::getVelocity() const
 	return mVelocity;
 }
 
+void Entity::setMaterial(MaterialHandle material)
+{
+	mMaterial = material;
+}
+
 void Entity::updateCurrent(const GameTimer& gt)
 {
 	XMFLOAT2 mV;
@@ -31,3 +36,9 @@ void Entity::updateCurrent(const GameTimer& gt)
 	renderer->World = getWorldTransform();
 	renderer->NumFramesDirty++;
 }
+
+void Entity::setActiveCurrent(bool active)
+{
+	if (renderer != nullptr)
+		renderer->Active = active;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "SceneNode.hpp"
+#include "RenderItem.h"
 
 class Entity :
 	public SceneNode
@@ -10,8 +11,16 @@ public:
 	void setVelocity(float vx, float vy);
 	XMFLOAT2 getVelocity() const;
 
+	//! Material drawn instead of the default one of the entity's type.
+	void setMaterial(MaterialHandle material);
+
 	virtual void updateCurrent(const GameTimer& gt);
+	virtual void setActiveCurrent(bool active);
 
 public:
 	XMFLOAT2 mVelocity;
+
+protected:
+	//! Invalid unless setMaterial was called.
+	MaterialHandle mMaterial;
 };
@@ -3,13 +3,11 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "ObjectConstants.h"
 
-struct ObjectConstants
-{
-    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
-	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-    UINT     MaterialIndex;
-};
+// Meshes are uploaded as 16 byte PackedVertex instead of Vertex when true.  The input
+// layout and the shader variant follow it.
+extern const bool gQuantizedVertices;
 
 struct PassConstants
 {
@@ -82,6 +80,9 @@ public:
     std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
 
+    // Game::mMainPassVersion PassCB was last written from; 0 before the first write.
+    UINT64 PassVersion = 0;
+
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
     UINT64 Fence = 0;
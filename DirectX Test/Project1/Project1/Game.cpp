@@ -1,10 +1,62 @@
 #include "Game.hpp"
+#include <stdexcept>
 using namespace std;
 
 const int gNumFrameResources = 3;
+const bool gQuantizedVertices = true;
+
+//! GPU memory shared by all streamed textures, and the SRV slots handed to the streaming
+//! backend.  Each texture holds one slot plus one per change still in flight.
+static const UINT64 TextureStreamBudget = 64ull << 20;
+static const UINT TextureStreamSrvCount = 64;
+
+//! Largest simplification error, in pixels, tolerated when picking a mesh LOD.
+static const float LodPixelError = 1.0f;
+
+//! Size of the shared vertex and index buffers every mesh is sub-allocated from.  The
+//! 32-bit indices are only for meshes of more than 65536 vertices.
+static const UINT GeometryArenaVertices = 1 << 20;
+static const UINT GeometryArenaIndices = 4 << 20;
+static const UINT GeometryArenaWideIndices = 1 << 20;
+
+//! Compiled shaders, and the list of every shader the game uses for building them ahead.
+//! The list is generated, so it is written next to the cache rather than into Shaders.
+static const wchar_t* ShaderCacheDirectory = L"../../ShaderCache";
+static const wchar_t* ShaderCacheManifest = L"../../ShaderCache/ShaderCache.txt";
+
+//! Pipeline states of earlier runs, as a D3D12 pipeline library.
+static const wchar_t* PipelineLibraryPath = L"../../PipelineLibrary.bin";
+
+//! The level as authored and compiled; the text is only needed to rebuild the binary.
+static const wchar_t* LevelTextPath = L"../../Levels/Level1.txt";
+static const wchar_t* LevelPath = L"../../Levels/Level1.lvl";
+
+//! Shader variant every item of a render layer is drawn with.
+static std::uint32_t layerShaderFeatures(RenderLayer layer)
+{
+	std::uint32_t features = ShaderVariants::Sampler(ShaderVariants::SamplerMode::PointWrap) |
+		ShaderVariants::Lights(3, 0, 0);
+	if (gQuantizedVertices)
+		features |= ShaderVariants::QuantizedVertices;
+	if (layer == RenderLayer::Transparent)
+		features |= ShaderVariants::Blend;
+	return features;
+}
+
+//! Variants known before the scene is built: those of the render layers.  Items that
+//! add features of their own get their variant compiled (and cached) at load time.
+static std::vector<std::uint32_t> layerShaderVariants()
+{
+	std::vector<std::uint32_t> variants;
+	for (int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+		variants.push_back(layerShaderFeatures((RenderLayer)layer));
+	return variants;
+}
 
 Game::Game(HINSTANCE hInstance)
 	: D3DApp(hInstance)
+	, mShaderCache(ShaderCacheDirectory)
+	, mTextureStreamer(TextureStreamBudget)
 	, mWorld(this)
 {
 }
@@ -13,6 +65,36 @@ Game::~Game()
 {
     if (md3dDevice != nullptr)
         FlushCommandQueue();
+
+    //! Stops the pipeline worker before the members its jobs use are destroyed.
+    if (mPipelineCache != nullptr)
+    {
+        mPipelineCache->Save();
+
+        PipelineCache::Stats stats = mPipelineCache->GetStats();
+        char text[192];
+        sprintf_s(text, "Pipeline states: %u from memory, %u from the library, %u created, %.1f ms; %u draws fell back\n",
+            stats.MemoryHits, stats.LibraryHits, stats.Created, stats.CreateMs, stats.AsyncFallbacks);
+        OutputDebugStringA(text);
+
+        mPipelineCache.reset();
+    }
+}
+
+UINT Game::BuildShaderCache()
+{
+	//! The manifest is regenerated from the variants in use first, so only those are compiled.
+	CreateDirectoryW(ShaderCacheDirectory, nullptr);
+	std::ofstream fout(ShaderCacheManifest, std::ios::trunc);
+	fout << "# Generated by \"Project1.exe -buildshadercache\" from the shader variants in use.\n"
+		<< "#   <file> <entry point> <target> [NAME=VALUE ...]\n"
+		<< ShaderVariants::GetManifest(layerShaderVariants());
+	fout.close();
+	if (!fout)
+		throw std::runtime_error("Game::BuildShaderCache: cannot write the manifest");
+
+	ShaderCache cache(ShaderCacheDirectory);
+	return cache.BuildFromManifest(ShaderCacheManifest);
 }
 
 bool Game::Initialize()
@@ -29,16 +111,21 @@ bool Game::Initialize()
     // so we have to query this information.
     mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+    mWorld.loadLevel(LevelTextPath, LevelPath);
     LoadTextures();
     BuildRootSignature();
     BuildDescriptorHeaps();
-    BuildShadersAndInputLayout();
+    BuildInputLayout();
     BuildShapeGeometry();
     BuildMaterials();
+    RegisterResources();
     BuildRenderItems();
     BuildFrameResources();
     BuildPSOs();
 
+    // Load the mip tails of the streamed textures along with everything else.
+    UpdateTextureStreaming();
+
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
     ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
@@ -70,13 +157,34 @@ std::vector<std::unique_ptr<RenderItem>>& Game::getRenderItems()
 }
 
 
-std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& Game::getGeometries()
+const SceneResources& Game::getSceneResources()const
+{
+	return mSceneResources;
+}
+
+Material* Game::getMaterial(MaterialHandle handle)const
+{
+	return mMaterialHandles.Get(handle);
+}
+
+MeshGeometry* Game::getGeometry(GeometryHandle handle)const
 {
-	return mGeometries;
+	return mGeometryHandles.Get(handle);
 }
-std::unordered_map<std::string, std::unique_ptr<Material>>& Game::getMaterials()
+
+const SubmeshLods& Game::getSubmesh(SubmeshHandle handle)const
 {
-	return mMaterials;
+	return mSubmeshHandles.Get(handle);
+}
+
+MaterialHandle Game::findMaterial(ResourceName name)const
+{
+	return mMaterialHandles.Resolve(name);
+}
+
+TextureStreamer& Game::getTextureStreamer()
+{
+	return mTextureStreamer;
 }
 
 void Game::OnResize()
@@ -104,6 +212,7 @@ void Game::Update(const GameTimer& gt)
     // If not, wait until the GPU has completed commands up to this fence point.
     if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
     {
+        PROFILE_ZONE("Game::WaitForFrameResource");
         HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
         ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
         WaitForSingleObject(eventHandle, INFINITE);
@@ -114,6 +223,9 @@ void Game::Update(const GameTimer& gt)
     UpdateObjectCBs(gt);
     UpdateMaterialCBs(gt);
     UpdateMainPassCB(gt);
+    UpdateScreenSizes(gt);
+    CullRenderItems();
+    UpdateTextureRequests(gt);
 }
 
 
@@ -127,7 +239,12 @@ void Game::Draw(const GameTimer& gt)
 
     // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
     // Reusing the command list reuses memory.
-    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
+    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), nullptr));
+
+    // Upload the texture mips requested in Update() before anything samples them.
+    UpdateTextureStreaming();
+    mGeometryArena->BeginFrame(mCurrentFence + 1, mFence->GetCompletedValue());
+    mWorld.streamTerrain(mCommandList.Get(), *mGeometryArena);
 
     mCommandList->RSSetViewports(1, &mScreenViewport);
     mCommandList->RSSetScissorRects(1, &mScissorRect);
@@ -151,10 +268,8 @@ void Game::Draw(const GameTimer& gt)
     auto passCB = mCurrFrameResource->PassCB->Resource();
     mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
-
-    mCommandList->SetPipelineState(mPSOs["transparent"].Get());
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
+    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque], layerShaderFeatures(RenderLayer::Opaque));
+    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent], layerShaderFeatures(RenderLayer::Transparent));
 
     // Indicate a state transition on the resource usage.
     mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
@@ -168,7 +283,10 @@ void Game::Draw(const GameTimer& gt)
     mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
     // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
+    {
+        PROFILE_ZONE("Game::Present");
+        ThrowIfFailed(mSwapChain->Present(0, 0));
+    }
     mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
     // Advance the fence value to mark commands up to this fence point.
@@ -238,6 +356,8 @@ void Game::OnMouseMove(WPARAM btnState, int x, int y)
 
 void Game::OnKeyboardInput(const GameTimer& gt)
 {
+	PROFILE_ZONE("Game::OnKeyboardInput");
+
 	const float dt = gt.DeltaTime();
 
 	if (GetAsyncKeyState('W') & 0x8000)
@@ -257,6 +377,8 @@ void Game::OnKeyboardInput(const GameTimer& gt)
 
 void Game::UpdateCamera(const GameTimer& gt)
 {
+    PROFILE_ZONE("Game::UpdateCamera");
+
     // Convert Spherical to Cartesian coordinates.
     mEyePos.x = mRadius*sinf(mPhi)*cosf(mTheta);
     mEyePos.z = mRadius*sinf(mPhi)*sinf(mTheta);
@@ -267,8 +389,9 @@ void Game::UpdateCamera(const GameTimer& gt)
     XMVECTOR target = XMVectorZero();
     XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 
-    XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
-    XMStoreFloat4x4(&mView, view);
+    //! The camera only bumps its view version when the orbit actually moved.
+    mCamera.LookAt(pos, target, up);
+    mCamera.UpdateViewMatrix();
 }
 
 void Game::AnimateMaterials(const GameTimer& gt)
@@ -278,31 +401,15 @@ void Game::AnimateMaterials(const GameTimer& gt)
 
 void Game::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for (auto& e : mAllRitems)
-	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if (e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
-
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
-			objConstants.MaterialIndex = e->Mat->MatCBIndex;
+	PROFILE_ZONE("Game::UpdateObjectCBs");
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
-	}
+	UpdateObjectConstants(mAllRitems, *mCurrFrameResource->ObjectCB);
 }
 
 void Game::UpdateMaterialCBs(const GameTimer& gt)
 {
+	PROFILE_ZONE("Game::UpdateMaterialCBs");
+
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
 	for (auto& e : mMaterials)
 	{
@@ -329,41 +436,172 @@ void Game::UpdateMaterialCBs(const GameTimer& gt)
 
 void Game::UpdateMainPassCB(const GameTimer& gt)
 {
-	//XMMATRIX view = mCamera.GetView();
-	//XMMATRIX proj = mCamera.GetProj();
-
-	XMMATRIX view = XMLoadFloat4x4(&mView);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
-
-	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
-	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
-	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
-	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-	mMainPassCB.EyePosW = mEyePos;
-	//mMainPassCB.EyePosW = mCamera.GetPosition3f();
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
+	PROFILE_ZONE("Game::UpdateMainPassCB");
+
+	//! Matrices, inverses and the other per-view constants are only rebuilt when the
+	//! camera or the render target changed.  Camera keeps the products and inverses, so
+	//! nothing is inverted here.
+	bool viewChanged = mCamera.GetViewVersion() != mPassViewVersion ||
+		mCamera.GetProjVersion() != mPassProjVersion ||
+		mClientWidth != mPassClientWidth || mClientHeight != mPassClientHeight;
+
+	if (viewChanged)
+	{
+		XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(mCamera.GetView()));
+		XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(mCamera.GetInvView()));
+		XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(mCamera.GetProj()));
+		XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(mCamera.GetInvProj()));
+		XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(mCamera.GetViewProj()));
+		XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(mCamera.GetInvViewProj()));
+		mMainPassCB.EyePosW = mCamera.GetPosition3f();
+		mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
+		mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
+		mMainPassCB.NearZ = mCamera.GetNearZ();
+		mMainPassCB.FarZ = mCamera.GetFarZ();
+		mMainPassCB.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
+		mMainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
+		mMainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
+		mMainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
+		mMainPassCB.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
+		mMainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
+		mMainPassCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
+
+		mPassViewVersion = mCamera.GetViewVersion();
+		mPassProjVersion = mCamera.GetProjVersion();
+		mPassClientWidth = mClientWidth;
+		mPassClientHeight = mClientHeight;
+		++mMainPassVersion;
+	}
+
 	mMainPassCB.TotalTime = gt.TotalTime();
 	mMainPassCB.DeltaTime = gt.DeltaTime();
-	mMainPassCB.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
-	mMainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
-	mMainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
-	mMainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
-	mMainPassCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
 
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+	//! Each frame resource has its own copy of the constants, so a change reaches the
+	//! next gNumFrameResources frames one at a time; an up to date copy is left alone
+	//! except for the timers, which change every frame and are written on their own.
+	if (mCurrFrameResource->PassVersion != mMainPassVersion)
+	{
+		mCurrFrameResource->PassCB->CopyData(0, mMainPassCB);
+		mCurrFrameResource->PassVersion = mMainPassVersion;
+	}
+	else
+	{
+		mCurrFrameResource->PassCB->CopyData(0, offsetof(PassConstants, TotalTime), &mMainPassCB.TotalTime,
+			offsetof(PassConstants, DeltaTime) + sizeof(float) - offsetof(PassConstants, TotalTime));
+	}
+}
+
+void Game::UpdateScreenSizes(const GameTimer& gt)
+{
+	PROFILE_ZONE("Game::UpdateScreenSizes");
+
+	XMMATRIX viewProj = mCamera.GetViewProj();
+
+	for (auto& e : mAllRitems)
+	{
+		// Screen-space extent of the item's bounds, in pixels.
+		XMMATRIX worldViewProj = XMMatrixMultiply(XMLoadFloat4x4(&e->World), viewProj);
+
+		XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+		e->Bounds.GetCorners(corners);
+
+		XMVECTOR ndcMin = XMVectorReplicate(MathHelper::Infinity);
+		XMVECTOR ndcMax = XMVectorReplicate(-MathHelper::Infinity);
+		for (const XMFLOAT3& corner : corners)
+		{
+			XMVECTOR p = XMVector3Transform(XMLoadFloat3(&corner), worldViewProj);
+
+			// Corners at or behind the eye blow up, which asks for full detail.
+			float w = MathHelper::Max(XMVectorGetW(p), 0.001f);
+			p = XMVectorScale(p, 1.0f / w);
+
+			ndcMin = XMVectorMin(ndcMin, p);
+			ndcMax = XMVectorMax(ndcMax, p);
+		}
+
+		XMFLOAT2 ndcSize;
+		XMStoreFloat2(&ndcSize, XMVectorSubtract(ndcMax, ndcMin));
+		e->ScreenSize = MathHelper::Max(0.5f * ndcSize.x * mClientWidth, 0.5f * ndcSize.y * mClientHeight);
+	}
+}
+
+void Game::CullRenderItems()
+{
+	PROFILE_ZONE("Game::CullRenderItems");
+
+	//! All items are tested in one batch against the camera frustum, with their local
+	//! bounds moved to world space first.
+	const size_t count = mAllRitems.size();
+	for (std::vector<float>& component : mCullBounds)
+		component.resize(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		BoundingBox worldBounds;
+		mAllRitems[i]->Bounds.Transform(worldBounds, XMLoadFloat4x4(&mAllRitems[i]->World));
+
+		mCullBounds[0][i] = worldBounds.Center.x;
+		mCullBounds[1][i] = worldBounds.Center.y;
+		mCullBounds[2][i] = worldBounds.Center.z;
+		mCullBounds[3][i] = worldBounds.Extents.x;
+		mCullBounds[4][i] = worldBounds.Extents.y;
+		mCullBounds[5][i] = worldBounds.Extents.z;
+	}
+
+	FrustumCuller::BoxBounds bounds;
+	bounds.CenterX = mCullBounds[0].data();
+	bounds.CenterY = mCullBounds[1].data();
+	bounds.CenterZ = mCullBounds[2].data();
+	bounds.ExtentX = mCullBounds[3].data();
+	bounds.ExtentY = mCullBounds[4].data();
+	bounds.ExtentZ = mCullBounds[5].data();
+	bounds.Count = count;
+
+	mVisibleMask.resize(FrustumCuller::GetMaskWords(count));
+	FrustumCuller::CullBoxes(mCamera.GetFrustum(), bounds, mVisibleMask.data());
+
+	for (size_t i = 0; i < count; ++i)
+		mAllRitems[i]->Visible = mAllRitems[i]->Active && (mVisibleMask[i / 32] & (1u << (i % 32))) != 0;
+}
+
+void Game::UpdateTextureRequests(const GameTimer& gt)
+{
+	PROFILE_ZONE("Game::UpdateTextureRequests");
+
+	for (auto& e : mAllRitems)
+	{
+		//! Off-screen items do not ask for finer mips.
+		if (e->Mat->DiffuseStreamId < 0 || !e->Visible)
+			continue;
+
+		// A texture repeated n times across the item only gets 1/n of the pixels.
+		float screenSize = e->ScreenSize;
+		XMMATRIX texTransform = XMMatrixMultiply(XMLoadFloat4x4(&e->TexTransform), XMLoadFloat4x4(&e->Mat->MatTransform));
+		float repeats = MathHelper::Max(
+			XMVectorGetX(XMVector2Length(texTransform.r[0])),
+			XMVectorGetX(XMVector2Length(texTransform.r[1])));
+		if (repeats > 0.0f)
+			screenSize /= repeats;
+
+		mTextureStreamer.Request((UINT)e->Mat->DiffuseStreamId, screenSize);
+	}
+}
+
+void Game::UpdateTextureStreaming()
+{
+	PROFILE_ZONE("Game::UpdateTextureStreaming");
+
+	// Resources replaced now are still used by the frames in flight, so they are only
+	// released once the fence of the frame being recorded has passed.
+	mTextureStreamBackend->BeginFrame(mCommandList.Get(), mCurrentFence + 1, mFence->GetCompletedValue());
+	mTextureStreamer.Update();
+
+	for (auto& e : mMaterials)
+	{
+		Material* mat = e.second.get();
+		if (mat->DiffuseStreamId >= 0)
+			mat->DiffuseSrvHeapIndex = mTextureStreamBackend->GetSrvHeapIndex((UINT)mat->DiffuseStreamId);
+	}
 }
 
 //step 8
@@ -412,7 +650,7 @@ void Game::LoadTextures()
 	//	mTextures[texMap->Name] = std::move(texMap);
 	//}
 
-	mWorld.loadTextures(md3dDevice, mCommandList, mTextures);
+	mWorld.loadTextures(md3dDevice, mCommandList, mTextures, mTextureStreamer);
 }
 
 void Game::BuildRootSignature()
@@ -430,6 +668,9 @@ void Game::BuildRootSignature()
 	slotRootParameter[2].InitAsConstantBufferView(1);
 	slotRootParameter[3].InitAsConstantBufferView(2);
 
+	//! No layer uses the ShaderVariants::Instancing variants yet.  The one that does needs
+	//! a root SRV for their gInstanceData (t0, space1) here.
+
 	auto staticSamplers = GetStaticSamplers();
 
 	// A root signature is an array of root parameters.
@@ -456,6 +697,8 @@ void Game::BuildRootSignature()
 		serializedRootSig->GetBufferPointer(),
 		serializedRootSig->GetBufferSize(),
 		IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+
+	mRootSignatureHash = Fnv1a(serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize());
 }
 
 //step12
@@ -467,7 +710,7 @@ void Game::BuildDescriptorHeaps()
 	// Create the SRV heap.
 	//
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 3;
+	srvHeapDesc.NumDescriptors = 1 + TextureStreamSrvCount;
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
@@ -477,37 +720,38 @@ void Game::BuildDescriptorHeaps()
 	//
 	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
-	auto EagleTex = mTextures["Eagle"]->Resource;
-	auto RaptorTex = mTextures["Raptor"]->Resource;
-	auto DesertTex = mTextures["Desert"]->Resource;
+	// Eagle and Raptor are only sources for the sprite atlas and get no SRV of their own.
+	auto SpriteAtlasTex = mTextures["SpriteAtlas"]->Resource;
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = EagleTex->GetDesc().Format;
+	srvDesc.Format = SpriteAtlasTex->GetDesc().Format;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = EagleTex->GetDesc().MipLevels;
+	srvDesc.Texture2D.MipLevels = SpriteAtlasTex->GetDesc().MipLevels;
 	srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-	md3dDevice->CreateShaderResourceView(EagleTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = RaptorTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = RaptorTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(RaptorTex.Get(), &srvDesc, hDescriptor);
-
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = DesertTex->GetDesc().Format;
-	srvDesc.Texture2D.MipLevels = DesertTex->GetDesc().MipLevels;
-	md3dDevice->CreateShaderResourceView(DesertTex.Get(), &srvDesc, hDescriptor);
+	md3dDevice->CreateShaderResourceView(SpriteAtlasTex.Get(), &srvDesc, hDescriptor);
 
+	// Streamed textures (the desert) get their SRVs from the streaming backend, which
+	// rewrites them as mips come and go.
+	mTextureStreamBackend = std::make_unique<D3D12TextureStreamBackend>(md3dDevice.Get(),
+		mSrvDescriptorHeap.Get(), 1, TextureStreamSrvCount);
+	mTextureStreamer.SetBackend(mTextureStreamBackend.get());
 }
 
-void Game::BuildShadersAndInputLayout()
+void Game::BuildInputLayout()
 {
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_0");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_0");
+	if (gQuantizedVertices)
+	{
+		//! PackedVertex: the shader dequantises the position and unfolds the normal.
+		mInputLayout =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+		return;
+	}
 
 	mInputLayout =
 	{
@@ -568,59 +812,94 @@ void Game::BuildShapeGeometry()
 	//
 	//mGeometries[geo->Name] = std::move(geo);
 
-	mWorld.buildShapeGeometry(md3dDevice, mCommandList, mGeometries);
+	const UINT vertexStride = gQuantizedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+	mGeometryArena = std::make_unique<GeometryArena>(md3dDevice.Get(), vertexStride,
+		GeometryArenaVertices, GeometryArenaIndices, GeometryArenaWideIndices);
+
+	mWorld.buildShapeGeometry(md3dDevice, mCommandList, mGeometries, *mGeometryArena);
 }
 
 void Game::BuildPSOs()
 {
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
+	mPipelineCache = std::make_unique<PipelineCache>(md3dDevice.Get(), PipelineLibraryPath);
 
-	//
-	// PSO for opaque objects.
-	//
-	ZeroMemory(&opaquePsoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-	opaquePsoDesc.InputLayout = { mInputLayout.data(), (UINT)mInputLayout.size() };
-	opaquePsoDesc.pRootSignature = mRootSignature.Get();
-	opaquePsoDesc.VS =
+	//! The variants of the render layers and of every item that adds features to its layer.
+	std::vector<std::uint32_t> variants = layerShaderVariants();
+	for (int layer = 0; layer < (int)RenderLayer::Count; ++layer)
 	{
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()),
-		mShaders["standardVS"]->GetBufferSize()
+		for (const RenderItem* ri : mRitemLayer[layer])
+			variants.push_back(layerShaderFeatures((RenderLayer)layer) | ri->ShaderFeatures);
+	}
+
+	for (std::uint32_t features : variants)
+	{
+		if (!mPipelines.Contains(features))
+			mPipelines.Add(features, BuildPipeline(features));
+	}
+}
+
+ID3D12PipelineState* Game::BuildPipeline(std::uint32_t features)
+{
+	ShaderVariants::Defines vsDefines;
+	ShaderVariants::Defines psDefines;
+	ShaderVariants::GetVertexShaderDefines(features, vsDefines);
+	ShaderVariants::GetPixelShaderDefines(features, psDefines);
+	ComPtr<ID3DBlob> vs = mShaderCache.Get(L"Shaders\\Default.hlsl", vsDefines.GetMacros(), "VS", "vs_5_0");
+	ComPtr<ID3DBlob> ps = mShaderCache.Get(L"Shaders\\Default.hlsl", psDefines.GetMacros(), "PS", "ps_5_0");
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
+	ZeroMemory(&psoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
+	psoDesc.InputLayout = { mInputLayout.data(), (UINT)mInputLayout.size() };
+	psoDesc.pRootSignature = mRootSignature.Get();
+	psoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(vs->GetBufferPointer()),
+		vs->GetBufferSize()
 	};
-	opaquePsoDesc.PS =
+	psoDesc.PS =
 	{
-		reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()),
-		mShaders["opaquePS"]->GetBufferSize()
+		reinterpret_cast<BYTE*>(ps->GetBufferPointer()),
+		ps->GetBufferSize()
 	};
-	opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-	opaquePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-	opaquePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-	opaquePsoDesc.SampleMask = UINT_MAX;
-	opaquePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	opaquePsoDesc.NumRenderTargets = 1;
-	opaquePsoDesc.RTVFormats[0] = mBackBufferFormat;
-	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
-	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
-	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
-
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC transparentPsoDesc = opaquePsoDesc;
-
-	D3D12_RENDER_TARGET_BLEND_DESC transparencyBlendDesc;
-	transparencyBlendDesc.BlendEnable = true;
-	transparencyBlendDesc.LogicOpEnable = false;
-	transparencyBlendDesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
-	transparencyBlendDesc.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
-	transparencyBlendDesc.BlendOp = D3D12_BLEND_OP_ADD;
-	transparencyBlendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
-	transparencyBlendDesc.DestBlendAlpha = D3D12_BLEND_ZERO;
-	transparencyBlendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
-	transparencyBlendDesc.LogicOp = D3D12_LOGIC_OP_NOOP;
-	transparencyBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
-
-	//transparentPsoDesc.BlendState.AlphaToCoverageEnable = true;
-
-	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&mPSOs["transparent"])));
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = mBackBufferFormat;
+	psoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
+	psoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
+	psoDesc.DSVFormat = mDepthStencilFormat;
+
+	if (features & ShaderVariants::Blend)
+	{
+		D3D12_RENDER_TARGET_BLEND_DESC transparencyBlendDesc;
+		transparencyBlendDesc.BlendEnable = true;
+		transparencyBlendDesc.LogicOpEnable = false;
+		transparencyBlendDesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		transparencyBlendDesc.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+		transparencyBlendDesc.BlendOp = D3D12_BLEND_OP_ADD;
+		transparencyBlendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
+		transparencyBlendDesc.DestBlendAlpha = D3D12_BLEND_ZERO;
+		transparencyBlendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+		transparencyBlendDesc.LogicOp = D3D12_LOGIC_OP_NOOP;
+		transparencyBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+		psoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
+	}
+
+	return mPipelineCache->Get(psoDesc, mRootSignatureHash);
+}
+
+ID3D12PipelineState* Game::RequestPipeline(std::uint32_t features, std::uint32_t fallbackFeatures)
+{
+	ID3D12PipelineState* pso = mPipelineCache->GetAsync(features, [this, features]() { return BuildPipeline(features); });
+	if (pso == nullptr)
+		return mPipelines.Find(fallbackFeatures);
+
+	mPipelines.Add(features, pso);
+	return pso;
 }
 
 void Game::BuildFrameResources()
@@ -667,6 +946,30 @@ void Game::BuildMaterials()
 
 }
 
+void Game::RegisterResources()
+{
+	mMaterialHandles.Clear();
+	for (auto& e : mMaterials)
+		mMaterialHandles.Add(e.first.c_str(), e.second.get());
+
+	mGeometryHandles.Clear();
+	mSubmeshHandles.Clear();
+	for (auto& e : mGeometries)
+	{
+		MeshGeometry* geo = e.second.get();
+		mGeometryHandles.Add(e.first.c_str(), geo);
+
+		for (auto& submesh : geo->DrawArgs)
+			mSubmeshHandles.Add((e.first + "/" + submesh.first).c_str(), GetSubmeshLods(*geo, submesh.first));
+	}
+
+	mSceneResources.Box = mSubmeshHandles.Resolve("boxGeo/box");
+	mSceneResources.TerrainGeo = mGeometryHandles.Resolve("terrainGeo");
+	mSceneResources.Desert = mMaterialHandles.Resolve("Desert");
+	mSceneResources.AircraftSprites[Aircraft::Eagle] = mMaterialHandles.Resolve("Eagle");
+	mSceneResources.AircraftSprites[Aircraft::Raptor] = mMaterialHandles.Resolve("Raptor");
+}
+
 void Game::CreateRenderItem(UINT index, std::string matName, std::string shapeName, XMMATRIX transform = XMMatrixIdentity(), XMMATRIX texScaling = XMMatrixIdentity())
 {
 	//auto renderItem = std::make_unique<RenderItem>();
@@ -754,21 +1057,56 @@ void Game::BuildRenderItems()
 	//	mOpaqueRitems.push_back(e.get());
 }
 
-void Game::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void Game::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems, std::uint32_t layerFeatures)
 {
+	PROFILE_ZONE("Game::DrawRenderItems");
+
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
 	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
 	auto matCB = mCurrFrameResource->MaterialCB->Resource();
 
+	XMMATRIX viewProj = mCamera.GetViewProj();
+
+	// Meshes in the geometry arena share their buffers, so these only change for
+	// geometry that lives outside it.
+	ID3D12Resource* boundVertexBuffer = nullptr;
+	ID3D12Resource* boundIndexBuffer = nullptr;
+
+	//! Items of a layer mostly share its variant, so the pipeline state rarely changes.
+	ID3D12PipelineState* boundPso = nullptr;
+
 	// For each render item...
 	for (size_t i = 0; i < ritems.size(); ++i)
 	{
 		auto ri = ritems[i];
+		if (!ri->Visible)
+			continue;
+
+		//! A variant first needed here is built in the background; until then the item is
+		//! drawn with its layer's variant.
+		std::uint32_t features = layerFeatures | ri->ShaderFeatures;
+		ID3D12PipelineState* pso = mPipelines.Find(features);
+		if (pso == nullptr)
+			pso = RequestPipeline(features, layerFeatures);
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+		if (pso != boundPso)
+		{
+			cmdList->SetPipelineState(pso);
+			boundPso = pso;
+		}
+
+		if (ri->Geo->VertexBufferGPU.Get() != boundVertexBuffer)
+		{
+			cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+			boundVertexBuffer = ri->Geo->VertexBufferGPU.Get();
+		}
+		if (ri->Geo->IndexBufferGPU.Get() != boundIndexBuffer)
+		{
+			cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+			boundIndexBuffer = ri->Geo->IndexBufferGPU.Get();
+		}
 		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
 		//step18
@@ -784,7 +1122,37 @@ void Game::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector
 		cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
 		cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		// Coarsest LOD whose error stays below LodPixelError at the item's current size.
+		UINT indexCount = ri->IndexCount;
+		UINT startIndexLocation = ri->StartIndexLocation;
+		int baseVertexLocation = ri->BaseVertexLocation;
+		const MeshletSet* meshlets = ri->Lods.empty() ? nullptr : ri->Lods[0].Meshlets.get();
+		for (size_t lod = ri->Lods.size(); lod-- > 1; )
+		{
+			if (ri->Lods[lod].LodError * ri->ScreenSize <= LodPixelError)
+			{
+				indexCount = ri->Lods[lod].IndexCount;
+				startIndexLocation = ri->Lods[lod].StartIndexLocation;
+				baseVertexLocation = ri->Lods[lod].BaseVertexLocation;
+				meshlets = ri->Lods[lod].Meshlets.get();
+				break;
+			}
+		}
+
+		if (meshlets == nullptr)
+		{
+			cmdList->DrawIndexedInstanced(indexCount, 1, startIndexLocation, baseVertexLocation, 0);
+			continue;
+		}
+
+		//! Only the meshlets inside the frustum and facing the eye are drawn, one draw per
+		//! run of neighbouring ones.
+		XMFLOAT4X4 worldViewProj;
+		XMStoreFloat4x4(&worldViewProj, XMMatrixMultiply(XMLoadFloat4x4(&ri->World), viewProj));
+		MeshletBuilder::Cull(*meshlets, MeshletBuilder::MakeCullView(worldViewProj), mMeshletRanges);
+
+		for (const MeshletBuilder::IndexRange& range : mMeshletRanges)
+			cmdList->DrawIndexedInstanced(range.IndexCount, 1, startIndexLocation + range.IndexOffset, baseVertexLocation, 0);
 	}
 }
 
@@ -1,5 +1,20 @@
 #include "World.hpp"
 #include "RenderLayer.h"
+#include "ShaderVariants.h"
+#include "../../Common/PipelineCache.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/Camera.h"
+#include "../../Common/D3D12TextureStreamBackend.h"
+
+//! Handles of the resources scene nodes are built from, resolved once after loading so
+//! that building a node looks nothing up by name.
+struct SceneResources
+{
+	SubmeshHandle Box;
+	GeometryHandle TerrainGeo;
+	MaterialHandle Desert;
+	std::array<MaterialHandle, Aircraft::TypeCount> AircraftSprites;
+};
 
 class Game : public D3DApp
 {
@@ -11,11 +26,21 @@ public:
 
 	virtual bool Initialize()override;
 
+	//! Compiles every shader in the manifest into the shader cache; no window or device
+	//! is created.  Returns the number of shaders compiled.
+	static UINT BuildShaderCache();
+
 public:
 	std::vector<RenderItem*>& getItemLayers(RenderLayer renderLayer);
 	std::vector<std::unique_ptr<RenderItem>>& getRenderItems();
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& getGeometries();
-	std::unordered_map<std::string, std::unique_ptr<Material>>& getMaterials();
+	const SceneResources& getSceneResources()const;
+	Material* getMaterial(MaterialHandle handle)const;
+	MeshGeometry* getGeometry(GeometryHandle handle)const;
+	const SubmeshLods& getSubmesh(SubmeshHandle handle)const;
+
+	//! Hashes the name, so only for loading.  Throws if no material has the name.
+	MaterialHandle findMaterial(ResourceName name)const;
+	TextureStreamer& getTextureStreamer();
 
 private:
 	virtual void OnResize()override;
@@ -32,6 +57,10 @@ private:
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
+	void UpdateScreenSizes(const GameTimer& gt);
+	void CullRenderItems();
+	void UpdateTextureRequests(const GameTimer& gt);
+	void UpdateTextureStreaming();
 
 	void LoadTextures();
 
@@ -39,14 +68,26 @@ private:
 
 	void BuildDescriptorHeaps();
 
-	void BuildShadersAndInputLayout();
+	void BuildInputLayout();
 	void BuildShapeGeometry();
 	void BuildPSOs();
+
+	//! Pipeline state of a shader variant, created or loaded by the pipeline cache.  Safe
+	//! to call from the pipeline cache's worker once the game is initialised.
+	ID3D12PipelineState* BuildPipeline(std::uint32_t features);
+
+	//! Pipeline state of a variant without waiting: the one of fallbackFeatures until the
+	//! variant has been built in the background.
+	ID3D12PipelineState* RequestPipeline(std::uint32_t features, std::uint32_t fallbackFeatures);
 	void BuildFrameResources();
 	void BuildMaterials();
+
+	//! Fills the handle tables from mMaterials and mGeometries and resolves mSceneResources.
+	//! Submeshes are registered as "<geometry>/<submesh>".
+	void RegisterResources();
 	void CreateRenderItem(UINT index, std::string matName, std::string geoName, XMMATRIX transform, XMMATRIX texScaling);
 	void BuildRenderItems();
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems, std::uint32_t layerFeatures);
 
 	//step20
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
@@ -60,6 +101,7 @@ private:
 	UINT mCbvSrvDescriptorSize = 0;
 
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
+	std::uint64_t mRootSignatureHash = 0;
 
 	//step11
 	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
@@ -70,11 +112,19 @@ private:
 	//step7
 	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
 
-	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
+	//! Dense handle tables over the resources above; the maps own them.
+	ResourceRegistry<Material*> mMaterialHandles;
+	ResourceRegistry<MeshGeometry*> mGeometryHandles;
+	ResourceRegistry<SubmeshLods> mSubmeshHandles;
+	SceneResources mSceneResources;
+
+	ShaderCache mShaderCache;
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
-	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+	//! One pipeline state per shader variant in use, from mPipelineCache.
+	ShaderVariants mPipelines;
+	std::unique_ptr<PipelineCache> mPipelineCache;
 
 	// List of all the render items.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
@@ -87,8 +137,15 @@ private:
 	PassConstants mMainPassCB;
 
 	XMFLOAT3 mEyePos = { 50.0f, 0.0f, 0.0f };
-	XMFLOAT4X4 mView = MathHelper::Identity4x4();
-	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
+
+	//! Camera versions and render target size mMainPassCB was last built for.
+	std::uint64_t mPassViewVersion = 0;
+	std::uint64_t mPassProjVersion = 0;
+	int mPassClientWidth = 0;
+	int mPassClientHeight = 0;
+
+	//! Incremented whenever mMainPassCB changes; see FrameResource::PassVersion.
+	std::uint64_t mMainPassVersion = 0;
 
 	float mTheta = 1.3f * XM_PI;
 	float mPhi = 0.4f * XM_PI;
@@ -97,6 +154,22 @@ private:
 	POINT mLastMousePos;
 
 	Camera mCamera;
+
+	//! Owns the GPU copies of streamed textures; created with the SRV heap.
+	std::unique_ptr<D3D12TextureStreamBackend> mTextureStreamBackend;
+	TextureStreamer mTextureStreamer;
+
+	//! Shared vertex/index buffers of all meshes.
+	std::unique_ptr<GeometryArena> mGeometryArena;
+
+	//! World space bounds of all render items as structure-of-arrays (center x, y, z,
+	//! extents x, y, z) and their visibility mask, kept to reuse the allocations.
+	std::array<std::vector<float>, 6> mCullBounds;
+	std::vector<std::uint32_t> mVisibleMask;
+
+	//! Visible meshlet ranges of the item being drawn, kept to reuse the allocation.
+	std::vector<MeshletBuilder::IndexRange> mMeshletRanges;
+
 	World mWorld;
 
 
@@ -0,0 +1,49 @@
+#pragma once
+#include "../../Common/MathHelper.h"
+#include <memory>
+#include <vector>
+
+struct ObjectConstants
+{
+    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+	// Box that PackedVertex positions are quantised in (the submesh bounds).
+	DirectX::XMFLOAT4 PosCenter = { 0.0f, 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT4 PosExtents = { 1.0f, 1.0f, 1.0f, 0.0f };
+
+    std::uint32_t MaterialIndex;
+};
+
+// Copies the constants of every item changed in the last gNumFrameResources frames to
+// objectCB, anything with CopyData(int, const ObjectConstants&) like UploadBuffer.
+// Items are RenderItem in the game; only the fields read here are needed, so the
+// benchmarks time this without Direct3D.
+template <typename Item, typename ObjectBuffer>
+void UpdateObjectConstants(const std::vector<std::unique_ptr<Item>>& items, ObjectBuffer& objectCB)
+{
+	using namespace DirectX;
+
+	for (auto& e : items)
+	{
+		// Only update the cbuffer data if the constants have changed.  
+		// This needs to be tracked per frame resource.
+		if (e->NumFramesDirty > 0)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&e->World);
+			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+
+			ObjectConstants objConstants;
+			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+			objConstants.PosCenter = XMFLOAT4(e->Bounds.Center.x, e->Bounds.Center.y, e->Bounds.Center.z, 0.0f);
+			objConstants.PosExtents = XMFLOAT4(e->Bounds.Extents.x, e->Bounds.Extents.y, e->Bounds.Extents.z, 0.0f);
+			objConstants.MaterialIndex = e->Mat->MatCBIndex;
+
+			objectCB.CopyData(e->ObjCBIndex, objConstants);
+
+			// Next FrameResource need to be updated too.
+			e->NumFramesDirty--;
+		}
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "../../Common/d3dApp.h"
+#include "FrameResource.h"
+#include "../../Common/ResourceRegistry.h"
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -29,6 +31,29 @@ struct RenderItem
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 
+	// Local space bounds of the geometry, used to estimate the on-screen size.
+	BoundingBox Bounds;
+
+	// Largest on-screen extent of Bounds this frame, in pixels.
+	float ScreenSize = 0.0f;
+
+	// False when the item's bounds are outside the view frustum this frame, or when the
+	// item is not Active.
+	bool Visible = true;
+
+	// False while the node owning the item is not in the scene, e.g. until its spawn
+	// wave.  Inactive items keep their constant buffer slot but are never drawn.
+	bool Active = true;
+
+	// ShaderVariants features added to those of the item's render layer, e.g.
+	// ShaderVariants::AlphaTest.  Pipeline states are built for the items that exist
+	// when the game initialises, so set this before then.
+	std::uint32_t ShaderFeatures = 0;
+
+	// The submesh drawn at full detail followed by its coarser LODs, if the geometry
+	// has any.  Empty for items that always draw IndexCount/StartIndexLocation.
+	std::vector<SubmeshGeometry> Lods;
+
 	// Primitive topology.
 	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
@@ -36,4 +61,50 @@ struct RenderItem
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
-};
\ No newline at end of file
+};
+
+// A submesh followed by its "<name>_lod1", "<name>_lod2", ... versions, gathered from
+// the geometry's draw args once so that render items can be pointed at it without
+// looking anything up.
+struct SubmeshLods
+{
+	MeshGeometry* Geo = nullptr;
+	std::vector<SubmeshGeometry> Lods;
+};
+
+typedef ResourceRegistry<Material*>::Handle MaterialHandle;
+typedef ResourceRegistry<MeshGeometry*>::Handle GeometryHandle;
+typedef ResourceRegistry<SubmeshLods>::Handle SubmeshHandle;
+
+// Throws std::out_of_range if the geometry has no submesh with the name.
+inline SubmeshLods GetSubmeshLods(MeshGeometry& geo, const std::string& name)
+{
+	auto it = geo.DrawArgs.find(name);
+	if (it == geo.DrawArgs.end())
+		throw std::out_of_range(geo.Name + " has no submesh named " + name);
+
+	SubmeshLods submesh;
+	submesh.Geo = &geo;
+	submesh.Lods.push_back(it->second);
+	for (int lod = 1; ; ++lod)
+	{
+		it = geo.DrawArgs.find(name + "_lod" + std::to_string(lod));
+		if (it == geo.DrawArgs.end())
+			break;
+
+		submesh.Lods.push_back(it->second);
+	}
+	return submesh;
+}
+
+// Points the item at the geometry and submesh, at full detail.
+inline void SetRenderItemSubmesh(RenderItem& ri, const SubmeshLods& submesh)
+{
+	const SubmeshGeometry& full = submesh.Lods.front();
+	ri.Geo = submesh.Geo;
+	ri.IndexCount = full.IndexCount;
+	ri.StartIndexLocation = full.StartIndexLocation;
+	ri.BaseVertexLocation = full.BaseVertexLocation;
+	ri.Bounds = full.Bounds;
+	ri.Lods = submesh.Lods;
+}
@@ -1,14 +1,16 @@
 #include "SceneNode.hpp"
-#include "Game.hpp"
+#include <algorithm>
+#include <cassert>
 
 SceneNode::SceneNode(Game* game)
 	: mChildren()
 	, mParent(nullptr)
 	, game(game)
+	, renderer(nullptr)
 {
-	//mWorldPosition = XMFLOAT3(0, 0, 0);
-	//mWorldScaling = XMFLOAT3(1, 1, 1);
-	//mWorldRotation = XMFLOAT3(0, 0, 0);
+	mWorldPosition = XMFLOAT3(0, 0, 0);
+	mWorldScaling = XMFLOAT3(1, 1, 1);
+	mWorldRotation = XMFLOAT3(0, 0, 0);
 }
 	
 
@@ -87,6 +89,21 @@ SceneNode::SceneNode(Game* game)
 		}
 	}
 
+	void SceneNode::setActive(bool active)
+	{
+		setActiveCurrent(active);
+
+		for (const Ptr& child : mChildren)
+		{
+			child->setActive(active);
+		}
+	}
+
+	void SceneNode::setActiveCurrent(bool active)
+	{
+
+	}
+
 	XMFLOAT3 SceneNode::getWorldPosition() const
 	{
 		return mWorldPosition;
@@ -124,8 +141,9 @@ SceneNode::SceneNode(Game* game)
 
 		for (const SceneNode* node = this; node != nullptr; node = node->mParent)
 		{
-			XMMATRIX Tp = XMLoadFloat4x4(&node->getTransform());
-			T = Tp * T;
+			// Row vectors: the node's own transform applies first, then its parent's.
+			XMFLOAT4X4 local = node->getTransform();
+			T = T * XMLoadFloat4x4(&local);
 		}
 		XMStoreFloat4x4(&transform, T);
 
@@ -133,7 +151,12 @@ SceneNode::SceneNode(Game* game)
 	}
 	XMFLOAT4X4 SceneNode::getTransform() const
 	{
+		XMMATRIX S = XMMatrixScaling(mWorldScaling.x, mWorldScaling.y, mWorldScaling.z);
+		XMMATRIX R = XMMatrixRotationRollPitchYaw(mWorldRotation.x, mWorldRotation.y, mWorldRotation.z);
+		XMMATRIX T = XMMatrixTranslation(mWorldPosition.x, mWorldPosition.y, mWorldPosition.z);
+
 		XMFLOAT4X4 transform;
+		XMStoreFloat4x4(&transform, S * R * T);
 		return transform;
 	}
 
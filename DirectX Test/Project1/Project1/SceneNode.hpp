@@ -1,48 +1,15 @@
 #pragma once
-#include "../../Common/d3dApp.h"
 #include "../../Common/MathHelper.h"
-#include "../../Common/UploadBuffer.h"
-#include "../../Common/GeometryGenerator.h"
-#include "../../Common/Camera.h"
-#include "FrameResource.h"
+#include "../../Common/GameTimer.h"
+#include <memory>
+#include <vector>
 
-using Microsoft::WRL::ComPtr;
 using namespace DirectX;
-using namespace DirectX::PackedVector;
-
-#pragma comment(lib, "d3dcompiler.lib")
-#pragma comment(lib, "D3D12.lib")
-
-struct RenderItem
-{
-	RenderItem() = default;
-
-	XMFLOAT4X4 World = MathHelper::Identity4x4();
-
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-	UINT ObjCBIndex = -1;
-
-	Material* Mat = nullptr;
-	MeshGeometry* Geo = nullptr;
-
-	// Primitive topology.
-	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-	// DrawIndexedInstanced parameters.
-	UINT IndexCount = 0;
-	UINT StartIndexLocation = 0;
-	int BaseVertexLocation = 0;
-};
 
+//! The scene graph itself needs no Direct3D, so that the benchmarks can build it on any
+//! platform; the nodes that draw include RenderItem.h.
 class Game;
+struct RenderItem;
 
 class SceneNode
 {
@@ -59,6 +26,9 @@ public:
 	void draw() const;
 	void build();
 
+	//! Shows or hides the render items of the node and its children.
+	void setActive(bool active);
+
 	XMFLOAT3 getWorldPosition() const;
 	void setPosition(float x, float y, float z);
 	XMFLOAT3 getWorldRotation() const;
@@ -78,6 +48,7 @@ private:
 	void drawChildren() const;
 	virtual void buildCurrent();
 	void buildChildren();
+	virtual void setActiveCurrent(bool active);
 
 protected:
 	Game* game;
@@ -0,0 +1,86 @@
+#include "ShaderVariants.h"
+#include <set>
+
+const D3D_SHADER_MACRO* ShaderVariants::Defines::GetMacros()
+{
+	Macros.clear();
+	for (const auto& value : Values)
+		Macros.push_back({ value.first.c_str(), value.second.c_str() });
+	Macros.push_back({ nullptr, nullptr });
+	return Macros.data();
+}
+
+void ShaderVariants::GetVertexShaderDefines(std::uint32_t features, Defines& defines)
+{
+	defines.Values.clear();
+	if (features & QuantizedVertices)
+		defines.Values.push_back({ "QUANTIZED_VERTICES", "1" });
+	if (features & Instancing)
+		defines.Values.push_back({ "INSTANCING", "1" });
+}
+
+void ShaderVariants::GetPixelShaderDefines(std::uint32_t features, Defines& defines)
+{
+	defines.Values.clear();
+	defines.Values.push_back({ "SAMPLER_MODE", std::to_string((features & SamplerMask) >> SamplerShift) });
+	defines.Values.push_back({ "NUM_DIR_LIGHTS", std::to_string((features >> DirLightsShift) & LightCountMask) });
+	defines.Values.push_back({ "NUM_POINT_LIGHTS", std::to_string((features >> PointLightsShift) & LightCountMask) });
+	defines.Values.push_back({ "NUM_SPOT_LIGHTS", std::to_string((features >> SpotLightsShift) & LightCountMask) });
+	if (features & AlphaTest)
+		defines.Values.push_back({ "ALPHA_TEST", "1" });
+}
+
+std::string ShaderVariants::GetManifest(const std::vector<std::uint32_t>& variants)
+{
+	std::set<std::uint32_t> vertexShaders;
+	std::set<std::uint32_t> pixelShaders;
+	for (std::uint32_t features : variants)
+	{
+		vertexShaders.insert(features & VertexShaderMask);
+		pixelShaders.insert(features & PixelShaderMask);
+	}
+
+	std::string manifest;
+	Defines defines;
+	auto addLine = [&](const char* entrypoint, const char* target)
+	{
+		manifest += std::string("Shaders\\Default.hlsl ") + entrypoint + " " + target;
+		for (const auto& value : defines.Values)
+			manifest += " " + value.first + "=" + value.second;
+		manifest += "\n";
+	};
+
+	for (std::uint32_t features : vertexShaders)
+	{
+		GetVertexShaderDefines(features, defines);
+		addLine("VS", "vs_5_0");
+	}
+	for (std::uint32_t features : pixelShaders)
+	{
+		GetPixelShaderDefines(features, defines);
+		addLine("PS", "ps_5_0");
+	}
+	return manifest;
+}
+
+void ShaderVariants::Add(std::uint32_t features, Microsoft::WRL::ComPtr<ID3D12PipelineState> pso)
+{
+	auto it = std::lower_bound(mFeatures.begin(), mFeatures.end(), features);
+	size_t index = it - mFeatures.begin();
+	if (it != mFeatures.end() && *it == features)
+	{
+		mPipelines[index] = pso;
+		return;
+	}
+
+	mFeatures.insert(it, features);
+	mPipelines.insert(mPipelines.begin() + index, pso);
+}
+
+ID3D12PipelineState* ShaderVariants::Find(std::uint32_t features)const
+{
+	auto it = std::lower_bound(mFeatures.begin(), mFeatures.end(), features);
+	if (it == mFeatures.end() || *it != features)
+		return nullptr;
+	return mPipelines[it - mFeatures.begin()].Get();
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "../../Common/d3dUtil.h"
+
+//! The permutation space of Shaders\Default.hlsl, and the pipeline states built for the
+//! variants in use.
+//!
+//! A variant is a 32-bit feature mask:
+//!   bits 0-2   SamplerMode the diffuse map is sampled with
+//!   bits 3-4   directional lights, 0-3
+//!   bits 5-6   point lights, 0-3
+//!   bits 7-8   spot lights, 0-3
+//!   bit  9     QuantizedVertices
+//!   bit  10    Instancing
+//!   bit  11    AlphaTest
+//!   bit  12    Blend, alpha blending; pipeline state only, the shaders are the same
+//! Each shader stage only gets the defines it reads, so variants that differ in pixel
+//! features share their vertex shader bytecode and the other way round.
+//!
+//! Pipeline states are found with a binary search in a small sorted array, so a draw
+//! that changes variant costs a few comparisons and no hashing or allocation.
+class ShaderVariants
+{
+public:
+	//! Shader register of the static sampler in Game::GetStaticSamplers.
+	enum class SamplerMode : std::uint32_t
+	{
+		PointWrap,
+		PointClamp,
+		LinearWrap,
+		LinearClamp,
+		AnisotropicWrap,
+		AnisotropicClamp
+	};
+
+	static const std::uint32_t SamplerShift = 0;
+	static const std::uint32_t SamplerMask = 0x7u << SamplerShift;
+	static const std::uint32_t DirLightsShift = 3;
+	static const std::uint32_t PointLightsShift = 5;
+	static const std::uint32_t SpotLightsShift = 7;
+	static const std::uint32_t LightCountMask = 0x3;
+	static const std::uint32_t MaxLightsPerType = 3;
+
+	static const std::uint32_t QuantizedVertices = 1u << 9;
+	static const std::uint32_t Instancing = 1u << 10;
+	static const std::uint32_t AlphaTest = 1u << 11;
+	static const std::uint32_t Blend = 1u << 12;
+
+	//! Bits read by each shader stage.
+	static const std::uint32_t VertexShaderMask = QuantizedVertices | Instancing;
+	static const std::uint32_t PixelShaderMask = SamplerMask | (0x3fu << DirLightsShift) | AlphaTest;
+
+	static std::uint32_t Sampler(SamplerMode mode)
+	{
+		return (std::uint32_t)mode << SamplerShift;
+	}
+
+	static std::uint32_t Lights(UINT dirLights, UINT pointLights, UINT spotLights)
+	{
+		assert(dirLights <= MaxLightsPerType && pointLights <= MaxLightsPerType && spotLights <= MaxLightsPerType);
+		return (dirLights << DirLightsShift) | (pointLights << PointLightsShift) | (spotLights << SpotLightsShift);
+	}
+
+	//! Defines of one shader stage of a variant, kept alive for as long as the macros are used.
+	struct Defines
+	{
+		std::vector<std::pair<std::string, std::string>> Values;
+		std::vector<D3D_SHADER_MACRO> Macros;
+
+		//! Null terminated, as D3DCompile expects.
+		const D3D_SHADER_MACRO* GetMacros();
+	};
+
+	static void GetVertexShaderDefines(std::uint32_t features, Defines& defines);
+	static void GetPixelShaderDefines(std::uint32_t features, Defines& defines);
+
+	//! The ShaderCache manifest lines that compile every shader of the variants, each
+	//! shader once.
+	static std::string GetManifest(const std::vector<std::uint32_t>& variants);
+
+public:
+	void Add(std::uint32_t features, Microsoft::WRL::ComPtr<ID3D12PipelineState> pso);
+
+	//! Null if no pipeline state was built for the variant.
+	ID3D12PipelineState* Find(std::uint32_t features)const;
+
+	bool Contains(std::uint32_t features)const { return Find(features) != nullptr; }
+
+	size_t GetCount()const { return mFeatures.size(); }
+
+private:
+	//! Sorted; mPipelines[i] belongs to mFeatures[i].
+	std::vector<std::uint32_t> mFeatures;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12PipelineState>> mPipelines;
+};
@@ -2,6 +2,16 @@
 // Default.hlsl 
 //
 // Default shader, currently supports lighting.
+//
+// Every variant is compiled from this one file; ShaderVariants.h packs the permutation
+// space into a feature mask and turns it into these defines:
+//   SAMPLER_MODE          static sampler the diffuse map is read with, 0-5 (s0-s5)
+//   NUM_DIR_LIGHTS,
+//   NUM_POINT_LIGHTS,
+//   NUM_SPOT_LIGHTS       light counts, 0-3 each
+//   QUANTIZED_VERTICES    PackedVertex input
+//   INSTANCING            world and texture transforms per instance, from gInstanceData
+//   ALPHA_TEST            pixels with alpha below 0.1 are discarded
 //***************************************************************************************
 
 // Defaults for number of lights.
@@ -17,28 +27,47 @@
     #define NUM_SPOT_LIGHTS 0
 #endif
 
+#ifndef SAMPLER_MODE
+    #define SAMPLER_MODE 0
+#endif
+
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
 //step14
 Texture2D    gDiffuseMap : register(t0);
-SamplerState gsamPointWrap : register(s0);
-
-//SamplerState gsamPointWrap : register(s0);
-//SamplerState gsamPointClamp : register(s1);
-//SamplerState gsamLinearWrap : register(s2);
-//SamplerState gsamLinearClamp : register(s3);
-//SamplerState gsamAnisotropicWrap : register(s4);
-//SamplerState gsamAnisotropicClamp : register(s5);
-
-
 
+// The static samplers of the root signature.
+SamplerState gsamPointWrap : register(s0);
+SamplerState gsamPointClamp : register(s1);
+SamplerState gsamLinearWrap : register(s2);
+SamplerState gsamLinearClamp : register(s3);
+SamplerState gsamAnisotropicWrap : register(s4);
+SamplerState gsamAnisotropicClamp : register(s5);
+
+#if SAMPLER_MODE == 0
+    #define gsamDiffuse gsamPointWrap
+#elif SAMPLER_MODE == 1
+    #define gsamDiffuse gsamPointClamp
+#elif SAMPLER_MODE == 2
+    #define gsamDiffuse gsamLinearWrap
+#elif SAMPLER_MODE == 3
+    #define gsamDiffuse gsamLinearClamp
+#elif SAMPLER_MODE == 4
+    #define gsamDiffuse gsamAnisotropicWrap
+#else
+    #define gsamDiffuse gsamAnisotropicClamp
+#endif
 
 // Constant data that varies per object.
 cbuffer cbPerObject : register(b0)
 {
     float4x4 gWorld;
     float4x4 gTexTransform;
+
+    // Box the quantised positions are stored in.
+    float4 gPosCenter;
+    float4 gPosExtents;
 };
 
 // Constant data that varies per frame.
@@ -76,6 +105,38 @@ cbuffer cbMaterial : register(b2)
     float4x4 gMatTransform;
 };
 
+#ifdef INSTANCING
+// Transforms of the instances of one draw, which replace gWorld and gTexTransform.
+struct InstanceData
+{
+    float4x4 World;
+    float4x4 TexTransform;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t0, space1);
+#endif
+
+#ifdef QUANTIZED_VERTICES
+// PackedVertex: R16G16B16A16_UNORM position, R16G16_SNORM octahedral normal,
+// R16G16_FLOAT texture coordinates.
+struct VertexIn
+{
+	float4 PosQ    : POSITION;
+    float2 NormalQ : NORMAL;
+	float2 TexC    : TEXCOORD;
+};
+
+float3 OctahedralDecode(float2 e)
+{
+    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+
+    // Unfold the lower half of the octahedron.
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+
+    return normalize(n);
+}
+#else
 struct VertexIn
 {
 	float3 PosL    : POSITION;
@@ -83,6 +144,7 @@ struct VertexIn
     //step2
 	float2 TexC    : TEXCOORD;
 };
+#endif
 
 struct VertexOut
 {
@@ -93,16 +155,36 @@ struct VertexOut
 	float2 TexC    : TEXCOORD;
 };
 
+#ifdef INSTANCING
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
+#else
 VertexOut VS(VertexIn vin)
+#endif
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+#ifdef INSTANCING
+    float4x4 world = gInstanceData[instanceID].World;
+    float4x4 texTransform = gInstanceData[instanceID].TexTransform;
+#else
+    float4x4 world = gWorld;
+    float4x4 texTransform = gTexTransform;
+#endif
+
+#ifdef QUANTIZED_VERTICES
+    float3 posL = gPosCenter.xyz + (vin.PosQ.xyz * 2.0f - 1.0f) * gPosExtents.xyz;
+    float3 normalL = OctahedralDecode(vin.NormalQ);
+#else
+    float3 posL = vin.PosL;
+    float3 normalL = vin.NormalL;
+#endif
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(posL, 1.0f), world);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(normalL, (float3x3)world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
@@ -114,7 +196,7 @@ VertexOut VS(VertexIn vin)
     //We use two separate texture transformation matrices gTexTransform and gMatTransform .
     //Because sometimes it makes more sense for the material to transform the textures (for animated materials like water), but sometimes it makes more sense for the texture transform to be a property of the object.
 
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
+    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), texTransform);
     vout.TexC = mul(texC, gMatTransform).xy;
 
     return vout;
@@ -125,7 +207,12 @@ float4 PS(VertexOut pin) : SV_Target
     //step17: we add a diffuse albedo texture map to specify the diffuse albedo
     //component of our material
 
-    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamPointWrap, pin.TexC) * gDiffuseAlbedo;
+    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamDiffuse, pin.TexC) * gDiffuseAlbedo;
+
+#ifdef ALPHA_TEST
+    // Discard early, before the lighting is computed.
+    clip(diffuseAlbedo.a - 0.1f);
+#endif
 
     //float diffuseAlbedo2 = float4(0.9f, 0.9f, 1.0f, 1.0f);
     //float4 diffuseAlbedo = gDiffuseMap.Sample(gsamLinear, pin.TexC) * diffuseAlbedo2;
@@ -1,152 +0,0 @@
-//***************************************************************************************
-// Default_Border2.hlsl 
-//
-// Default shader, currently supports lighting.
-//***************************************************************************************
-
-// Defaults for number of lights.
-#ifndef NUM_DIR_LIGHTS
-    #define NUM_DIR_LIGHTS 3
-#endif
-
-#ifndef NUM_POINT_LIGHTS
-    #define NUM_POINT_LIGHTS 0
-#endif
-
-#ifndef NUM_SPOT_LIGHTS
-    #define NUM_SPOT_LIGHTS 0
-#endif
-
-// Include structures and functions for lighting.
-#include "LightingUtil.hlsl"
-
-Texture2D    gDiffuseMap : register(t0);
-
-SamplerState gsamBorder : register(s0);
-
-
-
-// Constant data that varies per object.
-cbuffer cbPerObject : register(b0)
-{
-    float4x4 gWorld;
-    float4x4 gTexTransform;
-};
-
-// Constant data that varies per frame.
-cbuffer cbPass : register(b1)
-{
-    float4x4 gView;
-    float4x4 gInvView;
-    float4x4 gProj;
-    float4x4 gInvProj;
-    float4x4 gViewProj;
-    float4x4 gInvViewProj;
-    float3 gEyePosW;
-    float cbPerObjectPad1;
-    float2 gRenderTargetSize;
-    float2 gInvRenderTargetSize;
-    float gNearZ;
-    float gFarZ;
-    float gTotalTime;
-    float gDeltaTime;
-    float4 gAmbientLight;
-
-    // Indices [0, NUM_DIR_LIGHTS) are directional lights;
-    // indices [NUM_DIR_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHTS) are point lights;
-    // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
-    // are spot lights for a maximum of MaxLights per object.
-    Light gLights[MaxLights];
-};
-
-
-// Constant data that varies per material.
-cbuffer cbMaterial : register(b2)
-{
-	float4 gDiffuseAlbedo;
-    float3 gFresnelR0;
-    float  gRoughness;
-    float4x4 gMatTransform;
-};
-
-struct VertexIn
-{
-	float3 PosL    : POSITION;
-    float3 NormalL : NORMAL;
-    //step2
-	float2 TexC    : TEXCOORD;
-};
-
-struct VertexOut
-{
-	float4 PosH    : SV_POSITION;
-    float3 PosW    : POSITION;
-    float3 NormalW : NORMAL;
-	float2 TexC    : TEXCOORD;
-};
-
-VertexOut VS(VertexIn vin)
-{
-	VertexOut vout = (VertexOut)0.0f;
-	
-    // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
-    vout.PosW = posW.xyz;
-
-    // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
-
-    // Transform to homogeneous clip space.
-    vout.PosH = mul(posW, gViewProj);
-	
-	// Output vertex attributes for interpolation across triangle.
-    //step16
-    float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-    vout.TexC = mul(texC, gMatTransform).xy;
-
-    // Multiplied by 3 to force the texture to wrap, subtract 1 to center the texture
-    //you can do the samething in the application by scaling. Look at inside BuildRenderItem!
-    vout.TexC = vout.TexC * 3.0 - float2(1.0, 1.0);
-
-
-    return vout;
-}
-
-float4 PS(VertexOut pin) : SV_Target
-{
-    //we add a diffuse albedo texture map to specify the diffuse albedo
-    //component of our material
-    //SamplerState gsamPointWrap : register(s0);
-    //SamplerState gsamBorder : register(s1);
-    //SamplerState gsamLinearWrap : register(s2);
-    //SamplerState gsamLinearClamp : register(s3);
-    //SamplerState gsamAnisotropicWrap : register(s4);
-    //SamplerState gsamAnisotropicClamp : register(s5);
-
-    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamBorder, pin.TexC) * gDiffuseAlbedo;
-
-
-    // Interpolating normal can unnormalize it, so renormalize it.
-    pin.NormalW = normalize(pin.NormalW);
-
-    // Vector from point being lit to eye. 
-    float3 toEyeW = normalize(gEyePosW - pin.PosW);
-
-    // Light terms. Note that we are using diffuseAlbedo instead of gDiffuseAlbedo
-    float4 ambient = gAmbientLight*diffuseAlbedo;
-
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
-    float3 shadowFactor = 1.0f;
-    float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
-        pin.NormalW, toEyeW, shadowFactor);
-
-    float4 litColor = ambient + directLight;
-
-    // Common convention to take alpha from diffuse material.
-    litColor.a = diffuseAlbedo.a;
-
-    return litColor;
-}
-
-
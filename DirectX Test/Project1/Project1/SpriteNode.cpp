@@ -8,7 +8,7 @@ SpriteNode::SpriteNode(Game* game) : Entity(game)
 
 void SpriteNode::drawCurrent() const
 {
-	renderer->World = getTransform();
+	renderer->World = getWorldTransform();
 	renderer->NumFramesDirty++;
 }
 
@@ -16,15 +16,13 @@ void SpriteNode::buildCurrent()
 {
 	auto render = std::make_unique<RenderItem>();
 	renderer = render.get();
-	renderer->World = getTransform();
+	renderer->World = getWorldTransform();
 	XMStoreFloat4x4(&renderer->TexTransform, XMMatrixScaling(10.0f, 10.0f, 10.0f));
 	renderer->ObjCBIndex = game->getRenderItems().size();
-	renderer->Mat = game->getMaterials()["Desert"].get();
-	renderer->Geo = game->getGeometries()["boxGeo"].get();
+	const SceneResources& resources = game->getSceneResources();
+	renderer->Mat = game->getMaterial(mMaterial.IsValid() ? mMaterial : resources.Desert);
 	renderer->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	renderer->IndexCount = renderer->Geo->DrawArgs["box"].IndexCount;
-	renderer->StartIndexLocation = renderer->Geo->DrawArgs["box"].StartIndexLocation;
-	renderer->BaseVertexLocation = renderer->Geo->DrawArgs["box"].BaseVertexLocation;
+	SetRenderItemSubmesh(*renderer, game->getSubmesh(resources.Box));
 
 	game->getItemLayers(RenderLayer::Opaque).push_back(render.get());
 	game->getRenderItems().push_back(std::move(render));
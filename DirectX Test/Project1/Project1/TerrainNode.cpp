@@ -0,0 +1,144 @@
+#include "TerrainNode.h"
+#include "Game.hpp"
+#include "RenderLayer.h"
+
+//! Chunks generated per frame once the pool is full.  A new chunk is only needed every
+//! ChunkDepth / scroll speed seconds, so one is plenty.
+static const UINT ChunkBuildsPerFrame = 1;
+
+static ChunkedTerrain::Desc terrainDesc()
+{
+	ChunkedTerrain::Desc desc;
+	desc.ChunkWidth = 10.0f;
+	desc.ChunkDepth = 20.0f;
+	desc.ChunkQuads = 32;
+	desc.ChunkCount = 8;
+	desc.ChunksBehind = 2;
+	return desc;
+}
+
+//! Low dunes running across the level.
+static float duneHeight(float x, float z)
+{
+	return 0.25f * sinf(0.35f * z + 1.7f * sinf(0.21f * x)) + 0.15f * sinf(0.11f * z + 0.3f * x);
+}
+
+TerrainNode::TerrainNode(Game* game, float scrollSpeed) : SceneNode(game)
+, mTerrain(terrainDesc(), duneHeight)
+, mScrollSpeed(scrollSpeed)
+, mScrollPosition(0.0f)
+{
+}
+
+void TerrainNode::updateCurrent(const GameTimer& gt)
+{
+	mScrollPosition += mScrollSpeed * gt.DeltaTime();
+	mTerrain.Update(mScrollPosition, ChunkBuildsPerFrame);
+
+	for (UINT slot = 0; slot < mTerrain.GetSlotCount(); ++slot)
+		placeChunk(slot);
+}
+
+void TerrainNode::buildCurrent()
+{
+	const SceneResources& resources = game->getSceneResources();
+	MeshGeometry* geo = game->getGeometry(resources.TerrainGeo);
+	Material* mat = game->getMaterial(resources.Desert);
+
+	for (UINT slot = 0; slot < mTerrain.GetSlotCount(); ++slot)
+	{
+		auto render = std::make_unique<RenderItem>();
+		XMStoreFloat4x4(&render->TexTransform, XMMatrixScaling(2.0f, 4.0f, 1.0f));
+		render->ObjCBIndex = game->getRenderItems().size();
+		render->Mat = mat;
+		render->Geo = geo;
+		render->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		mChunkItems.push_back(render.get());
+
+		game->getItemLayers(RenderLayer::Opaque).push_back(render.get());
+		game->getRenderItems().push_back(std::move(render));
+	}
+	mChunkMeshes.assign(mTerrain.GetSlotCount(), GeometryArena::InvalidId);
+
+	//! The whole pool is generated up front; its size, not the level length, sets the
+	//! startup cost.
+	mTerrain.Update(mScrollPosition, mTerrain.GetSlotCount());
+	for (UINT slot = 0; slot < mTerrain.GetSlotCount(); ++slot)
+		placeChunk(slot);
+}
+
+void TerrainNode::placeChunk(UINT slot)
+{
+	const ChunkedTerrain::Slot& chunk = mTerrain.GetSlot(slot);
+	RenderItem* ri = mChunkItems[slot];
+
+	if (chunk.Chunk == ChunkedTerrain::NoChunk)
+	{
+		ri->IndexCount = 0;
+		return;
+	}
+
+	//! The grid's up axis is turned towards the camera (-x) like the background wall it
+	//! replaces, and the chunk slides back as the level scrolls.
+	XMFLOAT3 position = getWorldPosition();
+	float z = position.z + mTerrain.GetChunkCenter(chunk.Chunk) - mScrollPosition;
+	XMStoreFloat4x4(&ri->World, XMMatrixRotationZ(XM_PIDIV2) * XMMatrixTranslation(position.x, position.y, z));
+
+	ri->Bounds.Center = chunk.BoundsCenter;
+	ri->Bounds.Extents = chunk.BoundsExtents;
+	ri->NumFramesDirty = gNumFrameResources;
+}
+
+void TerrainNode::uploadChunks(ID3D12GraphicsCommandList* cmdList, GeometryArena& arena)
+{
+	std::vector<Vertex> vertices;
+	std::vector<PackedVertex> packedVertices;
+
+	for (UINT slot = 0; slot < mTerrain.GetSlotCount(); ++slot)
+	{
+		ChunkedTerrain::Slot& chunk = mTerrain.GetSlot(slot);
+		if (chunk.Chunk == ChunkedTerrain::NoChunk)
+			continue;
+
+		if (chunk.Dirty)
+		{
+			//! Same vertex layouts as the box in World::buildBoxMesh.
+			const std::vector<GeometryGenerator::Vertex>& source = chunk.Mesh.Vertices;
+			const void* vertexData = nullptr;
+			if (gQuantizedVertices)
+			{
+				packedVertices.resize(source.size());
+				VertexQuantizer::Encode(source.data(), source.size(),
+					chunk.BoundsCenter, chunk.BoundsExtents, packedVertices.data());
+				vertexData = packedVertices.data();
+			}
+			else
+			{
+				vertices.resize(source.size());
+				for (size_t i = 0; i < source.size(); ++i)
+				{
+					vertices[i].Pos = source[i].Position;
+					vertices[i].Normal = source[i].Normal;
+					vertices[i].TexC = source[i].TexC;
+				}
+				vertexData = vertices.data();
+			}
+
+			//! The recycled chunk's space is reused at once; the arena's copies are ordered
+			//! after the frames still drawing it.
+			arena.Free(mChunkMeshes[slot]);
+			mChunkMeshes[slot] = arena.Allocate(cmdList, vertexData, (UINT)source.size(), chunk.Mesh.Indices32);
+			chunk.Dirty = false;
+		}
+
+		//! Placed every frame, since a compaction may have moved the chunk.
+		SubmeshGeometry local;
+		local.IndexCount = (UINT)chunk.Mesh.Indices32.size();
+		SubmeshGeometry placed = arena.Place(mChunkMeshes[slot], local);
+
+		RenderItem* ri = mChunkItems[slot];
+		ri->IndexCount = placed.IndexCount;
+		ri->StartIndexLocation = placed.StartIndexLocation;
+		ri->BaseVertexLocation = placed.BaseVertexLocation;
+	}
+}
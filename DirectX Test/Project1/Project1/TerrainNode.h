@@ -0,0 +1,31 @@
+#pragma once
+#include "SceneNode.hpp"
+#include "RenderItem.h"
+#include "../../Common/ChunkedTerrain.h"
+#include "../../Common/GeometryArena.h"
+
+//! Scrolling desert floor.  A fixed pool of terrain chunks is recycled along the scroll
+//! direction; each slot of the pool owns one render item.
+class TerrainNode :
+	public SceneNode
+{
+public:
+	TerrainNode(Game* game, float scrollSpeed);
+
+	//! Copies the chunks generated since the last call into the arena and points the
+	//! render items at them.  Called while the frame's command list is recording.
+	void uploadChunks(ID3D12GraphicsCommandList* cmdList, GeometryArena& arena);
+
+private:
+	virtual void updateCurrent(const GameTimer& gt);
+	virtual void buildCurrent();
+
+	void placeChunk(UINT slot);
+
+private:
+	ChunkedTerrain mTerrain;
+	float mScrollSpeed;
+	float mScrollPosition;
+	std::vector<RenderItem*> mChunkItems;
+	std::vector<UINT> mChunkMeshes;
+};
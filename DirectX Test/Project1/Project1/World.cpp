@@ -1,18 +1,67 @@
 #include "World.hpp"
 
+//! Hash of every processing stage and vertex layout a cached mesh went through.  Any
+//! change to one of them gives a new hash and makes the cache rebuild its entries.
+static std::uint64_t meshPipelineHash()
+{
+	const std::uint32_t parts[] =
+	{
+		GeometryGenerator::Version,
+		MeshOptimizer::Version,
+		MeshSimplifier::Version,
+		MeshletBuilder::Version,
+		VertexQuantizer::Version,
+		gQuantizedVertices ? 1u : 0u,
+		(std::uint32_t)sizeof(Vertex),
+		(std::uint32_t)sizeof(PackedVertex),
+		(std::uint32_t)sizeof(Meshlet)
+	};
+	return Fnv1a(parts, sizeof(parts));
+}
+
+//! Everything the box mesh is generated from.  buildBoxMesh reads it and boxMeshKey
+//! hashes it, so changing a value here also rebuilds the cached box.
+static const struct BoxMeshParameters
+{
+	float Width;
+	float Height;
+	float Depth;
+	std::uint32_t Subdivisions;
+	std::vector<float> LodRatios;
+	float LodMaxError;
+} gBoxMesh = { 0.0f, 10.0f, 10.0f, 3, { 0.5f, 0.25f, 0.1f }, 0.05f };
+
+//! Mesh cache key of the box: the CreateBox call followed by the LOD chain settings.
+static std::uint64_t boxMeshKey()
+{
+	std::uint64_t key = MeshCache::Key("CreateBox",
+		{ gBoxMesh.Width, gBoxMesh.Height, gBoxMesh.Depth, (float)gBoxMesh.Subdivisions });
+	key = Fnv1a(gBoxMesh.LodRatios.data(), gBoxMesh.LodRatios.size() * sizeof(float), key);
+	return Fnv1a(&gBoxMesh.LodMaxError, sizeof(gBoxMesh.LodMaxError), key);
+}
+
 World::World(Game* game)
 	: mSceneGraph(new SceneNode(game))
 	, mGame(game)
 	, mPlayerAircraft(nullptr)
-	, mBackground(nullptr)
+	, mTerrain(nullptr)
 	, mWorldBounds(-1.5f, 1.5, 200.0f, 0.0f)
 	, mSpawnPosition(0.f, 0.f)
 	, mScrollSpeed(1.0f)
+	, mMeshCache(L"../../MeshCache", meshPipelineHash())
+	, mNextWave(0)
+	, mLevelTime(0.0f)
 {
 }
 
 void World::update(const GameTimer& gt)
 {
+	PROFILE_ZONE("World::update");
+
+	mLevelTime += gt.DeltaTime();
+	while (mNextWave < mWaves.size() && mWaves[mNextWave].Time <= mLevelTime)
+		spawnWave(mNextWave++);
+
 	mSceneGraph->update(gt);
 }
 
@@ -21,77 +70,243 @@ void World::draw()
 	mSceneGraph->draw();
 }
 
-void World::loadTextures(Microsoft::WRL::ComPtr<ID3D12Device>& GameDevice, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& CommandList, std::unordered_map<std::string, std::unique_ptr<Texture>>& GameTextures)
+void World::loadLevel(const std::wstring& textFile, const std::wstring& levelFile)
 {
-	std::vector<std::string> texNames =
-	{
-		"Eagle",
-		"Raptor",
-		"Desert"
-	};
+	//! Designers edit the text; it is compiled again whenever it is newer than the
+	//! binary, so a shipped game only needs the binary.
+	if (LevelCompiler::IsOutOfDate(textFile, levelFile))
+		LevelCompiler::CompileFile(textFile, levelFile);
+
+	if (!mLevel.Load(levelFile))
+		throw std::runtime_error("World: cannot load level " + std::string(levelFile.begin(), levelFile.end()));
+
+	mScrollSpeed = mLevel.GetHeader().ScrollSpeed;
+}
+
+void World::loadTextures(Microsoft::WRL::ComPtr<ID3D12Device>& GameDevice, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& CommandList, std::unordered_map<std::string, std::unique_ptr<Texture>>& GameTextures, TextureStreamer& Streamer)
+{
+	const LevelHeader& level = mLevel.GetHeader();
+	const LevelTexture* levelTextures = mLevel.GetTextures();
+
+	//! Textures come from the pack built by AssetPacker when it exists, so the level is
+	//! read in one sequential pass.  Loose files are the fallback during development.
+	bool usePack = mAssets.Open(L"../../Textures/Textures.pak");
+	if (usePack)
+		mAssets.Prefetch();
 
-	std::vector<std::wstring> texFilenames =
+	auto findPackEntry = [this](const std::wstring& filename)
 	{
-		L"../../Textures/Eagle.dds",
-		L"../../Textures/Raptor.dds",
-		L"../../Textures/Desert.dds"
+		std::wstring leafName = filename.substr(filename.find_last_of(L"/\\") + 1);
+		return mAssets.Find(std::string(leafName.begin(), leafName.end()));
 	};
 
-	for (int i = 0; i < (int)texNames.size(); ++i)
+	for (UINT i = 0; i < level.TextureCount; ++i)
 	{
+		if (levelTextures[i].Kind != LevelTexture_Sprite)
+			continue;
+
+		std::string filename = mLevel.GetString(levelTextures[i].File);
 		auto texMap = std::make_unique<Texture>();
-		texMap->Name = texNames[i];
-		texMap->Filename = texFilenames[i];
-		ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(GameDevice.Get(),
-			CommandList.Get(), texMap->Filename.c_str(),
-			texMap->Resource, texMap->UploadHeap));
+		texMap->Name = mLevel.GetString(levelTextures[i].Name);
+		texMap->Filename = std::wstring(filename.begin(), filename.end());
+
+		const AssetPackEntry* entry = usePack ? findPackEntry(texMap->Filename) : nullptr;
+
+		if (entry != nullptr && (entry->Flags & AssetPackFlag_Lz4))
+		{
+			//! Compressed entries are decoded straight into the upload buffer, and the GPU
+			//! copies most mips out of it as they are; only the small mips are repacked.
+			Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer;
+			std::uint8_t* ddsData = nullptr;
+			ThrowIfFailed(DirectX::CreateDDSUploadBuffer12(GameDevice.Get(),
+				(size_t)entry->RawSize, uploadBuffer, &ddsData));
+			ThrowIfFailed(mAssets.Decode(*entry, ddsData) ? S_OK : E_FAIL);
+
+			ThrowIfFailed(DirectX::CreateDDSTextureFromUploadBuffer12(GameDevice.Get(),
+				CommandList.Get(), uploadBuffer.Get(), ddsData, (size_t)entry->RawSize,
+				texMap->Resource, texMap->UploadHeap));
+			mTextureUploadBuffers.push_back(uploadBuffer);
+		}
+		else if (entry != nullptr)
+		{
+			ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(GameDevice.Get(),
+				CommandList.Get(), mAssets.GetData(*entry), (size_t)entry->RawSize,
+				texMap->Resource, texMap->UploadHeap));
+		}
+		else
+		{
+			ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(GameDevice.Get(),
+				CommandList.Get(), texMap->Filename.c_str(),
+				texMap->Resource, texMap->UploadHeap));
+		}
 
 		GameTextures[texMap->Name] = std::move(texMap);
 	}
+
+	//! Sprites are packed into one atlas so every sprite material shares a single SRV.
+	for (UINT i = 0; i < level.TextureCount; ++i)
+	{
+		if (levelTextures[i].Kind != LevelTexture_Sprite)
+			continue;
+
+		const char* name = mLevel.GetString(levelTextures[i].Name);
+		D3D12_RESOURCE_DESC desc = GameTextures[name]->Resource->GetDesc();
+		mSpriteAtlas.Add(name, (UINT)desc.Width, desc.Height);
+	}
+	ThrowIfFailed(mSpriteAtlas.Pack() ? S_OK : E_FAIL);
+
+	auto atlasTex = std::make_unique<Texture>();
+	atlasTex->Name = "SpriteAtlas";
+	mSpriteAtlas.BuildResource(GameDevice.Get(), CommandList.Get(), GameTextures, atlasTex->Resource);
+	GameTextures[atlasTex->Name] = std::move(atlasTex);
+
+	//! Large textures are streamed: only their mip tail is loaded at startup and finer mips
+	//! follow as they grow on screen.  The streamer rereads the DDS bytes whenever it
+	//! changes the mips, so they stay mapped in the pack, or in memory when they had to
+	//! be read from a loose file or decompressed.
+	mTextureStreamIds.assign(level.TextureCount, -1);
+	for (UINT i = 0; i < level.TextureCount; ++i)
+	{
+		if (levelTextures[i].Kind != LevelTexture_Streamed)
+			continue;
+
+		std::string name = mLevel.GetString(levelTextures[i].Name);
+		std::string filename = mLevel.GetString(levelTextures[i].File);
+		std::wstring streamedFilename(filename.begin(), filename.end());
+
+		const AssetPackEntry* entry = usePack ? findPackEntry(streamedFilename) : nullptr;
+
+		const std::uint8_t* ddsData = nullptr;
+		size_t ddsSize = 0;
+
+		if (entry != nullptr && (entry->Flags & AssetPackFlag_Lz4) == 0)
+		{
+			ddsData = mAssets.GetData(*entry);
+			ddsSize = (size_t)entry->RawSize;
+		}
+		else
+		{
+			Microsoft::WRL::ComPtr<ID3DBlob> blob;
+			if (entry != nullptr)
+			{
+				ThrowIfFailed(D3DCreateBlob((SIZE_T)entry->RawSize, &blob));
+				ThrowIfFailed(mAssets.Decode(*entry, (std::uint8_t*)blob->GetBufferPointer()) ? S_OK : E_FAIL);
+			}
+			else
+			{
+				blob = d3dUtil::LoadBinary(streamedFilename);
+			}
+
+			ddsData = (const std::uint8_t*)blob->GetBufferPointer();
+			ddsSize = blob->GetBufferSize();
+			mStreamedTextureData.push_back(blob);
+		}
+
+		mTextureStreamIds[i] = (int)Streamer.AddTexture(name, ddsData, ddsSize);
+	}
 }
 
 void World::buildMaterials(std::unordered_map<std::string, std::unique_ptr<Material>>& GameMaterials)
 {
-	auto eagle = std::make_unique<Material>();
-	eagle->Name = "Eagle";
-	eagle->MatCBIndex = 0;
-	//! We add an index to our material definition, which references an SRV in the descriptor
-	//! heap specifying the texture associated with the material :
-	eagle->DiffuseSrvHeapIndex = 0;
-	eagle->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	eagle->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	eagle->Roughness = 0.2f;
-
-	auto raptor = std::make_unique<Material>();
-	raptor->Name = "Raptor";
-	raptor->MatCBIndex = 1;
-	raptor->DiffuseSrvHeapIndex = 1;
-	raptor->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	raptor->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	raptor->Roughness = 0.2f;
-
-	auto desert = std::make_unique<Material>();
-	desert->Name = "Desert";
-	desert->MatCBIndex = 2;
-	desert->DiffuseSrvHeapIndex = 2;
-	desert->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	desert->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	desert->Roughness = 0.2f;
-
-	GameMaterials["Eagle"] = std::move(eagle);
-	GameMaterials["Raptor"] = std::move(raptor);
-	GameMaterials["Desert"] = std::move(desert);
+	const LevelMaterial* levelMaterials = mLevel.GetMaterials();
+	for (UINT i = 0; i < mLevel.GetHeader().MaterialCount; ++i)
+	{
+		const LevelMaterial& record = levelMaterials[i];
+		const LevelTexture& texture = mLevel.GetTextures()[record.Texture];
+
+		auto material = std::make_unique<Material>();
+		material->Name = mLevel.GetString(record.Name);
+		material->MatCBIndex = (int)i;
+		if (texture.Kind == LevelTexture_Streamed)
+		{
+			//! The SRV of a streamed texture moves as mips come and go.  Game refreshes
+			//! DiffuseSrvHeapIndex from the streamer every frame.
+			material->DiffuseStreamId = mTextureStreamIds[record.Texture];
+		}
+		else
+		{
+			//! Sprites all point at the atlas and select their image through MatTransform.
+			material->DiffuseSrvHeapIndex = 0;
+			material->MatTransform = mSpriteAtlas.GetMatTransform(mLevel.GetString(texture.Name));
+		}
+		material->DiffuseAlbedo = record.DiffuseAlbedo;
+		material->FresnelR0 = record.FresnelR0;
+		material->Roughness = record.Roughness;
+
+		GameMaterials[material->Name] = std::move(material);
+	}
 }
 
-void World::buildShapeGeometry(Microsoft::WRL::ComPtr<ID3D12Device>& GameDevice, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& CommandList, std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& GameGeometries)
+void World::buildShapeGeometry(Microsoft::WRL::ComPtr<ID3D12Device>& GameDevice, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& CommandList, std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& GameGeometries, GeometryArena& Arena)
+{
+	//! The processed box comes from the mesh cache when an earlier run left it there, so
+	//! only a cold start pays for generating, optimising and simplifying it.
+	const std::uint64_t boxKey = boxMeshKey();
+
+	MeshCache::Mesh box;
+	if (!mMeshCache.Load(boxKey, box))
+	{
+		box = buildBoxMesh();
+		mMeshCache.Store(boxKey, box);
+	}
+
+	auto geo = std::make_unique<MeshGeometry>();
+	geo->Name = "boxGeo";
+	geo->VertexBufferCPU = box.VertexData;
+	geo->IndexBufferCPU = box.IndexData;
+
+	// The GPU copy lives in the shared arena; the draw args get its global offsets so all
+	// meshes draw from one vertex/index buffer binding.  The render items and submesh
+	// handles copy those offsets once, so the box is pinned where compaction won't move it.
+	// A box of more than 65536 vertices draws from the arena's 32-bit index buffer.
+	UINT meshId = Arena.Allocate(CommandList.Get(), box.VertexData->GetBufferPointer(), box.GetVertexCount(),
+		box.IndexData->GetBufferPointer(), box.GetIndexCount(), box.IndexFormat, true);
+	Arena.Bind(*geo, Arena.GetIndexFormat(meshId));
+
+	for (const MeshCache::NamedSubmesh& submesh : box.Submeshes)
+		geo->DrawArgs[submesh.Name] = Arena.Place(meshId, submesh.Submesh);
+
+	GameGeometries[geo->Name] = std::move(geo);
+
+	//! Terrain chunks are streamed into the arena while the level scrolls, so their
+	//! geometry only carries the arena's buffers and has no draw args of its own.  The
+	//! chunks are small grids, always drawn with 16-bit indices.
+	auto terrainGeo = std::make_unique<MeshGeometry>();
+	terrainGeo->Name = "terrainGeo";
+	Arena.Bind(*terrainGeo);
+	GameGeometries[terrainGeo->Name] = std::move(terrainGeo);
+}
+
+MeshCache::Mesh World::buildBoxMesh()
 {
 	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(0.0f, 10.0f, 10.0f, 3);
+	GeometryGenerator::MeshData box = geoGen.CreateBox(gBoxMesh.Width, gBoxMesh.Height, gBoxMesh.Depth, gBoxMesh.Subdivisions);
+
+	// Full detail is split into meshlets so the parts facing away or off screen can be
+	// skipped.  Building them regroups the triangles, so the box is only put in cache
+	// order beforehand, to keep neighbouring meshlets close, and each meshlet is then
+	// optimised on its own.  Renumbering the vertices last leaves both orders intact.
+	// The box is convex, so its front faces never overlap and it has no overdraw to sort.
+	MeshOptimizer::OptimizeVertexCache(box.Indices32, (UINT)box.Vertices.size());
+	auto boxMeshlets = std::make_shared<MeshletSet>(MeshletBuilder::Build(box.Indices32, box.Vertices));
+	for (const Meshlet& meshlet : boxMeshlets->Meshlets)
+		MeshOptimizer::OptimizeVertexCacheRange(box.Indices32, meshlet.IndexOffset, meshlet.IndexCount);
+	MeshOptimizer::OptimizeVertexFetch(box);
+
+	// Coarser versions of the box for distant items.  They index the same vertices and
+	// are appended to the index buffer as "box_lod1", "box_lod2", ...
+	std::vector<MeshSimplifier::Lod> boxLods = MeshSimplifier::BuildLodChain(box, gBoxMesh.LodRatios, gBoxMesh.LodMaxError);
+	for (MeshSimplifier::Lod& lod : boxLods)
+	{
+		MeshOptimizer::OptimizeVertexCache(lod.Indices, (UINT)box.Vertices.size());
+		MeshOptimizer::OptimizeOverdraw(lod.Indices, box.Vertices);
+	}
 
 	SubmeshGeometry boxSubmesh;
 	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
 	boxSubmesh.StartIndexLocation = 0;
 	boxSubmesh.BaseVertexLocation = 0;
+	boxSubmesh.Meshlets = boxMeshlets;
 
 
 	std::vector<Vertex> vertices(box.Vertices.size());
@@ -103,64 +318,178 @@ void World::buildShapeGeometry(Microsoft::WRL::ComPtr<ID3D12Device>& GameDevice,
 		vertices[i].TexC = box.Vertices[i].TexC;
 	}
 
-	std::vector<std::uint16_t> indices = box.GetIndices16();
+	BoundingBox::CreateFromPoints(boxSubmesh.Bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex));
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	MeshCache::Mesh mesh;
+	mesh.Submeshes.push_back({ "box", boxSubmesh });
 
-	auto geo = std::make_unique<MeshGeometry>();
-	geo->Name = "boxGeo";
+	std::vector<std::uint32_t> indices = box.Indices32;
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	for (size_t i = 0; i < boxLods.size(); ++i)
+	{
+		const MeshSimplifier::Lod& lod = boxLods[i];
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+		SubmeshGeometry lodSubmesh = boxSubmesh;
+		lodSubmesh.IndexCount = (UINT)lod.Indices.size();
+		lodSubmesh.StartIndexLocation = (UINT)indices.size();
+		lodSubmesh.LodError = lod.Error;
+		lodSubmesh.Meshlets = nullptr;
+		mesh.Submeshes.push_back({ "box_lod" + std::to_string(i + 1), lodSubmesh });
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(GameDevice.Get(),
-		CommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+		indices.insert(indices.end(), lod.Indices.begin(), lod.Indices.end());
+	}
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(GameDevice.Get(),
-		CommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	// The compact layout quantises positions inside the submesh bounds; the shader gets
+	// them back from the object constants of each render item.
+	std::vector<PackedVertex> packedVertices;
+	if (gQuantizedVertices)
+	{
+		packedVertices.resize(box.Vertices.size());
+		VertexQuantizer::Encode(box.Vertices.data(), box.Vertices.size(),
+			boxSubmesh.Bounds.Center, boxSubmesh.Bounds.Extents, packedVertices.data());
+	}
 
-	geo->VertexByteStride = sizeof(Vertex);
-	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
+	const void* vertexData = gQuantizedVertices ? (const void*)packedVertices.data() : (const void*)vertices.data();
+	mesh.VertexByteStride = gQuantizedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
 
-	geo->DrawArgs["box"] = boxSubmesh;
+	const UINT vbByteSize = (UINT)vertices.size() * mesh.VertexByteStride;
 
-	GameGeometries[geo->Name] = std::move(geo);
+	// System memory copy of the indices, 16-bit when the vertex count allows it.
+	std::vector<std::uint8_t> indexBytes;
+	mesh.IndexFormat = PackIndices(indices, vertices.size(), indexBytes);
+	const UINT ibByteSize = (UINT)indexBytes.size();
+
+	ThrowIfFailed(D3DCreateBlob(vbByteSize, &mesh.VertexData));
+	CopyMemory(mesh.VertexData->GetBufferPointer(), vertexData, vbByteSize);
+
+	ThrowIfFailed(D3DCreateBlob(ibByteSize, &mesh.IndexData));
+	CopyMemory(mesh.IndexData->GetBufferPointer(), indexBytes.data(), ibByteSize);
+
+	return mesh;
 }
 
 void World::buildScene()
 {
-	std::unique_ptr<Aircraft> player(new Aircraft(Aircraft::Eagle, mGame));
-	mPlayerAircraft = player.get();
-	mPlayerAircraft->setPosition(0, 10.0, 0.0);
-	mPlayerAircraft->setScale(3.0, 3.0, 3.0);
-	//mPlayerAircraft->setVeloctiy(mScrollSpeed, 0.0, 0.0);
-	mSceneGraph->attachChild(std::move(player));
-
-	std::unique_ptr<Aircraft> enemy1(new Aircraft(Aircraft::Raptor, mGame));
-	auto raptor = enemy1.get();
-	raptor->setPosition(0.5, 0, 1);
-	raptor->setScale(1.0, 1.0, 1.0);
-	raptor->setWorldRotation(0, XM_PI, 0);
-	mSceneGraph->attachChild(std::move(enemy1));
-
-	std::unique_ptr<Aircraft> enemy2(new Aircraft(Aircraft::Raptor, mGame));
-	auto raptor2 = enemy2.get();
-	raptor2->setPosition(0.5, 0, 1);
-	raptor2->setScale(1.0, 1.0, 1.0);
-	raptor2->setWorldRotation(0, XM_PI, 0);
-	mSceneGraph->attachChild(std::move(enemy2));
-
-	std::unique_ptr<SpriteNode> backgroundSprite(new SpriteNode(mGame));
-	mBackground = backgroundSprite.get();
-	mBackground->setPosition(1.0, 6.0, 6.0);
-	mBackground->setScale(10.0, 1.0, 200.0);
-	mSceneGraph->attachChild(std::move(backgroundSprite));
+	const LevelHeader& level = mLevel.GetHeader();
+	const LevelNode* records = mLevel.GetNodes();
+	const LevelWave* waves = mLevel.GetWaves();
+
+	//! Every node of the level, waves included, is created in one pass over the records
+	//! and built now, so their render items and constant buffer slots exist from the
+	//! start and spawning a wave only attaches and shows it.
+	std::vector<SceneNode*> nodes(level.NodeCount, nullptr);
+	mWaves.clear();
+	mWaves.resize(level.WaveCount);
+	for (UINT w = 0; w < level.WaveCount; ++w)
+		mWaves[w].Time = waves[w].Time;
+	mNextWave = 0;
+	mLevelTime = 0.0f;
+
+	mGame->getRenderItems().reserve(mGame->getRenderItems().size() + level.NodeCount);
+
+	//! Material overrides are resolved once per level material, not per node.
+	std::vector<MaterialHandle> materials(level.MaterialCount);
+	for (UINT i = 0; i < level.MaterialCount; ++i)
+		materials[i] = mGame->findMaterial(mLevel.GetString(mLevel.GetMaterials()[i].Name));
+
+	for (UINT i = 0; i < level.NodeCount; ++i)
+	{
+		const LevelNode& record = records[i];
+		SceneNode::Ptr node = createNode(record, record.Material != LevelNoIndex ? materials[record.Material] : MaterialHandle());
+		nodes[i] = node.get();
+
+		if (record.Parent != LevelNoIndex)
+			nodes[record.Parent]->attachChild(std::move(node));
+		else if (record.Wave != LevelNoIndex)
+			mWaves[record.Wave].Roots.push_back(std::move(node));
+		else
+			mSceneGraph->attachChild(std::move(node));
+	}
 
 	mSceneGraph->build();
+	for (SpawnWave& wave : mWaves)
+	{
+		for (SceneNode::Ptr& root : wave.Roots)
+		{
+			root->build();
+			root->setActive(false);
+		}
+	}
+}
+
+SceneNode::Ptr World::createNode(const LevelNode& record, MaterialHandle material)
+{
+	SceneNode::Ptr node;
+	switch (record.TypeId)
+	{
+	case ResourceId("Aircraft"):
+	{
+		Aircraft::Type type = Aircraft::Eagle;
+		switch (record.VariantId)
+		{
+		case ResourceId(""):
+		case ResourceId("Eagle"):
+			type = Aircraft::Eagle;
+			break;
+		case ResourceId("Raptor"):
+			type = Aircraft::Raptor;
+			break;
+		default:
+			throw std::runtime_error(std::string("World: unknown aircraft ") + mLevel.GetString(record.Variant));
+		}
+
+		std::unique_ptr<Aircraft> aircraft(new Aircraft(type, mGame));
+		aircraft->setMaterial(material);
+		if (mPlayerAircraft == nullptr && mLevel.GetString(record.Name) == std::string("player"))
+			mPlayerAircraft = aircraft.get();
+		node = std::move(aircraft);
+		break;
+	}
+	case ResourceId("Sprite"):
+	{
+		std::unique_ptr<SpriteNode> sprite(new SpriteNode(mGame));
+		sprite->setMaterial(material);
+		node = std::move(sprite);
+		break;
+	}
+	case ResourceId("Terrain"):
+	{
+		//! The background streams in chunk by chunk along the scroll instead of being one
+		//! box as long as the level.  The world streams a single terrain, present from the
+		//! start since its chunk items are not hidden with the node.
+		if (mTerrain != nullptr || record.Wave != LevelNoIndex)
+			throw std::runtime_error("World: a level has one terrain, present from the start");
+
+		std::unique_ptr<TerrainNode> terrain(new TerrainNode(mGame, mScrollSpeed));
+		mTerrain = terrain.get();
+		node = std::move(terrain);
+		break;
+	}
+	case ResourceId("Node"):
+		node.reset(new SceneNode(mGame));
+		break;
+	default:
+		throw std::runtime_error(std::string("World: unknown node type ") + mLevel.GetString(record.Type));
+	}
+
+	node->setPosition(record.Position.x, record.Position.y, record.Position.z);
+	node->setWorldRotation(record.Rotation.x, record.Rotation.y, record.Rotation.z);
+	node->setScale(record.Scale.x, record.Scale.y, record.Scale.z);
+	return node;
+}
+
+void World::spawnWave(size_t wave)
+{
+	for (SceneNode::Ptr& root : mWaves[wave].Roots)
+	{
+		root->setActive(true);
+		mSceneGraph->attachChild(std::move(root));
+	}
+	mWaves[wave].Roots.clear();
+}
+
+void World::streamTerrain(ID3D12GraphicsCommandList* CommandList, GeometryArena& Arena)
+{
+	if (mTerrain != nullptr)
+		mTerrain->uploadChunks(CommandList, Arena);
 }
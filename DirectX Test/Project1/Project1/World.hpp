@@ -2,7 +2,18 @@
 #include "SceneNode.hpp"
 #include "Aircraft.hpp"
 #include "SpriteNode.h"
+#include "TerrainNode.h"
 #include "RenderLayer.h"
+#include "../../Common/TextureAtlas.h"
+#include "../../Common/AssetPack.h"
+#include "../../Common/TextureStreamer.h"
+#include "../../Common/MeshOptimizer.h"
+#include "../../Common/MeshSimplifier.h"
+#include "../../Common/VertexQuantizer.h"
+#include "../../Common/GeometryArena.h"
+#include "../../Common/MeshletBuilder.h"
+#include "../../Common/MeshCache.h"
+#include "../../Common/LevelFile.h"
 
 class World
 {
@@ -11,15 +22,24 @@ public:
 	void update(const GameTimer& gt);
 	void draw();
 
+	//! Loads the compiled level, compiling the text first when it is newer.  Throws if
+	//! the text has errors or no valid level can be read.
+	void loadLevel(const std::wstring& textFile, const std::wstring& levelFile);
+
 	void loadTextures(Microsoft::WRL::ComPtr<ID3D12Device>& GameDevice,
 		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& CommandList,
-		std::unordered_map<std::string, std::unique_ptr<Texture>>& GameTextures);
+		std::unordered_map<std::string, std::unique_ptr<Texture>>& GameTextures,
+		TextureStreamer& Streamer);
 	void buildMaterials(std::unordered_map<std::string, std::unique_ptr<Material>>& GameMaterials);
 	void buildShapeGeometry(Microsoft::WRL::ComPtr<ID3D12Device>& GameDevice,
 		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>& CommandList,
-		std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& GameGeometries);
+		std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& GameGeometries,
+		GeometryArena& Arena);
 	void buildScene();
 
+	//! Uploads the terrain chunks generated this frame into the arena.
+	void streamTerrain(ID3D12GraphicsCommandList* CommandList, GeometryArena& Arena);
+
 //public:
 //	enum RenderLayer
 //	{
@@ -28,13 +48,45 @@ public:
 //		Count
 //	};
 
+private:
+	//! Generates and processes the box and its LODs into the form the mesh cache stores.
+	MeshCache::Mesh buildBoxMesh();
+
+	//! The scene node of a level node record, with its transform set.  An invalid
+	//! material keeps the default of the node type.
+	SceneNode::Ptr createNode(const LevelNode& record, MaterialHandle material);
+
+	//! Attaches the nodes of the wave to the scene and shows them.
+	void spawnWave(size_t wave);
+
+	//! Top level nodes of a wave, built with the rest of the level and attached to the
+	//! scene graph when the wave's time comes.
+	struct SpawnWave
+	{
+		float Time = 0.0f;
+		std::vector<SceneNode::Ptr> Roots;
+	};
+
 private:
 	Game* mGame;
 	SceneNode* mSceneGraph;
 	std::array<SceneNode*, RenderLayer::Count> mSceneLayers;
 	Aircraft* mPlayerAircraft;
-	SpriteNode* mBackground;
+	TerrainNode* mTerrain;
 	XMFLOAT4 mWorldBounds;
 	XMFLOAT2 mSpawnPosition;
 	float mScrollSpeed;
+	TextureAtlas mSpriteAtlas;
+	AssetPack mAssets;
+	//! Upload buffers the compressed sprites were decoded into.  The load command list
+	//! copies from them, so they live as long as the textures' own upload heaps.
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> mTextureUploadBuffers;
+	std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> mStreamedTextureData;
+	//! TextureStreamer id of each level texture, or -1 for sprites.
+	std::vector<int> mTextureStreamIds;
+	MeshCache mMeshCache;
+	LevelFile mLevel;
+	std::vector<SpawnWave> mWaves;
+	size_t mNextWave;
+	float mLevelTime;
 };
\ No newline at end of file
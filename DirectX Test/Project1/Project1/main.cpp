@@ -10,6 +10,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 
     try
     {
+        // Fill the shader cache from the manifest and exit, e.g. after a build.
+        if (strstr(cmdLine, "-buildshadercache") != nullptr)
+        {
+            Game::BuildShaderCache();
+            return 0;
+        }
+
         Game theApp(hInstance);
         if (!theApp.Initialize())
             return 0;
@@ -21,4 +28,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
         MessageBox(nullptr, e.ToString().c_str(), L"HR Failed", MB_OK);
         return 0;
     }
+    catch (std::exception& e)
+    {
+        MessageBoxA(nullptr, e.what(), "Error", MB_OK);
+        return 0;
+    }
 }
\ No newline at end of file
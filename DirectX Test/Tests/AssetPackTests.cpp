@@ -0,0 +1,178 @@
+//***************************************************************************************
+// AssetPackTests.cpp
+//
+// Writes a small pack, checks that it reads back, then damages copies of it and checks
+// that AssetPack::Open rejects every one instead of reading past the file.
+//***************************************************************************************
+
+#include "../Common/AssetPack.h"
+#include "../Common/ResourceRegistry.h"
+#include "Check.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+
+namespace
+{
+	const wchar_t* PackFile = L"AssetPackTests.pak";
+	const wchar_t* DamagedFile = L"AssetPackTests.damaged.pak";
+
+	std::vector<std::uint8_t> ReadFile(const char* path)
+	{
+		std::ifstream fin(path, std::ios::binary);
+		return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	void WriteFile(const char* path, const std::vector<std::uint8_t>& data)
+	{
+		std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+		fout.write((const char*)data.data(), data.size());
+	}
+
+	// Writes a modified copy of the pack and reports whether it opens.
+	bool OpensAfter(const std::vector<std::uint8_t>& pack, const std::function<void(std::vector<std::uint8_t>&)>& damage)
+	{
+		std::vector<std::uint8_t> copy = pack;
+		damage(copy);
+		WriteFile("AssetPackTests.damaged.pak", copy);
+
+		AssetPack damaged;
+		return damaged.Open(DamagedFile);
+	}
+
+	AssetPackEntry& EntryAt(std::vector<std::uint8_t>& pack, std::uint32_t index)
+	{
+		const AssetPackHeader* header = (const AssetPackHeader*)pack.data();
+		return ((AssetPackEntry*)(pack.data() + header->TocOffset))[index];
+	}
+
+	AssetPackChunkHeader& ChunksOf(std::vector<std::uint8_t>& pack, std::uint32_t index)
+	{
+		return *(AssetPackChunkHeader*)(pack.data() + EntryAt(pack, index).Offset);
+	}
+}
+
+int main()
+{
+	// A raw entry, a compressed entry of three chunks and an empty entry.
+	std::mt19937 random(7);
+	std::vector<std::uint8_t> noise(10000);
+	for (std::uint8_t& b : noise)
+		b = (std::uint8_t)random();
+
+	std::vector<std::uint8_t> text(2 * AssetPack::ChunkSize + 1000);
+	for (size_t i = 0; i < text.size(); ++i)
+		text[i] = (std::uint8_t)("the quick brown fox "[i % 20] + (i / 4096) % 3);
+
+	AssetPackBuilder builder;
+	builder.AddMemory("Textures\\Noise.dds", noise);
+	builder.AddMemory("levels/text.lvl", text, true);
+	builder.AddMemory("empty", std::vector<std::uint8_t>());
+	CHECK(builder.Write(PackFile));
+
+	//
+	// The intact pack reads back.
+	//
+
+	std::uint32_t noiseIndex = 0;
+	std::uint32_t textIndex = 0;
+	{
+		AssetPack pack;
+		CHECK(pack.Open(PackFile));
+		CHECK(pack.GetEntryCount() == 3);
+
+		const AssetPackEntry* noiseEntry = pack.Find("textures/noise.DDS");
+		const AssetPackEntry* textEntry = pack.Find("levels\\text.lvl");
+		CHECK(noiseEntry != nullptr && textEntry != nullptr && pack.Find("missing") == nullptr);
+		if (noiseEntry == nullptr || textEntry == nullptr)
+			return 1;
+
+		CHECK(noiseEntry->Flags == AssetPackFlag_None);
+		CHECK(textEntry->Flags == AssetPackFlag_Lz4);
+		CHECK(pack.GetName(*textEntry) == "levels/text.lvl");
+
+		// Level files name resources with ResourceId, packs with HashName; they must agree.
+		CHECK(textEntry->NameHash == ResourceId("levels/text.lvl"));
+		CHECK(AssetPack::HashName("") == ResourceId(""));
+
+		std::vector<std::uint8_t> decoded(noiseEntry->RawSize);
+		CHECK(pack.Decode(*noiseEntry, decoded.data()) && decoded == noise);
+
+		// The first compressed entry starts the worker threads; the later ones reuse them.
+		for (int i = 0; i < 3; ++i)
+		{
+			decoded.assign(textEntry->RawSize, 0);
+			CHECK(pack.Decode(*textEntry, decoded.data()) && decoded == text);
+		}
+
+		noiseIndex = (std::uint32_t)(noiseEntry - pack.GetEntries());
+		textIndex = (std::uint32_t)(textEntry - pack.GetEntries());
+	}
+
+	const std::vector<std::uint8_t> pack = ReadFile("AssetPackTests.pak");
+	CHECK(OpensAfter(pack, [](std::vector<std::uint8_t>&) {}));
+
+	//
+	// Truncated packs.
+	//
+
+	const AssetPackHeader header = *(const AssetPackHeader*)pack.data();
+	const std::uint64_t cuts[] =
+	{
+		0, sizeof(AssetPackHeader) - 1, header.TocOffset + sizeof(AssetPackEntry),
+		header.SlotOffset + 2, header.DataOffset, pack.size() - 1,
+	};
+	for (std::uint64_t cut : cuts)
+	{
+		CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { p.resize((size_t)cut); }));
+	}
+
+	//
+	// Corrupt headers and entries.
+	//
+
+	CHECK(!OpensAfter(pack, [](std::vector<std::uint8_t>& p) { ((AssetPackHeader*)p.data())->Magic ^= 1; }));
+	CHECK(!OpensAfter(pack, [](std::vector<std::uint8_t>& p) { ((AssetPackHeader*)p.data())->EntryCount = 0x10000000; }));
+	CHECK(!OpensAfter(pack, [](std::vector<std::uint8_t>& p) { ((AssetPackHeader*)p.data())->TocOffset = ~0ull - 8; }));
+	CHECK(!OpensAfter(pack, [](std::vector<std::uint8_t>& p) { ((AssetPackHeader*)p.data())->DataSize += 1; }));
+
+	// Payload past the end of the file, or wrapping around.
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { EntryAt(p, noiseIndex).Offset = p.size() - 100; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { EntryAt(p, noiseIndex).Offset = ~0ull - 100; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { EntryAt(p, noiseIndex).StoredSize = ~0ull; }));
+
+	// Name outside the name table, or not terminated before the payloads.
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { EntryAt(p, noiseIndex).NameOffset = 0x7fffffff; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p)
+	{
+		const AssetPackHeader* h = (const AssetPackHeader*)p.data();
+		memset(p.data() + h->NameOffset, 'x', (size_t)(h->DataOffset - h->NameOffset));
+	}));
+
+	// Uncompressed entries must decode to exactly what is stored.
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { EntryAt(p, noiseIndex).RawSize += 1; }));
+
+	// Chunk tables that disagree with the entry or run past the payload.
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { ChunksOf(p, textIndex).ChunkCount += 1; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { ChunksOf(p, textIndex).ChunkCount = 0x40000000; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { ChunksOf(p, textIndex).ChunkSize = 0; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { EntryAt(p, textIndex).RawSize *= 2; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p) { EntryAt(p, textIndex).StoredSize = 4; }));
+	CHECK(!OpensAfter(pack, [&](std::vector<std::uint8_t>& p)
+	{
+		std::uint32_t* storedSizes = (std::uint32_t*)(&ChunksOf(p, textIndex) + 1);
+		storedSizes[1] = 0x7fffffff;
+	}));
+
+	std::remove("AssetPackTests.pak");
+	std::remove("AssetPackTests.damaged.pak");
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("AssetPackTests passed\n");
+	return 0;
+}
@@ -0,0 +1,191 @@
+//***************************************************************************************
+// BatchMathTests.cpp
+//
+// Runs every BatchMath kernel on the same seeded inputs on each path this machine
+// supports and compares the results with the scalar path: SSE2 bit for bit, AVX2 and
+// AVX-512 within the rounding that fused multiply-add changes.  The counts cover every
+// tail that does not fill a 4, 8 or 16 float register.  The scalar AngleFromXY is
+// checked against MathHelper::AngleFromXY within the documented accuracy.
+//***************************************************************************************
+
+#include "../Common/BatchMath.h"
+#include "../Common/MathHelper.h"
+#include "Check.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::vector<float> Floats;
+
+	Floats Random(size_t count, float low, float high, std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> dist(low, high);
+		Floats values(count);
+		for (float& v : values)
+			v = dist(rng);
+		return values;
+	}
+
+	struct Float3s
+	{
+		Floats X, Y, Z;
+
+		explicit Float3s(size_t count) : X(count), Y(count), Z(count) {}
+
+		BatchMath::Float3Array Array()
+		{
+			BatchMath::Float3Array a;
+			a.X = X.data();
+			a.Y = Y.data();
+			a.Z = Z.data();
+			return a;
+		}
+	};
+
+	// Results of all kernels on one path.
+	struct Results
+	{
+		Float3s Points, Vectors, Normals;
+		Floats Lerped, MultiplyAdded, Clamped, Angles;
+
+		explicit Results(size_t count)
+			: Points(count), Vectors(count), Normals(count)
+			, Lerped(count), MultiplyAdded(count), Clamped(count), Angles(count) {}
+	};
+
+	struct Inputs
+	{
+		Floats X, Y, Z, A, B;
+		XMFLOAT4X4 M;
+	};
+
+	Inputs MakeInputs(size_t count, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		Inputs in;
+		in.X = Random(count, -10.0f, 10.0f, rng);
+		in.Y = Random(count, -10.0f, 10.0f, rng);
+		in.Z = Random(count, -10.0f, 10.0f, rng);
+		in.A = Random(count, -10.0f, 10.0f, rng);
+		in.B = Random(count, -10.0f, 10.0f, rng);
+
+		// Zero vectors and points on the axes, where Normalize and AngleFromXY have
+		// special cases.
+		for (size_t i = 0; i < count; i += 5)
+		{
+			in.X[i] = 0.0f;
+			if (i % 2 == 0)
+				in.Y[i] = 0.0f;
+			if (i % 3 == 0)
+				in.Z[i] = 0.0f;
+		}
+
+		Floats m = Random(16, -2.0f, 2.0f, rng);
+		std::memcpy(&in.M, m.data(), sizeof(in.M));
+		return in;
+	}
+
+	Results Run(const Inputs& in, BatchMath::Path path)
+	{
+		const size_t count = in.X.size();
+		const BatchMath::ConstFloat3Array xyz(in.X.data(), in.Y.data(), in.Z.data());
+
+		Results r(count);
+		BatchMath::TransformPoints(in.M, xyz, r.Points.Array(), count, path);
+		BatchMath::TransformVectors(in.M, xyz, r.Vectors.Array(), count, path);
+		BatchMath::Normalize(xyz, r.Normals.Array(), count, path);
+		BatchMath::Lerp(in.A.data(), in.B.data(), 0.3f, r.Lerped.data(), count, path);
+		BatchMath::MultiplyAdd(in.A.data(), in.B.data(), 0.016f, r.MultiplyAdded.data(), count, path);
+		BatchMath::Clamp(in.A.data(), -2.5f, 4.0f, r.Clamped.data(), count, path);
+		BatchMath::AngleFromXY(in.X.data(), in.Y.data(), r.Angles.data(), count, path);
+		return r;
+	}
+
+	// tolerance 0 asks for the same bits.
+	bool Close(const Floats& a, const Floats& b, float tolerance)
+	{
+		if (tolerance == 0.0f)
+			return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (!(std::fabs(a[i] - b[i]) <= tolerance * MathHelper::Max(1.0f, std::fabs(b[i]))))
+				return false;
+		}
+		return true;
+	}
+
+	bool Close(const Float3s& a, const Float3s& b, float tolerance)
+	{
+		return Close(a.X, b.X, tolerance) && Close(a.Y, b.Y, tolerance) && Close(a.Z, b.Z, tolerance);
+	}
+
+	void Compare(const Results& a, const Results& b, float tolerance)
+	{
+		// The transforms add terms up to about 60, so their rounding is absolute.
+		CHECK(Close(a.Points, b.Points, 8.0f * tolerance));
+		CHECK(Close(a.Vectors, b.Vectors, 8.0f * tolerance));
+		CHECK(Close(a.Normals, b.Normals, tolerance));
+		CHECK(Close(a.Lerped, b.Lerped, tolerance));
+		CHECK(Close(a.MultiplyAdded, b.MultiplyAdded, tolerance));
+		CHECK(Close(a.Clamped, b.Clamped, 0.0f));
+		CHECK(Close(a.Angles, b.Angles, tolerance));
+	}
+
+	// Distance between two angles, either way round the circle.
+	float AngleDistance(float a, float b)
+	{
+		float d = std::fabs(a - b);
+		return MathHelper::Min(d, 2.0f * MathHelper::Pi - d);
+	}
+}
+
+int main()
+{
+	// Every tail length of the widest register, and longer runs.
+	std::vector<size_t> counts;
+	for (size_t count = 0; count <= 40; ++count)
+		counts.push_back(count);
+	counts.push_back(1000);
+	counts.push_back(1007);
+	counts.push_back(1039);
+
+	for (size_t count : counts)
+	{
+		const Inputs in = MakeInputs(count, (unsigned)count + 7);
+		const Results scalar = Run(in, BatchMath::Path::Scalar);
+
+		// Paths this machine lacks fall back to the best one it has, so compare them
+		// with the tolerance of the fused paths unless SSE2 is all there is.
+		const bool fused = BatchMath::GetBestPath() > BatchMath::Path::Sse2;
+		Compare(Run(in, BatchMath::Path::Sse2), scalar, 0.0f);
+		Compare(Run(in, BatchMath::Path::Avx2), scalar, fused ? 1e-6f : 0.0f);
+		Compare(Run(in, BatchMath::Path::Avx512), scalar, fused ? 1e-6f : 0.0f);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float length = std::sqrt(scalar.Normals.X[i] * scalar.Normals.X[i] +
+				scalar.Normals.Y[i] * scalar.Normals.Y[i] + scalar.Normals.Z[i] * scalar.Normals.Z[i]);
+			const bool zero = in.X[i] == 0.0f && in.Y[i] == 0.0f && in.Z[i] == 0.0f;
+			CHECK(zero ? length == 0.0f : std::fabs(length - 1.0f) < 1e-6f);
+
+			CHECK(scalar.Angles[i] >= 0.0f && scalar.Angles[i] < 2.0f * MathHelper::Pi);
+			if (in.X[i] == 0.0f && in.Y[i] == 0.0f)
+				CHECK(scalar.Angles[i] == 0.0f);
+			else
+				CHECK(AngleDistance(scalar.Angles[i], MathHelper::AngleFromXY(in.X[i], in.Y[i])) < 4e-6f);
+		}
+	}
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("BatchMathTests passed\n");
+	return 0;
+}
@@ -0,0 +1,29 @@
+//***************************************************************************************
+// Check.h
+//
+// The one assertion the tests use: CHECK reports a failed expression with its file and
+// line and lets the test carry on, and main returns CheckFailures() != 0 so that ctest
+// sees the failure.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+
+inline int& CheckFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline bool CheckImpl(bool condition, const char* expression, const char* file, int line)
+{
+	if (!condition)
+	{
+		std::printf("%s(%d): failed: %s\n", file, line, expression);
+		++CheckFailures();
+	}
+	return condition;
+}
+
+#define CHECK(expression) CheckImpl((expression), #expression, __FILE__, __LINE__)
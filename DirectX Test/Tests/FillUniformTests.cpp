@@ -0,0 +1,82 @@
+//***************************************************************************************
+// FillUniformTests.cpp
+//
+// Fills arrays from two RandomEngines with the same seed, one through FillUniform and
+// one through FillUniformScalar, and checks that the floats match bit for bit.  The
+// counts include every tail that does not fill a four-float step, and the calls are
+// chained so that the streams must also advance the same way after a partial step.
+//***************************************************************************************
+
+#include "../Common/MathHelper.h"
+#include "Check.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	bool SameBits(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+	}
+
+	bool InUnitRange(const std::vector<float>& values)
+	{
+		for (float v : values)
+		{
+			if (!(v >= 0.0f && v < 1.0f))
+				return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	const std::uint64_t seeds[] = { 0, 1, 12345, 0xffffffffffffffffull };
+
+	for (std::uint64_t seed : seeds)
+	{
+		RandomEngine simd(seed);
+		RandomEngine scalar(seed);
+
+		// One call per count, so every count starts from where the last one left the
+		// streams.
+		for (size_t count = 0; count <= 37; ++count)
+		{
+			std::vector<float> a(count);
+			std::vector<float> b(count);
+			simd.FillUniform(a.data(), count);
+			scalar.FillUniformScalar(b.data(), count);
+			CHECK(SameBits(a, b));
+			CHECK(InUnitRange(a));
+		}
+
+		std::vector<float> a(1003);
+		std::vector<float> b(1003);
+		simd.FillUniform(a.data(), a.size());
+		scalar.FillUniformScalar(b.data(), b.size());
+		CHECK(SameBits(a, b));
+		CHECK(InUnitRange(a));
+
+		// The wide streams are independent of Next.
+		CHECK(simd.Next() == scalar.Next());
+	}
+
+	// Different seeds give different numbers.
+	{
+		RandomEngine a(1);
+		RandomEngine b(2);
+		std::vector<float> va(16);
+		std::vector<float> vb(16);
+		a.FillUniform(va.data(), va.size());
+		b.FillUniform(vb.data(), vb.size());
+		CHECK(!SameBits(va, vb));
+	}
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("FillUniformTests passed\n");
+	return 0;
+}
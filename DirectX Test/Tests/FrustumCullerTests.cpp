@@ -0,0 +1,177 @@
+//***************************************************************************************
+// FrustumCullerTests.cpp
+//
+// Culls the same random spheres and boxes on every path this machine supports and
+// checks that the SSE2 and AVX masks match the scalar one bit for bit, for counts that
+// fill whole registers and for those that leave a tail of 1 to 7 bounds.  The scalar
+// path is checked against Frustum::IntersectsSphere and IntersectsBox in turn.
+//***************************************************************************************
+
+#include "../Common/FrustumCuller.h"
+#include "Check.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Perspective projection as XMMatrixPerspectiveFovLH builds it, with the eye at the
+	// origin looking down +z.
+	Frustum MakeFrustum()
+	{
+		const float fovY = 0.25f * 3.14159265f;
+		const float aspect = 16.0f / 9.0f;
+		const float nearZ = 1.0f;
+		const float farZ = 100.0f;
+
+		const float yScale = 1.0f / std::tan(0.5f * fovY);
+		const float xScale = yScale / aspect;
+		const float range = farZ / (farZ - nearZ);
+
+		XMFLOAT4X4 proj;
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				proj.m[r][c] = 0.0f;
+		proj.m[0][0] = xScale;
+		proj.m[1][1] = yScale;
+		proj.m[2][2] = range;
+		proj.m[2][3] = 1.0f;
+		proj.m[3][2] = -range * nearZ;
+
+		return Frustum::FromViewProj(proj);
+	}
+
+	struct Bounds
+	{
+		std::vector<float> CenterX, CenterY, CenterZ;
+		std::vector<float> ExtentX, ExtentY, ExtentZ;
+		std::vector<float> Radius;
+	};
+
+	// Bounds around the frustum, many of them straddling a plane.
+	Bounds MakeBounds(size_t count, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> xy(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> z(-10.0f, 110.0f);
+		std::uniform_real_distribution<float> size(0.0f, 8.0f);
+
+		Bounds b;
+		for (size_t i = 0; i < count; ++i)
+		{
+			b.CenterX.push_back(xy(rng));
+			b.CenterY.push_back(xy(rng));
+			b.CenterZ.push_back(z(rng));
+			b.ExtentX.push_back(size(rng));
+			b.ExtentY.push_back(size(rng));
+			b.ExtentZ.push_back(size(rng));
+			b.Radius.push_back(size(rng));
+		}
+		return b;
+	}
+
+	FrustumCuller::SphereBounds Spheres(const Bounds& b)
+	{
+		FrustumCuller::SphereBounds s;
+		s.CenterX = b.CenterX.data();
+		s.CenterY = b.CenterY.data();
+		s.CenterZ = b.CenterZ.data();
+		s.Radius = b.Radius.data();
+		s.Count = b.CenterX.size();
+		return s;
+	}
+
+	FrustumCuller::BoxBounds Boxes(const Bounds& b)
+	{
+		FrustumCuller::BoxBounds x;
+		x.CenterX = b.CenterX.data();
+		x.CenterY = b.CenterY.data();
+		x.CenterZ = b.CenterZ.data();
+		x.ExtentX = b.ExtentX.data();
+		x.ExtentY = b.ExtentY.data();
+		x.ExtentZ = b.ExtentZ.data();
+		x.Count = b.CenterX.size();
+		return x;
+	}
+
+	bool Visible(const std::vector<std::uint32_t>& mask, size_t i)
+	{
+		return (mask[i / 32] >> (i % 32) & 1) != 0;
+	}
+}
+
+int main()
+{
+	const Frustum frustum = MakeFrustum();
+
+	std::vector<FrustumCuller::Path> paths;
+	paths.push_back(FrustumCuller::Path::Sse2);
+	paths.push_back(FrustumCuller::Path::Avx);
+
+	// Every tail length of both register widths, and longer runs.
+	std::vector<size_t> counts;
+	for (size_t count = 0; count <= 40; ++count)
+		counts.push_back(count);
+	counts.push_back(1000);
+	counts.push_back(1003);
+	counts.push_back(1031);
+
+	size_t total = 0;
+	size_t visibleTotal = 0;
+	for (size_t count : counts)
+	{
+		const Bounds b = MakeBounds(count, (unsigned)count + 1);
+		const size_t words = FrustumCuller::GetMaskWords(count);
+
+		// 0xcd fill shows whether the unused bits of the last word are cleared.
+		std::vector<std::uint32_t> scalarSpheres(words, 0xcdcdcdcd);
+		std::vector<std::uint32_t> scalarBoxes(words, 0xcdcdcdcd);
+		const size_t sphereCount = FrustumCuller::CullSpheres(frustum, Spheres(b), scalarSpheres.data(), FrustumCuller::Path::Scalar);
+		const size_t boxCount = FrustumCuller::CullBoxes(frustum, Boxes(b), scalarBoxes.data(), FrustumCuller::Path::Scalar);
+		total += count;
+		visibleTotal += sphereCount;
+
+		size_t expectedSpheres = 0;
+		size_t expectedBoxes = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const bool sphere = frustum.IntersectsSphere(XMFLOAT3(b.CenterX[i], b.CenterY[i], b.CenterZ[i]), b.Radius[i]);
+			const bool box = frustum.IntersectsBox(XMFLOAT3(b.CenterX[i], b.CenterY[i], b.CenterZ[i]),
+				XMFLOAT3(b.ExtentX[i], b.ExtentY[i], b.ExtentZ[i]));
+			CHECK(Visible(scalarSpheres, i) == sphere);
+			CHECK(Visible(scalarBoxes, i) == box);
+			expectedSpheres += sphere ? 1 : 0;
+			expectedBoxes += box ? 1 : 0;
+		}
+		CHECK(sphereCount == expectedSpheres);
+		CHECK(boxCount == expectedBoxes);
+		if (count % 32 != 0)
+		{
+			CHECK(scalarSpheres.back() >> (count % 32) == 0);
+			CHECK(scalarBoxes.back() >> (count % 32) == 0);
+		}
+
+		// Paths this machine lacks fall back to the best one it has.
+		for (FrustumCuller::Path path : paths)
+		{
+			std::vector<std::uint32_t> spheres(words, 0xcdcdcdcd);
+			std::vector<std::uint32_t> boxes(words, 0xcdcdcdcd);
+			CHECK(FrustumCuller::CullSpheres(frustum, Spheres(b), spheres.data(), path) == sphereCount);
+			CHECK(FrustumCuller::CullBoxes(frustum, Boxes(b), boxes.data(), path) == boxCount);
+			CHECK(spheres == scalarSpheres);
+			CHECK(boxes == scalarBoxes);
+		}
+	}
+
+	// The bounds straddle the frustum, so some must be culled and some kept.
+	CHECK(visibleTotal > 0 && visibleTotal < total);
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("FrustumCullerTests passed\n");
+	return 0;
+}
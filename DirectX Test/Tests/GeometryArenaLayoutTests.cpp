@@ -0,0 +1,222 @@
+//***************************************************************************************
+// GeometryArenaLayoutTests.cpp
+//
+// Allocates, frees and compacts meshes in a GeometryArenaLayout and checks the free
+// lists, which meshes compaction moves and the offsets Place gives before and after,
+// including a pinned mesh that compaction has to leave where it is and meshes of more
+// than 65536 vertices, whose indices go to the 32-bit range.
+//***************************************************************************************
+
+#include "../Common/GeometryArenaLayout.h"
+#include "Check.h"
+#include <cstdio>
+
+namespace
+{
+	typedef GeometryArenaLayout::Range Range;
+
+	// Place of a submesh that starts at the mesh's first index and vertex.
+	void PlaceOrigin(const GeometryArenaLayout& layout, std::uint32_t id, std::uint32_t& start, std::int32_t& base)
+	{
+		start = 0;
+		base = 0;
+		layout.Place(id, start, base);
+	}
+
+	bool Moved(const std::vector<GeometryArenaLayout::Move>& moves, std::uint32_t id)
+	{
+		for (const GeometryArenaLayout::Move& move : moves)
+		{
+			if (move.Id == id)
+				return true;
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	//
+	// Free list: first fit, merging on free.
+	//
+
+	{
+		GeometryArenaLayout::FreeList list(100);
+		std::uint32_t a = 0, b = 0, c = 0;
+		CHECK(list.Allocate(30, a) && a == 0);
+		CHECK(list.Allocate(30, b) && b == 30);
+		CHECK(list.Allocate(30, c) && c == 60);
+		CHECK(list.GetFreeCount() == 10 && list.GetLargestFreeRange() == 10);
+		CHECK(!list.Allocate(11, a));
+
+		list.Free(b, 30);
+		CHECK(list.GetFreeCount() == 40 && list.GetLargestFreeRange() == 30);
+
+		// Freeing the neighbours merges all three ranges and the tail into one.
+		list.Free(a, 30);
+		list.Free(c, 30);
+		CHECK(list.GetFreeCount() == 100 && list.GetLargestFreeRange() == 100);
+
+		// Reset with used ranges leaves the gaps between them free.
+		Range used[2];
+		used[0].Offset = 10;
+		used[0].Count = 20;
+		used[1].Offset = 50;
+		used[1].Count = 10;
+		list.Reset(std::vector<Range>(used, used + 2));
+		CHECK(list.GetFreeCount() == 70 && list.GetLargestFreeRange() == 40);
+		CHECK(list.Allocate(10, a) && a == 0);
+		CHECK(list.Allocate(20, a) && a == 30);
+		CHECK(list.Allocate(40, a) && a == 60);
+	}
+
+	//
+	// Compaction slides meshes to the front and Place follows them.
+	//
+
+	{
+		GeometryArenaLayout layout(100, 300);
+		std::uint32_t a = 0, b = 0, c = 0, d = 0;
+		CHECK(layout.Allocate(20, 60, false, a));
+		CHECK(layout.Allocate(30, 90, false, b));
+		CHECK(layout.Allocate(10, 30, false, c));
+		CHECK(layout.Allocate(20, 60, false, d));
+		CHECK(layout.GetMeshCount() == 4);
+
+		std::uint32_t start = 0;
+		std::int32_t base = 0;
+		PlaceOrigin(layout, c, start, base);
+		CHECK(start == 150 && base == 50);
+
+		// A submesh keeps its offsets within the mesh.
+		start = 6;
+		base = 2;
+		layout.Place(c, start, base);
+		CHECK(start == 156 && base == 52);
+
+		// Nothing to close yet.
+		CHECK(layout.Compact().empty());
+		CHECK(layout.GetVersion() == 0);
+
+		// 40 vertices are free, but in pieces of 20 and 20.
+		layout.Free(a);
+		CHECK(layout.GetMeshCount() == 3);
+		std::uint32_t e = 0;
+		CHECK(!layout.Allocate(40, 60, false, e));
+		CHECK(layout.FitsAfterCompact(40, 60));
+		CHECK(!layout.FitsAfterCompact(41, 60));
+
+		std::vector<GeometryArenaLayout::Move> moves = layout.Compact();
+		CHECK(moves.size() == 3 && Moved(moves, b) && Moved(moves, c) && Moved(moves, d));
+		CHECK(layout.GetVersion() == 1);
+		for (const GeometryArenaLayout::Move& move : moves)
+		{
+			CHECK(move.OldVertices.Count == move.NewVertices.Count);
+			CHECK(move.OldIndices.Count == move.NewIndices.Count);
+			CHECK(move.NewVertices.Offset < move.OldVertices.Offset);
+		}
+
+		PlaceOrigin(layout, b, start, base);
+		CHECK(start == 0 && base == 0);
+		PlaceOrigin(layout, c, start, base);
+		CHECK(start == 90 && base == 30);
+		PlaceOrigin(layout, d, start, base);
+		CHECK(start == 120 && base == 40);
+
+		CHECK(layout.Allocate(40, 60, false, e));
+		CHECK(e == a);
+		PlaceOrigin(layout, e, start, base);
+		CHECK(start == 180 && base == 60);
+		CHECK(layout.GetFreeVertices().GetFreeCount() == 0);
+	}
+
+	//
+	// Pinned meshes stay put and split the free space.
+	//
+
+	{
+		GeometryArenaLayout layout(50, 50);
+		std::uint32_t x = 0, p = 0, y = 0, z = 0;
+		CHECK(layout.Allocate(10, 10, false, x));
+		CHECK(layout.Allocate(10, 10, true, p));
+		CHECK(layout.Allocate(10, 10, false, y));
+		CHECK(layout.Allocate(10, 10, false, z));
+		CHECK(layout.IsPinned(p) && !layout.IsPinned(z));
+
+		layout.Free(x);
+		layout.Free(y);
+
+		// Free: [0, 10), [20, 30), [40, 50).  Sliding z next to p leaves [0, 10) and
+		// [30, 50); the pinned mesh keeps 25 from fitting although 30 are free.
+		std::uint32_t e = 0;
+		CHECK(!layout.Allocate(15, 15, false, e));
+		CHECK(layout.FitsAfterCompact(20, 20));
+		CHECK(!layout.FitsAfterCompact(25, 25));
+
+		std::vector<GeometryArenaLayout::Move> moves = layout.Compact();
+		CHECK(moves.size() == 1 && Moved(moves, z) && !Moved(moves, p));
+
+		std::uint32_t start = 0;
+		std::int32_t base = 0;
+		PlaceOrigin(layout, p, start, base);
+		CHECK(start == 10 && base == 10);
+		PlaceOrigin(layout, z, start, base);
+		CHECK(start == 20 && base == 20);
+
+		CHECK(layout.Allocate(15, 15, false, e));
+		PlaceOrigin(layout, e, start, base);
+		CHECK(start == 30 && base == 30);
+
+		// A mesh that only fits in front of the pinned one goes there.
+		std::uint32_t f = 0;
+		CHECK(layout.Allocate(10, 10, false, f));
+		PlaceOrigin(layout, f, start, base);
+		CHECK(start == 0 && base == 0);
+	}
+
+	//
+	// Meshes of more than 65536 vertices take 32-bit indices.
+	//
+
+	{
+		const std::uint32_t large = GeometryArenaLayout::MaxNarrowVertices + 1;
+		GeometryArenaLayout layout(3 * large, 300, 300);
+		std::uint32_t small = 0, wide = 0, wide2 = 0;
+		CHECK(layout.Allocate(100, 60, false, small));
+		CHECK(layout.Allocate(large, 90, false, wide));
+		CHECK(layout.Allocate(large, 30, false, wide2));
+		CHECK(!layout.IsWide(small) && layout.IsWide(wide) && layout.IsWide(wide2));
+		CHECK(layout.GetFreeIndices().GetFreeCount() == 240);
+		CHECK(layout.GetFreeWideIndices().GetFreeCount() == 180);
+
+		// The vertices are shared; the indices start over in their own range.
+		std::uint32_t start = 0;
+		std::int32_t base = 0;
+		PlaceOrigin(layout, wide, start, base);
+		CHECK(start == 0 && base == 100);
+		PlaceOrigin(layout, wide2, start, base);
+		CHECK(start == 90 && base == (std::int32_t)(100 + large));
+
+		// Without a 32-bit range there is no room for them at all.
+		GeometryArenaLayout narrow(3 * large, 300);
+		std::uint32_t e = 0;
+		CHECK(!narrow.Allocate(large, 30, false, e));
+		CHECK(!narrow.FitsAfterCompact(large, 30));
+
+		// Compaction moves each mesh's indices within their own range.
+		layout.Free(small);
+		layout.Free(wide);
+		std::vector<GeometryArenaLayout::Move> moves = layout.Compact();
+		CHECK(moves.size() == 1 && moves[0].Id == wide2 && moves[0].Wide);
+		PlaceOrigin(layout, wide2, start, base);
+		CHECK(start == 0 && base == 0);
+		CHECK(layout.GetFreeWideIndices().GetFreeCount() == 270);
+		CHECK(layout.GetFreeIndices().GetFreeCount() == 300);
+	}
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("GeometryArenaLayoutTests passed\n");
+	return 0;
+}
@@ -0,0 +1,137 @@
+//***************************************************************************************
+// IndexPackingTests.cpp
+//
+// Packs the indices of a small mesh and of one with more than 65536 vertices, checks
+// that they come out as R16_UINT and R32_UINT with the same values, and that an index
+// past the last vertex throws in both formats, from PackIndices and CheckIndices.
+//***************************************************************************************
+
+#include "../Common/IndexPacking.h"
+#include "Check.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	// A strip of triangles over vertexCount vertices, ending on the last one.
+	std::vector<std::uint32_t> MakeIndices(std::uint32_t vertexCount)
+	{
+		std::vector<std::uint32_t> indices;
+		for (std::uint32_t v = 0; v + 2 < vertexCount; ++v)
+		{
+			indices.push_back(v);
+			indices.push_back(v + 1);
+			indices.push_back(v + 2);
+		}
+		return indices;
+	}
+
+	template <typename T>
+	bool SameValues(const std::vector<std::uint32_t>& indices, const std::vector<std::uint8_t>& bytes)
+	{
+		if (bytes.size() != indices.size() * sizeof(T))
+			return false;
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			T value;
+			std::memcpy(&value, bytes.data() + i * sizeof(T), sizeof(T));
+			if (value != indices[i])
+				return false;
+		}
+		return true;
+	}
+
+	bool PackThrows(const std::vector<std::uint32_t>& indices, size_t vertexCount)
+	{
+		std::vector<std::uint8_t> bytes;
+		try
+		{
+			PackIndices(indices, vertexCount, bytes);
+		}
+		catch (std::out_of_range&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	bool CheckThrows(const std::vector<std::uint8_t>& bytes, DXGI_FORMAT format, size_t vertexCount)
+	{
+		try
+		{
+			CheckIndices(bytes.data(), bytes.size() / IndexByteSize(format), format, vertexCount);
+		}
+		catch (std::out_of_range&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	CHECK(NarrowestIndexFormat(0) == DXGI_FORMAT_R16_UINT);
+	CHECK(NarrowestIndexFormat(65536) == DXGI_FORMAT_R16_UINT);
+	CHECK(NarrowestIndexFormat(65537) == DXGI_FORMAT_R32_UINT);
+	CHECK(IndexByteSize(DXGI_FORMAT_R16_UINT) == 2 && IndexByteSize(DXGI_FORMAT_R32_UINT) == 4);
+
+	//
+	// Up to 65536 vertices: 16-bit.
+	//
+
+	{
+		const std::uint32_t vertexCount = 65536;
+		std::vector<std::uint32_t> indices = MakeIndices(vertexCount);
+		std::vector<std::uint8_t> bytes;
+		CHECK(PackIndices(indices, vertexCount, bytes) == DXGI_FORMAT_R16_UINT);
+		CHECK(SameValues<std::uint16_t>(indices, bytes));
+		CHECK(!CheckThrows(bytes, DXGI_FORMAT_R16_UINT, vertexCount));
+
+		// 65536 would wrap to 0 in 16 bits rather than fail on the GPU.
+		indices.back() = vertexCount;
+		CHECK(PackThrows(indices, vertexCount));
+
+		// Packed data read back, e.g. from the mesh cache, for fewer vertices.
+		CHECK(CheckThrows(bytes, DXGI_FORMAT_R16_UINT, vertexCount - 1));
+	}
+
+	//
+	// More than 65536 vertices: 32-bit, range-checked the same way.
+	//
+
+	{
+		const std::uint32_t vertexCount = 70000;
+		std::vector<std::uint32_t> indices = MakeIndices(vertexCount);
+		std::vector<std::uint8_t> bytes;
+		CHECK(PackIndices(indices, vertexCount, bytes) == DXGI_FORMAT_R32_UINT);
+		CHECK(SameValues<std::uint32_t>(indices, bytes));
+		CHECK(!CheckThrows(bytes, DXGI_FORMAT_R32_UINT, vertexCount));
+
+		indices.back() = vertexCount;
+		CHECK(PackThrows(indices, vertexCount));
+		indices.back() = 0xffffffff;
+		CHECK(PackThrows(indices, vertexCount));
+
+		CHECK(CheckThrows(bytes, DXGI_FORMAT_R32_UINT, vertexCount - 1));
+	}
+
+	//
+	// No indices.
+	//
+
+	{
+		std::vector<std::uint8_t> bytes;
+		CHECK(PackIndices(std::vector<std::uint32_t>(), 0, bytes) == DXGI_FORMAT_R16_UINT);
+		CHECK(bytes.empty());
+		CHECK(!CheckThrows(bytes, DXGI_FORMAT_R32_UINT, 0));
+	}
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("IndexPackingTests passed\n");
+	return 0;
+}
@@ -0,0 +1,162 @@
+//***************************************************************************************
+// TextureStreamerTests.cpp
+//
+// Drives TextureStreamer with NullTextureStreamBackend over a few 256 x 256 textures
+// whose requested sizes change from frame to frame.  Checks that the resident bytes
+// never exceed the budget, that the backend and the streamer agree on every texture's
+// resident mips, and that finer mips are loaded as a texture grows on screen and
+// evicted again when the budget needs them for another one.
+//***************************************************************************************
+
+#include "../Common/TextureStreamer.h"
+#include "Check.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const std::uint32_t Size = 256;
+	const std::uint32_t MipCount = 9;
+
+	// Header of an uncompressed RGBA8 DDS texture.  The streamer only reads the header;
+	// the null backend never looks at the pixels.
+	std::vector<std::uint8_t> MakeDds(std::uint32_t width, std::uint32_t height, std::uint32_t mipCount)
+	{
+		DDS_HEADER header;
+		std::memset(&header, 0, sizeof(header));
+		header.size = sizeof(DDS_HEADER);
+		header.flags = DDS_WIDTH | DDS_HEIGHT;
+		header.width = width;
+		header.height = height;
+		header.mipMapCount = mipCount;
+		header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+		header.ddspf.flags = DDS_RGB | 0x00000001; // DDPF_ALPHAPIXELS
+		header.ddspf.RGBBitCount = 32;
+		header.ddspf.RBitMask = 0x000000ff;
+		header.ddspf.GBitMask = 0x0000ff00;
+		header.ddspf.BBitMask = 0x00ff0000;
+		header.ddspf.ABitMask = 0xff000000;
+
+		std::vector<std::uint8_t> dds(sizeof(std::uint32_t) + sizeof(DDS_HEADER));
+		std::memcpy(dds.data(), &DDS_MAGIC, sizeof(std::uint32_t));
+		std::memcpy(dds.data() + sizeof(std::uint32_t), &header, sizeof(header));
+		return dds;
+	}
+
+	// Bytes of mips [firstMip, MipCount) of one texture.
+	std::uint64_t BytesFrom(std::uint32_t firstMip)
+	{
+		std::uint64_t bytes = 0;
+		for (std::uint32_t mip = firstMip; mip < MipCount; ++mip)
+		{
+			std::uint64_t side = Size >> mip;
+			bytes += side * side * 4;
+		}
+		return bytes;
+	}
+
+	// Runs frames updates with the same requests, checking the budget and that the
+	// backend holds what the streamer thinks after each.
+	void Run(TextureStreamer& streamer, const NullTextureStreamBackend& backend,
+		const std::vector<float>& sizes, int frames)
+	{
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (std::uint32_t id = 0; id < (std::uint32_t)sizes.size(); ++id)
+			{
+				if (sizes[id] > 0.0f)
+					streamer.Request(id, sizes[id]);
+			}
+			streamer.Update();
+
+			const TextureStreamer::Stats& stats = streamer.GetStats();
+			CHECK(stats.ResidentBytes <= stats.BudgetBytes);
+
+			std::uint64_t resident = 0;
+			for (std::uint32_t id = 0; id < streamer.GetTextureCount(); ++id)
+			{
+				const std::uint32_t mip = streamer.GetResidentMip(id);
+				CHECK(mip == MipCount || backend.GetResidentMip(id) == mip);
+				resident += BytesFrom(mip);
+			}
+			CHECK(resident == stats.ResidentBytes);
+		}
+	}
+}
+
+int main()
+{
+	//
+	// Mip selection.
+	//
+
+	CHECK(TextureStreamer::MipForScreenSize(Size, Size, 2, 256.0f) == 0);
+	CHECK(TextureStreamer::MipForScreenSize(Size, Size, 2, 1000.0f) == 0);
+	CHECK(TextureStreamer::MipForScreenSize(Size, Size, 2, 128.0f) == 1);
+	CHECK(TextureStreamer::MipForScreenSize(Size, Size, 2, 100.0f) == 1);
+	CHECK(TextureStreamer::MipForScreenSize(Size, Size, 2, 10.0f) == 2);
+	CHECK(TextureStreamer::MipForScreenSize(Size, Size, 2, 0.0f) == 2);
+
+	//
+	// Residency follows the requests within the budget.
+	//
+
+	// Room for one full texture and the tails of all three, not for two full ones.
+	const std::uint64_t budget = BytesFrom(0) + 2 * BytesFrom(2);
+	TextureStreamer streamer(budget, 64, 2);
+	NullTextureStreamBackend backend;
+	streamer.SetBackend(&backend);
+
+	std::vector<std::uint8_t> dds = MakeDds(Size, Size, MipCount);
+	for (int i = 0; i < 3; ++i)
+		CHECK(streamer.AddTexture("texture" + std::to_string(i), dds.data(), dds.size()) == (std::uint32_t)i);
+
+	const TextureStreamer::StreamedTexture& texture = streamer.GetTexture(0);
+	CHECK(texture.MipCount == MipCount && texture.TailMip == 2);
+	CHECK(streamer.GetResidentMip(0) == MipCount);
+
+	// Nothing on screen: only the tails are preloaded.
+	Run(streamer, backend, { 0.0f, 0.0f, 0.0f }, 2);
+	for (std::uint32_t id = 0; id < 3; ++id)
+		CHECK(streamer.GetResidentMip(id) == 2);
+	CHECK(streamer.GetStats().ResidentBytes == 3 * BytesFrom(2));
+
+	// Texture 0 grows on screen: promoted one step, then to full detail.
+	Run(streamer, backend, { 128.0f, 0.0f, 0.0f }, 2);
+	CHECK(streamer.GetResidentMip(0) == 1 && streamer.GetWantedMip(0) == 1);
+	Run(streamer, backend, { 256.0f, 0.0f, 0.0f }, 2);
+	CHECK(streamer.GetResidentMip(0) == 0);
+	CHECK(streamer.GetResidentMip(1) == 2 && streamer.GetResidentMip(2) == 2);
+
+	// Texture 1 takes over.  Texture 0 is still on screen but small, so its surplus
+	// mips go to make room; the tail of texture 2 fits alongside.
+	std::uint32_t evictions = streamer.GetStats().MipEvictions;
+	Run(streamer, backend, { 10.0f, 256.0f, 0.0f }, 3);
+	CHECK(streamer.GetResidentMip(0) == 2);
+	CHECK(streamer.GetResidentMip(1) == 0);
+	CHECK(streamer.GetResidentMip(2) == 2);
+	CHECK(streamer.GetStats().MipEvictions > evictions);
+
+	// Both wanted at full detail: only one fits, and the other settles for the finest
+	// mip that does.
+	Run(streamer, backend, { 256.0f, 256.0f, 0.0f }, 4);
+	CHECK(streamer.GetResidentMip(0) == 0 || streamer.GetResidentMip(1) == 0);
+	CHECK(streamer.GetResidentMip(0) != streamer.GetResidentMip(1));
+	CHECK(streamer.GetStats().ResidentBytes <= budget);
+
+	// Off screen, the textures keep the mips they have while nothing needs the memory;
+	// a texture that lost its tail gets it back from the spare budget.
+	const std::uint32_t resident0 = streamer.GetResidentMip(0);
+	const std::uint32_t resident1 = streamer.GetResidentMip(1);
+	Run(streamer, backend, { 0.0f, 0.0f, 0.0f }, 2);
+	CHECK(streamer.GetResidentMip(0) == resident0 && streamer.GetResidentMip(1) == resident1);
+	CHECK(streamer.GetResidentMip(2) <= 2);
+
+	CHECK(streamer.GetStats().FailedUpdates == 0);
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("TextureStreamerTests passed\n");
+	return 0;
+}
@@ -0,0 +1,256 @@
+//***************************************************************************************
+// VertexQuantizerTests.cpp
+//
+// Round-trips positions, octahedral normals and half float UVs through PackedVertex,
+// over random vertices and the edge cases (box faces and corners, flat boxes, axis
+// aligned normals, signed zeros, UVs outside [0, 1], half float subnormals and the
+// largest half).  Checks the worst error against the bounds VertexQuantizer.h
+// documents, and that Encode produces the same bits as EncodeScalar.
+//***************************************************************************************
+
+#include "../Common/VertexQuantizer.h"
+#include "Check.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	GeometryGenerator::Vertex MakeVertex(const XMFLOAT3& position, const XMFLOAT3& normal, const XMFLOAT2& texC)
+	{
+		return GeometryGenerator::Vertex(position, normal, XMFLOAT3(1.0f, 0.0f, 0.0f), texC);
+	}
+
+	// Angle between two directions in degrees, accurate for tiny angles.
+	double AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		double cx = (double)a.y * b.z - (double)a.z * b.y;
+		double cy = (double)a.z * b.x - (double)a.x * b.z;
+		double cz = (double)a.x * b.y - (double)a.y * b.x;
+		double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+		return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / 3.14159265358979323846;
+	}
+
+	// Half a quantisation step, plus float rounding in the encode and decode arithmetic.
+	float PositionBound(float center, float extents)
+	{
+		return extents / 65535.0f * 1.001f + 8.0f * FLT_EPSILON * (std::fabs(center) + extents) + FLT_MIN;
+	}
+
+	// Half a half-float step: 2^-11 relative for normal halves, 2^-25 for subnormals.
+	float HalfBound(float value)
+	{
+		return std::max(std::fabs(value) * (1.0f / 2048.0f), 1.0f / 33554432.0f);
+	}
+
+	void CheckBitsMatch(const std::vector<GeometryGenerator::Vertex>& vertices, const XMFLOAT3& center, const XMFLOAT3& extents)
+	{
+		std::vector<PackedVertex> simd(vertices.size());
+		std::vector<PackedVertex> scalar(vertices.size());
+		VertexQuantizer::Encode(vertices.data(), vertices.size(), center, extents, simd.data());
+		VertexQuantizer::EncodeScalar(vertices.data(), vertices.size(), center, extents, scalar.data());
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			if (memcmp(&simd[i], &scalar[i], sizeof(PackedVertex)) != 0 && mismatches++ == 0)
+			{
+				const GeometryGenerator::Vertex& v = vertices[i];
+				std::printf("vertex %zu (n %g %g %g, uv %g %g) encodes differently\n",
+					i, v.Normal.x, v.Normal.y, v.Normal.z, v.TexC.x, v.TexC.y);
+			}
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+int main()
+{
+	std::mt19937 random(33);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	//
+	// Positions.
+	//
+
+	struct Box
+	{
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+	};
+	const Box boxes[] =
+	{
+		{ XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) },
+		{ XMFLOAT3(3.0f, -2.0f, 10.0f), XMFLOAT3(5.0f, 0.25f, 100.0f) },
+		{ XMFLOAT3(-500.0f, 0.0f, 1.0f), XMFLOAT3(0.001f, 0.0f, 2048.0f) }, // flat in y
+	};
+
+	for (const Box& box : boxes)
+	{
+		const XMFLOAT3& c = box.Center;
+		const XMFLOAT3& e = box.Extents;
+
+		std::vector<GeometryGenerator::Vertex> vertices;
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			vertices.push_back(MakeVertex(XMFLOAT3(
+				c.x + (corner & 1 ? e.x : -e.x),
+				c.y + (corner & 2 ? e.y : -e.y),
+				c.z + (corner & 4 ? e.z : -e.z)),
+				XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f)));
+		}
+		vertices.push_back(MakeVertex(c, XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f)));
+		for (int i = 0; i < 10000; ++i)
+		{
+			vertices.push_back(MakeVertex(XMFLOAT3(c.x + unit(random) * e.x, c.y + unit(random) * e.y, c.z + unit(random) * e.z),
+				XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f)));
+		}
+
+		std::vector<PackedVertex> packed(vertices.size());
+		VertexQuantizer::Encode(vertices.data(), vertices.size(), c, e, packed.data());
+
+		const float bound[3] = { PositionBound(c.x, e.x), PositionBound(c.y, e.y), PositionBound(c.z, e.z) };
+
+		float worst[3] = {};
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			XMFLOAT3 p = VertexQuantizer::DecodePosition(packed[i], c, e);
+			worst[0] = std::max(worst[0], std::fabs(p.x - vertices[i].Position.x) / bound[0]);
+			worst[1] = std::max(worst[1], std::fabs(p.y - vertices[i].Position.y) / bound[1]);
+			worst[2] = std::max(worst[2], std::fabs(p.z - vertices[i].Position.z) / bound[2]);
+		}
+		std::printf("position: worst error %.3f %.3f %.3f of the bound\n", worst[0], worst[1], worst[2]);
+		CHECK(worst[0] <= 1.0f && worst[1] <= 1.0f && worst[2] <= 1.0f);
+
+		// Positions outside the box clamp to its faces.
+		GeometryGenerator::Vertex outside = MakeVertex(XMFLOAT3(c.x + 4.0f * e.x + 1.0f, c.y - 4.0f * e.y - 1.0f, c.z),
+			XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f));
+		PackedVertex clamped;
+		VertexQuantizer::Encode(&outside, 1, c, e, &clamped);
+		CHECK(clamped.Position[0] == (e.x > 0.0f ? 65535 : 32767));
+		CHECK(clamped.Position[1] == (e.y > 0.0f ? 0 : 32767));
+
+		CheckBitsMatch(vertices, c, e);
+	}
+
+	//
+	// Normals.
+	//
+
+	std::vector<GeometryGenerator::Vertex> normals;
+	const float axes[] = { 1.0f, -1.0f, 0.0f, -0.0f };
+	for (float x : axes)
+	{
+		for (float y : axes)
+		{
+			for (float z : axes)
+			{
+				if (x != 0.0f || y != 0.0f || z != 0.0f)
+				{
+					float length = std::sqrt(x * x + y * y + z * z);
+					normals.push_back(MakeVertex(XMFLOAT3(0.0f, 0.0f, 0.0f),
+						XMFLOAT3(x / length, y / length, z / length), XMFLOAT2(0.0f, 0.0f)));
+				}
+			}
+		}
+	}
+	for (int i = 0; i < 100000; ++i)
+	{
+		XMFLOAT3 n(unit(random), unit(random), unit(random));
+		float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+		if (length < 1e-3f)
+			continue;
+		normals.push_back(MakeVertex(XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT3(n.x / length, n.y / length, n.z / length), XMFLOAT2(0.0f, 0.0f)));
+	}
+
+	{
+		std::vector<PackedVertex> packed(normals.size());
+		VertexQuantizer::Encode(normals.data(), normals.size(), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), packed.data());
+
+		double worst = 0.0;
+		for (size_t i = 0; i < normals.size(); ++i)
+			worst = std::max(worst, AngleDegrees(VertexQuantizer::DecodeNormal(packed[i]), normals[i].Normal));
+
+		std::printf("normal: worst error %.5f degrees, bound 0.05\n", worst);
+		CHECK(worst < 0.05);
+
+		CheckBitsMatch(normals, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	}
+
+	//
+	// Texture coordinates.
+	//
+
+	std::vector<GeometryGenerator::Vertex> texCs;
+	const float edgeUVs[] =
+	{
+		0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 0.99999f, 1.00001f, 2.0f, -3.75f, 17.3f, 1000.25f, -2048.5f,
+		65504.0f, -65504.0f,                 // largest finite half
+		6.103515625e-05f, 6.0e-05f, 1.0e-05f, // smallest normal half and subnormals below it
+		5.96e-08f, 1.0e-09f,                 // smallest subnormal half and below
+	};
+	for (float u : edgeUVs)
+	{
+		for (float v : edgeUVs)
+			texCs.push_back(MakeVertex(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(u, v)));
+	}
+	std::uniform_real_distribution<float> wide(-8.0f, 8.0f);
+	for (int i = 0; i < 100000; ++i)
+	{
+		texCs.push_back(MakeVertex(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f),
+			XMFLOAT2(wide(random), (unit(random) + 1.0f) * 0.5f)));
+	}
+
+	{
+		std::vector<PackedVertex> packed(texCs.size());
+		VertexQuantizer::Encode(texCs.data(), texCs.size(), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), packed.data());
+
+		float worst = 0.0f;
+		for (size_t i = 0; i < texCs.size(); ++i)
+		{
+			XMFLOAT2 uv = VertexQuantizer::DecodeTexC(packed[i]);
+			worst = std::max(worst, std::fabs(uv.x - texCs[i].TexC.x) / HalfBound(texCs[i].TexC.x));
+			worst = std::max(worst, std::fabs(uv.y - texCs[i].TexC.y) / HalfBound(texCs[i].TexC.y));
+		}
+		std::printf("uv: worst error %.3f of the bound\n", worst);
+		CHECK(worst <= 1.0f);
+
+		CheckBitsMatch(texCs, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	}
+
+	// Signed zeros keep their sign, and values beyond the half range become infinities.
+	CHECK(VertexQuantizer::FloatToHalf(0.0f) == 0x0000);
+	CHECK(VertexQuantizer::FloatToHalf(-0.0f) == 0x8000);
+	CHECK(std::signbit(VertexQuantizer::HalfToFloat(0x8000)));
+	CHECK(VertexQuantizer::FloatToHalf(65520.0f) == 0x7c00);
+	CHECK(VertexQuantizer::FloatToHalf(-1.0e6f) == 0xfc00);
+	CHECK(VertexQuantizer::HalfToFloat(0x7bff) == 65504.0f);
+
+	// Every half converts back to itself.
+	for (std::uint32_t h = 0; h < 0x10000; ++h)
+	{
+		if ((h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0)
+			continue; // NaN payloads are not kept
+		if (VertexQuantizer::FloatToHalf(VertexQuantizer::HalfToFloat((std::uint16_t)h)) != h)
+		{
+			CHECK(!"half round trip");
+			break;
+		}
+	}
+
+	// Tails that are not a multiple of four go through the same kernel.
+	std::vector<GeometryGenerator::Vertex> tail(normals.begin(), normals.begin() + 7);
+	CheckBitsMatch(tail, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+
+	if (CheckFailures() != 0)
+		return 1;
+
+	std::printf("VertexQuantizerTests passed\n");
+	return 0;
+}